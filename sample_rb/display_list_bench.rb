@@ -0,0 +1,39 @@
+# DisplayList benchmark: a 200 primitive dashboard drawn directly from Ruby
+# and replayed from a DisplayList.
+
+def dashboard(g)
+  20.times do |i|
+    x = (i % 5) * 26
+    y = (i / 5) * 30
+    g.fill_rect(x, y, 24, 28, 0x2104)
+    g.draw_rect(x, y, 24, 28, 0xffff)
+    g.draw_line(x, y + 27, x + 23, y, 0x07e0)
+    g.fill_circle(x + 12, y + 14, 6, 0xf800)
+    g.draw_circle(x + 12, y + 14, 9, 0xffe0)
+    g.draw_line(x, y, x + 23, y + 27, 0x001f)
+    g.fill_rect(x + 2, y + 2, 4, 4, 0xf81f)
+    g.fill_rect(x + 18, y + 2, 4, 4, 0x07ff)
+    g.draw_line(x + 12, y, x + 12, y + 27, 0x8410)
+    g.draw_line(x, y + 14, x + 23, y + 14, 0x8410)
+  end
+end
+
+FRAMES = 20
+
+t = Utils.millis
+FRAMES.times do
+  Display.start_write
+  dashboard(Display)
+  Display.end_write
+end
+puts "direct: #{(Utils.millis - t) / FRAMES} ticks/frame"
+
+list = DisplayList.new
+dashboard(list)
+puts "list: #{list.size} primitives, #{list.bytes} bytes"
+us = 0
+FRAMES.times do
+  us += list.run
+end
+puts "DisplayList: #{us / FRAMES} us/frame"
+list.destroy
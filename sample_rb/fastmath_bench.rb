@@ -0,0 +1,30 @@
+# FastMath benchmark: speed and largest error against Math for the calls
+# mexicanhat.rb makes per frame.
+
+N = 3700
+
+xs = []
+N.times { |i| xs << i * 0.01 }
+
+t = Utils.millis
+xs.each { |x| Math.cos(x); Math.sqrt(x) }
+puts "Math: #{Utils.millis - t} ticks"
+
+t = Utils.millis
+xs.each { |x| FastMath.cos(x); FastMath.sqrt(x) }
+puts "FastMath: #{Utils.millis - t} ticks"
+
+t = Utils.millis
+FastMath.cos_array(xs)
+FastMath.sqrt_array(xs)
+puts "FastMath arrays: #{Utils.millis - t} ticks"
+
+err_cos = 0.0
+err_sqrt = 0.0
+xs.each do |x|
+  e = (FastMath.cos(x) - Math.cos(x)).abs
+  err_cos = e if e > err_cos
+  e = (FastMath.sqrt(x) - Math.sqrt(x)).abs / (Math.sqrt(x) + 1)
+  err_sqrt = e if e > err_sqrt
+end
+puts "max error cos: #{err_cos}, sqrt (relative): #{err_sqrt}"
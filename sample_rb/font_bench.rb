@@ -0,0 +1,27 @@
+# Font switching benchmark.
+# Build with USE_LGFX_BUILTIN_FONTS to register all LovyanGFX built-in fonts.
+
+LOOPS = 1000
+names = Font.names
+puts "fonts registered: #{Font.count}"
+
+t = Utils.millis
+LOOPS.times do |i|
+  Display.set_font(names[i % names.size])
+end
+puts "set_font(name):   #{Utils.millis - t} ticks / #{LOOPS}"
+
+t = Utils.millis
+LOOPS.times do |i|
+  Display.set_font(i % names.size)
+end
+puts "set_font(number): #{Utils.millis - t} ticks / #{LOOPS}"
+
+fonts = names.map { |n| Font.get(n) }
+t = Utils.millis
+LOOPS.times do |i|
+  Display.set_font(fonts[i % fonts.size])
+end
+puts "set_font(Font):   #{Utils.millis - t} ticks / #{LOOPS}"
+
+Display.set_font(0)
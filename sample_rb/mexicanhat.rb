@@ -27,8 +27,8 @@ while true do
   (-30..30).each do |by|
     (-30..30).each do |bx|
       x=bx*6; y=by*6
-      r=dr*Math.sqrt(x*x+y*y)
-      z=100*Math.cos(r) - 30*Math.cos(3*r)
+      r=dr*FastMath.sqrt(x*x+y*y)
+      z=100*FastMath.cos(r) - 30*FastMath.cos(3*r)
       sx=(80+x/3-y/6).to_i
       sy=(40-y/6-z/4).to_i
       if sx>=0 && x<160 then
@@ -0,0 +1,35 @@
+# PWM benchmark: duty updates per second through set_duty (percent),
+# set_duty_raw and set_duties, and the set_duties latency. Connect nothing,
+# or LEDs, to the pins.
+# Utils.millis counts FreeRTOS ticks, 10 ms each with CONFIG_FREERTOS_HZ=100.
+
+PIN = 2
+N = 2000
+TICK_MS = 10
+
+ch = PWM.setup(PIN, 0)
+max = PWM.max_duty(ch)
+
+t = Utils.millis
+N.times { |i| PWM.set_duty(ch, i % 101) }
+ticks = Utils.millis - t
+puts "set_duty: #{ticks} ticks, #{N * 1000 / (ticks * TICK_MS + 1)} updates/s"
+
+t = Utils.millis
+N.times { |i| PWM.set_duty_raw(ch, i % (max + 1)) }
+ticks = Utils.millis - t
+puts "set_duty_raw: #{ticks} ticks, #{N * 1000 / (ticks * TICK_MS + 1)} updates/s"
+
+ch2 = PWM.setup(PIN + 1, 0)
+t = Utils.millis
+N.times { |i| PWM.set_duties([[ch, i % (max + 1)], [ch2, max - i % (max + 1)]]) }
+ticks = Utils.millis - t
+puts "set_duties (2 ch): #{ticks} ticks, #{N * 1000 / (ticks * TICK_MS + 1)} batches/s"
+lat = PWM.latency
+puts "set_duties latency: last #{lat[1]} us, max #{lat[2]} us, then up to #{lat[3]} us for the next period"
+PWM.disable(ch2)
+
+PWM.fade(ch, max, 1000)
+puts "fading in hardware for 1s"
+sleep_ms 1100  # the ESP32 refuses disable until the fade ends
+PWM.disable(ch)
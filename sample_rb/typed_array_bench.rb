@@ -0,0 +1,33 @@
+# Int16Array benchmark: the mexicanhat.rb depth buffer as an Array and as an
+# Int16Array. The Array keeps one mrbc_value (8-16 bytes) per element, the
+# Int16Array 2 bytes.
+
+N = 160
+LOOPS = 200
+
+t = Utils.millis
+LOOPS.times do
+  d = Array.new(N, 100)
+  s = 0
+  d.each { |x| s += x }
+end
+puts "Array: #{Utils.millis - t} ticks"
+
+t = Utils.millis
+LOOPS.times do
+  d = Int16Array.new(N, 100)
+  d.sum
+end
+puts "Int16Array: #{Utils.millis - t} ticks"
+
+d = Int16Array.new(N, 100)
+puts "Int16Array bytes: #{d.bytesize}"
+d.map!(:*, 3).map!(:min, 250)
+puts "max #{d.max}, min #{d.min}"
+
+pts = Int16Array.new(2 * 64)
+64.times do |i|
+  pts[2 * i] = i * 2
+  pts[2 * i + 1] = 40 + FastMath.isin(i * 64) * 30 / 4096
+end
+Display.draw_points(pts, 0xffe0)
@@ -0,0 +1,283 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file fastmath.c
+ * @brief Implementation of FastMath API for mruby/c
+ *
+ * Implements the FastMath class and its methods for the mruby/c VM. Math
+ * goes through double precision libm, which is emulated in software on the
+ * ESP32; FastMath uses lib/fastmath instead. The *_array methods take an
+ * Array and return an Array, so a whole row costs one method call.
+ */
+#include "fastmath.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../lib/fastmath/fastmath.h"
+#include "../lib/fn.h"
+#include "mrubyc.h"
+
+/**
+ * @brief Forward declarations for the mruby/c method implementations
+ */
+static void c_fastmath_sin(mrb_vm *vm, mrb_value *v, int argc);
+static void c_fastmath_cos(mrb_vm *vm, mrb_value *v, int argc);
+static void c_fastmath_sqrt(mrb_vm *vm, mrb_value *v, int argc);
+static void c_fastmath_atan2(mrb_vm *vm, mrb_value *v, int argc);
+static void c_fastmath_isin(mrb_vm *vm, mrb_value *v, int argc);
+static void c_fastmath_icos(mrb_vm *vm, mrb_value *v, int argc);
+static void c_fastmath_isqrt(mrb_vm *vm, mrb_value *v, int argc);
+static void c_fastmath_iatan2(mrb_vm *vm, mrb_value *v, int argc);
+static void c_fastmath_sin_array(mrb_vm *vm, mrb_value *v, int argc);
+static void c_fastmath_cos_array(mrb_vm *vm, mrb_value *v, int argc);
+static void c_fastmath_sqrt_array(mrb_vm *vm, mrb_value *v, int argc);
+static void c_fastmath_atan2_array(mrb_vm *vm, mrb_value *v, int argc);
+
+/**
+ * @brief Defines the FastMath class and methods for mruby/c
+ *
+ * @return kSuccess always
+ */
+fn_t api_fastmath_define(void) {
+  mrb_class *class_fastmath;
+  class_fastmath = mrbc_define_class(0, "FastMath", mrbc_class_object);
+  mrbc_define_method(0, class_fastmath, "sin", c_fastmath_sin);
+  mrbc_define_method(0, class_fastmath, "cos", c_fastmath_cos);
+  mrbc_define_method(0, class_fastmath, "sqrt", c_fastmath_sqrt);
+  mrbc_define_method(0, class_fastmath, "atan2", c_fastmath_atan2);
+  mrbc_define_method(0, class_fastmath, "isin", c_fastmath_isin);
+  mrbc_define_method(0, class_fastmath, "icos", c_fastmath_icos);
+  mrbc_define_method(0, class_fastmath, "isqrt", c_fastmath_isqrt);
+  mrbc_define_method(0, class_fastmath, "iatan2", c_fastmath_iatan2);
+  mrbc_define_method(0, class_fastmath, "sin_array", c_fastmath_sin_array);
+  mrbc_define_method(0, class_fastmath, "cos_array", c_fastmath_cos_array);
+  mrbc_define_method(0, class_fastmath, "sqrt_array", c_fastmath_sqrt_array);
+  mrbc_define_method(0, class_fastmath, "atan2_array", c_fastmath_atan2_array);
+  return kSuccess;
+}
+
+/**
+ * @brief Converts an Integer or Float argument to float
+ *
+ * @param vm Pointer to the mruby/c VM
+ * @param val Value to convert
+ * @param out Converted value
+ * @return true on success; an ArgumentError has been raised otherwise
+ */
+static bool to_float(mrb_vm *vm, const mrb_value *val, float *out) {
+  switch (val->tt) {
+    case MRBC_TT_INTEGER:
+      *out = (float)val->i;
+      return true;
+    case MRBC_TT_FLOAT:
+      *out = (float)val->d;
+      return true;
+    default:
+      mrbc_raise(vm, MRBC_CLASS(ArgumentError), "not a number");
+      return false;
+  }
+}
+
+/**
+ * @brief Converts an Integer or Float argument to an integer
+ *
+ * @return true on success; an ArgumentError has been raised otherwise
+ */
+static bool to_int(mrb_vm *vm, const mrb_value *val, int32_t *out) {
+  switch (val->tt) {
+    case MRBC_TT_INTEGER:
+      *out = (int32_t)val->i;
+      return true;
+    case MRBC_TT_FLOAT:
+      *out = (int32_t)val->d;
+      return true;
+    default:
+      mrbc_raise(vm, MRBC_CLASS(ArgumentError), "not a number");
+      return false;
+  }
+}
+
+/**
+ * @brief Shared body of the one-argument Float methods
+ */
+static void float_unary(mrb_vm *vm, mrb_value *v, int argc,
+                        float (*fn)(float)) {
+  float x;
+  if (argc < 1) {
+    mrbc_raise(vm, MRBC_CLASS(ArgumentError), "wrong number of arguments");
+    return;
+  }
+  if (to_float(vm, &v[1], &x)) {
+    SET_FLOAT_RETURN(fn(x));
+  }
+}
+
+/**
+ * @brief Shared body of the *_array methods with one argument
+ *
+ * Returns a new Array holding fn applied to each element of the argument.
+ */
+static void float_unary_array(mrb_vm *vm, mrb_value *v, int argc,
+                              float (*fn)(float)) {
+  if (argc < 1 || v[1].tt != MRBC_TT_ARRAY) {
+    mrbc_raise(vm, MRBC_CLASS(ArgumentError), "not an array");
+    return;
+  }
+  int n = mrbc_array_size(&v[1]);
+  mrbc_value ret = mrbc_array_new(vm, n);
+  for (int i = 0; i < n; i++) {
+    mrbc_value e = mrbc_array_get(&v[1], i);
+    float x;
+    if (!to_float(vm, &e, &x)) {
+      mrbc_decref(&ret);
+      return;
+    }
+    mrbc_value r = mrbc_float_value(vm, fn(x));
+    mrbc_array_set(&ret, i, &r);
+  }
+  SET_RETURN(ret);
+}
+
+/**
+ * @brief FastMath.sin(rad): sine as a Float
+ */
+static void c_fastmath_sin(mrb_vm *vm, mrb_value *v, int argc) {
+  float_unary(vm, v, argc, fastmath_sinf);
+}
+
+/**
+ * @brief FastMath.cos(rad): cosine as a Float
+ */
+static void c_fastmath_cos(mrb_vm *vm, mrb_value *v, int argc) {
+  float_unary(vm, v, argc, fastmath_cosf);
+}
+
+/**
+ * @brief FastMath.sqrt(x): square root as a Float, 0 for negative x
+ */
+static void c_fastmath_sqrt(mrb_vm *vm, mrb_value *v, int argc) {
+  float_unary(vm, v, argc, fastmath_sqrtf);
+}
+
+/**
+ * @brief FastMath.atan2(y, x): angle in radians as a Float
+ */
+static void c_fastmath_atan2(mrb_vm *vm, mrb_value *v, int argc) {
+  float y, x;
+  if (argc < 2) {
+    mrbc_raise(vm, MRBC_CLASS(ArgumentError), "wrong number of arguments");
+    return;
+  }
+  if (to_float(vm, &v[1], &y) && to_float(vm, &v[2], &x)) {
+    SET_FLOAT_RETURN(fastmath_atan2f(y, x));
+  }
+}
+
+/**
+ * @brief FastMath.isin(angle): fixed-point sine
+ *
+ * The angle is in 1/4096 turns and the result is scaled by 4096.
+ */
+static void c_fastmath_isin(mrb_vm *vm, mrb_value *v, int argc) {
+  int32_t a;
+  if (argc < 1) {
+    mrbc_raise(vm, MRBC_CLASS(ArgumentError), "wrong number of arguments");
+    return;
+  }
+  if (to_int(vm, &v[1], &a)) {
+    SET_INT_RETURN(fastmath_isin(a));
+  }
+}
+
+/**
+ * @brief FastMath.icos(angle): fixed-point cosine, see isin
+ */
+static void c_fastmath_icos(mrb_vm *vm, mrb_value *v, int argc) {
+  int32_t a;
+  if (argc < 1) {
+    mrbc_raise(vm, MRBC_CLASS(ArgumentError), "wrong number of arguments");
+    return;
+  }
+  if (to_int(vm, &v[1], &a)) {
+    SET_INT_RETURN(fastmath_icos(a));
+  }
+}
+
+/**
+ * @brief FastMath.isqrt(n): integer square root, 0 for negative n
+ */
+static void c_fastmath_isqrt(mrb_vm *vm, mrb_value *v, int argc) {
+  int32_t n;
+  if (argc < 1) {
+    mrbc_raise(vm, MRBC_CLASS(ArgumentError), "wrong number of arguments");
+    return;
+  }
+  if (to_int(vm, &v[1], &n)) {
+    SET_INT_RETURN((n > 0) ? fastmath_isqrt((uint32_t)n) : 0);
+  }
+}
+
+/**
+ * @brief FastMath.iatan2(y, x): angle in 1/4096 turns (-2048 to 2048)
+ */
+static void c_fastmath_iatan2(mrb_vm *vm, mrb_value *v, int argc) {
+  int32_t y, x;
+  if (argc < 2) {
+    mrbc_raise(vm, MRBC_CLASS(ArgumentError), "wrong number of arguments");
+    return;
+  }
+  if (to_int(vm, &v[1], &y) && to_int(vm, &v[2], &x)) {
+    SET_INT_RETURN(fastmath_iatan2(y, x));
+  }
+}
+
+/**
+ * @brief FastMath.sin_array(array): sine of each element
+ */
+static void c_fastmath_sin_array(mrb_vm *vm, mrb_value *v, int argc) {
+  float_unary_array(vm, v, argc, fastmath_sinf);
+}
+
+/**
+ * @brief FastMath.cos_array(array): cosine of each element
+ */
+static void c_fastmath_cos_array(mrb_vm *vm, mrb_value *v, int argc) {
+  float_unary_array(vm, v, argc, fastmath_cosf);
+}
+
+/**
+ * @brief FastMath.sqrt_array(array): square root of each element
+ */
+static void c_fastmath_sqrt_array(mrb_vm *vm, mrb_value *v, int argc) {
+  float_unary_array(vm, v, argc, fastmath_sqrtf);
+}
+
+/**
+ * @brief FastMath.atan2_array(ys, xs): atan2 of each pair of elements
+ *
+ * The result has the length of the shorter Array.
+ */
+static void c_fastmath_atan2_array(mrb_vm *vm, mrb_value *v, int argc) {
+  if (argc < 2 || v[1].tt != MRBC_TT_ARRAY || v[2].tt != MRBC_TT_ARRAY) {
+    mrbc_raise(vm, MRBC_CLASS(ArgumentError), "not an array");
+    return;
+  }
+  int n = mrbc_array_size(&v[1]);
+  if (mrbc_array_size(&v[2]) < n) n = mrbc_array_size(&v[2]);
+  mrbc_value ret = mrbc_array_new(vm, n);
+  for (int i = 0; i < n; i++) {
+    mrbc_value ey = mrbc_array_get(&v[1], i);
+    mrbc_value ex = mrbc_array_get(&v[2], i);
+    float y, x;
+    if (!to_float(vm, &ey, &y) || !to_float(vm, &ex, &x)) {
+      mrbc_decref(&ret);
+      return;
+    }
+    mrbc_value r = mrbc_float_value(vm, fastmath_atan2f(y, x));
+    mrbc_array_set(&ret, i, &r);
+  }
+  SET_RETURN(ret);
+}
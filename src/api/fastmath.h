@@ -0,0 +1,27 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file fastmath.h
+ * @brief API interface for FastMath functionality in mruby/c
+ *
+ * Defines the interface for the FastMath class in mruby/c, which provides
+ * table-driven single precision and fixed-point math for graphics loops.
+ */
+#ifndef API_FASTMATH_H
+#define API_FASTMATH_H
+
+#include "../lib/fn.h"
+
+/**
+ * @brief Defines the FastMath class and methods for mruby/c
+ *
+ * Creates the FastMath class and registers sin, cos, sqrt, atan2, their
+ * fixed-point and Array variants.
+ *
+ * @return kSuccess always
+ */
+fn_t api_fastmath_define(void);
+
+#endif
@@ -8,6 +8,8 @@
  *
  * Implements the Input class and its methods for the mruby/c VM,
  * providing functionality to check button states on the M5Stack hardware.
+ * The buttons are read by the sampler in drv/input.cpp, which debounces
+ * them and queues press and release edges.
  */
 #include "input.h"
 
@@ -15,7 +17,18 @@
 #include <stdbool.h>
 
 #include "../../mrubyc/src/mrubyc.h"
+#include "../drv/input.h"
 #include "../lib/fn.h"
+#include "esp_timer.h"
+
+#define INPUT_WAIT_DEFAULT_MS 1000
+
+// Ruby task waiting in wait_event, and its timeout
+static mrbc_tcb *input_waiter = NULL;
+static esp_timer_handle_t input_wait_timer = NULL;
+// release counts already reported by was_released?
+static uint32_t input_seen_releases[INPUT_BUTTONS];
+static bool input_started = false;
 
 /**
  * @brief Forward declarations for the mruby/c method implementations
@@ -26,12 +39,34 @@
  */
 static void c_get_sw_pressed(mrb_vm *vm, mrb_value *v, int argc);
 static void c_get_sw_released(mrb_vm *vm, mrb_value *v, int argc);
+static void c_get_sw_was_released(mrb_vm *vm, mrb_value *v, int argc);
+static void c_input_events(mrb_vm *vm, mrb_value *v, int argc);
+static void c_input_wait_event(mrb_vm *vm, mrb_value *v, int argc);
+static void c_input_configure(mrb_vm *vm, mrb_value *v, int argc);
+static void c_input_stats(mrb_vm *vm, mrb_value *v, int argc);
+
+/**
+ * @brief Resumes the Ruby task waiting in wait_event
+ *
+ * Called from the sampler task when an edge is queued, and from the
+ * esp_timer task on timeout.
+ */
+static void input_wake_waiter(void *arg) {
+  hal_disable_irq();
+  mrbc_tcb *tcb = input_waiter;
+  input_waiter = NULL;
+  hal_enable_irq();
+  if (tcb == NULL) return;
+  esp_timer_stop(input_wait_timer);
+  mrbc_resume_task(tcb);
+}
 
 /**
  * @brief Defines the Input class and methods for mruby/c
  *
- * Creates the Input class and registers the pressed? and released? methods
- * which allow Ruby code to check button states.
+ * Creates the Input class and registers the pressed?, released?,
+ * was_released?, events, wait_event, configure and stats methods which
+ * allow Ruby code to check button states.
  *
  * @return kSuccess always
  */
@@ -40,21 +75,71 @@ fn_t api_input_define(void) {
   class_input = mrbc_define_class(0, "Input", mrbc_class_object);
   mrbc_define_method(0, class_input, "pressed?", c_get_sw_pressed);
   mrbc_define_method(0, class_input, "released?", c_get_sw_released);
+  mrbc_define_method(0, class_input, "was_released?", c_get_sw_was_released);
+  mrbc_define_method(0, class_input, "events", c_input_events);
+  mrbc_define_method(0, class_input, "wait_event", c_input_wait_event);
+  mrbc_define_method(0, class_input, "configure", c_input_configure);
+  mrbc_define_method(0, class_input, "stats", c_input_stats);
+
+  // The tasks of the previous VM are gone, and so is interest in its edges.
+  // The sampler stops too, until the new script uses Input.
+  drv_input_stop();
+  input_started = false;
+  if (input_wait_timer != NULL) esp_timer_stop(input_wait_timer);
+  hal_disable_irq();
+  input_waiter = NULL;
+  hal_enable_irq();
+  drv_input_flush();
+  for (int i = 0; i < INPUT_BUTTONS; i++) {
+    input_seen_releases[i] = drv_input_release_count(i);
+  }
   return kSuccess;
 }
 
+/**
+ * @brief Starts the sampler with the default timing on first use
+ *
+ * Once it runs the sampler calls M5.update() every period, so the M5
+ * button latches such as wasPressed() only last until the next sample.
+ * Scripts that never use Input keep calling M5.update() on their own, as
+ * the sampler is stopped whenever the VM is reloaded.
+ *
+ * @return true if the sampler is running
+ */
+static bool input_start(void) {
+  if (!input_started) {
+    input_started = kSuccess == drv_input_start(INPUT_DEFAULT_PERIOD_MS,
+                                                INPUT_DEFAULT_DEBOUNCE_MS);
+  }
+  return input_started;
+}
+
+/**
+ * @brief Returns the button number argument (default A)
+ *
+ * @return Button number, or -1 if it is invalid
+ */
+static int get_button(mrb_value *v, int argc) {
+  if (argc < 1) return 0;
+  if (v[1].tt != MRBC_TT_INTEGER || v[1].i < 0 || v[1].i >= INPUT_BUTTONS) {
+    return -1;
+  }
+  return v[1].i;
+}
+
 /**
  * @brief Implementation of the pressed? method for the Input class
  *
- * Checks if the button A is currently pressed.
+ * Checks if a button (A by default) is currently pressed, from the
+ * debounced level kept by the sampler.
  *
  * @param vm Pointer to the mruby/c VM
  * @param v Pointer to the method arguments
  * @param argc Number of arguments
  */
 static void c_get_sw_pressed(mrb_vm *vm, mrb_value *v, int argc) {
-  M5.update();
-  if (true == M5.BtnA.isPressed()) {
+  int button = get_button(v, argc);
+  if (button >= 0 && input_start() && drv_input_pressed(button)) {
     SET_TRUE_RETURN();
   } else {
     SET_FALSE_RETURN();
@@ -64,17 +149,194 @@ static void c_get_sw_pressed(mrb_vm *vm, mrb_value *v, int argc) {
 /**
  * @brief Implementation of the released? method for the Input class
  *
- * Checks if the button A was just released.
+ * Checks if a button (A by default) is currently not pressed, from the
+ * debounced level kept by the sampler.
  *
  * @param vm Pointer to the mruby/c VM
  * @param v Pointer to the method arguments
  * @param argc Number of arguments
  */
 static void c_get_sw_released(mrb_vm *vm, mrb_value *v, int argc) {
-  M5.update();
-  if (true == M5.BtnA.isReleased()) {
+  int button = get_button(v, argc);
+  if (button >= 0 && input_start() && !drv_input_pressed(button)) {
     SET_TRUE_RETURN();
   } else {
     SET_FALSE_RETURN();
   }
 }
+
+/**
+ * @brief Implementation of the was_released? method for the Input class
+ *
+ * Checks if a button (A by default) has been released since the last call.
+ * A release that happened between two calls is not missed.
+ *
+ * @param vm Pointer to the mruby/c VM
+ * @param v Pointer to the method arguments
+ * @param argc Number of arguments
+ */
+static void c_get_sw_was_released(mrb_vm *vm, mrb_value *v, int argc) {
+  int button = get_button(v, argc);
+  if (button < 0 || !input_start()) {
+    SET_FALSE_RETURN();
+    return;
+  }
+  uint32_t releases = drv_input_release_count(button);
+  if (releases != input_seen_releases[button]) {
+    input_seen_releases[button] = releases;
+    SET_TRUE_RETURN();
+  } else {
+    SET_FALSE_RETURN();
+  }
+}
+
+/**
+ * @brief Implementation of the events method for the Input class
+ *
+ * Takes every queued edge. Each one is [button, pressed, time_ms], where
+ * button is 0 to 2 for A to C, pressed is true for a press and false for
+ * a release, and time_ms is when the button started to change, in
+ * milliseconds since boot.
+ *
+ * @param vm Pointer to the mruby/c VM
+ * @param v Pointer to the method arguments
+ * @param argc Number of arguments
+ */
+static void c_input_events(mrb_vm *vm, mrb_value *v, int argc) {
+  input_start();
+  mrbc_value ret = mrbc_array_new(vm, drv_input_pending());
+  drv_input_event_t event;
+  int n = 0;
+  while (drv_input_next(&event)) {
+    mrbc_value e = mrbc_array_new(vm, 3);
+    mrbc_value button = mrbc_fixnum_value(event.button);
+    mrbc_value pressed = mrbc_bool_value(event.pressed);
+    mrbc_value time_ms = mrbc_fixnum_value((int32_t)(event.time_us / 1000));
+    mrbc_array_set(&e, 0, &button);
+    mrbc_array_set(&e, 1, &pressed);
+    mrbc_array_set(&e, 2, &time_ms);
+    mrbc_array_set(&ret, n++, &e);
+  }
+  SET_RETURN(ret);
+}
+
+/**
+ * @brief Implementation of the wait_event method for the Input class
+ *
+ * Stops only the calling Ruby task until an edge is queued, or until the
+ * timeout (1000ms by default) passes. Other Ruby tasks keep running.
+ * Returns true if an edge is already queued (no wait), nil if it waited
+ * (check with events after it resumes), false on error.
+ *
+ * @param vm Pointer to the mruby/c VM
+ * @param v Pointer to the method arguments
+ * @param argc Number of arguments
+ */
+static void c_input_wait_event(mrb_vm *vm, mrb_value *v, int argc) {
+  SET_FALSE_RETURN();
+  uint32_t timeout_ms = INPUT_WAIT_DEFAULT_MS;
+  if (argc >= 1 && v[1].tt == MRBC_TT_INTEGER) {
+    timeout_ms = (v[1].i < 0) ? 0 : (uint32_t)v[1].i;
+  }
+  if (!input_start()) return;
+  if (input_wait_timer == NULL) {
+    const esp_timer_create_args_t args = {
+        .callback = input_wake_waiter,
+        .name = "input_wait",
+    };
+    if (esp_timer_create(&args, &input_wait_timer) != ESP_OK) {
+      input_wait_timer = NULL;
+      return;
+    }
+    drv_input_set_notify(input_wake_waiter, NULL);
+  }
+
+  mrbc_tcb *tcb = VM2TCB(vm);
+
+  // Register before checking the queue, so an edge in between wakes us
+  hal_disable_irq();
+  if (input_waiter != NULL) {
+    hal_enable_irq();
+    return;  // another task is waiting
+  }
+  input_waiter = tcb;
+  hal_enable_irq();
+
+  // Arm the timeout before suspending. Armed afterwards, an edge in between
+  // would stop a timer that is not running yet and leave it to wake the
+  // next wait early. Every path that does not suspend stops it.
+  if (timeout_ms > 0) {
+    esp_timer_stop(input_wait_timer);
+    esp_timer_start_once(input_wait_timer, (uint64_t)timeout_ms * 1000);
+  }
+
+  bool ready = drv_input_pending() > 0;
+
+  hal_disable_irq();
+  if (input_waiter != tcb) {
+    // the sampler (an edge was queued) or the timeout took the registration
+    hal_enable_irq();
+    esp_timer_stop(input_wait_timer);
+    if (ready || drv_input_pending() > 0) {
+      SET_TRUE_RETURN();
+    } else {
+      SET_NIL_RETURN();  // timed out before the task was stopped
+    }
+    return;
+  }
+  if (ready || timeout_ms == 0) {
+    input_waiter = NULL;
+    hal_enable_irq();
+    esp_timer_stop(input_wait_timer);
+    if (ready) SET_TRUE_RETURN();
+    return;
+  }
+  mrbc_suspend_task(tcb);
+  hal_enable_irq();
+  SET_NIL_RETURN();
+}
+
+/**
+ * @brief Implementation of the configure method for the Input class
+ *
+ * Sets the sampling period (1-100ms, default 5) and the debounce time
+ * (default 20ms) of the sampler.
+ *
+ * @param vm Pointer to the mruby/c VM
+ * @param v Pointer to the method arguments
+ * @param argc Number of arguments
+ */
+static void c_input_configure(mrb_vm *vm, mrb_value *v, int argc) {
+  SET_FALSE_RETURN();
+  if (argc < 1 || v[1].tt != MRBC_TT_INTEGER || v[1].i < 1) return;
+  int debounce_ms = INPUT_DEFAULT_DEBOUNCE_MS;
+  if (argc >= 2) {
+    if (v[2].tt != MRBC_TT_INTEGER || v[2].i < 0) return;
+    debounce_ms = v[2].i;
+  }
+  if (kSuccess == drv_input_start(v[1].i, debounce_ms)) {
+    input_started = true;
+    SET_TRUE_RETURN();
+  }
+}
+
+/**
+ * @brief Implementation of the stats method for the Input class
+ *
+ * Returns [samples, missed ticks, largest sampling delay in us, dropped
+ * edges].
+ *
+ * @param vm Pointer to the mruby/c VM
+ * @param v Pointer to the method arguments
+ * @param argc Number of arguments
+ */
+static void c_input_stats(mrb_vm *vm, mrb_value *v, int argc) {
+  uint32_t values[4];
+  drv_input_stats(&values[0], &values[1], &values[2], &values[3]);
+  mrbc_value ret = mrbc_array_new(vm, 4);
+  for (int i = 0; i < 4; i++) {
+    mrbc_value n = mrbc_fixnum_value(values[i]);
+    mrbc_array_set(&ret, i, &n);
+  }
+  SET_RETURN(ret);
+}
@@ -11,10 +11,12 @@
  */
 #include "led.h"
 
+#include <limits.h>
 #include <stdbool.h>
 #include <stdint.h>
 
 #include "../drv/led.h"
+#include "../drv/led_fx.h"
 #include "../lib/fn.h"
 #include "mrubyc.h"
 
@@ -26,12 +28,27 @@
  * @param argc Number of arguments
  */
 static void c_set_led(mrb_vm *vm, mrb_value *v, int argc);
+static void c_set_pixel(mrb_vm *vm, mrb_value *v, int argc);
+static void c_set_all(mrb_vm *vm, mrb_value *v, int argc);
+static void c_show(mrb_vm *vm, mrb_value *v, int argc);
+static void c_wait(mrb_vm *vm, mrb_value *v, int argc);
+static void c_size(mrb_vm *vm, mrb_value *v, int argc);
+static void c_stats(mrb_vm *vm, mrb_value *v, int argc);
+static void c_attach(mrb_vm *vm, mrb_value *v, int argc);
+static void c_detach(mrb_vm *vm, mrb_value *v, int argc);
+static void c_keyframes(mrb_vm *vm, mrb_value *v, int argc);
+static void c_rainbow(mrb_vm *vm, mrb_value *v, int argc);
+static void c_chase(mrb_vm *vm, mrb_value *v, int argc);
+static void c_stop(mrb_vm *vm, mrb_value *v, int argc);
+static void c_playing(mrb_vm *vm, mrb_value *v, int argc);
+static void c_fx_stats(mrb_vm *vm, mrb_value *v, int argc);
+static void c_output(mrb_vm *vm, mrb_value *v, int argc);
 
 /**
  * @brief Defines the LED class and methods for mruby/c
  *
- * Creates the LED class and registers the set method
- * which allows Ruby code to control the RGB LED.
+ * Creates the LED class and registers its methods, which allow Ruby code
+ * to control the RGB LED.
  *
  * @return kSuccess always
  */
@@ -39,40 +56,475 @@ fn_t api_led_define(void) {
   mrb_class *class_led;
   class_led = mrbc_define_class(0, "LED", mrbc_class_object);
   mrbc_define_method(0, class_led, "set", c_set_led);
+  mrbc_define_method(0, class_led, "set_pixel", c_set_pixel);
+  mrbc_define_method(0, class_led, "set_all", c_set_all);
+  mrbc_define_method(0, class_led, "show", c_show);
+  mrbc_define_method(0, class_led, "wait", c_wait);
+  mrbc_define_method(0, class_led, "size", c_size);
+  mrbc_define_method(0, class_led, "stats", c_stats);
+  mrbc_define_method(0, class_led, "attach", c_attach);
+  mrbc_define_method(0, class_led, "detach", c_detach);
+  mrbc_define_method(0, class_led, "keyframes", c_keyframes);
+  mrbc_define_method(0, class_led, "rainbow", c_rainbow);
+  mrbc_define_method(0, class_led, "chase", c_chase);
+  mrbc_define_method(0, class_led, "stop", c_stop);
+  mrbc_define_method(0, class_led, "playing?", c_playing);
+  mrbc_define_method(0, class_led, "fx_stats", c_fx_stats);
+  mrbc_define_method(0, class_led, "output", c_output);
   return kSuccess;
 }
 
+/**
+ * @brief Reads a color given as [r, g, b], [r, g, b, w] or as an Integer
+ * 0xRRGGBB (0xWWRRGGBB for RGBW strips)
+ *
+ * @param v Value to read
+ * @param rgbw Array to store red, green, blue and white
+ * @return true if the value is a color
+ */
+static bool get_rgb(const mrbc_value *v, uint8_t rgbw[4]) {
+  if (MRBC_TT_INTEGER == v->tt) {
+    rgbw[0] = (uint8_t)(v->i >> 16);
+    rgbw[1] = (uint8_t)(v->i >> 8);
+    rgbw[2] = (uint8_t)v->i;
+    rgbw[3] = (uint8_t)(v->i >> 24);
+    return true;
+  }
+  if (MRBC_TT_ARRAY != v->tt || v->array->n_stored < 3 ||
+      v->array->n_stored > 4) {
+    return false;
+  }
+  rgbw[3] = 0;
+  for (size_t i = 0; i < v->array->n_stored; i++) {
+    rgbw[i] = (uint8_t)v->array->data[i].i;
+  }
+  return true;
+}
+
+/**
+ * @brief Reads an optional Integer argument
+ *
+ * @param v Pointer to the method arguments
+ * @param argc Number of arguments
+ * @param index Argument index
+ * @param def Value if the argument is missing or not an Integer
+ * @return Argument value, clamped to the int range so that range checks
+ * see huge values as such instead of their truncated bits
+ */
+static int get_int_arg(mrb_value *v, int argc, int index, int def) {
+  if (index <= argc && MRBC_TT_INTEGER == v[index].tt) {
+    if (v[index].i > INT_MAX) return INT_MAX;
+    if (v[index].i < INT_MIN) return INT_MIN;
+    return (int)v[index].i;
+  }
+  return def;
+}
+
+/**
+ * @brief Reads an optional strip number argument
+ *
+ * @param v Pointer to the method arguments
+ * @param argc Number of arguments
+ * @param index Argument index
+ * @param def Value if the argument is missing or not an Integer
+ * @return Strip number, -1 if it is out of range
+ */
+static int get_strip_arg(mrb_value *v, int argc, int index, int def) {
+  int strip = get_int_arg(v, argc, index, def);
+  return (strip < 0 || strip > UINT8_MAX) ? -1 : strip;
+}
+
 /**
  * @brief Implementation of the set method for the LED class
  *
- * Sets the RGB LED color based on the provided RGB array.
- * The array should contain 3 values for red, green, and blue (0-255).
+ * Sets the RGB LED color based on the provided RGB array and sends it at
+ * once. The array should contain 3 values for red, green, and blue (0-255).
+ * Arguments: color, [num] (LED index, default 0), [strip] (default 0).
+ * Like set_pixel, set_all and show, it stops the effect running on the
+ * strip.
  *
  * @param vm Pointer to the mruby/c VM
  * @param v Pointer to the method arguments
  * @param argc Number of arguments
  */
 static void c_set_led(mrb_vm *vm, mrb_value *v, int argc) {
-  uint8_t rgb[3] = {0};
-  uint8_t num = 0;
+  uint8_t rgbw[4] = {0};
+  int num = get_int_arg(v, argc, 2, 0);
+  int strip = get_strip_arg(v, argc, 3, 0);
   SET_FALSE_RETURN();
 
-  do {
-    if (MRBC_TT_ARRAY == v[1].tt) {
-      if (3 != v[1].array->n_stored) break;
-      for (size_t i = 0; i < 3; i++) {
-        rgb[i] = (uint8_t)v[1].array->data[i].i;
-      }
-    } else {
-      break;
+  if (1 <= argc) get_rgb(&v[1], rgbw);  // anything else turns the LED off
+  if (num < 0 || num > UINT16_MAX || strip < 0) return;
+  drv_led_fx_stop(strip);
+
+  if (kSuccess == drv_led_set_pixel(strip, num, rgbw[0], rgbw[1], rgbw[2],
+                                    rgbw[3]) &&
+      kSuccess == drv_led_show(strip)) {
+    SET_TRUE_RETURN();
+  }
+}
+
+/**
+ * @brief Implementation of the set_pixel method for the LED class
+ *
+ * Like set, but only updates the frame buffer. Call show to send it.
+ * Arguments: color ([r, g, b], [r, g, b, w] or 0xRRGGBB), [num] (LED index,
+ * default 0), [strip] (default 0).
+ *
+ * @param vm Pointer to the mruby/c VM
+ * @param v Pointer to the method arguments
+ * @param argc Number of arguments
+ */
+static void c_set_pixel(mrb_vm *vm, mrb_value *v, int argc) {
+  uint8_t rgbw[4];
+  int num = get_int_arg(v, argc, 2, 0);
+  int strip = get_strip_arg(v, argc, 3, 0);
+  SET_FALSE_RETURN();
+
+  if (argc < 1 || !get_rgb(&v[1], rgbw) || num < 0 || num > UINT16_MAX ||
+      strip < 0) {
+    return;
+  }
+  drv_led_fx_stop(strip);
+  if (kSuccess ==
+      drv_led_set_pixel(strip, num, rgbw[0], rgbw[1], rgbw[2], rgbw[3])) {
+    SET_TRUE_RETURN();
+  }
+}
+
+/**
+ * @brief Implementation of the set_all method for the LED class
+ *
+ * Fills the frame buffer of the strip (default 0) from the given pixel
+ * offset (default 0) without sending it. The colors are either an Array of
+ * colors as for set_pixel, or a String of packed r, g, b bytes (r, g, b, w
+ * on RGBW strips). Pixels past the end of the strip are ignored. Returns the
+ * number of pixels set.
+ *
+ * @param vm Pointer to the mruby/c VM
+ * @param v Pointer to the method arguments
+ * @param argc Number of arguments
+ */
+static void c_set_all(mrb_vm *vm, mrb_value *v, int argc) {
+  int offset = get_int_arg(v, argc, 2, 0);
+  int strip = get_strip_arg(v, argc, 3, 0);
+  int count = 0;
+  SET_INT_RETURN(0);
+
+  if (offset < 0) offset = 0;
+  if (strip < 0) return;
+  int room = (int)drv_led_size(strip) - offset;
+  if (argc < 1 || room <= 0) return;
+  drv_led_fx_stop(strip);
+
+  if (MRBC_TT_STRING == v[1].tt) {
+    const uint8_t *p = v[1].string->data;
+    int bpp = drv_led_format(strip);
+    count = v[1].string->size / bpp;
+    if (count > room) count = room;
+    for (int i = 0; i < count; i++, p += bpp) {
+      drv_led_set_pixel(strip, offset + i, p[0], p[1], p[2],
+                        bpp == kLedGrbw ? p[3] : 0);
     }
-  } while (0);
+  } else if (MRBC_TT_ARRAY == v[1].tt) {
+    int n = v[1].array->n_stored;
+    if (n > room) n = room;
+    for (; count < n; count++) {
+      uint8_t rgbw[4];
+      if (!get_rgb(&v[1].array->data[count], rgbw)) break;
+      drv_led_set_pixel(strip, offset + count, rgbw[0], rgbw[1], rgbw[2],
+                        rgbw[3]);
+    }
+  }
+  SET_INT_RETURN(count);
+}
+
+/**
+ * @brief Implementation of the show method for the LED class
+ *
+ * Queues the frame buffer for the strip in one transaction and returns
+ * while it is sent in the background. Argument: [strip] (default 0).
+ *
+ * @param vm Pointer to the mruby/c VM
+ * @param v Pointer to the method arguments
+ * @param argc Number of arguments
+ */
+static void c_show(mrb_vm *vm, mrb_value *v, int argc) {
+  int strip = get_strip_arg(v, argc, 1, 0);
+  if (strip >= 0) drv_led_fx_stop(strip);
+  SET_BOOL_RETURN(strip >= 0 && kSuccess == drv_led_show(strip));
+}
+
+/**
+ * @brief Implementation of the wait method for the LED class
+ *
+ * Waits until every queued frame has been sent. Arguments: [timeout_ms]
+ * (default 1000), [strip] (default 0).
+ *
+ * @param vm Pointer to the mruby/c VM
+ * @param v Pointer to the method arguments
+ * @param argc Number of arguments
+ */
+static void c_wait(mrb_vm *vm, mrb_value *v, int argc) {
+  int timeout_ms = get_int_arg(v, argc, 1, 1000);
+  int strip = get_strip_arg(v, argc, 2, 0);
+  if (timeout_ms < 0) timeout_ms = 1000;
+  SET_BOOL_RETURN(strip >= 0 && kSuccess == drv_led_wait(strip, timeout_ms));
+}
+
+/**
+ * @brief Implementation of the size method for the LED class
+ *
+ * Returns the number of LEDs of the strip (default 0, the LEDs on the
+ * board), 0 if it is not attached.
+ *
+ * @param vm Pointer to the mruby/c VM
+ * @param v Pointer to the method arguments
+ * @param argc Number of arguments
+ */
+static void c_size(mrb_vm *vm, mrb_value *v, int argc) {
+  int strip = get_strip_arg(v, argc, 1, 0);
+  SET_INT_RETURN(strip < 0 ? 0 : drv_led_size(strip));
+}
+
+/**
+ * @brief Implementation of the stats method for the LED class
+ *
+ * Returns [transmissions, stalls]: the number of frames sent to the strip
+ * (default 0) and how often show had to wait because two frames were
+ * already queued.
+ *
+ * @param vm Pointer to the mruby/c VM
+ * @param v Pointer to the method arguments
+ * @param argc Number of arguments
+ */
+static void c_stats(mrb_vm *vm, mrb_value *v, int argc) {
+  int strip = get_strip_arg(v, argc, 1, 0);
+  mrbc_value ret = mrbc_array_new(vm, 2);
+  mrbc_value n =
+      mrbc_fixnum_value(strip < 0 ? 0 : drv_led_transmit_count(strip));
+  mrbc_value stalls =
+      mrbc_fixnum_value(strip < 0 ? 0 : drv_led_stall_count(strip));
+  mrbc_array_set(&ret, 0, &n);
+  mrbc_array_set(&ret, 1, &stalls);
+  SET_RETURN(ret);
+}
 
-  if (2 <= argc && MRBC_TT_INTEGER == v[2].tt) {
-    num = (uint8_t)v[2].i;
+/**
+ * @brief Implementation of the attach method for the LED class
+ *
+ * Attaches an external WS2812 compatible strip on its own RMT channel.
+ * Arguments: pin, size (number of LEDs), [rgbw] (true for RGBW strips,
+ * default false). A strip already attached on the pin is replaced. Returns
+ * the strip number for the other methods, or nil if no RMT channel or
+ * memory is left.
+ *
+ * @param vm Pointer to the mruby/c VM
+ * @param v Pointer to the method arguments
+ * @param argc Number of arguments
+ */
+static void c_attach(mrb_vm *vm, mrb_value *v, int argc) {
+  SET_NIL_RETURN();
+  if (argc < 2 || MRBC_TT_INTEGER != v[1].tt || MRBC_TT_INTEGER != v[2].tt ||
+      v[1].i < 0 || v[1].i >= GPIO_NUM_MAX || v[2].i <= 0 ||
+      v[2].i > UINT16_MAX) {
+    mrbc_raise(vm, MRBC_CLASS(ArgumentError), "pin, size");
+    return;
+  }
+  drv_led_format_t format =
+      (3 <= argc && MRBC_TT_TRUE == v[3].tt) ? kLedGrbw : kLedGrb;
+  int old = drv_led_find((gpio_num_t)v[1].i);
+  if (old >= 0) drv_led_fx_detach(old);
+  int strip = drv_led_attach((gpio_num_t)v[1].i, v[2].i, format);
+  if (strip >= 0) {
+    SET_INT_RETURN(strip);
   }
+}
+
+/**
+ * @brief Implementation of the detach method for the LED class
+ *
+ * Releases a strip and its RMT channel. Argument: strip.
+ *
+ * @param vm Pointer to the mruby/c VM
+ * @param v Pointer to the method arguments
+ * @param argc Number of arguments
+ */
+static void c_detach(mrb_vm *vm, mrb_value *v, int argc) {
+  int strip = get_strip_arg(v, argc, 1, -1);
+  SET_BOOL_RETURN(strip >= 0 && kSuccess == drv_led_fx_detach(strip));
+}
+
+/**
+ * @brief Implementation of the keyframes method for the LED class
+ *
+ * Plays a sequence of colors on the whole strip from the native effect
+ * engine. Arguments: frames (Array of [color, ms] or [color, ms, true] to
+ * fade in from the previous color), [repeat] (times to play, default 0 for
+ * forever), [strip] (default 0).
+ *
+ * @param vm Pointer to the mruby/c VM
+ * @param v Pointer to the method arguments
+ * @param argc Number of arguments
+ */
+static void c_keyframes(mrb_vm *vm, mrb_value *v, int argc) {
+  drv_led_fx_key_t keys[LED_FX_MAX_KEYS];
+  int repeat = get_int_arg(v, argc, 2, 0);
+  int strip = get_strip_arg(v, argc, 3, 0);
+  SET_FALSE_RETURN();
+
+  if (argc < 1 || MRBC_TT_ARRAY != v[1].tt ||
+      v[1].array->n_stored > LED_FX_MAX_KEYS || repeat < 0 ||
+      repeat > UINT16_MAX || strip < 0) {
+    mrbc_raise(vm, MRBC_CLASS(ArgumentError), "frames");
+    return;
+  }
+  int count = v[1].array->n_stored;
+  for (int i = 0; i < count; i++) {
+    const mrbc_value *f = &v[1].array->data[i];
+    if (MRBC_TT_ARRAY != f->tt || f->array->n_stored < 2 ||
+        !get_rgb(&f->array->data[0], keys[i].rgbw) ||
+        MRBC_TT_INTEGER != f->array->data[1].tt ||
+        f->array->data[1].i < 0 || f->array->data[1].i > UINT16_MAX) {
+      mrbc_raise(vm, MRBC_CLASS(ArgumentError), "frame: [color, ms]");
+      return;
+    }
+    keys[i].ms = f->array->data[1].i;
+    keys[i].fade =
+        f->array->n_stored > 2 && MRBC_TT_TRUE == f->array->data[2].tt;
+  }
+  if (kSuccess == drv_led_fx_keyframes(strip, keys, count, repeat)) {
+    SET_TRUE_RETURN();
+  }
+}
+
+/**
+ * @brief Implementation of the rainbow method for the LED class
+ *
+ * Plays a rainbow moving along the strip. Arguments: period_ms (one turn
+ * of the color wheel), [brightness] (default 255), [strip] (default 0).
+ *
+ * @param vm Pointer to the mruby/c VM
+ * @param v Pointer to the method arguments
+ * @param argc Number of arguments
+ */
+static void c_rainbow(mrb_vm *vm, mrb_value *v, int argc) {
+  int period_ms = get_int_arg(v, argc, 1, 0);
+  int brightness = get_int_arg(v, argc, 2, 255);
+  int strip = get_strip_arg(v, argc, 3, 0);
+  if (brightness < 0) brightness = 0;
+  if (brightness > 255) brightness = 255;
+  SET_BOOL_RETURN(period_ms > 0 && strip >= 0 &&
+                  kSuccess == drv_led_fx_rainbow(strip, period_ms,
+                                                 (uint8_t)brightness));
+}
+
+/**
+ * @brief Implementation of the chase method for the LED class
+ *
+ * Moves a lit segment along the strip. Arguments: color, step_ms (time per
+ * pixel), [length] (default 1), [background] (default 0, off), [strip]
+ * (default 0).
+ *
+ * @param vm Pointer to the mruby/c VM
+ * @param v Pointer to the method arguments
+ * @param argc Number of arguments
+ */
+static void c_chase(mrb_vm *vm, mrb_value *v, int argc) {
+  uint8_t rgbw[4];
+  uint8_t background[4] = {0};
+  int step_ms = get_int_arg(v, argc, 2, 0);
+  int length = get_int_arg(v, argc, 3, 1);
+  int strip = get_strip_arg(v, argc, 5, 0);
+  SET_FALSE_RETURN();
 
-  if (kSuccess == drv_led_set(num, rgb[0], rgb[1], rgb[2])) {
+  if (argc < 2 || !get_rgb(&v[1], rgbw) || step_ms <= 0 ||
+      step_ms > UINT16_MAX || length < 0 || length > UINT16_MAX ||
+      strip < 0) {
+    return;
+  }
+  if (4 <= argc) get_rgb(&v[4], background);
+  if (kSuccess ==
+      drv_led_fx_chase(strip, rgbw, background, length, step_ms)) {
     SET_TRUE_RETURN();
   }
 }
+
+/**
+ * @brief Implementation of the stop method for the LED class
+ *
+ * Stops the effect on the strip (default 0). The pixels keep their last
+ * color.
+ *
+ * @param vm Pointer to the mruby/c VM
+ * @param v Pointer to the method arguments
+ * @param argc Number of arguments
+ */
+static void c_stop(mrb_vm *vm, mrb_value *v, int argc) {
+  int strip = get_strip_arg(v, argc, 1, 0);
+  if (strip >= 0) drv_led_fx_stop(strip);
+  SET_TRUE_RETURN();
+}
+
+/**
+ * @brief Implementation of the playing? method for the LED class
+ *
+ * Returns true while an effect runs on the strip (default 0).
+ *
+ * @param vm Pointer to the mruby/c VM
+ * @param v Pointer to the method arguments
+ * @param argc Number of arguments
+ */
+static void c_playing(mrb_vm *vm, mrb_value *v, int argc) {
+  int strip = get_strip_arg(v, argc, 1, 0);
+  SET_BOOL_RETURN(strip >= 0 && drv_led_fx_running(strip));
+}
+
+/**
+ * @brief Implementation of the fx_stats method for the LED class
+ *
+ * Returns [frames, missed, max_late_us]: frames rendered by the effect
+ * engine, ticks it missed because a frame took too long, and the largest
+ * delay between a tick and its frame.
+ *
+ * @param vm Pointer to the mruby/c VM
+ * @param v Pointer to the method arguments
+ * @param argc Number of arguments
+ */
+static void c_fx_stats(mrb_vm *vm, mrb_value *v, int argc) {
+  uint32_t values[3];
+  drv_led_fx_stats(&values[0], &values[1], &values[2]);
+  mrbc_value ret = mrbc_array_new(vm, 3);
+  for (int i = 0; i < 3; i++) {
+    mrbc_value n = mrbc_fixnum_value(values[i]);
+    mrbc_array_set(&ret, i, &n);
+  }
+  SET_RETURN(ret);
+}
+
+/**
+ * @brief Implementation of the output method for the LED class
+ *
+ * Sets how the strip's colors are sent: gamma correction, global
+ * brightness and temporal dithering, applied while the frame is encoded.
+ * Arguments: gamma (true for gamma 2.2), [brightness] (0-255, default
+ * 255), [dither] (default false), [strip] (default 0). Takes effect from
+ * the next frame sent. A dithered strip is sent again by the effect engine
+ * while no new frame is shown.
+ *
+ * @param vm Pointer to the mruby/c VM
+ * @param v Pointer to the method arguments
+ * @param argc Number of arguments
+ */
+static void c_output(mrb_vm *vm, mrb_value *v, int argc) {
+  bool gamma = 1 <= argc && MRBC_TT_TRUE == v[1].tt;
+  int brightness = get_int_arg(v, argc, 2, 255);
+  bool dither = 3 <= argc && MRBC_TT_TRUE == v[3].tt;
+  int strip = get_strip_arg(v, argc, 4, 0);
+  if (brightness < 0) brightness = 0;
+  if (brightness > 255) brightness = 255;
+  SET_BOOL_RETURN(strip >= 0 &&
+                  kSuccess == drv_led_set_output(strip, gamma, brightness,
+                                                 dither) &&
+                  kSuccess == drv_led_fx_dither(strip));
+}
@@ -8,59 +8,138 @@
  *
  * Implements the PWM class and its methods for the mruby/c VM,
  * providing functionality to control PWM outputs on GPIO pins.
+ *
+ * PWM.new returns an instance that holds a driver channel handle. Every
+ * method also works as a class method that takes the handle as its first
+ * argument (PWM.setup and friends). A handle carries the generation of its
+ * channel, so a handle kept after disable never reaches the next user of
+ * the channel. Both look the channel up directly in the driver, and
+ * channels left open are released when the VM ends.
  */
 #include "pwm.h"
 
+#include <limits.h>
 #include <stdbool.h>
 #include <stdint.h>
 
-#include "../drv/led.h"
+#include "../drv/pwm.h"
 #include "../lib/fn.h"
+#include "esp_timer.h"
 #include "mrubyc.h"
 
-// PWMチャンネルを保持する配列（最大8チャンネル）
-static int pwm_channels[8] = {-1, -1, -1, -1, -1, -1, -1, -1};
+// set_dutiesのレイテンシ（メソッド呼び出しから反映の指示まで）
+static uint32_t pwm_batches = 0;
+static uint32_t pwm_latency_last_us = 0;
+static uint32_t pwm_latency_max_us = 0;
+static uint32_t pwm_period_us = 0;  // 最後のバッチで最も長い周期
+
+static mrb_class *class_pwm;
 
 /**
  * @brief mruby/c用のメソッド実装の前方宣言
  */
+static void c_pwm_new(mrb_vm *vm, mrb_value *v, int argc);
 static void c_pwm_setup(mrb_vm *vm, mrb_value *v, int argc);
+static void c_pwm_channel(mrb_vm *vm, mrb_value *v, int argc);
 static void c_pwm_set_duty(mrb_vm *vm, mrb_value *v, int argc);
 static void c_pwm_disable(mrb_vm *vm, mrb_value *v, int argc);
+static void c_pwm_set_duty_raw(mrb_vm *vm, mrb_value *v, int argc);
+static void c_pwm_max_duty(mrb_vm *vm, mrb_value *v, int argc);
+static void c_pwm_set_freq(mrb_vm *vm, mrb_value *v, int argc);
+static void c_pwm_fade(mrb_vm *vm, mrb_value *v, int argc);
+static void c_pwm_set_duties(mrb_vm *vm, mrb_value *v, int argc);
+static void c_pwm_latency(mrb_vm *vm, mrb_value *v, int argc);
 
 /**
  * @brief mruby/c用のPWMクラスとメソッドを定義
  *
- * PWMクラスを作成し、setup、set_duty、disableメソッドを登録
+ * PWMクラスを作成し、new、setup、channel、set_duty、disable、set_duty_raw、
+ * max_duty、set_freq、fade、set_duties、latencyメソッドを登録
  *
  * @return kSuccess 常に成功
  */
 fn_t api_pwm_define(void) {
-  mrb_class *class_pwm;
   class_pwm = mrbc_define_class(0, "PWM", mrbc_class_object);
+  mrbc_define_method(0, class_pwm, "new", c_pwm_new);
   mrbc_define_method(0, class_pwm, "setup", c_pwm_setup);
+  mrbc_define_method(0, class_pwm, "channel", c_pwm_channel);
   mrbc_define_method(0, class_pwm, "set_duty", c_pwm_set_duty);
   mrbc_define_method(0, class_pwm, "disable", c_pwm_disable);
+  mrbc_define_method(0, class_pwm, "set_duty_raw", c_pwm_set_duty_raw);
+  mrbc_define_method(0, class_pwm, "max_duty", c_pwm_max_duty);
+  mrbc_define_method(0, class_pwm, "set_freq", c_pwm_set_freq);
+  mrbc_define_method(0, class_pwm, "fade", c_pwm_fade);
+  mrbc_define_method(0, class_pwm, "set_duties", c_pwm_set_duties);
+  mrbc_define_method(0, class_pwm, "latency", c_pwm_latency);
   return kSuccess;
 }
 
 /**
- * @brief PWMクラスのsetupメソッドの実装
+ * @brief 値が指すチャンネル番号を返す
  *
- * GPIOピンをPWM出力として設定します。
- * 引数: pin_num - GPIOピン番号, initial_duty - 初期デューティ比(0-100%)
- * 戻り値: チャンネル番号（0-7）または -1（失敗時）
+ * PWMインスタンスならインスタンスが持つハンドル、整数ならその値を
+ * ドライバで引きます。ほかのクラスのオブジェクトや、disableの後の古い
+ * ハンドルは無効です。ドライバのチャンネル表を直接引くだけなので O(1)
+ * です。
+ *
+ * @param value PWMインスタンスまたはハンドル
+ * @return チャンネル番号、無効なとき-1
+ */
+static int value_channel(mrb_value *value) {
+  int handle;
+  if (value->tt == MRBC_TT_OBJECT) {
+    if (!mrbc_obj_is_kind_of(value, class_pwm)) {
+      return -1;
+    }
+    handle = *(int *)value->instance->data;
+  } else if (value->tt == MRBC_TT_INTEGER) {
+    if (value->i < 0 || value->i > INT_MAX) {
+      return -1;
+    }
+    handle = (int)value->i;
+  } else {
+    return -1;
+  }
+  return drv_pwm_handle_channel(handle);
+}
+
+/**
+ * @brief 対象のチャンネルと、残りの引数の位置を得る
+ *
+ * インスタンスメソッドとして呼ばれたときはインスタンスのチャンネル、
+ * クラスメソッドとして呼ばれたときは第1引数のハンドルを使います。
  *
- * @param vm mruby/c VMへのポインタ
  * @param v メソッド引数へのポインタ
  * @param argc 引数の数
+ * @param arg 残りの引数の先頭の添字（v[arg]）
+ * @return チャンネル番号、無効なとき-1
  */
-static void c_pwm_setup(mrb_vm *vm, mrb_value *v, int argc) {
-  SET_INT_RETURN(-1); // デフォルトは失敗
+static int get_channel(mrb_value *v, int argc, int *arg) {
+  if (v[0].tt == MRBC_TT_OBJECT) {
+    *arg = 1;
+    return value_channel(&v[0]);
+  }
+  *arg = 2;
+  if (argc < 1 || v[1].tt != MRBC_TT_INTEGER) {
+    return -1;
+  }
+  return value_channel(&v[1]);
+}
 
+/**
+ * @brief 引数からPWM出力を設定
+ *
+ * 引数: pin_num - GPIOピン番号, initial_duty - 初期デューティ比(0-100%),
+ * [freq_hz] - 周波数（デフォルト5000）
+ *
+ * @param v メソッド引数へのポインタ
+ * @param argc 引数の数
+ * @return チャンネルのハンドル、失敗時-1
+ */
+static int pwm_open(mrb_value *v, int argc) {
   // 引数チェック
   if (argc < 2 || v[1].tt != MRBC_TT_INTEGER || v[2].tt != MRBC_TT_INTEGER) {
-    return;
+    return -1;
   }
 
   // ピン番号と初期デューティ比を取得
@@ -69,23 +148,98 @@ static void c_pwm_setup(mrb_vm *vm, mrb_value *v, int argc) {
 
   // 値の範囲チェック
   if (pin_num < 0 || initial_duty < 0 || initial_duty > 100) {
-    return;
+    return -1;
+  }
+
+  int freq_hz = 5000;
+  if (argc >= 3 && v[3].tt == MRBC_TT_INTEGER) {
+    freq_hz = v[3].i;
+  }
+  if (freq_hz <= 0) {
+    return -1;
   }
 
-  // PWMセットアップ
-  int channel = drv_pwm_setup_pin(pin_num, initial_duty);
-  if (channel >= 0 && channel < 8) {
-    // チャンネル番号を保存
-    pwm_channels[channel] = pin_num;
-    SET_INT_RETURN(channel);
+  // PWMセットアップ（周波数に応じた分解能で%を変換）
+  int channel = drv_pwm_setup(pin_num, freq_hz, 0);
+  if (channel < 0) {
+    return -1;
   }
+  drv_pwm_set_duty(channel, initial_duty);
+  return drv_pwm_handle(channel);
+}
+
+/**
+ * @brief PWMクラスのnewメソッドの実装
+ *
+ * GPIOピンをPWM出力として設定し、チャンネルを持つPWMインスタンスを
+ * 返します。引数はsetupと同じです。
+ * 戻り値: PWMインスタンス（引数が不正なときArgumentError、チャンネルや
+ * タイマーが足りないときRuntimeError）
+ *
+ * @param vm mruby/c VMへのポインタ
+ * @param v メソッド引数へのポインタ
+ * @param argc 引数の数
+ */
+static void c_pwm_new(mrb_vm *vm, mrb_value *v, int argc) {
+  if (argc < 2 || v[1].tt != MRBC_TT_INTEGER || v[2].tt != MRBC_TT_INTEGER ||
+      v[1].i < 0 || v[2].i < 0 || v[2].i > 100 ||
+      (argc >= 3 && (v[3].tt != MRBC_TT_INTEGER || v[3].i <= 0))) {
+    mrbc_raise(vm, MRBC_CLASS(ArgumentError), "pin, duty(0-100), [freq_hz]");
+    return;
+  }
+  mrbc_value obj = mrbc_instance_new(vm, v[0].cls, sizeof(int));
+  if (obj.instance == NULL) {
+    mrbc_raise(vm, MRBC_CLASS(RuntimeError), "out of memory");
+    return;
+  }
+  int handle = pwm_open(v, argc);
+  if (handle < 0) {
+    mrbc_decref(&obj);
+    mrbc_raise(vm, MRBC_CLASS(RuntimeError), "no PWM channel or timer left");
+    return;
+  }
+  *(int *)obj.instance->data = handle;
+  SET_RETURN(obj);
+}
+
+/**
+ * @brief PWMクラスのsetupメソッドの実装
+ *
+ * GPIOピンをPWM出力として設定します。
+ * 引数: pin_num - GPIOピン番号, initial_duty - 初期デューティ比(0-100%),
+ * [freq_hz] - 周波数（デフォルト5000）
+ * 戻り値: チャンネルのハンドル（8以上）または -1（失敗時）
+ *
+ * @param vm mruby/c VMへのポインタ
+ * @param v メソッド引数へのポインタ
+ * @param argc 引数の数
+ */
+static void c_pwm_setup(mrb_vm *vm, mrb_value *v, int argc) {
+  SET_INT_RETURN(pwm_open(v, argc));
+}
+
+/**
+ * @brief PWMクラスのchannelメソッドの実装
+ *
+ * インスタンスのチャンネルのハンドルを返します。クラスメソッドに
+ * 渡せます。
+ * 戻り値: ハンドル、disable後は-1
+ *
+ * @param vm mruby/c VMへのポインタ
+ * @param v メソッド引数へのポインタ
+ * @param argc 引数の数
+ */
+static void c_pwm_channel(mrb_vm *vm, mrb_value *v, int argc) {
+  int channel = v[0].tt == MRBC_TT_OBJECT ? value_channel(&v[0]) : -1;
+  SET_INT_RETURN(drv_pwm_handle(channel));
 }
 
 /**
  * @brief PWMクラスのset_dutyメソッドの実装
  *
  * PWM出力のデューティ比を設定します。
- * 引数: channel - チャンネル番号, duty - デューティ比(0-100%)
+ * 引数: [channel] - チャンネルのハンドル（クラスメソッドのとき）,
+ * duty - デューティ比(0-100%)
  * 戻り値: 成功時true、失敗時false
  *
  * @param vm mruby/c VMへのポインタ
@@ -93,24 +247,18 @@ static void c_pwm_setup(mrb_vm *vm, mrb_value *v, int argc) {
  * @param argc 引数の数
  */
 static void c_pwm_set_duty(mrb_vm *vm, mrb_value *v, int argc) {
+  int arg;
+  int channel = get_channel(v, argc, &arg);
   SET_FALSE_RETURN(); // デフォルトは失敗
 
-  // 引数チェック
-  if (argc < 2 || v[1].tt != MRBC_TT_INTEGER || v[2].tt != MRBC_TT_INTEGER) {
-    return;
-  }
-
-  // チャンネル番号とデューティ比を取得
-  int channel = v[1].i;
-  int duty = v[2].i;
-
   // 値の範囲チェック
-  if (channel < 0 || channel >= 8 || duty < 0 || duty > 100 || pwm_channels[channel] == -1) {
+  if (channel < 0 || argc < arg || v[arg].tt != MRBC_TT_INTEGER ||
+      v[arg].i < 0 || v[arg].i > 100) {
     return;
   }
 
   // デューティ比を設定
-  if (kSuccess == drv_pwm_set_duty(channel, duty)) {
+  if (kSuccess == drv_pwm_set_duty(channel, v[arg].i)) {
     SET_TRUE_RETURN();
   }
 }
@@ -118,8 +266,8 @@ static void c_pwm_set_duty(mrb_vm *vm, mrb_value *v, int argc) {
 /**
  * @brief PWMクラスのdisableメソッドの実装
  *
- * PWM出力を無効化します。
- * 引数: channel - チャンネル番号
+ * PWM出力を無効化します。インスタンスはチャンネルを手放します。
+ * 引数: [channel] - チャンネルのハンドル（クラスメソッドのとき）
  * 戻り値: 成功時true、失敗時false
  *
  * @param vm mruby/c VMへのポインタ
@@ -127,24 +275,190 @@ static void c_pwm_set_duty(mrb_vm *vm, mrb_value *v, int argc) {
  * @param argc 引数の数
  */
 static void c_pwm_disable(mrb_vm *vm, mrb_value *v, int argc) {
-  SET_FALSE_RETURN(); // デフォルトは失敗
+  int arg;
+  int channel = get_channel(v, argc, &arg);
 
-  // 引数チェック
-  if (argc < 1 || v[1].tt != MRBC_TT_INTEGER) {
+  // PWM出力を無効化。インスタンスはチャンネルを手放す（戻り値でv[0]が
+  // 解放されることがあるので、戻り値は最後に設定する）
+  bool ok = channel >= 0 && kSuccess == drv_pwm_disable(channel);
+  if (ok && v[0].tt == MRBC_TT_OBJECT) {
+    *(int *)v[0].instance->data = -1;
+  }
+  if (ok) {
+    SET_TRUE_RETURN();
+  } else {
+    SET_FALSE_RETURN();
+  }
+}
+
+/**
+ * @brief PWMクラスのset_duty_rawメソッドの実装
+ *
+ * デューティ値をタイマーの分解能のまま設定します。ログを出さないので
+ * 高い頻度で呼べます。
+ * 引数: [channel], duty - デューティ値(0-max_duty)
+ * 戻り値: 成功時true、失敗時false
+ *
+ * @param vm mruby/c VMへのポインタ
+ * @param v メソッド引数へのポインタ
+ * @param argc 引数の数
+ */
+static void c_pwm_set_duty_raw(mrb_vm *vm, mrb_value *v, int argc) {
+  int arg;
+  int channel = get_channel(v, argc, &arg);
+  SET_FALSE_RETURN();
+  if (channel < 0 || argc < arg || v[arg].tt != MRBC_TT_INTEGER ||
+      v[arg].i < 0) {
     return;
   }
+  if (kSuccess == drv_pwm_set_duty_raw(channel, v[arg].i)) {
+    SET_TRUE_RETURN();
+  }
+}
 
-  // チャンネル番号を取得
-  int channel = v[1].i;
+/**
+ * @brief PWMクラスのmax_dutyメソッドの実装
+ *
+ * デューティ比100%に当たるデューティ値を返します（5kHzでは8192）。
+ * 引数: [channel]
+ * 戻り値: 最大デューティ値、無効なチャンネルは0
+ *
+ * @param vm mruby/c VMへのポインタ
+ * @param v メソッド引数へのポインタ
+ * @param argc 引数の数
+ */
+static void c_pwm_max_duty(mrb_vm *vm, mrb_value *v, int argc) {
+  int arg;
+  int channel = get_channel(v, argc, &arg);
+  SET_INT_RETURN(channel < 0 ? 0 : drv_pwm_get_max_duty(channel));
+}
 
-  // 値の範囲チェック
-  if (channel < 0 || channel >= 8 || pwm_channels[channel] == -1) {
+/**
+ * @brief PWMクラスのset_freqメソッドの実装
+ *
+ * チャンネルの周波数を変えます。デューティ比は保たれますが、分解能が
+ * 変わるのでmax_dutyも変わります。使える周波数は同時に4種類までです。
+ * 引数: [channel], freq_hz - 周波数
+ * 戻り値: 成功時true、失敗時false
+ *
+ * @param vm mruby/c VMへのポインタ
+ * @param v メソッド引数へのポインタ
+ * @param argc 引数の数
+ */
+static void c_pwm_set_freq(mrb_vm *vm, mrb_value *v, int argc) {
+  int arg;
+  int channel = get_channel(v, argc, &arg);
+  SET_FALSE_RETURN();
+  if (channel < 0 || argc < arg || v[arg].tt != MRBC_TT_INTEGER ||
+      v[arg].i <= 0) {
     return;
   }
+  if (kSuccess == drv_pwm_set_freq(channel, v[arg].i)) {
+    SET_TRUE_RETURN();
+  }
+}
 
-  // PWM出力を無効化
-  if (kSuccess == drv_pwm_disable(channel)) {
-    pwm_channels[channel] = -1;
+/**
+ * @brief PWMクラスのfadeメソッドの実装
+ *
+ * LEDCのハードウェアでデューティ値を目標までフェードします。
+ * すぐに戻り、フェード中もスクリプトは動き続けます。
+ * 引数: [channel], duty - 目標デューティ値(0-max_duty),
+ * time_ms - フェード時間
+ * 戻り値: 成功時true、失敗時false
+ *
+ * @param vm mruby/c VMへのポインタ
+ * @param v メソッド引数へのポインタ
+ * @param argc 引数の数
+ */
+static void c_pwm_fade(mrb_vm *vm, mrb_value *v, int argc) {
+  int arg;
+  int channel = get_channel(v, argc, &arg);
+  SET_FALSE_RETURN();
+  if (channel < 0 || argc < arg + 1 || v[arg].tt != MRBC_TT_INTEGER ||
+      v[arg + 1].tt != MRBC_TT_INTEGER || v[arg].i < 0 || v[arg + 1].i < 0) {
+    return;
+  }
+  if (kSuccess == drv_pwm_fade(channel, v[arg].i, v[arg + 1].i)) {
     SET_TRUE_RETURN();
   }
-} 
\ No newline at end of file
+}
+
+/**
+ * @brief PWMクラスのset_dutiesメソッドの実装
+ *
+ * 複数チャンネルのデューティ値をまとめて書き込み、次のPWM周期で
+ * 同時に切り替えます（同じタイマーのチャンネル）。RGB LEDやモーターの
+ * 組が途中の組み合わせを出力しません。
+ * 引数: [[pwm, duty], ...] - pwmはPWMインスタンスまたはハンドル、
+ * dutyはデューティ値(0-max_duty)
+ * 戻り値: 成功時true、失敗時false（無効な要素があれば何も変えません）
+ *
+ * @param vm mruby/c VMへのポインタ
+ * @param v メソッド引数へのポインタ
+ * @param argc 引数の数
+ */
+static void c_pwm_set_duties(mrb_vm *vm, mrb_value *v, int argc) {
+  int64_t start_us = esp_timer_get_time();
+  SET_FALSE_RETURN();
+  if (argc < 1 || v[1].tt != MRBC_TT_ARRAY || v[1].array->n_stored < 1 ||
+      v[1].array->n_stored > 8) {
+    return;
+  }
+
+  int count = v[1].array->n_stored;
+  int channels[8];
+  uint32_t duties[8];
+  uint32_t period_us = 0;
+  for (int i = 0; i < count; i++) {
+    const mrbc_value *e = &v[1].array->data[i];
+    if (e->tt != MRBC_TT_ARRAY || e->array->n_stored < 2 ||
+        e->array->data[1].tt != MRBC_TT_INTEGER ||
+        e->array->data[1].i < 0) {
+      return;
+    }
+    int channel = value_channel(&e->array->data[0]);
+    if (channel < 0) {
+      return;
+    }
+    channels[i] = channel;
+    duties[i] = e->array->data[1].i;
+    uint32_t freq_hz = drv_pwm_get_freq(channel);
+    if (freq_hz > 0 && 1000000 / freq_hz > period_us) {
+      period_us = 1000000 / freq_hz;
+    }
+  }
+
+  if (kSuccess != drv_pwm_set_duties(channels, duties, count)) {
+    return;
+  }
+  uint32_t latency_us = esp_timer_get_time() - start_us;
+  pwm_batches++;
+  pwm_latency_last_us = latency_us;
+  if (latency_us > pwm_latency_max_us) pwm_latency_max_us = latency_us;
+  pwm_period_us = period_us;
+  SET_TRUE_RETURN();
+}
+
+/**
+ * @brief PWMクラスのlatencyメソッドの実装
+ *
+ * set_dutiesのレイテンシを返します。出力は反映の指示から最大で
+ * 1周期（period_us）後に切り替わるので、呼び出しから出力が変わるまでは
+ * 最大でmax_us + period_usです。
+ * 戻り値: [バッチ数, last_us, max_us, period_us]
+ *
+ * @param vm mruby/c VMへのポインタ
+ * @param v メソッド引数へのポインタ
+ * @param argc 引数の数
+ */
+static void c_pwm_latency(mrb_vm *vm, mrb_value *v, int argc) {
+  uint32_t values[] = {pwm_batches, pwm_latency_last_us, pwm_latency_max_us,
+                       pwm_period_us};
+  mrbc_value ret = mrbc_array_new(vm, 4);
+  for (int i = 0; i < 4; i++) {
+    mrbc_value n = mrbc_fixnum_value(values[i]);
+    mrbc_array_set(&ret, i, &n);
+  }
+  SET_RETURN(ret);
+}
@@ -0,0 +1,441 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file typed_array.c
+ * @brief Implementation of Int16Array and Float32Array for mruby/c
+ *
+ * Both classes share one implementation. The instance data holds a small
+ * header followed by the packed elements, so an array is a single VM heap
+ * block that is freed together with the instance.
+ */
+#include "typed_array.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../lib/fn.h"
+#include "mrubyc.h"
+
+/**
+ * @brief Instance data layout, followed by the elements
+ */
+typedef struct {
+  uint32_t count; /**< number of elements */
+} typed_array_header_t;
+
+// Largest element area, mruby/c heap blocks stay well below 64KB
+#define TYPED_ARRAY_MAX_BYTES (UINT16_MAX - sizeof(typed_array_header_t))
+
+/**
+ * @brief Element operations for map!
+ */
+typedef enum {
+  kOpAdd,
+  kOpSub,
+  kOpMul,
+  kOpDiv,
+  kOpMin,
+  kOpMax,
+  kOpAbs,
+} typed_array_op_t;
+
+static mrb_class *class_int16_array;
+static mrb_class *class_float32_array;
+
+/**
+ * @brief Forward declarations for the mruby/c method implementations
+ */
+static void c_typed_array_new(mrb_vm *vm, mrb_value *v, int argc);
+static void c_typed_array_get(mrb_vm *vm, mrb_value *v, int argc);
+static void c_typed_array_set(mrb_vm *vm, mrb_value *v, int argc);
+static void c_typed_array_size(mrb_vm *vm, mrb_value *v, int argc);
+static void c_typed_array_bytesize(mrb_vm *vm, mrb_value *v, int argc);
+static void c_typed_array_fill(mrb_vm *vm, mrb_value *v, int argc);
+static void c_typed_array_sum(mrb_vm *vm, mrb_value *v, int argc);
+static void c_typed_array_min(mrb_vm *vm, mrb_value *v, int argc);
+static void c_typed_array_max(mrb_vm *vm, mrb_value *v, int argc);
+static void c_typed_array_map(mrb_vm *vm, mrb_value *v, int argc);
+static void c_typed_array_to_a(mrb_vm *vm, mrb_value *v, int argc);
+
+/**
+ * @brief Registers the shared methods on a typed array class
+ */
+static void define_methods(mrb_class *cls) {
+  mrbc_define_method(0, cls, "new", c_typed_array_new);
+  mrbc_define_method(0, cls, "[]", c_typed_array_get);
+  mrbc_define_method(0, cls, "[]=", c_typed_array_set);
+  mrbc_define_method(0, cls, "size", c_typed_array_size);
+  mrbc_define_method(0, cls, "length", c_typed_array_size);
+  mrbc_define_method(0, cls, "bytesize", c_typed_array_bytesize);
+  mrbc_define_method(0, cls, "fill", c_typed_array_fill);
+  mrbc_define_method(0, cls, "sum", c_typed_array_sum);
+  mrbc_define_method(0, cls, "min", c_typed_array_min);
+  mrbc_define_method(0, cls, "max", c_typed_array_max);
+  mrbc_define_method(0, cls, "map!", c_typed_array_map);
+  mrbc_define_method(0, cls, "to_a", c_typed_array_to_a);
+}
+
+/**
+ * @brief Defines the Int16Array and Float32Array classes for mruby/c
+ *
+ * @return kSuccess always
+ */
+fn_t api_typed_array_define(void) {
+  class_int16_array = mrbc_define_class(0, "Int16Array", mrbc_class_object);
+  class_float32_array =
+      mrbc_define_class(0, "Float32Array", mrbc_class_object);
+  define_methods(class_int16_array);
+  define_methods(class_float32_array);
+  return kSuccess;
+}
+
+/**
+ * @brief Returns true for Float32Array instances, false for Int16Array
+ */
+static bool is_float(const mrb_value *v) {
+  return v->instance->cls == class_float32_array;
+}
+
+/**
+ * @brief Returns true if v is an instance of either class
+ */
+static bool is_typed_array(const mrbc_value *v) {
+  return v->tt == MRBC_TT_OBJECT && (v->instance->cls == class_int16_array ||
+                                     v->instance->cls == class_float32_array);
+}
+
+static typed_array_header_t *header(const mrb_value *v) {
+  return (typed_array_header_t *)v->instance->data;
+}
+
+static int16_t *int16_data(const mrb_value *v) {
+  return (int16_t *)(header(v) + 1);
+}
+
+static float *float_data(const mrb_value *v) {
+  return (float *)(header(v) + 1);
+}
+
+uint8_t *typed_array_bytes(const mrbc_value *v, size_t *bytes) {
+  if (!is_typed_array(v)) return NULL;
+  if (bytes) {
+    *bytes = header(v)->count * (is_float(v) ? sizeof(float) : sizeof(int16_t));
+  }
+  return (uint8_t *)(header(v) + 1);
+}
+
+int16_t *typed_array_int16(const mrbc_value *v, int *count) {
+  if (v->tt != MRBC_TT_OBJECT || v->instance->cls != class_int16_array) {
+    return NULL;
+  }
+  if (count) *count = header(v)->count;
+  return int16_data(v);
+}
+
+/**
+ * @brief Converts an Integer or Float to float
+ *
+ * @return true on success; an ArgumentError has been raised otherwise
+ */
+static bool to_float(mrb_vm *vm, const mrb_value *val, float *out) {
+  switch (val->tt) {
+    case MRBC_TT_INTEGER:
+      *out = (float)val->i;
+      return true;
+    case MRBC_TT_FLOAT:
+      *out = (float)val->d;
+      return true;
+    default:
+      mrbc_raise(vm, MRBC_CLASS(ArgumentError), "not a number");
+      return false;
+  }
+}
+
+/**
+ * @brief Saturates a value to the int16_t range
+ */
+static int16_t clamp16(float x) {
+  if (x > INT16_MAX) return INT16_MAX;
+  if (x < INT16_MIN) return INT16_MIN;
+  return (int16_t)x;
+}
+
+/**
+ * @brief Resolves a possibly negative index
+ *
+ * @return The element index, or -1 when out of range
+ */
+static int resolve_index(const mrb_value *v, const mrb_value *idx) {
+  if (idx->tt != MRBC_TT_INTEGER) return -1;
+  int n = header(v)->count;
+  if (idx->i < -n || idx->i >= n) return -1;  // before narrowing to int
+  int i = idx->i;
+  return (i < 0) ? i + n : i;
+}
+
+/**
+ * @brief new(size, [value]): creates an array of size elements
+ *
+ * Elements start at value, or 0 when it is omitted.
+ */
+static void c_typed_array_new(mrb_vm *vm, mrb_value *v, int argc) {
+  if (argc < 1 || v[1].tt != MRBC_TT_INTEGER || v[1].i < 0) {
+    mrbc_raise(vm, MRBC_CLASS(ArgumentError), "size must be an Integer >= 0");
+    return;
+  }
+  float init = 0;
+  if (argc > 1 && !to_float(vm, &v[2], &init)) return;
+
+  bool f = (v[0].cls == class_float32_array);
+  size_t elem = f ? sizeof(float) : sizeof(int16_t);
+  if (v[1].i > (mrbc_int_t)(TYPED_ARRAY_MAX_BYTES / elem)) {
+    mrbc_raise(vm, MRBC_CLASS(ArgumentError), "size too large");
+    return;
+  }
+  int n = v[1].i;
+  mrbc_value obj =
+      mrbc_instance_new(vm, v[0].cls, sizeof(typed_array_header_t) + n * elem);
+  if (obj.instance == NULL) {
+    mrbc_raise(vm, MRBC_CLASS(RuntimeError), "out of memory");
+    return;
+  }
+  header(&obj)->count = n;
+  if (f) {
+    float *d = float_data(&obj);
+    for (int i = 0; i < n; i++) d[i] = init;
+  } else {
+    int16_t *d = int16_data(&obj);
+    int16_t x = clamp16(init);
+    for (int i = 0; i < n; i++) d[i] = x;
+  }
+  v[0] = obj;
+}
+
+/**
+ * @brief [index]: element at index, nil when out of range
+ */
+static void c_typed_array_get(mrb_vm *vm, mrb_value *v, int argc) {
+  int i = (argc > 0) ? resolve_index(&v[0], &v[1]) : -1;
+  if (i < 0) {
+    SET_NIL_RETURN();
+  } else if (is_float(&v[0])) {
+    SET_FLOAT_RETURN(float_data(&v[0])[i]);
+  } else {
+    SET_INT_RETURN(int16_data(&v[0])[i]);
+  }
+}
+
+/**
+ * @brief [index] = value: stores value, saturated for Int16Array
+ */
+static void c_typed_array_set(mrb_vm *vm, mrb_value *v, int argc) {
+  if (argc < 2) {
+    mrbc_raise(vm, MRBC_CLASS(ArgumentError), "wrong number of arguments");
+    return;
+  }
+  int i = resolve_index(&v[0], &v[1]);
+  if (i < 0) {
+    mrbc_raise(vm, MRBC_CLASS(IndexError), "index out of range");
+    return;
+  }
+  float x;
+  if (!to_float(vm, &v[2], &x)) return;
+  if (is_float(&v[0])) {
+    float_data(&v[0])[i] = x;
+  } else {
+    int16_data(&v[0])[i] = clamp16(x);
+  }
+  mrbc_value ret = v[2];
+  SET_RETURN(ret);
+}
+
+static void c_typed_array_size(mrb_vm *vm, mrb_value *v, int argc) {
+  SET_INT_RETURN(header(&v[0])->count);
+}
+
+static void c_typed_array_bytesize(mrb_vm *vm, mrb_value *v, int argc) {
+  size_t bytes;
+  typed_array_bytes(&v[0], &bytes);
+  SET_INT_RETURN(bytes);
+}
+
+/**
+ * @brief fill(value): sets every element and returns self
+ */
+static void c_typed_array_fill(mrb_vm *vm, mrb_value *v, int argc) {
+  float x;
+  if (argc < 1) {
+    mrbc_raise(vm, MRBC_CLASS(ArgumentError), "wrong number of arguments");
+    return;
+  }
+  if (!to_float(vm, &v[1], &x)) return;
+  int n = header(&v[0])->count;
+  if (is_float(&v[0])) {
+    float *d = float_data(&v[0]);
+    for (int i = 0; i < n; i++) d[i] = x;
+  } else {
+    int16_t *d = int16_data(&v[0]);
+    int16_t x16 = clamp16(x);
+    for (int i = 0; i < n; i++) d[i] = x16;
+  }
+}
+
+/**
+ * @brief sum: Integer for Int16Array, Float for Float32Array
+ */
+static void c_typed_array_sum(mrb_vm *vm, mrb_value *v, int argc) {
+  int n = header(&v[0])->count;
+  if (is_float(&v[0])) {
+    const float *d = float_data(&v[0]);
+    float sum = 0;
+    for (int i = 0; i < n; i++) sum += d[i];
+    SET_FLOAT_RETURN(sum);
+  } else {
+    const int16_t *d = int16_data(&v[0]);
+    int32_t sum = 0;
+    for (int i = 0; i < n; i++) sum += d[i];
+    SET_INT_RETURN(sum);
+  }
+}
+
+/**
+ * @brief Shared body of min and max; nil for an empty array
+ */
+static void min_max(mrb_vm *vm, mrb_value *v, bool want_max) {
+  int n = header(&v[0])->count;
+  if (n == 0) {
+    SET_NIL_RETURN();
+    return;
+  }
+  if (is_float(&v[0])) {
+    const float *d = float_data(&v[0]);
+    float m = d[0];
+    for (int i = 1; i < n; i++) {
+      if (want_max ? (d[i] > m) : (d[i] < m)) m = d[i];
+    }
+    SET_FLOAT_RETURN(m);
+  } else {
+    const int16_t *d = int16_data(&v[0]);
+    int16_t m = d[0];
+    for (int i = 1; i < n; i++) {
+      if (want_max ? (d[i] > m) : (d[i] < m)) m = d[i];
+    }
+    SET_INT_RETURN(m);
+  }
+}
+
+static void c_typed_array_min(mrb_vm *vm, mrb_value *v, int argc) {
+  min_max(vm, v, false);
+}
+
+static void c_typed_array_max(mrb_vm *vm, mrb_value *v, int argc) {
+  min_max(vm, v, true);
+}
+
+/**
+ * @brief Parses the operation name of map!
+ *
+ * @return true if the name is known
+ */
+static bool parse_op(const mrb_value *val, typed_array_op_t *op) {
+  static const struct {
+    const char *name;
+    typed_array_op_t op;
+  } ops[] = {{"+", kOpAdd}, {"-", kOpSub},   {"*", kOpMul},  {"/", kOpDiv},
+             {"min", kOpMin}, {"max", kOpMax}, {"abs", kOpAbs}};
+  const char *name;
+  if (val->tt == MRBC_TT_STRING) {
+    name = mrbc_string_cstr(val);
+  } else if (val->tt == MRBC_TT_SYMBOL) {
+    name = mrbc_symid_to_str(val->i);
+  } else {
+    return false;
+  }
+  for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++) {
+    if (strcmp(name, ops[i].name) == 0) {
+      *op = ops[i].op;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Applies one operation to an element
+ */
+static float apply_op(typed_array_op_t op, float x, float operand) {
+  switch (op) {
+    case kOpAdd:
+      return x + operand;
+    case kOpSub:
+      return x - operand;
+    case kOpMul:
+      return x * operand;
+    case kOpDiv:
+      return (operand != 0) ? x / operand : x;
+    case kOpMin:
+      return (x < operand) ? x : operand;
+    case kOpMax:
+      return (x > operand) ? x : operand;
+    case kOpAbs:
+      return (x < 0) ? -x : x;
+  }
+  return x;
+}
+
+/**
+ * @brief map!(op, [operand]): applies op to every element in place
+ *
+ * op is "+", "-", "*", "/", "min", "max" or "abs" (String or Symbol).
+ * Int16Array results are saturated; division by 0 leaves elements as they
+ * are. Returns self.
+ */
+static void c_typed_array_map(mrb_vm *vm, mrb_value *v, int argc) {
+  typed_array_op_t op;
+  if (argc < 1 || !parse_op(&v[1], &op)) {
+    mrbc_raise(vm, MRBC_CLASS(ArgumentError), "unknown operation");
+    return;
+  }
+  float operand = 0;
+  if (op != kOpAbs) {
+    if (argc < 2) {
+      mrbc_raise(vm, MRBC_CLASS(ArgumentError), "operand missing");
+      return;
+    }
+    if (!to_float(vm, &v[2], &operand)) return;
+  }
+
+  int n = header(&v[0])->count;
+  if (is_float(&v[0])) {
+    float *d = float_data(&v[0]);
+    for (int i = 0; i < n; i++) d[i] = apply_op(op, d[i], operand);
+  } else if (op == kOpAdd || op == kOpSub) {
+    // integer path for the common offset case
+    int16_t *d = int16_data(&v[0]);
+    int32_t k = (int32_t)((op == kOpAdd) ? operand : -operand);
+    for (int i = 0; i < n; i++) {
+      int32_t x = d[i] + k;
+      d[i] = (x > INT16_MAX) ? INT16_MAX : (x < INT16_MIN) ? INT16_MIN : x;
+    }
+  } else {
+    int16_t *d = int16_data(&v[0]);
+    for (int i = 0; i < n; i++) d[i] = clamp16(apply_op(op, d[i], operand));
+  }
+}
+
+/**
+ * @brief to_a: copies the elements into a new Array
+ */
+static void c_typed_array_to_a(mrb_vm *vm, mrb_value *v, int argc) {
+  int n = header(&v[0])->count;
+  mrbc_value ret = mrbc_array_new(vm, n);
+  for (int i = 0; i < n; i++) {
+    mrbc_value e = is_float(&v[0]) ? mrbc_float_value(vm, float_data(&v[0])[i])
+                                   : mrbc_fixnum_value(int16_data(&v[0])[i]);
+    mrbc_array_set(&ret, i, &e);
+  }
+  SET_RETURN(ret);
+}
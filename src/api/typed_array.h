@@ -0,0 +1,56 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file typed_array.h
+ * @brief API interface for packed numeric arrays in mruby/c
+ *
+ * Defines the Int16Array and Float32Array classes. Elements are stored
+ * packed inside the instance (2 or 4 bytes each instead of one mrbc_value),
+ * and other classes can reach the storage directly through the accessors
+ * below.
+ */
+#ifndef API_TYPED_ARRAY_H
+#define API_TYPED_ARRAY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../lib/fn.h"
+#include "mrubyc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Defines the Int16Array and Float32Array classes for mruby/c
+ *
+ * @return kSuccess always
+ */
+fn_t api_typed_array_define(void);
+
+/**
+ * @brief Returns the element storage of an Int16Array or Float32Array
+ *
+ * @param v Value to inspect
+ * @param bytes Size of the storage in bytes (may be NULL)
+ * @return Pointer to the elements, or NULL if v is not a typed array
+ */
+uint8_t *typed_array_bytes(const mrbc_value *v, size_t *bytes);
+
+/**
+ * @brief Returns the elements of an Int16Array
+ *
+ * @param v Value to inspect
+ * @param count Number of elements (may be NULL)
+ * @return Pointer to the elements, or NULL if v is not an Int16Array
+ */
+int16_t *typed_array_int16(const mrbc_value *v, int *count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -19,9 +19,11 @@
 // Include the driver layer header
 #include "../drv/uart.h"  // Use the driver layer
 #include "../lib/fn.h"
+#include "typed_array.h"
 // #include "driver/gpio.h"        // GPIO included via drv/uart.h or not needed
 // #include "driver/uart.h"        // UART driver included via drv/uart.h
 #include "esp_log.h"            // For logging
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"  // For pdMS_TO_TICKS indirectly if needed for timeouts
 #include "freertos/task.h"  // For pdMS_TO_TICKS indirectly if needed for timeouts
 #include "mrubyc.h"
@@ -30,15 +32,37 @@
 // static bool uart_initialized[UART_NUM_MAX] = {false};
 static const char *TAG = "mrbc_uart";
 
+/**
+ * @brief wait_dataで停止中のmruby/cタスク (ポートごとに1つ)
+ *
+ * tcbはhal_disable_irq()の中でだけ読み書きする。
+ */
+typedef struct {
+  mrbc_tcb *tcb;              // 停止中のタスク、なければNULL
+  esp_timer_handle_t timer;   // タイムアウト用
+  int64_t woken_us;           // データ到着で再開させた時刻、0は未計測
+  uint32_t max_wake_us;       // 再開からRuby側の次の呼び出しまでの最大値
+} uart_waiter_t;
+
+static uart_waiter_t uart_waiters[UART_NUM_MAX];
+
 /**
  * @brief mruby/c用のメソッド実装の前方宣言
  */
 static void c_uart_init(mrb_vm *vm, mrb_value *v, int argc);
 static void c_uart_write(mrb_vm *vm, mrb_value *v, int argc);
+static void c_uart_write_async(mrb_vm *vm, mrb_value *v, int argc);
+static void c_uart_flush(mrb_vm *vm, mrb_value *v, int argc);
 static void c_uart_read(mrb_vm *vm, mrb_value *v, int argc);
 static void c_uart_read_until(mrb_vm *vm, mrb_value *v, int argc);
+static void c_uart_read_into(mrb_vm *vm, mrb_value *v, int argc);
 static void c_uart_deinit(mrb_vm *vm, mrb_value *v, int argc);
 static void c_uart_available(mrb_vm *vm, mrb_value *v, int argc);
+static void c_uart_wait_data(mrb_vm *vm, mrb_value *v, int argc);
+static void c_uart_wait_any(mrb_vm *vm, mrb_value *v, int argc);
+static void c_uart_rx_time(mrb_vm *vm, mrb_value *v, int argc);
+static void c_uart_stats(mrb_vm *vm, mrb_value *v, int argc);
+static void c_uart_tx_stats(mrb_vm *vm, mrb_value *v, int argc);
 
 /**
  * @brief mruby/c用のUARTクラスとメソッドを定義
@@ -53,14 +77,114 @@ fn_t api_uart_define(void) {
 
   mrbc_define_method(0, class_uart, "init", c_uart_init);
   mrbc_define_method(0, class_uart, "write", c_uart_write);
+  mrbc_define_method(0, class_uart, "write_async", c_uart_write_async);
+  mrbc_define_method(0, class_uart, "flush", c_uart_flush);
   mrbc_define_method(0, class_uart, "read", c_uart_read);
   mrbc_define_method(0, class_uart, "read_until", c_uart_read_until);
+  mrbc_define_method(0, class_uart, "read_into", c_uart_read_into);
   mrbc_define_method(0, class_uart, "deinit", c_uart_deinit);
   mrbc_define_method(0, class_uart, "available", c_uart_available);
+  mrbc_define_method(0, class_uart, "wait_data", c_uart_wait_data);
+  mrbc_define_method(0, class_uart, "wait_any", c_uart_wait_any);
+  mrbc_define_method(0, class_uart, "rx_time", c_uart_rx_time);
+  mrbc_define_method(0, class_uart, "stats", c_uart_stats);
+  mrbc_define_method(0, class_uart, "tx_stats", c_uart_tx_stats);
+
+  // VMの再起動で前のタスクは消えている
+  for (int i = 0; i < UART_NUM_MAX; i++) {
+    if (uart_waiters[i].timer) esp_timer_stop(uart_waiters[i].timer);
+    hal_disable_irq();
+    uart_waiters[i].tcb = NULL;
+    hal_enable_irq();
+    uart_waiters[i].woken_us = 0;
+  }
 
   return kSuccess;
 }
 
+/**
+ * @brief 待機中のタスクを再開させる
+ *
+ * @param port_num ポート番号
+ * @param by_data データ到着による再開ならtrue (再開遅延を計測する)
+ */
+static void uart_wake_waiter(uart_port_t port_num, bool by_data) {
+  bool cleared[UART_NUM_MAX] = {false};
+
+  // wait_anyで複数ポートに登録したタスクは、全ポートから外す
+  hal_disable_irq();
+  mrbc_tcb *tcb = uart_waiters[port_num].tcb;
+  if (tcb) {
+    for (int i = 0; i < UART_NUM_MAX; i++) {
+      if (uart_waiters[i].tcb == tcb) {
+        uart_waiters[i].tcb = NULL;
+        cleared[i] = true;
+      }
+    }
+  }
+  hal_enable_irq();
+  if (!tcb) return;
+
+  for (int i = 0; i < UART_NUM_MAX; i++) {
+    if (cleared[i] && uart_waiters[i].timer) {
+      esp_timer_stop(uart_waiters[i].timer);
+    }
+  }
+  if (by_data) uart_waiters[port_num].woken_us = esp_timer_get_time();
+  mrbc_resume_task(tcb);
+}
+
+/**
+ * @brief サービスタスクから呼ばれるデータ到着通知
+ */
+static void uart_rx_notify(uart_port_t port_num, void *arg) {
+  if (uart_waiters[port_num].tcb == NULL) return;
+  uart_wake_waiter(port_num, true);
+}
+
+/**
+ * @brief wait_data/wait_anyのタイムアウト (esp_timerタスクから呼ばれる)
+ */
+static void uart_wait_timeout(void *arg) {
+  uart_wake_waiter((uart_port_t)(intptr_t)arg, false);
+}
+
+/**
+ * @brief データ到着による再開からの遅延を記録する
+ *
+ * 再開後にRuby側から最初に呼ばれたUARTメソッドで計測する。
+ */
+static void uart_note_resumed(uart_port_t port_num) {
+  int64_t woken = uart_waiters[port_num].woken_us;
+  if (woken == 0) return;
+  uint32_t us = (uint32_t)(esp_timer_get_time() - woken);
+  if (us > uart_waiters[port_num].max_wake_us) {
+    uart_waiters[port_num].max_wake_us = us;
+  }
+  uart_waiters[port_num].woken_us = 0;
+}
+
+/**
+ * @brief 読み込んだ長さにStringを合わせる
+ *
+ * ドライバはStringのデータ領域へ直接書き込むので、一時バッファからの
+ * コピーは発生しない。
+ *
+ * @param vm mruby/c VMへのポインタ
+ * @param str 対象のString
+ * @param len 読み込んだバイト数
+ * @param shrink trueなら余った領域をヒープに返す
+ */
+static void uart_string_set_size(mrb_vm *vm, mrbc_value *str, int len,
+                                 bool shrink) {
+  if (shrink && len < str->string->size) {
+    uint8_t *data = (uint8_t *)mrbc_realloc(vm, str->string->data, len + 1);
+    if (data) str->string->data = data;
+  }
+  str->string->size = len;
+  str->string->data[len] = '\0';
+}
+
 /**
  * @brief UARTクラスのinitメソッドの実装 (ドライバ層呼び出し)
  *
@@ -143,85 +267,116 @@ static void c_uart_init(mrb_vm *vm, mrb_value *v, int argc) {
 }
 
 /**
- * @brief UARTクラスのwriteメソッドの実装 (ドライバ層呼び出し)
+ * @brief write/write_asyncの引数から送信データを取り出す
  *
- * UARTポートからデータを送信します。
- * 引数: port_num - ポート番号(1または2), data -
- * 送信データ（文字列またはバイト配列） 戻り値: 送信したバイト数、エラー時は-1
+ * 型付き配列とStringは要素領域をそのまま返す。Arrayは一時バッファに
+ * 詰め直すので、送信後にmrbc_freeで解放すること (*temp_buf)。
  *
  * @param vm mruby/c VMへのポインタ
  * @param v メソッド引数へのポインタ
  * @param argc 引数の数
+ * @param name ログ用のメソッド名
+ * @param port_num ポート番号の格納先
+ * @param data データ先頭の格納先
+ * @param len データ長の格納先
+ * @param temp_buf 一時バッファの格納先 (不要ならNULL)
+ * @return kSuccess 成功, kFailure 引数エラー
  */
-static void c_uart_write(mrb_vm *vm, mrb_value *v, int argc) {
-  SET_INT_RETURN(-1);  // Default to error (-1 bytes written)
+static fn_t uart_get_write_args(mrb_vm *vm, mrb_value *v, int argc,
+                                const char *name, uart_port_t *port_num,
+                                const void **data, size_t *len,
+                                uint8_t **temp_buf) {
+  *temp_buf = NULL;
 
   // Args: port_num, data (String or Array)
   if (argc < 2 || v[1].tt != MRBC_TT_INTEGER) {
-    ESP_LOGE(TAG, "write: invalid argument count or type for port");
-    return;
+    ESP_LOGE(TAG, "%s: invalid argument count or type for port", name);
+    return kFailure;
   }
 
   int port_num_int = v[1].i;
 
   // Port number check
   if (port_num_int < 0 || port_num_int >= UART_NUM_MAX) {
-    ESP_LOGE(TAG, "write: invalid UART port number %d", port_num_int);
-    return;
+    ESP_LOGE(TAG, "%s: invalid UART port number %d", name, port_num_int);
+    return kFailure;
   }
-  uart_port_t port_num = (uart_port_t)port_num_int;
+  *port_num = (uart_port_t)port_num_int;
 
   // Initialization check is handled by the driver layer
 
-  const void *data_ptr = NULL;
-  size_t data_len = 0;
-  uint8_t *temp_buf = NULL;  // For array conversion
-  if (v[2].tt == MRBC_TT_STRING) {
+  uint8_t *typed = typed_array_bytes(&v[2], len);
+  if (typed) {
+    // Int16Array / Float32Array: raw element bytes, no copy
+    *data = (const void *)typed;
+  } else if (v[2].tt == MRBC_TT_STRING) {
     // String data
-    data_ptr =
-        (const void *)mrbc_string_cstr(&v[2]);  // Use safe C string getter
-    data_len = mrbc_string_size(&v[2]);
+    *data = (const void *)mrbc_string_cstr(&v[2]);  // Use safe C string getter
+    *len = mrbc_string_size(&v[2]);
   } else if (v[2].tt == MRBC_TT_ARRAY) {
     // Array data (byte array)
-    data_len = mrbc_array_size(&v[2]);
-    if (data_len == 0) {
-      SET_INT_RETURN(0);  // Wrote 0 bytes
-      return;
+    *len = mrbc_array_size(&v[2]);
+    *data = NULL;
+    if (*len == 0) {
+      return kSuccess;  // Nothing to send
     }
 
     // Allocate temporary buffer
-    temp_buf = (uint8_t *)mrbc_alloc(vm, data_len);
-    if (!temp_buf) {
-      ESP_LOGE(TAG, "write: failed to allocate buffer for array write");
-      return;  // Returns -1
+    uint8_t *buf = (uint8_t *)mrbc_alloc(vm, *len);
+    if (!buf) {
+      ESP_LOGE(TAG, "%s: failed to allocate buffer for array write", name);
+      return kFailure;
     }
 
     // Extract bytes from array
-    bool type_error = false;
-    for (int i = 0; i < data_len; i++) {
+    for (int i = 0; i < *len; i++) {
       mrb_value item = mrbc_array_get(&v[2], i);
-      if (item.tt == MRBC_TT_INTEGER) {
-        int val = item.i;
-        // Clip to 0-255
-        if (val < 0) val = 0;
-        if (val > 255) val = 255;
-        temp_buf[i] = (uint8_t)val;
-      } else {
-        type_error = true;
-        break;
+      if (item.tt != MRBC_TT_INTEGER) {
+        ESP_LOGE(TAG, "%s: array contains non-integer elements", name);
+        mrbc_free(vm, buf);
+        return kFailure;
       }
+      int val = item.i;
+      // Clip to 0-255
+      if (val < 0) val = 0;
+      if (val > 255) val = 255;
+      buf[i] = (uint8_t)val;
     }
-
-    if (type_error) {
-      ESP_LOGE(TAG, "write: array contains non-integer elements");
-      mrbc_free(vm, temp_buf);
-      return;  // Returns -1
-    }
-    data_ptr = (const void *)temp_buf;
+    *data = (const void *)buf;
+    *temp_buf = buf;
   } else {
-    ESP_LOGE(TAG, "write: data must be String or Array");
+    ESP_LOGE(TAG, "%s: data must be String, Array or typed array", name);
+    return kFailure;
+  }
+  return kSuccess;
+}
+
+/**
+ * @brief UARTクラスのwriteメソッドの実装 (ドライバ層呼び出し)
+ *
+ * UARTポートからデータを送信します。
+ * 引数: port_num - ポート番号(1または2), data -
+ * 送信データ（文字列またはバイト配列） 戻り値: 送信したバイト数、エラー時は-1
+ *
+ * @param vm mruby/c VMへのポインタ
+ * @param v メソッド引数へのポインタ
+ * @param argc 引数の数
+ */
+static void c_uart_write(mrb_vm *vm, mrb_value *v, int argc) {
+  SET_INT_RETURN(-1);  // Default to error (-1 bytes written)
+
+  uart_port_t port_num;
+  const void *data_ptr;
+  size_t data_len;
+  uint8_t *temp_buf;
+  if (uart_get_write_args(vm, v, argc, "write", &port_num, &data_ptr,
+                          &data_len, &temp_buf) != kSuccess) {
     return;  // Returns -1
   }
+  if (data_len == 0) {
+    SET_INT_RETURN(0);  // Wrote 0 bytes
+    return;
+  }
 
   // Call driver write function
   int written = drv_uart_write(port_num, data_ptr, data_len);
@@ -235,6 +390,69 @@ static void c_uart_write(mrb_vm *vm, mrb_value *v, int argc) {
   SET_INT_RETURN(written);
 }
 
+/**
+ * @brief UARTクラスのwrite_asyncメソッドの実装 (ドライバ層呼び出し)
+ *
+ * データを送信キューに積んで、送信完了を待たずに戻ります。キューに
+ * 入りきらなかった分は積まれません (戻り値がデータ長より小さくなる)。
+ * 引数: port_num - ポート番号, data - 送信データ（writeと同じ）
+ * 戻り値: キューに積んだバイト数、エラー時は-1
+ *
+ * @param vm mruby/c VMへのポインタ
+ * @param v メソッド引数へのポインタ
+ * @param argc 引数の数
+ */
+static void c_uart_write_async(mrb_vm *vm, mrb_value *v, int argc) {
+  SET_INT_RETURN(-1);  // Default to error
+
+  uart_port_t port_num;
+  const void *data_ptr;
+  size_t data_len;
+  uint8_t *temp_buf;
+  if (uart_get_write_args(vm, v, argc, "write_async", &port_num, &data_ptr,
+                          &data_len, &temp_buf) != kSuccess) {
+    return;
+  }
+
+  int queued = drv_uart_write_async(port_num, data_ptr, data_len);
+  if (temp_buf) {
+    mrbc_free(vm, temp_buf);
+  }
+  SET_INT_RETURN(queued);
+}
+
+/**
+ * @brief UARTクラスのflushメソッドの実装 (ドライバ層呼び出し)
+ *
+ * write_asyncで積んだデータがすべて送出されるまで待ちます。
+ * 引数: port_num - ポート番号, [timeout_ms] - タイムアウト（ミリ秒、
+ * デフォルト1000ms）
+ * 戻り値: 送出し終えたらtrue、タイムアウトやエラーならfalse
+ *
+ * @param vm mruby/c VMへのポインタ
+ * @param v メソッド引数へのポインタ
+ * @param argc 引数の数
+ */
+static void c_uart_flush(mrb_vm *vm, mrb_value *v, int argc) {
+  SET_FALSE_RETURN();
+
+  if (argc < 1 || v[1].tt != MRBC_TT_INTEGER || v[1].i < 0 ||
+      v[1].i >= UART_NUM_MAX) {
+    ESP_LOGE(TAG, "flush: invalid UART port number");
+    return;
+  }
+  uart_port_t port_num = (uart_port_t)v[1].i;
+
+  uint32_t timeout_ms = 1000;  // Default timeout
+  if (argc >= 2 && v[2].tt == MRBC_TT_INTEGER) {
+    timeout_ms = (v[2].i < 0) ? 0 : (uint32_t)v[2].i;
+  }
+
+  if (drv_uart_flush(port_num, timeout_ms) == kSuccess) {
+    SET_TRUE_RETURN();
+  }
+}
+
 /**
  * @brief UARTクラスのreadメソッドの実装 (ドライバ層呼び出し)
  *
@@ -269,6 +487,7 @@ static void c_uart_read(mrb_vm *vm, mrb_value *v, int argc) {
     return;
   }
   uart_port_t port_num = (uart_port_t)port_num_int;
+  uart_note_resumed(port_num);
 
   // Length check
   if (length <= 0) {
@@ -284,34 +503,29 @@ static void c_uart_read(mrb_vm *vm, mrb_value *v, int argc) {
     timeout_ms = (timeout_arg < 0) ? 0 : (uint32_t)timeout_arg;
   }
 
-  // Allocate buffer for reading
-  uint8_t *buf = (uint8_t *)mrbc_alloc(vm, length);
-  if (!buf) {
+  // 結果のStringを先に確保し、ドライバにそのデータ領域へ直接読ませる
+  mrbc_value result = mrbc_string_new(vm, NULL, length);
+  if (result.tt != MRBC_TT_STRING) {
     ESP_LOGE(TAG, "read: failed to allocate buffer (%d bytes)", length);
     SET_NIL_RETURN();
     return;
   }
 
   // Call driver read function
-  int read_bytes = drv_uart_read(port_num, buf, length, timeout_ms);
+  int read_bytes =
+      drv_uart_read(port_num, result.string->data, length, timeout_ms);
 
-  if (read_bytes > 0) {
-    // Success: return string with read data
-    mrbc_value result = mrbc_string_new(vm, (const char *)buf, read_bytes);
-    SET_RETURN(result);
-  } else if (read_bytes == 0) {
-    // Timeout or no data: return empty string
-    mrbc_value result = mrbc_string_new_cstr(vm, "");
+  if (read_bytes >= 0) {
+    // Success (0 bytes on timeout): shrink to the data actually read
+    uart_string_set_size(vm, &result, read_bytes, true);
     SET_RETURN(result);
   } else {
     // Error from driver layer
     ESP_LOGE(TAG, "drv_uart_read for UART%d failed (returned %d)", port_num,
              read_bytes);
+    mrbc_decref(&result);
     SET_NIL_RETURN();  // Return nil on error
   }
-
-  // Free buffer
-  mrbc_free(vm, buf);
 }
 
 /**
@@ -361,6 +575,7 @@ static void c_uart_read_until(mrb_vm *vm, mrb_value *v, int argc) {
     return;
   }
   uart_port_t port_num = (uart_port_t)port_num_int;
+  uart_note_resumed(port_num);
 
   // Length check
   if (length <= 0) {
@@ -394,34 +609,111 @@ static void c_uart_read_until(mrb_vm *vm, mrb_value *v, int argc) {
     timeout_ms = (timeout_arg < 0) ? 0 : (uint32_t)timeout_arg;
   }
 
-  // Allocate buffer for reading
-  uint8_t *buf = (uint8_t *)mrbc_alloc(vm, length);
-  if (!buf) {
+  // 結果のStringを先に確保し、ドライバにそのデータ領域へ直接読ませる
+  mrbc_value result = mrbc_string_new(vm, NULL, length);
+  if (result.tt != MRBC_TT_STRING) {
     ESP_LOGE(TAG, "read_until: failed to allocate buffer (%d bytes)", length);
     return;
   }
 
   // Call driver read_until function
-  int read_bytes =
-      drv_uart_read_until(port_num, buf, length, delimiter, timeout_ms);
+  int read_bytes = drv_uart_read_until(port_num, result.string->data, length,
+                                       delimiter, timeout_ms);
 
-  if (read_bytes > 0) {
-    // Success: return string with read data
-    mrbc_value result = mrbc_string_new(vm, (const char *)buf, read_bytes);
-    SET_RETURN(result);
-  } else if (read_bytes == 0) {
-    // Timeout or no data: return empty string
-    mrbc_value result = mrbc_string_new_cstr(vm, "");
+  if (read_bytes >= 0) {
+    // Success (0 bytes on timeout): shrink to the data actually read
+    uart_string_set_size(vm, &result, read_bytes, true);
     SET_RETURN(result);
   } else {
     // Error from driver layer
     ESP_LOGE(TAG, "drv_uart_read_until for UART%d failed (returned %d)",
              port_num, read_bytes);
+    mrbc_decref(&result);
     // SET_NIL_RETURN is already set at the beginning
   }
+}
+
+/**
+ * @brief UARTクラスのread_intoメソッドの実装 (ドライバ層呼び出し)
+ *
+ * 受信データを既存のバッファへ直接読み込みます。バッファを使い回せば
+ * 受信ループはVMヒープから何も確保しません。
+ * - String: 内容を受信データで置き換えます。領域は必要なときだけ
+ *   lengthまで広げ、縮めないので、次の呼び出しでは確保が起きません。
+ * - Int16Array/Float32Array: 要素領域へ先頭から書き込みます。
+ * 引数: port_num - ポート番号, buf - 読み込み先, [length] -
+ * 最大バイト数（Stringでは必須、型付き配列ではbytesize以下、デフォルトは
+ * bytesize）, [timeout_ms] - タイムアウト（ミリ秒、デフォルト100ms）
+ * 戻り値: 受信したバイト数、エラー時は-1
+ *
+ * @param vm mruby/c VMへのポインタ
+ * @param v メソッド引数へのポインタ
+ * @param argc 引数の数
+ */
+static void c_uart_read_into(mrb_vm *vm, mrb_value *v, int argc) {
+  SET_INT_RETURN(-1);  // Default to error
+
+  // Args: port_num, buf, [length], [timeout_ms]
+  if (argc < 2 || v[1].tt != MRBC_TT_INTEGER) {
+    ESP_LOGE(TAG, "read_into: invalid argument count or type");
+    return;
+  }
+
+  int port_num_int = v[1].i;
+  uint32_t timeout_ms = 100;  // Default timeout
+
+  // Port number check
+  if (port_num_int < 0 || port_num_int >= UART_NUM_MAX) {
+    ESP_LOGE(TAG, "read_into: invalid UART port number %d", port_num_int);
+    return;
+  }
+  uart_port_t port_num = (uart_port_t)port_num_int;
+  uart_note_resumed(port_num);
+
+  int length = -1;
+  if (argc >= 3 && v[3].tt == MRBC_TT_INTEGER) length = v[3].i;
+
+  // Optional timeout argument
+  if (argc >= 4 && v[4].tt == MRBC_TT_INTEGER) {
+    int timeout_arg = v[4].i;
+    timeout_ms = (timeout_arg < 0) ? 0 : (uint32_t)timeout_arg;
+  }
 
-  // Free buffer
-  mrbc_free(vm, buf);
+  size_t capacity = 0;
+  uint8_t *buf = typed_array_bytes(&v[2], &capacity);
+  if (buf) {
+    if (length < 0 || (size_t)length > capacity) length = capacity;
+  } else if (v[2].tt == MRBC_TT_STRING) {
+    if (length < 0) {
+      ESP_LOGE(TAG, "read_into: length is required for a String");
+      return;
+    }
+    // 領域が足りないときだけ広げる。縮めないので、同じStringを使い回せば
+    // 次の呼び出しでは確保が起きない
+    buf = v[2].string->data;
+    if (mrbc_alloc_usable_size(buf) < (unsigned int)length + 1) {
+      buf = (uint8_t *)mrbc_realloc(vm, buf, length + 1);
+      if (!buf) {
+        ESP_LOGE(TAG, "read_into: failed to allocate buffer (%d bytes)",
+                 length);
+        return;
+      }
+      v[2].string->data = buf;
+    }
+  } else {
+    ESP_LOGE(TAG, "read_into: buffer must be a String or typed array");
+    return;
+  }
+
+  int read_bytes = 0;
+  if (length > 0) {
+    // Call driver read function
+    read_bytes = drv_uart_read(port_num, buf, length, timeout_ms);
+  }
+  if (v[2].tt == MRBC_TT_STRING) {
+    uart_string_set_size(vm, &v[2], read_bytes < 0 ? 0 : read_bytes, false);
+  }
+  SET_INT_RETURN(read_bytes);
 }
 
 /**
@@ -494,6 +786,7 @@ static void c_uart_available(mrb_vm *vm, mrb_value *v, int argc) {
     return;
   }
   uart_port_t port_num = (uart_port_t)port_num_int;
+  uart_note_resumed(port_num);
 
   size_t available_bytes = 0;
   // Call driver get_available function
@@ -506,4 +799,319 @@ static void c_uart_available(mrb_vm *vm, mrb_value *v, int argc) {
     // ESP_LOGE(TAG, "drv_uart_get_available for UART%d failed.", port_num);
     SET_INT_RETURN(0);  // Return 0 on failure
   }
-}
\ No newline at end of file
+}
+
+/**
+ * @brief uart_waitの結果
+ */
+#define UART_WAIT_SUSPENDED (-1)  // タスクを停止した
+#define UART_WAIT_NONE (-2)       // データなし (タイムアウト0)
+#define UART_WAIT_ERROR (-3)
+
+/**
+ * @brief 受信データがある最初のポートを探す
+ *
+ * @return ポート番号、なければUART_WAIT_NONE
+ */
+static int uart_find_ready(const uart_port_t *ports, int count) {
+  for (int i = 0; i < count; i++) {
+    size_t available_bytes = 0;
+    drv_uart_get_available(ports[i], &available_bytes);
+    if (available_bytes > 0) return ports[i];
+  }
+  return UART_WAIT_NONE;
+}
+
+/**
+ * @brief いずれかのポートに受信データが来るまで呼び出したタスクを停止する
+ *
+ * 全ポートに同じタスクを登録し、最初のデータ到着で全ポートから外して
+ * 再開させる。タイムアウトは先頭ポートのタイマーで計る。
+ *
+ * @param vm mruby/c VMへのポインタ
+ * @param ports ポート番号の配列 (範囲チェック済み)
+ * @param count ポート数 (1以上)
+ * @param timeout_ms タイムアウト（ミリ秒）
+ * @param name ログ用のメソッド名
+ * @return データがあるポート番号、UART_WAIT_SUSPENDED、UART_WAIT_NONE
+ * またはUART_WAIT_ERROR
+ */
+static int uart_wait(mrb_vm *vm, const uart_port_t *ports, int count,
+                     uint32_t timeout_ms, const char *name) {
+  // 通知の登録 (未初期化ポートはここで弾かれる)
+  for (int i = 0; i < count; i++) {
+    uart_waiter_t *w = &uart_waiters[ports[i]];
+    if (drv_uart_set_rx_notify(ports[i], uart_rx_notify, NULL) != kSuccess) {
+      ESP_LOGE(TAG, "%s: UART%d not initialized", name, ports[i]);
+      return UART_WAIT_ERROR;
+    }
+    if (!w->timer) {
+      const esp_timer_create_args_t args = {
+          .callback = uart_wait_timeout,
+          .arg = (void *)(intptr_t)ports[i],
+          .name = "uart_wait",
+      };
+      if (esp_timer_create(&args, &w->timer) != ESP_OK) {
+        ESP_LOGE(TAG, "%s: timer creation failed", name);
+        return UART_WAIT_ERROR;
+      }
+    }
+  }
+
+  mrbc_tcb *tcb = VM2TCB(vm);
+
+  // 先に登録してから残量を確認し、その間に届いた通知を取りこぼさない
+  hal_disable_irq();
+  for (int i = 0; i < count; i++) {
+    if (uart_waiters[ports[i]].tcb != NULL) {
+      hal_enable_irq();
+      ESP_LOGE(TAG, "%s: UART%d already has a waiting task", name, ports[i]);
+      return UART_WAIT_ERROR;
+    }
+  }
+  for (int i = 0; i < count; i++) {
+    uart_waiters[ports[i]].tcb = tcb;
+  }
+  hal_enable_irq();
+
+  // 停止より前にタイマーを動かす。停止後に動かすと、その間に届いた通知が
+  // まだ動いていないタイマーを止め、待ち手のいないタイマーが残って
+  // 次の待ちを早く起こしてしまう。停止しない経路ではすべて止める
+  esp_timer_handle_t timer = uart_waiters[ports[0]].timer;
+  if (timeout_ms > 0) {
+    esp_timer_stop(timer);
+    esp_timer_start_once(timer, (uint64_t)timeout_ms * 1000);
+  }
+
+  int ready = uart_find_ready(ports, count);
+
+  hal_disable_irq();
+  if (uart_waiters[ports[0]].tcb != tcb) {
+    // 通知またはタイムアウトがすでに登録を外した
+    hal_enable_irq();
+    esp_timer_stop(timer);
+    return (ready >= 0) ? ready : uart_find_ready(ports, count);
+  }
+  if (ready >= 0 || timeout_ms == 0) {
+    for (int i = 0; i < count; i++) {
+      uart_waiters[ports[i]].tcb = NULL;
+    }
+    hal_enable_irq();
+    esp_timer_stop(timer);
+    return ready;
+  }
+  mrbc_suspend_task(tcb);
+  hal_enable_irq();
+  return UART_WAIT_SUSPENDED;
+}
+
+/**
+ * @brief UARTクラスのwait_dataメソッドの実装
+ *
+ * 受信データが来るまで呼び出したRubyタスクだけを停止します。
+ * uart_read_bytesのようにVM全体をブロックしないので、その間も他の
+ * Rubyタスクは動き続けます。データ到着時にサービスタスクから再開され、
+ * タイムアウトでも再開されます。
+ * 引数: port_num - ポート番号, [timeout_ms] - タイムアウト（ミリ秒、
+ * デフォルト1000ms）
+ * 戻り値: すでにデータがあればtrue（待たない）、待った場合はnil
+ * （再開後にavailableやreadで確認する）、エラー時はfalse
+ *
+ * @param vm mruby/c VMへのポインタ
+ * @param v メソッド引数へのポインタ
+ * @param argc 引数の数
+ */
+static void c_uart_wait_data(mrb_vm *vm, mrb_value *v, int argc) {
+  SET_FALSE_RETURN();  // Default to failure
+
+  // Args: port_num, [timeout_ms]
+  if (argc < 1 || v[1].tt != MRBC_TT_INTEGER) {
+    ESP_LOGE(TAG, "wait_data: invalid argument count or type");
+    return;
+  }
+
+  int port_num_int = v[1].i;
+  uint32_t timeout_ms = 1000;  // Default timeout: 1 second
+
+  // Port number check
+  if (port_num_int < 0 || port_num_int >= UART_NUM_MAX) {
+    ESP_LOGE(TAG, "wait_data: invalid UART port number %d", port_num_int);
+    return;
+  }
+  uart_port_t port_num = (uart_port_t)port_num_int;
+
+  if (argc >= 2 && v[2].tt == MRBC_TT_INTEGER) {
+    int timeout_arg = v[2].i;
+    timeout_ms = (timeout_arg < 0) ? 0 : (uint32_t)timeout_arg;
+  }
+
+  int result = uart_wait(vm, &port_num, 1, timeout_ms, "wait_data");
+  if (result >= 0) {
+    SET_TRUE_RETURN();
+  } else if (result == UART_WAIT_SUSPENDED) {
+    SET_NIL_RETURN();
+  }
+}
+
+/**
+ * @brief UARTクラスのwait_anyメソッドの実装
+ *
+ * 複数ポートのどれかに受信データが来るまで、呼び出したRubyタスクだけを
+ * 停止します (selectに相当)。1つのスクリプトでポーリングせずに複数の
+ * シリアル機器を中継できます。
+ * 引数: ports - ポート番号の配列, [timeout_ms] - タイムアウト（ミリ秒、
+ * デフォルト1000ms）
+ * 戻り値: すでにデータがあればそのポート番号（配列の順で最初のもの、
+ * 待たない）、待った場合はnil（再開後にもう一度呼ぶ）、データがなく
+ * タイムアウト0の場合やエラー時はfalse
+ *
+ * @param vm mruby/c VMへのポインタ
+ * @param v メソッド引数へのポインタ
+ * @param argc 引数の数
+ */
+static void c_uart_wait_any(mrb_vm *vm, mrb_value *v, int argc) {
+  SET_FALSE_RETURN();  // Default to failure
+
+  // Args: ports, [timeout_ms]
+  if (argc < 1 || v[1].tt != MRBC_TT_ARRAY) {
+    ESP_LOGE(TAG, "wait_any: ports must be an Array");
+    return;
+  }
+  int count = mrbc_array_size(&v[1]);
+  if (count < 1 || count > UART_NUM_MAX) {
+    ESP_LOGE(TAG, "wait_any: 1 to %d ports expected", UART_NUM_MAX);
+    return;
+  }
+
+  uart_port_t ports[UART_NUM_MAX];
+  for (int i = 0; i < count; i++) {
+    mrbc_value port = mrbc_array_get(&v[1], i);
+    if (port.tt != MRBC_TT_INTEGER || port.i < 0 || port.i >= UART_NUM_MAX) {
+      ESP_LOGE(TAG, "wait_any: invalid UART port number");
+      return;
+    }
+    ports[i] = (uart_port_t)port.i;
+  }
+
+  uint32_t timeout_ms = 1000;  // Default timeout: 1 second
+  if (argc >= 2 && v[2].tt == MRBC_TT_INTEGER) {
+    int timeout_arg = v[2].i;
+    timeout_ms = (timeout_arg < 0) ? 0 : (uint32_t)timeout_arg;
+  }
+
+  int result = uart_wait(vm, ports, count, timeout_ms, "wait_any");
+  if (result >= 0) {
+    uart_note_resumed(result);
+    SET_INT_RETURN(result);
+  } else if (result == UART_WAIT_SUSPENDED) {
+    SET_NIL_RETURN();
+  }
+}
+
+/**
+ * @brief UARTクラスのrx_timeメソッドの実装
+ *
+ * 最後に受信データがバッファに入った時刻を返します。サービスタスクが
+ * データをリングに移した時点の時刻なので、Ruby側の処理遅延を含みません。
+ * 引数: port_num - ポート番号
+ * 戻り値: 起動からの時刻（マイクロ秒、まだ受信がなければ0）、エラー時はnil
+ *
+ * @param vm mruby/c VMへのポインタ
+ * @param v メソッド引数へのポインタ
+ * @param argc 引数の数
+ */
+static void c_uart_rx_time(mrb_vm *vm, mrb_value *v, int argc) {
+  SET_NIL_RETURN();
+
+  if (argc < 1 || v[1].tt != MRBC_TT_INTEGER || v[1].i < 0 ||
+      v[1].i >= UART_NUM_MAX) {
+    ESP_LOGE(TAG, "rx_time: invalid UART port number");
+    return;
+  }
+
+  int64_t time_us;
+  if (drv_uart_get_rx_time((uart_port_t)v[1].i, &time_us) == kSuccess) {
+    SET_INT_RETURN(time_us);
+  }
+}
+
+/**
+ * @brief UARTクラスのstatsメソッドの実装
+ *
+ * 受信の統計を返します。
+ * 引数: port_num - ポート番号
+ * 戻り値: [受信バイト数, 破棄バイト数, イベント数, オーバーフロー回数,
+ * サービスタスクの処理時間(us), データ到着から再開までの最大遅延(us)]、
+ * エラー時はnil
+ *
+ * @param vm mruby/c VMへのポインタ
+ * @param v メソッド引数へのポインタ
+ * @param argc 引数の数
+ */
+static void c_uart_stats(mrb_vm *vm, mrb_value *v, int argc) {
+  SET_NIL_RETURN();
+
+  if (argc < 1 || v[1].tt != MRBC_TT_INTEGER || v[1].i < 0 ||
+      v[1].i >= UART_NUM_MAX) {
+    ESP_LOGE(TAG, "stats: invalid UART port number");
+    return;
+  }
+  uart_port_t port_num = (uart_port_t)v[1].i;
+
+  drv_uart_stats_t stats;
+  if (drv_uart_get_stats(port_num, &stats) != kSuccess) {
+    return;
+  }
+  int32_t values[] = {stats.rx_bytes,
+                      stats.rx_dropped,
+                      stats.rx_events,
+                      stats.hw_overflows,
+                      (int32_t)stats.service_us,
+                      uart_waiters[port_num].max_wake_us};
+  int n = sizeof(values) / sizeof(values[0]);
+  mrbc_value ret = mrbc_array_new(vm, n);
+  for (int i = 0; i < n; i++) {
+    mrbc_value val = mrbc_fixnum_value(values[i]);
+    mrbc_array_set(&ret, i, &val);
+  }
+  SET_RETURN(ret);
+}
+
+/**
+ * @brief UARTクラスのtx_statsメソッドの実装
+ *
+ * write_asyncの送信キューの統計を返します。
+ * 引数: port_num - ポート番号
+ * 戻り値: [キューに積んだバイト数, 送出したバイト数, 満杯で積めなかった
+ * バイト数, 積みきれなかった呼び出し回数, キューの現在の深さ,
+ * キューの容量]、エラー時はnil
+ *
+ * @param vm mruby/c VMへのポインタ
+ * @param v メソッド引数へのポインタ
+ * @param argc 引数の数
+ */
+static void c_uart_tx_stats(mrb_vm *vm, mrb_value *v, int argc) {
+  SET_NIL_RETURN();
+
+  if (argc < 1 || v[1].tt != MRBC_TT_INTEGER || v[1].i < 0 ||
+      v[1].i >= UART_NUM_MAX) {
+    ESP_LOGE(TAG, "tx_stats: invalid UART port number");
+    return;
+  }
+  uart_port_t port_num = (uart_port_t)v[1].i;
+
+  drv_uart_stats_t stats;
+  if (drv_uart_get_stats(port_num, &stats) != kSuccess) {
+    return;
+  }
+  int32_t values[] = {stats.tx_queued,   stats.tx_sent,
+                      stats.tx_rejected, stats.tx_backpressure,
+                      stats.tx_pending,  stats.tx_capacity};
+  int n = sizeof(values) / sizeof(values[0]);
+  mrbc_value ret = mrbc_array_new(vm, n);
+  for (int i = 0; i < n; i++) {
+    mrbc_value val = mrbc_fixnum_value(values[i]);
+    mrbc_array_set(&ret, i, &val);
+  }
+  SET_RETURN(ret);
+}
@@ -0,0 +1,277 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file uart_packet.c
+ * @brief Implementation of UART::Packet for mruby/c
+ *
+ * A frame on the wire is COBS(payload + CRC) followed by a zero byte. The
+ * CRC is CRC-16/MODBUS of the payload, sent low byte first, so running the
+ * CRC over payload and CRC together gives zero for a good frame. Receiving
+ * reads up to the next zero straight from the driver's RX ring, decodes in
+ * place and checks the CRC, so Ruby only ever sees validated payloads.
+ *
+ * The instance data holds the counters followed by the RX, TX and scratch
+ * buffers, so a packet object is a single VM heap block and the steady state
+ * allocates only the returned payload strings.
+ */
+#include "uart_packet.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../drv/uart.h"
+#include "../lib/cobs/cobs.h"
+#include "../lib/crc/crc.h"
+#include "../lib/fn.h"
+#include "esp_timer.h"
+#include "mrubyc.h"
+
+#define UART_PACKET_CRC_POLY 0xA001U  // CRC-16/MODBUS, reflected
+#define UART_PACKET_CRC_SEED 0xFFFFU
+#define UART_PACKET_CRC_SIZE 2
+#define UART_PACKET_DEFAULT_MAX_PAYLOAD 256
+#define UART_PACKET_DEFAULT_TIMEOUT_MS 100
+
+/**
+ * @brief Instance data layout, followed by rx[frame_size], tx[frame_size]
+ * and raw[max_payload + UART_PACKET_CRC_SIZE]
+ */
+typedef struct {
+  uart_port_num_t port;
+  uint32_t max_payload;
+  uint32_t frame_size;    /**< encoded frame including the delimiter */
+  uint32_t fill;          /**< bytes of the current frame in rx */
+  bool skipping;          /**< overrun, discarding up to the next zero */
+  uint32_t rx_frames;
+  uint32_t tx_frames;
+  uint32_t crc_errors;
+  uint32_t frame_errors;  /**< invalid COBS or frames longer than allowed */
+  int64_t first_us;       /**< time of the first frame, 0 if none */
+  int64_t cpu_us;         /**< time spent encoding and decoding */
+} uart_packet_t;
+
+static mrb_class *class_uart_packet;
+
+/**
+ * @brief Forward declarations for the mruby/c method implementations
+ */
+static void c_uart_packet_new(mrb_vm *vm, mrb_value *v, int argc);
+static void c_uart_packet_read(mrb_vm *vm, mrb_value *v, int argc);
+static void c_uart_packet_write(mrb_vm *vm, mrb_value *v, int argc);
+static void c_uart_packet_stats(mrb_vm *vm, mrb_value *v, int argc);
+
+/**
+ * @brief Defines the UART::Packet class for mruby/c
+ */
+fn_t api_uart_packet_define(void) {
+  mrb_class *class_uart = mrbc_get_class_by_name("UART");
+  if (class_uart == NULL) return kFailure;
+
+  class_uart_packet =
+      mrbc_define_class_under(0, class_uart, "Packet", mrbc_class_object);
+  mrbc_define_method(0, class_uart_packet, "new", c_uart_packet_new);
+  mrbc_define_method(0, class_uart_packet, "read", c_uart_packet_read);
+  mrbc_define_method(0, class_uart_packet, "write", c_uart_packet_write);
+  mrbc_define_method(0, class_uart_packet, "stats", c_uart_packet_stats);
+  return kSuccess;
+}
+
+static uart_packet_t *packet(const mrbc_value *v) {
+  return (uart_packet_t *)v->instance->data;
+}
+
+static uint8_t *rx_buf(uart_packet_t *p) { return (uint8_t *)(p + 1); }
+
+static uint8_t *tx_buf(uart_packet_t *p) {
+  return rx_buf(p) + p->frame_size;
+}
+
+static uint8_t *raw_buf(uart_packet_t *p) {
+  return tx_buf(p) + p->frame_size;
+}
+
+/**
+ * @brief Decodes and checks the frame in rx (without its delimiter)
+ *
+ * @return Payload length, or -1 if the frame was rejected
+ */
+static int packet_decode(uart_packet_t *p, size_t len) {
+  uint8_t *buf = rx_buf(p);
+  size_t out;
+  if (!cobs_decode(buf, len, buf, &out) || out < UART_PACKET_CRC_SIZE) {
+    p->frame_errors++;
+    return -1;
+  }
+  if (crc16_reflect(UART_PACKET_CRC_POLY, UART_PACKET_CRC_SEED, buf, out) !=
+      0) {
+    p->crc_errors++;
+    return -1;
+  }
+  return out - UART_PACKET_CRC_SIZE;
+}
+
+/**
+ * @brief UART::Packet.new(port, [max_payload])
+ *
+ * max_payload defaults to 256 bytes. Longer incoming frames are dropped and
+ * counted as frame errors.
+ */
+static void c_uart_packet_new(mrb_vm *vm, mrb_value *v, int argc) {
+  if (argc < 1 || v[1].tt != MRBC_TT_INTEGER || v[1].i < 0 ||
+      v[1].i >= UART_NUM_MAX) {
+    mrbc_raise(vm, MRBC_CLASS(ArgumentError), "invalid UART port number");
+    return;
+  }
+  int max_payload = UART_PACKET_DEFAULT_MAX_PAYLOAD;
+  if (argc > 1 && v[2].tt == MRBC_TT_INTEGER) max_payload = v[2].i;
+  if (max_payload < 1 || max_payload > 0xFFFF) {
+    mrbc_raise(vm, MRBC_CLASS(ArgumentError), "max_payload out of range");
+    return;
+  }
+
+  size_t frame_size =
+      COBS_MAX_ENCODED(max_payload + UART_PACKET_CRC_SIZE) + 1;
+  mrbc_value obj = mrbc_instance_new(
+      vm, v[0].cls,
+      sizeof(uart_packet_t) + 2 * frame_size + max_payload +
+          UART_PACKET_CRC_SIZE);
+  if (obj.instance == NULL) {
+    mrbc_raise(vm, MRBC_CLASS(RuntimeError), "out of memory");
+    return;
+  }
+  uart_packet_t *p = packet(&obj);
+  memset(p, 0, sizeof(*p));
+  p->port = (uart_port_num_t)v[1].i;
+  p->max_payload = max_payload;
+  p->frame_size = frame_size;
+  v[0] = obj;
+}
+
+/**
+ * @brief UART::Packet#read([timeout_ms])
+ *
+ * Returns the payload of the next valid frame as a String, or nil if none
+ * arrived within the timeout (default 100ms). A partly received frame is
+ * kept for the next call. Frames that fail decoding or the CRC are dropped
+ * and counted.
+ */
+static void c_uart_packet_read(mrb_vm *vm, mrb_value *v, int argc) {
+  SET_NIL_RETURN();
+  uart_packet_t *p = packet(&v[0]);
+  int32_t timeout_ms = UART_PACKET_DEFAULT_TIMEOUT_MS;
+  if (argc > 0 && v[1].tt == MRBC_TT_INTEGER) {
+    timeout_ms = (v[1].i < 0) ? 0 : v[1].i;
+  }
+  int64_t deadline = esp_timer_get_time() + (int64_t)timeout_ms * 1000;
+  uint8_t *rx = rx_buf(p);
+
+  while (true) {
+    int64_t left_us = deadline - esp_timer_get_time();
+    uint32_t left_ms = (left_us > 0) ? (uint32_t)(left_us / 1000) : 0;
+    int n = drv_uart_read_until(p->port, rx + p->fill, p->frame_size - p->fill,
+                                0, left_ms);
+    if (n < 0) return;  // port not initialized
+    p->fill += n;
+
+    if (p->fill > 0 && rx[p->fill - 1] == 0) {
+      size_t len = p->fill - 1;
+      bool skipped = p->skipping;
+      p->fill = 0;
+      p->skipping = false;
+      if (skipped || len == 0) continue;  // end of an overrun, or idle zero
+
+      int64_t start = esp_timer_get_time();
+      int payload = packet_decode(p, len);
+      if (payload >= 0) {
+        mrbc_value str = mrbc_string_new(vm, rx, payload);
+        p->rx_frames++;
+        if (p->first_us == 0) p->first_us = start;
+        p->cpu_us += esp_timer_get_time() - start;
+        SET_RETURN(str);
+        return;
+      }
+      p->cpu_us += esp_timer_get_time() - start;
+      continue;
+    }
+
+    if (p->fill == p->frame_size) {
+      // longer than max_payload allows: drop it up to the next zero
+      if (!p->skipping) p->frame_errors++;
+      p->skipping = true;
+      p->fill = 0;
+      continue;
+    }
+    if (n == 0) return;  // timeout, keep the partial frame
+  }
+}
+
+/**
+ * @brief UART::Packet#write(payload)
+ *
+ * Frames and sends a String. Returns the number of bytes put on the wire, or
+ * -1 on error.
+ */
+static void c_uart_packet_write(mrb_vm *vm, mrb_value *v, int argc) {
+  SET_INT_RETURN(-1);
+  uart_packet_t *p = packet(&v[0]);
+  if (argc < 1 || v[1].tt != MRBC_TT_STRING) {
+    mrbc_raise(vm, MRBC_CLASS(ArgumentError), "payload must be a String");
+    return;
+  }
+  size_t len = mrbc_string_size(&v[1]);
+  if (len > p->max_payload) {
+    mrbc_raise(vm, MRBC_CLASS(ArgumentError), "payload too long");
+    return;
+  }
+
+  int64_t start = esp_timer_get_time();
+  uint8_t *raw = raw_buf(p);
+  uint8_t *tx = tx_buf(p);
+  memcpy(raw, v[1].string->data, len);
+  uint16_t crc = crc16_reflect(UART_PACKET_CRC_POLY, UART_PACKET_CRC_SEED, raw,
+                               len);
+  raw[len] = crc & 0xFF;
+  raw[len + 1] = crc >> 8;
+  size_t n = cobs_encode(raw, len + UART_PACKET_CRC_SIZE, tx);
+  tx[n++] = 0;
+  p->cpu_us += esp_timer_get_time() - start;
+
+  int written = drv_uart_write(p->port, tx, n);
+  if (written > 0) {
+    p->tx_frames++;
+    if (p->first_us == 0) p->first_us = start;
+  }
+  SET_INT_RETURN(written);
+}
+
+/**
+ * @brief UART::Packet#stats
+ *
+ * Returns [rx_frames, tx_frames, crc_errors, frame_errors, frames_per_sec,
+ * cpu_us_per_frame]. The rate covers both directions since the first frame;
+ * the CPU time covers framing and checking, not waiting for the line.
+ */
+static void c_uart_packet_stats(mrb_vm *vm, mrb_value *v, int argc) {
+  uart_packet_t *p = packet(&v[0]);
+  uint32_t frames = p->rx_frames + p->tx_frames;
+  double elapsed =
+      p->first_us ? (esp_timer_get_time() - p->first_us) / 1e6 : 0.0;
+
+  mrbc_value ret = mrbc_array_new(vm, 6);
+  mrbc_value vals[6] = {
+      mrbc_fixnum_value(p->rx_frames),
+      mrbc_fixnum_value(p->tx_frames),
+      mrbc_fixnum_value(p->crc_errors),
+      mrbc_fixnum_value(p->frame_errors),
+      mrbc_float_value(vm, elapsed > 0 ? frames / elapsed : 0.0),
+      mrbc_float_value(vm, frames ? (double)p->cpu_us / frames : 0.0),
+  };
+  for (int i = 0; i < 6; i++) {
+    mrbc_array_set(&ret, i, &vals[i]);
+  }
+  SET_RETURN(ret);
+}
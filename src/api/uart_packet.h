@@ -0,0 +1,26 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file uart_packet.h
+ * @brief API interface for framed UART packets in mruby/c
+ *
+ * Defines the UART::Packet class, which sends and receives whole binary
+ * frames (COBS with a CRC-16) over a port initialized with UART.init.
+ */
+#ifndef API_UART_PACKET_H
+#define API_UART_PACKET_H
+
+#include "../lib/fn.h"
+
+/**
+ * @brief Defines the UART::Packet class for mruby/c
+ *
+ * Must be called after api_uart_define().
+ *
+ * @return kSuccess on success, kFailure if the UART class is missing
+ */
+fn_t api_uart_packet_define(void);
+
+#endif  // API_UART_PACKET_H
@@ -29,7 +29,7 @@ extern "C" {
 fn_t app_init(void) {
   M5.begin();
   gpio_num_t rgb_led_pin = (gpio_num_t)M5.getPin(m5::pin_name_t::rgb_led);
-  uint8_t size = 0;
+  uint16_t size = 0;
   switch (M5.getBoard()) {
     case m5::board_t::board_M5StampS3:
       size = 1;
@@ -0,0 +1,254 @@
+/**
+ * @file input.cpp
+ * @brief Button sampler implementation
+ *
+ * A periodic esp_timer wakes a driver task that calls M5.update() and reads
+ * the buttons. M5.update() talks to the touch and power chips on some
+ * boards, so it cannot run in the timer callback itself. A button takes a
+ * new level once it has held it for the debounce time, and the edge is
+ * queued with the time the level first changed. The task runs above the
+ * mruby/c VM, so the sampling rate no longer depends on the script's loop.
+ * M5.update() rewrites the button and touch state the m5u classes read, so
+ * those reads and every other M5.update() go through input_lock. Display
+ * drawing is not serialized: on the supported boards the touch controller
+ * M5.update() reads sits on I2C, not on the display's SPI bus.
+ */
+#include "input.h"
+
+#include <M5Unified.h>
+
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#define INPUT_QUEUE_LENGTH 32
+#define INPUT_TASK_STACK 4096
+#define INPUT_TASK_PRIORITY 5  // above the mruby/c VM task
+
+typedef struct {
+  bool level;        // debounced level
+  bool changing;     // raw level differs from the debounced one
+  int64_t since_us;  // when the raw level started to differ
+  uint32_t releases;
+} input_button_t;
+
+static input_button_t input_buttons[INPUT_BUTTONS];
+static SemaphoreHandle_t input_lock = NULL;  // guards M5.update()
+static QueueHandle_t input_queue = NULL;
+static TaskHandle_t input_task_handle = NULL;
+static esp_timer_handle_t input_timer = NULL;
+static volatile int64_t input_tick_us = 0;
+static int64_t input_debounce_us = INPUT_DEFAULT_DEBOUNCE_MS * 1000;
+static void (*input_notify)(void *arg) = NULL;
+static void *input_notify_arg = NULL;
+static uint32_t input_samples = 0;
+static uint32_t input_missed = 0;
+static uint32_t input_max_late_us = 0;
+static uint32_t input_dropped = 0;
+
+/**
+ * @brief Sampler timer callback, wakes the sampler task
+ */
+static void input_tick(void *arg) {
+  input_tick_us = esp_timer_get_time();
+  xTaskNotifyGive(input_task_handle);
+}
+
+/**
+ * @brief Debounces one raw sample of a button and queues its edge
+ *
+ * @return true if an edge was queued
+ */
+static bool input_debounce(uint8_t i, bool raw, int64_t now) {
+  input_button_t *b = &input_buttons[i];
+  if (raw == b->level) {
+    b->changing = false;  // a bounce, or nothing happened
+    return false;
+  }
+  if (!b->changing) {
+    b->changing = true;
+    b->since_us = now;
+  }
+  if (now - b->since_us < input_debounce_us) {
+    return false;
+  }
+  b->level = raw;
+  b->changing = false;
+  if (!raw) b->releases++;
+
+  drv_input_event_t event = {i, raw, b->since_us};
+  if (xQueueSend(input_queue, &event, 0) != pdTRUE) {
+    input_dropped++;  // the script is not reading events
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Sampler task, reads and debounces the buttons once per tick
+ */
+static void input_task(void *arg) {
+  while (1) {
+    uint32_t ticks = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    int64_t now = esp_timer_get_time();
+    if (ticks > 1) input_missed += ticks - 1;
+    uint32_t late = (uint32_t)(now - input_tick_us);
+    if (late > input_max_late_us) input_max_late_us = late;
+
+    xSemaphoreTake(input_lock, portMAX_DELAY);
+    M5.update();
+    bool raw[INPUT_BUTTONS] = {M5.BtnA.isPressed(), M5.BtnB.isPressed(),
+                               M5.BtnC.isPressed()};
+    xSemaphoreGive(input_lock);
+
+    bool queued = false;
+    for (uint8_t i = 0; i < INPUT_BUTTONS; i++) {
+      if (input_debounce(i, raw[i], now)) queued = true;
+    }
+    input_samples++;
+    if (queued && input_notify != NULL) input_notify(input_notify_arg);
+  }
+}
+
+/**
+ * @brief Starts the sampler, or changes its timing if it is running
+ *
+ * @param period_ms Sampling period (1-100)
+ * @param debounce_ms How long a new level must hold before it counts
+ * @return kSuccess, kFailure if the arguments are invalid or out of memory
+ */
+fn_t drv_input_start(uint32_t period_ms, uint32_t debounce_ms) {
+  if (period_ms < 1 || period_ms > 100) {
+    return kFailure;
+  }
+  if (input_lock == NULL) {
+    input_lock = xSemaphoreCreateMutex();
+    if (input_lock == NULL) return kFailure;
+  }
+  if (input_queue == NULL) {
+    input_queue = xQueueCreate(INPUT_QUEUE_LENGTH, sizeof(drv_input_event_t));
+    if (input_queue == NULL) return kFailure;
+  }
+  if (input_task_handle == NULL &&
+      xTaskCreate(input_task, "input", INPUT_TASK_STACK, NULL,
+                  INPUT_TASK_PRIORITY, &input_task_handle) != pdPASS) {
+    input_task_handle = NULL;
+    return kFailure;
+  }
+  if (input_timer == NULL) {
+    const esp_timer_create_args_t args = {
+        .callback = input_tick,
+        .name = "input",
+    };
+    if (esp_timer_create(&args, &input_timer) != ESP_OK) {
+      input_timer = NULL;
+      return kFailure;
+    }
+  }
+
+  input_debounce_us = (int64_t)debounce_ms * 1000;
+  if (esp_timer_is_active(input_timer)) {
+    esp_timer_stop(input_timer);
+  } else {
+    // take the current levels so the first read is right, without edges
+    xSemaphoreTake(input_lock, portMAX_DELAY);
+    M5.update();
+    input_buttons[0].level = M5.BtnA.isPressed();
+    input_buttons[1].level = M5.BtnB.isPressed();
+    input_buttons[2].level = M5.BtnC.isPressed();
+    xSemaphoreGive(input_lock);
+    for (uint8_t i = 0; i < INPUT_BUTTONS; i++) {
+      input_buttons[i].changing = false;
+    }
+  }
+  esp_timer_start_periodic(input_timer, (uint64_t)period_ms * 1000);
+  return kSuccess;
+}
+
+/**
+ * @brief Stops sampling, the task, queue and lock stay for the next start
+ */
+void drv_input_stop(void) {
+  if (input_timer != NULL && esp_timer_is_active(input_timer)) {
+    esp_timer_stop(input_timer);
+  }
+}
+
+/**
+ * @brief Calls M5.update() without racing the sampler task
+ */
+void drv_input_update(void) {
+  drv_input_lock();
+  M5.update();
+  drv_input_unlock();
+}
+
+/**
+ * @brief Keeps the sampler from calling M5.update()
+ */
+void drv_input_lock(void) {
+  if (input_lock != NULL) xSemaphoreTake(input_lock, portMAX_DELAY);
+}
+
+/**
+ * @brief Lets the sampler call M5.update() again
+ */
+void drv_input_unlock(void) {
+  if (input_lock != NULL) xSemaphoreGive(input_lock);
+}
+
+/**
+ * @brief Returns the debounced level of a button
+ */
+bool drv_input_pressed(uint8_t button) {
+  return button < INPUT_BUTTONS && input_buttons[button].level;
+}
+
+/**
+ * @brief Returns how many times a button has been released
+ */
+uint32_t drv_input_release_count(uint8_t button) {
+  return button < INPUT_BUTTONS ? input_buttons[button].releases : 0;
+}
+
+/**
+ * @brief Takes the oldest queued edge
+ */
+bool drv_input_next(drv_input_event_t *event) {
+  return input_queue != NULL && xQueueReceive(input_queue, event, 0) == pdTRUE;
+}
+
+/**
+ * @brief Returns the number of queued edges
+ */
+uint32_t drv_input_pending(void) {
+  return input_queue == NULL ? 0 : uxQueueMessagesWaiting(input_queue);
+}
+
+/**
+ * @brief Drops all queued edges
+ */
+void drv_input_flush(void) {
+  if (input_queue != NULL) xQueueReset(input_queue);
+}
+
+/**
+ * @brief Sets the function called when edges are queued
+ */
+void drv_input_set_notify(void (*notify)(void *arg), void *arg) {
+  input_notify_arg = arg;
+  input_notify = notify;
+}
+
+/**
+ * @brief Returns the sampler statistics
+ */
+void drv_input_stats(uint32_t *samples, uint32_t *missed,
+                     uint32_t *max_late_us, uint32_t *dropped) {
+  *samples = input_samples;
+  *missed = input_missed;
+  *max_late_us = input_max_late_us;
+  *dropped = input_dropped;
+}
@@ -0,0 +1,132 @@
+/**
+ * @file input.h
+ * @brief Button sampler interface
+ *
+ * Samples the M5 buttons from a driver task on a periodic timer, debounces
+ * them and queues press and release edges with their time. Presses are no
+ * longer missed when the Ruby loop is slow.
+ */
+#ifndef DRV_INPUT_H
+#define DRV_INPUT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../lib/fn.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Number of sampled buttons: A, B and C
+#define INPUT_BUTTONS 3
+// Default sampling period and debounce time
+#define INPUT_DEFAULT_PERIOD_MS 5
+#define INPUT_DEFAULT_DEBOUNCE_MS 20
+
+/**
+ * @brief One press or release edge
+ */
+typedef struct {
+  uint8_t button;   // 0: A, 1: B, 2: C
+  bool pressed;     // true for a press, false for a release
+  int64_t time_us;  // when the button started to change (esp_timer time)
+} drv_input_event_t;
+
+/**
+ * @brief Starts the sampler, or changes its timing if it is running
+ *
+ * @param period_ms Sampling period (1-100)
+ * @param debounce_ms How long a new level must hold before it counts
+ * @return kSuccess, kFailure if the arguments are invalid or out of memory
+ */
+fn_t drv_input_start(uint32_t period_ms, uint32_t debounce_ms);
+
+/**
+ * @brief Stops sampling
+ *
+ * The task, queue and lock are kept, drv_input_start() resumes sampling.
+ * Until then M5.update() is only called through drv_input_update().
+ */
+void drv_input_stop(void);
+
+/**
+ * @brief Calls M5.update() without racing the sampler task
+ *
+ * Other code that needs M5.update() must call this instead.
+ */
+void drv_input_update(void);
+
+/**
+ * @brief Keeps the sampler from calling M5.update()
+ *
+ * Hold it around reads of the M5 button and touch state, which M5.update()
+ * rewrites. Does nothing if the sampler has never started.
+ */
+void drv_input_lock(void);
+
+/**
+ * @brief Releases drv_input_lock()
+ */
+void drv_input_unlock(void);
+
+/**
+ * @brief Returns the debounced level of a button
+ *
+ * @param button Button number
+ * @return true while the button is held
+ */
+bool drv_input_pressed(uint8_t button);
+
+/**
+ * @brief Returns how many times a button has been released
+ *
+ * @param button Button number
+ * @return Release count, wraps around
+ */
+uint32_t drv_input_release_count(uint8_t button);
+
+/**
+ * @brief Takes the oldest queued edge
+ *
+ * @param event Filled in with the edge
+ * @return true if there was one
+ */
+bool drv_input_next(drv_input_event_t *event);
+
+/**
+ * @brief Returns the number of queued edges
+ */
+uint32_t drv_input_pending(void);
+
+/**
+ * @brief Drops all queued edges
+ */
+void drv_input_flush(void);
+
+/**
+ * @brief Sets the function called when edges are queued
+ *
+ * It runs on the sampler task, once per sample that queued an edge.
+ *
+ * @param notify Function, NULL for none
+ * @param arg Argument passed to it
+ */
+void drv_input_set_notify(void (*notify)(void *arg), void *arg);
+
+/**
+ * @brief Returns the sampler statistics
+ *
+ * @param samples Number of samples taken
+ * @param missed Number of ticks missed because a sample took too long
+ * @param max_late_us Largest delay between a tick and its sample
+ * @param dropped Number of edges dropped because the queue was full
+ */
+void drv_input_stats(uint32_t *samples, uint32_t *missed,
+                     uint32_t *max_late_us, uint32_t *dropped);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -20,31 +20,75 @@
 #include <string.h>
 
 #include "../lib/fn.h"
+#include "../lib/pixel/gamma.h"
 #include "driver/gpio.h"
 #include "driver/rmt_tx.h"
+#include "esp_attr.h"
+#include "esp_err.h"
+#include "esp_heap_caps.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "freertos/task.h"
+#include "soc/soc_caps.h"
 
 #define RMT_LED_STRIP_RESOLUTION_HZ 40000000
+#define LED_TRANS_QUEUE_DEPTH 4
+// One frame is edited while up to two are queued or on the wire
+#define LED_FRAME_BUFFERS 3
+// Every TX channel can drive its own strip
+#define LED_MAX_STRIPS SOC_RMT_TX_CANDIDATES_PER_GROUP
+// Frames at least this large go to PSRAM when the board has it
+#define LED_PSRAM_MIN_BYTES 1024
 
-static uint8_t led_strip_pixels_size = 0;
-static uint8_t *led_strip_pixels = NULL;
-static rmt_encoder_handle_t simple_encoder = NULL;
-static rmt_channel_handle_t led_chan = NULL;
+typedef struct {
+  uint16_t size;  // number of pixels, 0 if the slot is free
+  uint8_t bpp;    // bytes per pixel, see drv_led_format_t
+  gpio_num_t pin;
+  uint8_t *frames[LED_FRAME_BUFFERS];
+  uint8_t edit;     // index of the frame set_pixel writes to
+  uint8_t *pixels;  // frames[edit]
+  int8_t last;      // index of the frame sent last, -1 before the first
+  QueueHandle_t free_frames;  // indices ready for editing
+  QueueHandle_t sent_frames;  // indices in flight, in order
+  SemaphoreHandle_t tx_lock;  // show and refresh queue frames in order
+  rmt_encoder_handle_t encoder;
+  rmt_channel_handle_t chan;
+  uint32_t transmit_count;
+  uint32_t stall_count;  // show had to wait for a free frame
+  // output stage, applied by the encoder
+  bool output;        // map bytes through lut
+  bool dither;        // temporal dithering of the lut fraction
+  uint16_t *lut;      // byte -> 8.8 fixed point output level
+  uint8_t phase;      // dither phase, advanced once per encoded frame
+} led_strip_t;
 
-static const rmt_symbol_word_t ws2812_zero = {
-    .level0 = 1,
-    .duration0 = 0.3 * RMT_LED_STRIP_RESOLUTION_HZ / 1000000,  // T0H=0.3us
-    .level1 = 0,
-    .duration1 = 0.9 * RMT_LED_STRIP_RESOLUTION_HZ / 1000000,  // T0L=0.9us
-};
+static led_strip_t led_strips[LED_MAX_STRIPS];
 
-static const rmt_symbol_word_t ws2812_one = {
-    .level0 = 1,
-    .duration0 = 0.9 * RMT_LED_STRIP_RESOLUTION_HZ / 1000000,  // T1H=0.9us
-    .level1 = 0,
-    .duration1 = 0.9 * RMT_LED_STRIP_RESOLUTION_HZ / 1000000,  // T1L=0.9us
+// WS2812 bit timings in RMT ticks
+#define WS2812_T0H (0.3 * RMT_LED_STRIP_RESOLUTION_HZ / 1000000)  // 0.3us
+#define WS2812_T0L (0.9 * RMT_LED_STRIP_RESOLUTION_HZ / 1000000)  // 0.9us
+#define WS2812_T1H (0.9 * RMT_LED_STRIP_RESOLUTION_HZ / 1000000)  // 0.9us
+#define WS2812_T1L (0.9 * RMT_LED_STRIP_RESOLUTION_HZ / 1000000)  // 0.9us
+
+#define WS2812_BIT(n, b)                                        \
+  {                                                             \
+    .level0 = 1,                                                \
+    .duration0 = (((n) >> (b)) & 1) ? WS2812_T1H : WS2812_T0H, \
+    .level1 = 0,                                                \
+    .duration1 = (((n) >> (b)) & 1) ? WS2812_T1L : WS2812_T0L, \
+  }
+#define WS2812_NIBBLE(n) \
+  {WS2812_BIT(n, 3), WS2812_BIT(n, 2), WS2812_BIT(n, 1), WS2812_BIT(n, 0)}
+
+// The 4 symbols of every nibble, MSB first, built at compile time. A byte
+// is two table copies instead of 8 bit tests.
+static const rmt_symbol_word_t ws2812_nibbles[16][4] = {
+    WS2812_NIBBLE(0),  WS2812_NIBBLE(1),  WS2812_NIBBLE(2),  WS2812_NIBBLE(3),
+    WS2812_NIBBLE(4),  WS2812_NIBBLE(5),  WS2812_NIBBLE(6),  WS2812_NIBBLE(7),
+    WS2812_NIBBLE(8),  WS2812_NIBBLE(9),  WS2812_NIBBLE(10), WS2812_NIBBLE(11),
+    WS2812_NIBBLE(12), WS2812_NIBBLE(13), WS2812_NIBBLE(14), WS2812_NIBBLE(15),
 };
 
 // reset defaults to 50uS
@@ -58,7 +102,15 @@ static const rmt_symbol_word_t ws2812_reset = {
 /**
  * @brief RMT encoder callback for WS2812 LED protocol
  *
- * Encodes byte data into RMT symbols according to the WS2812 protocol.
+ * Encodes as many bytes as fit into the free symbol space in one call,
+ * copying two precomputed nibbles per byte, so the callback runs once per
+ * RMT memory refill instead of once per byte.
+ *
+ * When the strip's output stage is on, every byte is first mapped through
+ * its gamma/brightness table. With dithering, the 8-bit fraction of the
+ * table value is compared against a threshold that moves with the frame
+ * and the byte position, so over 8 frames a byte averages out to the exact
+ * level instead of being rounded.
  *
  * @param data Pointer to the data to encode
  * @param data_size Size of the data in bytes
@@ -66,111 +118,527 @@ static const rmt_symbol_word_t ws2812_reset = {
  * @param symbols_free Number of free symbols in the buffer
  * @param symbols Pointer to the symbol buffer
  * @param done Pointer to a flag indicating if encoding is complete
- * @param arg User argument (unused)
+ * @param arg Strip being sent
  * @return Number of symbols written
  */
 static size_t encoder_callback(const void *data, size_t data_size,
                                size_t symbols_written, size_t symbols_free,
                                rmt_symbol_word_t *symbols, bool *done,
                                void *arg) {
-  // We need a minimum of 8 symbol spaces to encode a byte. We only
-  // need one to encode a reset, but it's simpler to simply demand that
-  // there are 8 symbol spaces free to write anything.
-  if (symbols_free < 8) {
-    return 0;
-  }
-
-  // We can calculate where in the data we are from the symbol pos.
-  // Alternatively, we could use some counter referenced by the arg
-  // parameter to keep track of this.
+  // Every byte is 8 symbols, so the position in the data follows from the
+  // symbols written so far.
   size_t data_pos = symbols_written / 8;
-  uint8_t *data_bytes = (uint8_t *)data;
+  const uint8_t *data_bytes = (const uint8_t *)data;
+  led_strip_t *strip = (led_strip_t *)arg;
+  const uint16_t *lut = strip->output ? strip->lut : NULL;
+
   if (data_pos < data_size) {
-    // Encode a byte
-    size_t symbol_pos = 0;
-    for (int bitmask = 0x80; bitmask != 0; bitmask >>= 1) {
-      if (data_bytes[data_pos] & bitmask) {
-        symbols[symbol_pos++] = ws2812_one;
-      } else {
-        symbols[symbol_pos++] = ws2812_zero;
+    size_t count = symbols_free / 8;
+    if (count > data_size - data_pos) count = data_size - data_pos;
+    if (symbols_written == 0) strip->phase += 5;  // odd, visits all 8
+    for (size_t i = 0; i < count; i++) {
+      uint8_t byte = data_bytes[data_pos + i];
+      if (lut != NULL) {
+        uint32_t round = 0x80;
+        if (strip->dither) {
+          round = (((strip->phase + (data_pos + i) * 3) & 7) << 5) + 16;
+        }
+        byte = (lut[byte] + round) >> 8;
       }
+      memcpy(&symbols[i * 8], ws2812_nibbles[byte >> 4],
+             sizeof(ws2812_nibbles[0]));
+      memcpy(&symbols[i * 8 + 4], ws2812_nibbles[byte & 0x0F],
+             sizeof(ws2812_nibbles[0]));
     }
-    // We're done; we should have written 8 symbols.
-    return symbol_pos;
-  } else {
-    // All bytes already are encoded.
-    // Encode the reset, and we're done.
-    symbols[0] = ws2812_reset;
-    *done = 1;  // Indicate end of the transaction.
-    return 1;   // we only wrote one symbol
+    return count * 8;  // 0 asks for more space
   }
+
+  if (symbols_free < 1) {
+    return 0;
+  }
+  // All bytes already are encoded.
+  // Encode the reset, and we're done.
+  symbols[0] = ws2812_reset;
+  *done = 1;  // Indicate end of the transaction.
+  return 1;   // we only wrote one symbol
 }
 
 /**
- * @brief Initializes the LED driver
+ * @brief RMT transaction done callback (ISR)
  *
- * Sets up the RMT peripheral for controlling WS2812 RGB LEDs.
+ * Transactions finish in the order they were queued, so the oldest frame in
+ * flight is the one that has just been sent. Its buffer goes back to the
+ * free list.
+ */
+static bool IRAM_ATTR led_trans_done(rmt_channel_handle_t tx_chan,
+                                     const rmt_tx_done_event_data_t *edata,
+                                     void *user_ctx) {
+  led_strip_t *strip = (led_strip_t *)user_ctx;
+  BaseType_t woken = pdFALSE;
+  uint8_t index;
+  if (xQueueReceiveFromISR(strip->sent_frames, &index, &woken) == pdTRUE) {
+    xQueueSendFromISR(strip->free_frames, &index, &woken);
+  }
+  return woken == pdTRUE;
+}
+
+/**
+ * @brief Returns the attached strip with the given number
  *
- * @return kSuccess on successful initialization
+ * @param kStrip Strip number
+ * @return Strip, NULL if the number is out of range or not attached
  */
-fn_t drv_led_init(gpio_num_t pin_num, uint8_t size) {
-  if (led_strip_pixels != NULL) {
+static led_strip_t *led_get_strip(const uint8_t kStrip) {
+  if (kStrip >= LED_MAX_STRIPS || led_strips[kStrip].size == 0) {
+    return NULL;
+  }
+  return &led_strips[kStrip];
+}
+
+/**
+ * @brief Allocates a zeroed frame buffer
+ *
+ * Long strips are kept in PSRAM when there is some. The encoder only reads
+ * a few bytes per RMT refill, so the slower memory does not limit the frame
+ * rate.
+ *
+ * @param bytes Buffer size
+ * @return Buffer, NULL if out of memory
+ */
+static uint8_t *led_frame_alloc(size_t bytes) {
+  uint8_t *frame = NULL;
+  if (bytes >= LED_PSRAM_MIN_BYTES) {
+    frame = (uint8_t *)heap_caps_calloc(bytes, 1, MALLOC_CAP_SPIRAM);
+  }
+  if (frame == NULL) {
+    frame = (uint8_t *)heap_caps_calloc(bytes, 1, MALLOC_CAP_8BIT);
+  }
+  return frame;
+}
+
+/**
+ * @brief Releases everything a strip slot holds and marks it free
+ *
+ * Safe on a partly set up slot.
+ *
+ * @param strip Strip to release
+ */
+static void led_strip_release(led_strip_t *strip) {
+  if (strip->chan != NULL) {
+    rmt_tx_wait_all_done(strip->chan, 1000);
+    rmt_disable(strip->chan);
+    rmt_del_channel(strip->chan);
+  }
+  if (strip->encoder != NULL) rmt_del_encoder(strip->encoder);
+  heap_caps_free(strip->lut);
+  for (int i = 0; i < LED_FRAME_BUFFERS; i++) {
+    heap_caps_free(strip->frames[i]);
+  }
+  if (strip->free_frames != NULL) vQueueDelete(strip->free_frames);
+  if (strip->sent_frames != NULL) vQueueDelete(strip->sent_frames);
+  if (strip->tx_lock != NULL) vSemaphoreDelete(strip->tx_lock);
+  if (strip->pin != GPIO_NUM_NC) gpio_reset_pin(strip->pin);
+  memset(strip, 0, sizeof(*strip));
+  strip->pin = GPIO_NUM_NC;
+}
+
+/**
+ * @brief Sets up one strip on a free RMT channel
+ *
+ * The simple encoder refills the channel memory from its interrupt while
+ * the frame is on the wire, so the symbol memory stays one block however
+ * long the strip is.
+ *
+ * @param strip Free strip slot
+ * @param pin_num GPIO number
+ * @param size Number of LEDs
+ * @param format Pixel format
+ * @return kSuccess, kFailure if out of channels or memory
+ */
+static fn_t led_strip_setup(led_strip_t *strip, gpio_num_t pin_num,
+                            uint16_t size, drv_led_format_t format) {
+  strip->pin = GPIO_NUM_NC;
+  strip->bpp = (uint8_t)format;
+  strip->free_frames = xQueueCreate(LED_FRAME_BUFFERS, sizeof(uint8_t));
+  strip->sent_frames = xQueueCreate(LED_FRAME_BUFFERS, sizeof(uint8_t));
+  strip->tx_lock = xSemaphoreCreateMutex();
+  if (strip->free_frames == NULL || strip->sent_frames == NULL ||
+      strip->tx_lock == NULL) {
     return kFailure;
   }
-  led_strip_pixels_size = size;
-  led_strip_pixels = (uint8_t *)malloc(led_strip_pixels_size * 3);
-  memset(led_strip_pixels, 0, led_strip_pixels_size * 3);
+  for (uint8_t i = 0; i < LED_FRAME_BUFFERS; i++) {
+    strip->frames[i] = led_frame_alloc((size_t)size * strip->bpp);
+    if (strip->frames[i] == NULL) {
+      return kFailure;
+    }
+    if (i != 0) xQueueSend(strip->free_frames, &i, 0);
+  }
+  strip->edit = 0;
+  strip->pixels = strip->frames[0];
+  strip->last = -1;
+
   gpio_reset_pin(pin_num);
+  strip->pin = pin_num;
   rmt_tx_channel_config_t tx_chan_config = {
       .clk_src = RMT_CLK_SRC_DEFAULT,  // select source clock
       .gpio_num = pin_num,
-      .mem_block_symbols =
-          64,  // increase the block size can make the LED less flickering
+      // one block per channel, so every TX channel can take a strip
+      .mem_block_symbols = SOC_RMT_MEM_WORDS_PER_CHANNEL,
       .resolution_hz = RMT_LED_STRIP_RESOLUTION_HZ,
-      .trans_queue_depth = 4,  // set the number of transactions that can be
-                               // pending in the background
+      .trans_queue_depth =
+          LED_TRANS_QUEUE_DEPTH,  // set the number of transactions that can
+                                  // be pending in the background
   };
-  ESP_ERROR_CHECK(rmt_new_tx_channel(&tx_chan_config, &led_chan));
+  if (rmt_new_tx_channel(&tx_chan_config, &strip->chan) != ESP_OK) {
+    strip->chan = NULL;
+    return kFailure;
+  }
 
   const rmt_simple_encoder_config_t simple_encoder_cfg = {
-      .callback = encoder_callback
+      .callback = encoder_callback,
+      .arg = strip,
       // Note we don't set min_chunk_size here as the default of 64 is good
       // enough.
   };
-  ESP_ERROR_CHECK(rmt_new_simple_encoder(&simple_encoder_cfg, &simple_encoder));
+  if (rmt_new_simple_encoder(&simple_encoder_cfg, &strip->encoder) !=
+      ESP_OK) {
+    strip->encoder = NULL;
+    return kFailure;
+  }
+
+  const rmt_tx_event_callbacks_t cbs = {
+      .on_trans_done = led_trans_done,
+  };
+  if (rmt_tx_register_event_callbacks(strip->chan, &cbs, strip) != ESP_OK ||
+      rmt_enable(strip->chan) != ESP_OK) {
+    return kFailure;
+  }
+  strip->size = size;
+  return kSuccess;
+}
+
+/**
+ * @brief Attaches a WS2812 compatible strip
+ *
+ * A strip already attached on the same pin is replaced, so a script can
+ * attach its strips again after a VM reload.
+ *
+ * @param pin_num GPIO number
+ * @param size Number of LEDs
+ * @param format Pixel format
+ * @return Strip number, -1 if out of channels or memory
+ */
+int drv_led_attach(gpio_num_t pin_num, uint16_t size,
+                   drv_led_format_t format) {
+  if (size == 0 || (format != kLedGrb && format != kLedGrbw)) {
+    return -1;
+  }
+  int slot = drv_led_find(pin_num);
+  if (slot >= 0) {
+    led_strip_release(&led_strips[slot]);
+  }
+  for (int i = 0; slot < 0 && i < LED_MAX_STRIPS; i++) {
+    if (led_strips[i].size == 0) slot = i;
+  }
+  if (slot < 0) {
+    return -1;
+  }
+  if (led_strip_setup(&led_strips[slot], pin_num, size, format) !=
+      kSuccess) {
+    led_strip_release(&led_strips[slot]);
+    return -1;
+  }
+  return slot;
+}
 
-  ESP_ERROR_CHECK(rmt_enable(led_chan));
+/**
+ * @brief Returns the strip attached on a pin
+ *
+ * @param pin_num GPIO number
+ * @return Strip number, -1 if there is none
+ */
+int drv_led_find(gpio_num_t pin_num) {
+  for (int i = 0; i < LED_MAX_STRIPS; i++) {
+    if (led_strips[i].size != 0 && led_strips[i].pin == pin_num) {
+      return i;
+    }
+  }
+  return -1;
+}
 
+/**
+ * @brief Detaches a strip and frees its RMT channel and frame buffers
+ *
+ * @param kStrip Strip number
+ * @return kSuccess, kFailure if the strip is not attached
+ */
+fn_t drv_led_detach(const uint8_t kStrip) {
+  led_strip_t *strip = led_get_strip(kStrip);
+  if (strip == NULL) {
+    return kFailure;
+  }
+  led_strip_release(strip);
   return kSuccess;
 }
 
 /**
- * @brief Sets the RGB LED color
+ * @brief Initializes the LED driver
  *
+ * Sets up the RMT peripheral for the built-in WS2812 RGB LEDs as strip 0.
+ *
+ * @return kSuccess on successful initialization
+ */
+fn_t drv_led_init(gpio_num_t pin_num, uint16_t size) {
+  if (led_strips[0].size != 0) {
+    return kFailure;
+  }
+  return drv_led_attach(pin_num, size, kLedGrb) == 0 ? kSuccess : kFailure;
+}
+
+/**
+ * @brief Sets one pixel in the frame buffer without sending it
+ *
+ * @param kStrip Strip number
  * @param kNum LED index (0-based)
  * @param kRed Red component (0-255)
  * @param kGreen Green component (0-255)
  * @param kBlue Blue component (0-255)
+ * @param kWhite White component (0-255), ignored on RGB strips
  * @return kSuccess on successful operation, kFailure if LED index is invalid
  */
-fn_t drv_led_set(const uint8_t kNum, const uint8_t kRed, const uint8_t kGreen,
-                 const uint8_t kBlue) {
-  if (kNum >= led_strip_pixels_size) {
+fn_t drv_led_set_pixel(const uint8_t kStrip, const uint16_t kNum,
+                       const uint8_t kRed, const uint8_t kGreen,
+                       const uint8_t kBlue, const uint8_t kWhite) {
+  led_strip_t *strip = led_get_strip(kStrip);
+  if (strip == NULL || kNum >= strip->size) {
     return kFailure;
   }
 
+  uint8_t *p = &strip->pixels[(size_t)kNum * strip->bpp];
+  p[0] = kGreen;
+  p[1] = kRed;
+  p[2] = kBlue;
+  if (strip->bpp == kLedGrbw) p[3] = kWhite;
+  return kSuccess;
+}
+
+/**
+ * @brief Hands a frame buffer to the RMT channel
+ *
+ * Called with tx_lock held, so frames are queued in the order they are
+ * sent and the done callback frees the right one.
+ *
+ * @param strip Strip
+ * @param index Frame to send
+ */
+static void led_transmit(led_strip_t *strip, uint8_t index) {
   rmt_transmit_config_t tx_config = {
       .loop_count = 0,  // no transfer loop
   };
+  xQueueSend(strip->sent_frames, &index, 0);
+  ESP_ERROR_CHECK(rmt_transmit(strip->chan, strip->encoder,
+                               strip->frames[index],
+                               (size_t)strip->size * strip->bpp, &tx_config));
+  strip->last = (int8_t)index;
+}
+
+/**
+ * @brief Queues the frame buffer for transmission and returns
+ *
+ * The edited frame is handed to the RMT channel as it is, and editing
+ * continues on a free buffer that starts as a copy of it. Only when two
+ * frames are already queued does this wait for the older one to finish.
+ *
+ * @param kStrip Strip number
+ * @return kSuccess on successful operation, kFailure if not attached
+ */
+fn_t drv_led_show(const uint8_t kStrip) {
+  led_strip_t *strip = led_get_strip(kStrip);
+  if (strip == NULL) {
+    return kFailure;
+  }
+
+  xSemaphoreTake(strip->tx_lock, portMAX_DELAY);
+  uint8_t next;
+  if (xQueueReceive(strip->free_frames, &next, 0) != pdTRUE) {
+    strip->stall_count++;
+    xQueueReceive(strip->free_frames, &next, portMAX_DELAY);
+  }
+
+  // Flush RGB values to LEDs in the background
+  size_t bytes = (size_t)strip->size * strip->bpp;
+  led_transmit(strip, strip->edit);
+  strip->transmit_count++;
+
+  memcpy(strip->frames[next], strip->pixels, bytes);
+  strip->edit = next;
+  strip->pixels = strip->frames[next];
+  xSemaphoreGive(strip->tx_lock);
+
+  return kSuccess;
+}
 
-  led_strip_pixels[kNum * 3 + 0] = kGreen;
-  led_strip_pixels[kNum * 3 + 1] = kRed;
-  led_strip_pixels[kNum * 3 + 2] = kBlue;
+/**
+ * @brief Sends the last frame again if the strip is idle
+ *
+ * Temporal dithering only averages out while frames keep going out, as
+ * the encoder moves the dither phase once per frame. The copy goes out
+ * from a free buffer, so the frame being edited is not touched. Nothing is
+ * sent while frames are in flight, as they move the phase already, or
+ * while show holds the strip.
+ *
+ * @param kStrip Strip number
+ * @return kSuccess if a frame was sent, kFailure otherwise
+ */
+fn_t drv_led_refresh(const uint8_t kStrip) {
+  led_strip_t *strip = led_get_strip(kStrip);
+  if (strip == NULL || strip->last < 0 ||
+      xSemaphoreTake(strip->tx_lock, 0) != pdTRUE) {
+    return kFailure;
+  }
+  fn_t ret = kFailure;
+  uint8_t index;
+  if (uxQueueMessagesWaiting(strip->sent_frames) == 0 &&
+      xQueueReceive(strip->free_frames, &index, 0) == pdTRUE) {
+    if (index != strip->last) {
+      memcpy(strip->frames[index], strip->frames[strip->last],
+             (size_t)strip->size * strip->bpp);
+    }
+    led_transmit(strip, index);
+    ret = kSuccess;
+  }
+  xSemaphoreGive(strip->tx_lock);
+  return ret;
+}
 
-  // Flush RGB values to LEDs
-  ESP_ERROR_CHECK(rmt_transmit(led_chan, simple_encoder, led_strip_pixels,
-                               led_strip_pixels_size * 3, &tx_config));
-  ESP_ERROR_CHECK(rmt_tx_wait_all_done(led_chan, portMAX_DELAY));
+/**
+ * @brief Waits until every queued frame has been sent
+ *
+ * @param kStrip Strip number
+ * @param timeout_ms Timeout in milliseconds
+ * @return kSuccess when the strip is idle, kFailure on timeout or if not
+ * attached
+ */
+fn_t drv_led_wait(const uint8_t kStrip, uint32_t timeout_ms) {
+  led_strip_t *strip = led_get_strip(kStrip);
+  if (strip == NULL) {
+    return kFailure;
+  }
+  return rmt_tx_wait_all_done(strip->chan, timeout_ms) == ESP_OK ? kSuccess
+                                                                  : kFailure;
+}
 
+/**
+ * @brief Sets the output stage of a strip
+ *
+ * The table is rebuilt in place while frames may be encoded from it. Each
+ * entry is a single 16-bit store, so a frame being sent at that moment
+ * only mixes old and new levels. The table is kept until the strip is
+ * detached, so the encoder never reads freed memory.
+ *
+ * @param kStrip Strip number
+ * @param gamma Apply gamma 2.2
+ * @param brightness Global brightness (0-255)
+ * @param dither Dither the levels between frames
+ * @return kSuccess, kFailure if not attached or out of memory
+ */
+fn_t drv_led_set_output(const uint8_t kStrip, bool gamma, uint8_t brightness,
+                        bool dither) {
+  led_strip_t *strip = led_get_strip(kStrip);
+  if (strip == NULL) {
+    return kFailure;
+  }
+  if (!gamma && brightness == 255 && !dither) {
+    strip->output = false;  // raw bytes, as set
+    return kSuccess;
+  }
+  if (strip->lut == NULL) {
+    // read by the encoder from the RMT interrupt
+    strip->lut = (uint16_t *)heap_caps_malloc(
+        256 * sizeof(uint16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (strip->lut == NULL) {
+      return kFailure;
+    }
+  }
+  for (int i = 0; i < 256; i++) {
+    uint32_t level = gamma ? pixel_gamma22[i] : (uint32_t)i << 8;
+    strip->lut[i] = (uint16_t)(level * brightness / 255);
+  }
+  strip->dither = dither;
+  strip->output = true;
   return kSuccess;
 }
+
+/**
+ * @brief Tells whether a strip dithers its output
+ *
+ * @param kStrip Strip number
+ * @return true if dithering is on, false otherwise or if not attached
+ */
+bool drv_led_dithering(const uint8_t kStrip) {
+  led_strip_t *strip = led_get_strip(kStrip);
+  return strip != NULL && strip->output && strip->dither;
+}
+
+/**
+ * @brief Sets the RGB LED color
+ *
+ * @param kStrip Strip number
+ * @param kNum LED index (0-based)
+ * @param kRed Red component (0-255)
+ * @param kGreen Green component (0-255)
+ * @param kBlue Blue component (0-255)
+ * @return kSuccess on successful operation, kFailure if LED index is invalid
+ */
+fn_t drv_led_set(const uint8_t kStrip, const uint16_t kNum,
+                 const uint8_t kRed, const uint8_t kGreen,
+                 const uint8_t kBlue) {
+  if (drv_led_set_pixel(kStrip, kNum, kRed, kGreen, kBlue, 0) != kSuccess) {
+    return kFailure;
+  }
+  return drv_led_show(kStrip);
+}
+
+/**
+ * @brief Returns the number of pixels of a strip
+ *
+ * @param kStrip Strip number
+ * @return Number of LEDs, 0 if not attached
+ */
+uint16_t drv_led_size(const uint8_t kStrip) {
+  led_strip_t *strip = led_get_strip(kStrip);
+  return strip == NULL ? 0 : strip->size;
+}
+
+/**
+ * @brief Returns the pixel format of a strip
+ *
+ * @param kStrip Strip number
+ * @return Bytes per pixel (a drv_led_format_t), 0 if not attached
+ */
+uint8_t drv_led_format(const uint8_t kStrip) {
+  led_strip_t *strip = led_get_strip(kStrip);
+  return strip == NULL ? 0 : strip->bpp;
+}
+
+/**
+ * @brief Returns the number of RMT transactions sent so far
+ *
+ * @param kStrip Strip number
+ * @return Transaction count
+ */
+uint32_t drv_led_transmit_count(const uint8_t kStrip) {
+  led_strip_t *strip = led_get_strip(kStrip);
+  return strip == NULL ? 0 : strip->transmit_count;
+}
+
+/**
+ * @brief Returns how often show had to wait for a frame buffer
+ *
+ * @param kStrip Strip number
+ * @return Stall count
+ */
+uint32_t drv_led_stall_count(const uint8_t kStrip) {
+  led_strip_t *strip = led_get_strip(kStrip);
+  return strip == NULL ? 0 : strip->stall_count;
+}
@@ -8,38 +8,181 @@
 #ifndef LED_H
 #define LED_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include "../lib/fn.h"
 #include "driver/gpio.h"
 
+/**
+ * @brief Pixel formats, the value is the number of bytes per pixel
+ */
+typedef enum {
+  kLedGrb = 3,   // WS2812, SK6812 RGB
+  kLedGrbw = 4,  // SK6812 RGBW
+} drv_led_format_t;
+
 /**
  * @brief Initializes the LED driver
  *
- * Sets up the RMT peripheral for controlling WS2812 RGB LEDs.
+ * Sets up the RMT peripheral for the built-in WS2812 RGB LEDs as strip 0.
  *
  * @param pin_num GPIO number
  * @param size Number of LEDs
  * @return kSuccess on successful initialization
  */
-fn_t drv_led_init(gpio_num_t pin_num, uint8_t size);
+fn_t drv_led_init(gpio_num_t pin_num, uint16_t size);
+
+/**
+ * @brief Attaches a WS2812 compatible strip
+ *
+ * Every strip gets its own RMT channel, so strips are sent in parallel. A
+ * strip already attached on the same pin is replaced.
+ *
+ * @param pin_num GPIO number
+ * @param size Number of LEDs
+ * @param format Pixel format
+ * @return Strip number, -1 if out of channels or memory
+ */
+int drv_led_attach(gpio_num_t pin_num, uint16_t size,
+                   drv_led_format_t format);
+
+/**
+ * @brief Returns the strip attached on a pin
+ *
+ * @param pin_num GPIO number
+ * @return Strip number, -1 if there is none
+ */
+int drv_led_find(gpio_num_t pin_num);
+
+/**
+ * @brief Detaches a strip and frees its RMT channel and frame buffers
+ *
+ * @param kStrip Strip number
+ * @return kSuccess, kFailure if the strip is not attached
+ */
+fn_t drv_led_detach(const uint8_t kStrip);
 
 /**
  * @brief Sets the RGB LED color
  *
+ * Sets one pixel and queues the frame, see drv_led_show().
+ *
+ * @param kStrip Strip number
  * @param kNum LED index (0-based)
  * @param kRed Red component (0-255)
  * @param kGreen Green component (0-255)
  * @param kBlue Blue component (0-255)
  * @return kSuccess on successful operation, kFailure if LED index is invalid
  */
-fn_t drv_led_set(const uint8_t kNum, const uint8_t kRed, const uint8_t kGreen,
+fn_t drv_led_set(const uint8_t kStrip, const uint16_t kNum,
+                 const uint8_t kRed, const uint8_t kGreen,
                  const uint8_t kBlue);
 
-// PWM制御関数
-fn_t drv_pwm_init(void);
-int drv_pwm_setup_pin(gpio_num_t gpio_pin, uint8_t initial_duty);
-fn_t drv_pwm_set_duty(int channel, uint8_t duty);
-fn_t drv_pwm_disable(int channel);
+/**
+ * @brief Sets one pixel in the frame buffer without sending it
+ *
+ * Call drv_led_show() once after updating several pixels.
+ *
+ * @param kStrip Strip number
+ * @param kNum LED index (0-based)
+ * @param kRed Red component (0-255)
+ * @param kGreen Green component (0-255)
+ * @param kBlue Blue component (0-255)
+ * @param kWhite White component (0-255), ignored on RGB strips
+ * @return kSuccess on successful operation, kFailure if LED index is invalid
+ */
+fn_t drv_led_set_pixel(const uint8_t kStrip, const uint16_t kNum,
+                       const uint8_t kRed, const uint8_t kGreen,
+                       const uint8_t kBlue, const uint8_t kWhite);
+
+/**
+ * @brief Queues the frame buffer for transmission and returns
+ *
+ * The frame is sent in the background while the next one is edited. This
+ * only blocks when two frames are already waiting to be sent.
+ *
+ * @param kStrip Strip number
+ * @return kSuccess on successful operation, kFailure if not attached
+ */
+fn_t drv_led_show(const uint8_t kStrip);
+
+/**
+ * @brief Sends the last frame again if the strip is idle
+ *
+ * Keeps dithered strips moving through their dither phases when no new
+ * frames are shown. The frame being edited is not touched.
+ *
+ * @param kStrip Strip number
+ * @return kSuccess if a frame was sent, kFailure if frames are in flight,
+ * none has been shown yet or the strip is not attached
+ */
+fn_t drv_led_refresh(const uint8_t kStrip);
+
+/**
+ * @brief Waits until every queued frame has been sent
+ *
+ * @param kStrip Strip number
+ * @param timeout_ms Timeout in milliseconds
+ * @return kSuccess when the strip is idle, kFailure on timeout or if not
+ * attached
+ */
+fn_t drv_led_wait(const uint8_t kStrip, uint32_t timeout_ms);
+
+/**
+ * @brief Sets the output stage of a strip
+ *
+ * The encoder maps every byte through a gamma/brightness table as it sends
+ * the frame, so the frame buffer keeps the colors as set. With everything
+ * off (no gamma, brightness 255, no dithering) bytes are sent as they are.
+ *
+ * @param kStrip Strip number
+ * @param gamma Apply gamma 2.2
+ * @param brightness Global brightness (0-255)
+ * @param dither Dither the levels between frames
+ * @return kSuccess, kFailure if not attached or out of memory
+ */
+fn_t drv_led_set_output(const uint8_t kStrip, bool gamma, uint8_t brightness,
+                        bool dither);
+
+/**
+ * @brief Tells whether a strip dithers its output
+ *
+ * @param kStrip Strip number
+ * @return true if dithering is on, false otherwise or if not attached
+ */
+bool drv_led_dithering(const uint8_t kStrip);
+
+/**
+ * @brief Returns the number of pixels of a strip
+ *
+ * @param kStrip Strip number
+ * @return Number of LEDs, 0 if not attached
+ */
+uint16_t drv_led_size(const uint8_t kStrip);
+
+/**
+ * @brief Returns the pixel format of a strip
+ *
+ * @param kStrip Strip number
+ * @return Bytes per pixel (a drv_led_format_t), 0 if not attached
+ */
+uint8_t drv_led_format(const uint8_t kStrip);
+
+/**
+ * @brief Returns the number of RMT transactions sent so far
+ *
+ * @param kStrip Strip number
+ * @return Transaction count
+ */
+uint32_t drv_led_transmit_count(const uint8_t kStrip);
+
+/**
+ * @brief Returns how often show had to wait for a frame buffer
+ *
+ * @param kStrip Strip number
+ * @return Stall count
+ */
+uint32_t drv_led_stall_count(const uint8_t kStrip);
 
 #endif
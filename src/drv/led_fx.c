@@ -0,0 +1,482 @@
+/**
+ * @file led_fx.c
+ * @brief Native LED effect engine implementation
+ *
+ * A periodic esp_timer wakes a driver task that renders one frame of every
+ * running effect. Frames are computed from the time since the effect
+ * started, not by counting ticks, so a late frame never shifts the rest of
+ * the animation. The task runs above the mruby/c VM and its state lives
+ * outside the VM heap, so effects survive a VM reload.
+ *
+ * The same task sends dithered strips again on every tick they have no new
+ * frame, whether an effect skipped it or the script shows a still image,
+ * so their dither phase keeps moving. The 8 phases have to cycle well above
+ * the flicker threshold, so while a strip dithers the timer ticks every
+ * LED_FX_DITHER_US and effects still render only every LED_FX_FRAME_US.
+ * A short strip takes under a millisecond to send; a longer one is sent
+ * again as soon as its last frame is out, as the refresh skips strips with
+ * frames in flight.
+ */
+#include "led_fx.h"
+
+#include <string.h>
+
+#include "../lib/fn.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "led.h"
+#include "soc/soc_caps.h"
+
+#define LED_FX_MAX_STRIPS SOC_RMT_TX_CANDIDATES_PER_GROUP
+#define LED_FX_FRAME_US 20000  // 50 frames/s
+#define LED_FX_DITHER_US 1250  // 800 refreshes/s, 8 phases cycle at 100 Hz
+#define LED_FX_TASK_STACK 3072
+#define LED_FX_TASK_PRIORITY 5  // above the mruby/c VM task
+
+typedef enum {
+  kLedFxNone = 0,
+  kLedFxKeyframes,
+  kLedFxRainbow,
+  kLedFxChase,
+} led_fx_type_t;
+
+typedef struct {
+  led_fx_type_t type;
+  int64_t start_us;
+  // keyframes
+  drv_led_fx_key_t keys[LED_FX_MAX_KEYS];
+  uint8_t count;
+  uint16_t repeat;
+  uint32_t total_ms;
+  // rainbow
+  uint32_t period_ms;
+  uint8_t brightness;
+  // chase
+  uint8_t rgbw[4];
+  uint8_t background[4];
+  uint16_t length;
+  uint16_t step_ms;
+  // what was sent last, to skip frames that would not change anything
+  bool shown;
+  uint8_t last_rgbw[4];
+  uint32_t last_step;
+} led_fx_t;
+
+static led_fx_t led_fx[LED_FX_MAX_STRIPS];
+static SemaphoreHandle_t led_fx_lock = NULL;  // guards led_fx[]
+static TaskHandle_t led_fx_task_handle = NULL;
+static esp_timer_handle_t led_fx_timer = NULL;
+static volatile int64_t led_fx_tick_us = 0;
+static uint32_t led_fx_period_us = 0;  // timer period while it runs
+static int64_t led_fx_render_us = 0;   // when effects were last rendered
+static uint32_t led_fx_frames = 0;
+static uint32_t led_fx_missed = 0;
+static uint32_t led_fx_max_late_us = 0;
+
+/**
+ * @brief Fills every pixel of a strip with one color and sends it
+ */
+static void led_fx_fill(const uint8_t kStrip, const uint8_t rgbw[4]) {
+  uint16_t size = drv_led_size(kStrip);
+  for (uint16_t i = 0; i < size; i++) {
+    drv_led_set_pixel(kStrip, i, rgbw[0], rgbw[1], rgbw[2], rgbw[3]);
+  }
+  drv_led_show(kStrip);
+}
+
+/**
+ * @brief Returns the color of the color wheel at hue, scaled by brightness
+ */
+static void led_fx_wheel(uint8_t hue, uint8_t brightness, uint8_t rgbw[4]) {
+  uint8_t r, g, b;
+  if (hue < 85) {
+    r = 255 - hue * 3;
+    g = hue * 3;
+    b = 0;
+  } else if (hue < 170) {
+    hue -= 85;
+    r = 0;
+    g = 255 - hue * 3;
+    b = hue * 3;
+  } else {
+    hue -= 170;
+    r = hue * 3;
+    g = 0;
+    b = 255 - hue * 3;
+  }
+  rgbw[0] = (r * (brightness + 1)) >> 8;
+  rgbw[1] = (g * (brightness + 1)) >> 8;
+  rgbw[2] = (b * (brightness + 1)) >> 8;
+  rgbw[3] = 0;
+}
+
+static void led_fx_render_keyframes(const uint8_t kStrip, led_fx_t *fx,
+                                    uint32_t ms) {
+  uint8_t rgbw[4];
+  if (fx->repeat != 0 && ms / fx->total_ms >= fx->repeat) {
+    memcpy(rgbw, fx->keys[fx->count - 1].rgbw, 4);
+    fx->type = kLedFxNone;  // done, the last color stays on
+  } else {
+    uint32_t t = ms % fx->total_ms;
+    uint8_t i = 0;
+    while (t >= fx->keys[i].ms) {
+      t -= fx->keys[i].ms;
+      i++;
+    }
+    const drv_led_fx_key_t *key = &fx->keys[i];
+    if (key->fade) {
+      const drv_led_fx_key_t *prev =
+          &fx->keys[(i + fx->count - 1) % fx->count];
+      for (int c = 0; c < 4; c++) {
+        int32_t delta = (int32_t)key->rgbw[c] - prev->rgbw[c];
+        rgbw[c] = prev->rgbw[c] + delta * (int32_t)t / key->ms;
+      }
+    } else {
+      memcpy(rgbw, key->rgbw, 4);
+    }
+  }
+  if (fx->shown && memcmp(rgbw, fx->last_rgbw, 4) == 0) {
+    return;
+  }
+  led_fx_fill(kStrip, rgbw);
+  memcpy(fx->last_rgbw, rgbw, 4);
+  fx->shown = true;
+}
+
+static void led_fx_render_rainbow(const uint8_t kStrip, led_fx_t *fx,
+                                  uint32_t ms) {
+  uint16_t size = drv_led_size(kStrip);
+  uint8_t base = (uint8_t)((uint64_t)ms * 256 / fx->period_ms);
+  for (uint16_t i = 0; i < size; i++) {
+    uint8_t rgbw[4];
+    led_fx_wheel(base + i * 256 / size, fx->brightness, rgbw);
+    drv_led_set_pixel(kStrip, i, rgbw[0], rgbw[1], rgbw[2], rgbw[3]);
+  }
+  drv_led_show(kStrip);
+}
+
+static void led_fx_render_chase(const uint8_t kStrip, led_fx_t *fx,
+                                uint32_t ms) {
+  uint16_t size = drv_led_size(kStrip);
+  uint32_t step = ms / fx->step_ms;
+  if (size == 0 || (fx->shown && step == fx->last_step)) {
+    return;
+  }
+  uint16_t head = step % size;
+  for (uint16_t i = 0; i < size; i++) {
+    const uint8_t *c =
+        ((i + size - head) % size < fx->length) ? fx->rgbw : fx->background;
+    drv_led_set_pixel(kStrip, i, c[0], c[1], c[2], c[3]);
+  }
+  drv_led_show(kStrip);
+  fx->last_step = step;
+  fx->shown = true;
+}
+
+/**
+ * @brief Effect timer callback, wakes the engine task for the next frame
+ */
+static void led_fx_tick(void *arg) {
+  led_fx_tick_us = esp_timer_get_time();
+  xTaskNotifyGive(led_fx_task_handle);
+}
+
+/**
+ * @brief Starts the timer, or restarts it if it ticks at another period
+ *
+ * Call with the engine lock held.
+ *
+ * @param period_us LED_FX_FRAME_US or LED_FX_DITHER_US
+ */
+static void led_fx_timer_run(uint32_t period_us) {
+  if (esp_timer_is_active(led_fx_timer)) {
+    if (led_fx_period_us == period_us) return;
+    esp_timer_stop(led_fx_timer);
+  }
+  led_fx_period_us = period_us;
+  esp_timer_start_periodic(led_fx_timer, period_us);
+}
+
+/**
+ * @brief Engine task, renders one frame of every running effect per frame
+ * time and refreshes dithered strips on every tick
+ *
+ * Stops the timer when no effect and no dithered strip is left, and moves
+ * it back to the frame rate when the last strip stops dithering.
+ */
+static void led_fx_task(void *arg) {
+  while (1) {
+    uint32_t ticks = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    int64_t now = esp_timer_get_time();
+    if (ticks > 1) led_fx_missed += ticks - 1;
+    uint32_t late = (uint32_t)(now - led_fx_tick_us);
+    if (late > led_fx_max_late_us) led_fx_max_late_us = late;
+
+    xSemaphoreTake(led_fx_lock, portMAX_DELAY);
+    // Half a dither tick of slack, so a slightly early tick is not skipped.
+    bool render = now - led_fx_render_us >=
+                  LED_FX_FRAME_US - LED_FX_DITHER_US / 2;
+    if (render) led_fx_render_us = now;
+    bool running = false;
+    bool dithering = false;
+    for (uint8_t i = 0; i < LED_FX_MAX_STRIPS; i++) {
+      led_fx_t *fx = &led_fx[i];
+      if (render) {
+        uint32_t ms = (uint32_t)((now - fx->start_us) / 1000);
+        switch (fx->type) {
+          case kLedFxKeyframes:
+            led_fx_render_keyframes(i, fx, ms);
+            break;
+          case kLedFxRainbow:
+            led_fx_render_rainbow(i, fx, ms);
+            break;
+          case kLedFxChase:
+            led_fx_render_chase(i, fx, ms);
+            break;
+          default:
+            break;
+        }
+      }
+      if (fx->type != kLedFxNone) running = true;
+      if (drv_led_dithering(i)) {
+        drv_led_refresh(i);  // no-op while a frame is still being sent
+        dithering = true;
+      }
+    }
+    if (dithering) {
+      led_fx_timer_run(LED_FX_DITHER_US);
+    } else if (running) {
+      led_fx_timer_run(LED_FX_FRAME_US);
+    } else {
+      esp_timer_stop(led_fx_timer);
+    }
+    if (render) led_fx_frames++;
+    xSemaphoreGive(led_fx_lock);
+  }
+}
+
+/**
+ * @brief Creates the engine task and timer on first use
+ *
+ * @return kSuccess, kFailure if out of memory
+ */
+static fn_t led_fx_engine_init(void) {
+  if (led_fx_timer != NULL) {
+    return kSuccess;
+  }
+  if (led_fx_lock == NULL) {
+    led_fx_lock = xSemaphoreCreateMutex();
+    if (led_fx_lock == NULL) return kFailure;
+  }
+  if (led_fx_task_handle == NULL &&
+      xTaskCreate(led_fx_task, "led_fx", LED_FX_TASK_STACK, NULL,
+                  LED_FX_TASK_PRIORITY, &led_fx_task_handle) != pdPASS) {
+    led_fx_task_handle = NULL;
+    return kFailure;
+  }
+  const esp_timer_create_args_t args = {
+      .callback = led_fx_tick,
+      .name = "led_fx",
+  };
+  if (esp_timer_create(&args, &led_fx_timer) != ESP_OK) {
+    led_fx_timer = NULL;
+    return kFailure;
+  }
+  return kSuccess;
+}
+
+/**
+ * @brief Takes the effect slot of a strip for a new effect
+ *
+ * On success the engine lock is held; led_fx_commit() releases it.
+ *
+ * @param kStrip Strip number
+ * @return Slot to fill in, NULL if the strip is not attached or the engine
+ * could not start
+ */
+static led_fx_t *led_fx_begin(const uint8_t kStrip) {
+  if (kStrip >= LED_FX_MAX_STRIPS || drv_led_size(kStrip) == 0 ||
+      led_fx_engine_init() != kSuccess) {
+    return NULL;
+  }
+  xSemaphoreTake(led_fx_lock, portMAX_DELAY);
+  led_fx_t *fx = &led_fx[kStrip];
+  memset(fx, 0, sizeof(*fx));
+  return fx;
+}
+
+/**
+ * @brief Starts the effect filled in after led_fx_begin()
+ */
+static fn_t led_fx_commit(led_fx_t *fx, led_fx_type_t type) {
+  fx->type = type;
+  fx->start_us = esp_timer_get_time();
+  if (!esp_timer_is_active(led_fx_timer)) {
+    led_fx_timer_run(LED_FX_FRAME_US);
+  }
+  xSemaphoreGive(led_fx_lock);
+  return kSuccess;
+}
+
+/**
+ * @brief Plays a keyframe sequence on every pixel of a strip
+ *
+ * @param kStrip Strip number
+ * @param keys Steps, copied
+ * @param count Number of steps (1 to LED_FX_MAX_KEYS)
+ * @param repeat Number of times to play the sequence, 0 for forever
+ * @return kSuccess, kFailure if the strip is not attached or the steps are
+ * invalid
+ */
+fn_t drv_led_fx_keyframes(const uint8_t kStrip, const drv_led_fx_key_t *keys,
+                          uint8_t count, uint16_t repeat) {
+  uint32_t total_ms = 0;
+  if (count == 0 || count > LED_FX_MAX_KEYS) {
+    return kFailure;
+  }
+  for (uint8_t i = 0; i < count; i++) {
+    total_ms += keys[i].ms;
+  }
+  if (total_ms == 0) {
+    return kFailure;
+  }
+  led_fx_t *fx = led_fx_begin(kStrip);
+  if (fx == NULL) {
+    return kFailure;
+  }
+  memcpy(fx->keys, keys, count * sizeof(keys[0]));
+  fx->count = count;
+  fx->repeat = repeat;
+  fx->total_ms = total_ms;
+  return led_fx_commit(fx, kLedFxKeyframes);
+}
+
+/**
+ * @brief Plays a rainbow that moves along the strip
+ *
+ * @param kStrip Strip number
+ * @param period_ms Time for one turn of the color wheel
+ * @param brightness Brightness (0-255)
+ * @return kSuccess, kFailure if the strip is not attached
+ */
+fn_t drv_led_fx_rainbow(const uint8_t kStrip, uint32_t period_ms,
+                        uint8_t brightness) {
+  if (period_ms == 0) {
+    return kFailure;
+  }
+  led_fx_t *fx = led_fx_begin(kStrip);
+  if (fx == NULL) {
+    return kFailure;
+  }
+  fx->period_ms = period_ms;
+  fx->brightness = brightness;
+  return led_fx_commit(fx, kLedFxRainbow);
+}
+
+/**
+ * @brief Moves a lit segment along the strip
+ *
+ * @param kStrip Strip number
+ * @param rgbw Segment color
+ * @param background Color of the other pixels
+ * @param length Segment length in pixels
+ * @param step_ms Time per one pixel step
+ * @return kSuccess, kFailure if the strip is not attached
+ */
+fn_t drv_led_fx_chase(const uint8_t kStrip, const uint8_t rgbw[4],
+                      const uint8_t background[4], uint16_t length,
+                      uint16_t step_ms) {
+  if (step_ms == 0) {
+    return kFailure;
+  }
+  led_fx_t *fx = led_fx_begin(kStrip);
+  if (fx == NULL) {
+    return kFailure;
+  }
+  memcpy(fx->rgbw, rgbw, 4);
+  memcpy(fx->background, background, 4);
+  fx->length = length;
+  fx->step_ms = step_ms;
+  return led_fx_commit(fx, kLedFxChase);
+}
+
+/**
+ * @brief Stops the effect running on a strip
+ *
+ * @param kStrip Strip number
+ * @return kSuccess always
+ */
+fn_t drv_led_fx_stop(const uint8_t kStrip) {
+  if (kStrip >= LED_FX_MAX_STRIPS || led_fx_lock == NULL) {
+    return kSuccess;
+  }
+  xSemaphoreTake(led_fx_lock, portMAX_DELAY);
+  led_fx[kStrip].type = kLedFxNone;
+  xSemaphoreGive(led_fx_lock);
+  return kSuccess;
+}
+
+/**
+ * @brief Detaches a strip once the engine is not using it
+ *
+ * Stops the effect on the strip and releases it under the engine lock, so
+ * the task is never rendering or refreshing a strip being freed.
+ *
+ * @param kStrip Strip number
+ * @return kSuccess, kFailure if the strip is not attached
+ */
+fn_t drv_led_fx_detach(const uint8_t kStrip) {
+  if (led_fx_lock == NULL) {
+    return drv_led_detach(kStrip);
+  }
+  xSemaphoreTake(led_fx_lock, portMAX_DELAY);
+  if (kStrip < LED_FX_MAX_STRIPS) led_fx[kStrip].type = kLedFxNone;
+  fn_t ret = drv_led_detach(kStrip);
+  xSemaphoreGive(led_fx_lock);
+  return ret;
+}
+
+/**
+ * @brief Runs the engine for a strip that has just turned dithering on
+ *
+ * @param kStrip Strip number
+ * @return kSuccess, kFailure if the engine could not start
+ */
+fn_t drv_led_fx_dither(const uint8_t kStrip) {
+  if (!drv_led_dithering(kStrip)) {
+    return kSuccess;  // the task lets the timer stop by itself
+  }
+  if (led_fx_engine_init() != kSuccess) {
+    return kFailure;
+  }
+  xSemaphoreTake(led_fx_lock, portMAX_DELAY);
+  led_fx_timer_run(LED_FX_DITHER_US);
+  xSemaphoreGive(led_fx_lock);
+  return kSuccess;
+}
+
+/**
+ * @brief Tells whether an effect is running on a strip
+ *
+ * @param kStrip Strip number
+ * @return true while an effect is running
+ */
+bool drv_led_fx_running(const uint8_t kStrip) {
+  return kStrip < LED_FX_MAX_STRIPS && led_fx[kStrip].type != kLedFxNone;
+}
+
+/**
+ * @brief Returns the engine statistics
+ *
+ * @param frames Number of frames rendered
+ * @param missed Number of ticks missed because a frame took too long
+ * @param max_late_us Largest delay between a tick and its frame
+ */
+void drv_led_fx_stats(uint32_t *frames, uint32_t *missed,
+                      uint32_t *max_late_us) {
+  *frames = led_fx_frames;
+  *missed = led_fx_missed;
+  *max_late_us = led_fx_max_late_us;
+}
@@ -0,0 +1,121 @@
+/**
+ * @file led_fx.h
+ * @brief Native LED effect engine interface
+ *
+ * Runs blink sequences, fades, rainbows and chases on LED strips from a
+ * driver task, so their timing does not depend on the mruby/c VM. Effects
+ * keep running while the VM is busy or reloading.
+ */
+#ifndef LED_FX_H
+#define LED_FX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../lib/fn.h"
+
+// Maximum number of keyframes of one effect
+#define LED_FX_MAX_KEYS 32
+
+/**
+ * @brief One step of a keyframe effect
+ */
+typedef struct {
+  uint8_t rgbw[4];  // color: red, green, blue, white
+  uint16_t ms;      // how long the step lasts
+  bool fade;        // fade in from the previous step's color
+} drv_led_fx_key_t;
+
+/**
+ * @brief Plays a keyframe sequence on every pixel of a strip
+ *
+ * Replaces the effect running on the strip.
+ *
+ * @param kStrip Strip number
+ * @param keys Steps, copied
+ * @param count Number of steps (1 to LED_FX_MAX_KEYS)
+ * @param repeat Number of times to play the sequence, 0 for forever. The
+ * last color stays on when it ends.
+ * @return kSuccess, kFailure if the strip is not attached or the steps are
+ * invalid
+ */
+fn_t drv_led_fx_keyframes(const uint8_t kStrip, const drv_led_fx_key_t *keys,
+                          uint8_t count, uint16_t repeat);
+
+/**
+ * @brief Plays a rainbow that moves along the strip
+ *
+ * @param kStrip Strip number
+ * @param period_ms Time for one turn of the color wheel
+ * @param brightness Brightness (0-255)
+ * @return kSuccess, kFailure if the strip is not attached
+ */
+fn_t drv_led_fx_rainbow(const uint8_t kStrip, uint32_t period_ms,
+                        uint8_t brightness);
+
+/**
+ * @brief Moves a lit segment along the strip
+ *
+ * @param kStrip Strip number
+ * @param rgbw Segment color
+ * @param background Color of the other pixels
+ * @param length Segment length in pixels
+ * @param step_ms Time per one pixel step
+ * @return kSuccess, kFailure if the strip is not attached
+ */
+fn_t drv_led_fx_chase(const uint8_t kStrip, const uint8_t rgbw[4],
+                      const uint8_t background[4], uint16_t length,
+                      uint16_t step_ms);
+
+/**
+ * @brief Stops the effect running on a strip
+ *
+ * The pixels keep their last color. The engine no longer touches the strip
+ * once this returns.
+ *
+ * @param kStrip Strip number
+ * @return kSuccess always
+ */
+fn_t drv_led_fx_stop(const uint8_t kStrip);
+
+/**
+ * @brief Detaches a strip once the engine is not using it
+ *
+ * Use this instead of drv_led_detach() while the engine may run.
+ *
+ * @param kStrip Strip number
+ * @return kSuccess, kFailure if the strip is not attached
+ */
+fn_t drv_led_fx_detach(const uint8_t kStrip);
+
+/**
+ * @brief Runs the engine for a strip that has just turned dithering on
+ *
+ * While a strip dithers, the engine sends its last frame again on every
+ * tick it has no new one, so the dither phase keeps moving on still
+ * images.
+ *
+ * @param kStrip Strip number
+ * @return kSuccess, kFailure if the engine could not start
+ */
+fn_t drv_led_fx_dither(const uint8_t kStrip);
+
+/**
+ * @brief Tells whether an effect is running on a strip
+ *
+ * @param kStrip Strip number
+ * @return true while an effect is running
+ */
+bool drv_led_fx_running(const uint8_t kStrip);
+
+/**
+ * @brief Returns the engine statistics
+ *
+ * @param frames Number of frames rendered
+ * @param missed Number of ticks missed because a frame took too long
+ * @param max_late_us Largest delay between a tick and its frame
+ */
+void drv_led_fx_stats(uint32_t *frames, uint32_t *missed,
+                      uint32_t *max_late_us);
+
+#endif
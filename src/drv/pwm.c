@@ -9,53 +9,203 @@
 #include "pwm.h"
 
 #include "driver/ledc.h"
+#include "esp_attr.h"
 #include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "soc/soc_caps.h"
 
 // PWM用のタグ定義
 static const char *TAG = "PWM";
 
 // PWM設定用の定数
-#define LEDC_TIMER LEDC_TIMER_0
 #define LEDC_MODE LEDC_LOW_SPEED_MODE
-#define LEDC_DUTY_RES LEDC_TIMER_13_BIT  // 0-8191の解像度
-#define LEDC_FREQUENCY 5000              // 5kHz
-#define LEDC_MAX_CHANNELS 8              // ESP32は8チャンネルまでサポート
+#define LEDC_DEFAULT_FREQUENCY 5000  // 5kHz
+#define LEDC_MAX_CHANNELS 8          // ESP32は8チャンネルまでサポート
+#define LEDC_MAX_TIMERS LEDC_TIMER_MAX
+#define LEDC_SRC_CLK_HZ 80000000  // APBクロック（分解能の計算用）
 
 // PWM用の構造体
 typedef struct {
   ledc_channel_t channel;
   gpio_num_t gpio;
   bool in_use;
+  uint8_t timer;          // pwm_timersの添字
+  uint32_t duty;          // 最後に設定したデューティ値
+  volatile bool fading;   // ハードウェアフェード中
+  uint16_t gen;           // 世代。設定し直すたびに進み、古いハンドルを弾く
 } pwm_channel_t;
 
+// タイマー1つにつき周波数1つ。同じ周波数のチャンネルは共有する
+typedef struct {
+  uint32_t freq_hz;
+  uint8_t res_bits;
+  uint8_t users;  // このタイマーを使うチャンネル数
+} pwm_timer_t;
+
 static pwm_channel_t pwm_channels[LEDC_MAX_CHANNELS] = {0};
+static pwm_timer_t pwm_timers[LEDC_MAX_TIMERS] = {0};
 static bool pwm_initialized = false;
+static bool pwm_fade_installed = false;
+// drv_pwm_set_dutiesの反映をまとめるためのロック
+static portMUX_TYPE pwm_latch_lock = portMUX_INITIALIZER_UNLOCKED;
 
 /**
- * @brief PWM機能の初期化
- *
- * LEDC周波数とタイマーを設定します
+ * @brief 周波数に対して取れる最大の分解能を求める
  *
- * @return kSuccess 初期化成功時
+ * @param freq_hz 周波数
+ * @return ビット数（1-SOC_LEDC_TIMER_BIT_WIDTH）
  */
-fn_t drv_pwm_init(void) {
-  if (pwm_initialized) {
-    return kSuccess;
+static uint8_t pwm_resolution(uint32_t freq_hz) {
+  uint8_t bits = 1;
+  while (bits < SOC_LEDC_TIMER_BIT_WIDTH &&
+         ((uint64_t)freq_hz << (bits + 1)) <= LEDC_SRC_CLK_HZ) {
+    bits++;
   }
+  return bits;
+}
 
-  // LEDCのタイマー設定
+/**
+ * @brief タイマーを周波数に合わせて設定
+ *
+ * @param timer タイマー番号
+ * @param freq_hz 周波数
+ * @return kSuccess 成功時、kFailure 失敗時
+ */
+static fn_t pwm_timer_config(int timer, uint32_t freq_hz) {
+  uint8_t bits = pwm_resolution(freq_hz);
   ledc_timer_config_t ledc_timer = {.speed_mode = LEDC_MODE,
-                                    .timer_num = LEDC_TIMER,
-                                    .duty_resolution = LEDC_DUTY_RES,
-                                    .freq_hz = LEDC_FREQUENCY,
+                                    .timer_num = timer,
+                                    .duty_resolution = bits,
+                                    .freq_hz = freq_hz,
                                     .clk_cfg = LEDC_AUTO_CLK};
-
-  // タイマー設定を適用
   esp_err_t err = ledc_timer_config(&ledc_timer);
   if (err != ESP_OK) {
     ESP_LOGE(TAG, "PWM timer setup failed with error: %d", err);
     return kFailure;
   }
+  pwm_timers[timer].freq_hz = freq_hz;
+  pwm_timers[timer].res_bits = bits;
+  return kSuccess;
+}
+
+/**
+ * @brief 周波数が同じ使用中のタイマーを探す
+ *
+ * @param freq_hz 周波数
+ * @return タイマー番号、なければ-1
+ */
+static int pwm_timer_find(uint32_t freq_hz) {
+  for (int i = 0; i < LEDC_MAX_TIMERS; i++) {
+    if (pwm_timers[i].users > 0 && pwm_timers[i].freq_hz == freq_hz) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/**
+ * @brief 周波数に合うタイマーを確保
+ *
+ * 同じ周波数のタイマーがあれば共有し、なければ空きタイマーを設定します。
+ *
+ * @param freq_hz 周波数
+ * @return タイマー番号、空きがなければ-1
+ */
+static int pwm_timer_acquire(uint32_t freq_hz) {
+  int timer = pwm_timer_find(freq_hz);
+  if (timer < 0) {
+    for (int i = 0; i < LEDC_MAX_TIMERS; i++) {
+      if (pwm_timers[i].users == 0) {
+        timer = i;
+        break;
+      }
+    }
+    if (timer < 0 || pwm_timer_config(timer, freq_hz) != kSuccess) {
+      return -1;
+    }
+  }
+  pwm_timers[timer].users++;
+  return timer;
+}
+
+/**
+ * @brief 有効なチャンネルを返す
+ *
+ * @param channel チャンネル番号
+ * @return チャンネル、無効なときNULL
+ */
+static pwm_channel_t *pwm_get_channel(int channel) {
+  if (channel < 0 || channel >= LEDC_MAX_CHANNELS ||
+      !pwm_channels[channel].in_use) {
+    return NULL;
+  }
+  return &pwm_channels[channel];
+}
+
+/**
+ * @brief フェード終了コールバック（ISR）
+ */
+static bool IRAM_ATTR pwm_fade_end(const ledc_cb_param_t *param,
+                                   void *user_arg) {
+  if (param->event == LEDC_FADE_END_EVT) {
+    ((pwm_channel_t *)user_arg)->fading = false;
+  }
+  return false;
+}
+
+/**
+ * @brief フェードを止められずにチャンネルを触れないかを返す
+ *
+ * フェードを止められないチップ（ESP32）では、フェードが終わるまで
+ * デューティ値もタイマーも変えられません。
+ *
+ * @param ch チャンネル
+ * @return フェードが終わるまで待つ必要があるときtrue
+ */
+static bool pwm_fade_busy(const pwm_channel_t *ch) {
+#if SOC_LEDC_SUPPORT_FADE_STOP
+  return false;
+#else
+  return ch->fading;
+#endif
+}
+
+/**
+ * @brief 実行中のフェードを止める
+ *
+ * フェードを止められないチップ（ESP32）では待たずにfalseを返します。
+ * VMのタスクを数秒止めないよう、呼び出し側はそのまま失敗を返します。
+ *
+ * @param ch チャンネル
+ * @return フェードがなくなったときtrue
+ */
+static bool pwm_fade_cancel(pwm_channel_t *ch) {
+  if (!ch->fading) {
+    return true;
+  }
+  if (pwm_fade_busy(ch)) {
+    return false;
+  }
+#if SOC_LEDC_SUPPORT_FADE_STOP
+  ledc_fade_stop(LEDC_MODE, ch->channel);
+#endif
+  ch->fading = false;
+  return true;
+}
+
+/**
+ * @brief PWM機能の初期化
+ *
+ * チャンネル表を初期化します。タイマーはチャンネルの設定時に
+ * 周波数ごとに割り当てます。
+ *
+ * @return kSuccess 初期化成功時
+ */
+fn_t drv_pwm_init(void) {
+  if (pwm_initialized) {
+    return kSuccess;
+  }
 
   // チャンネル構造体を初期化
   for (int i = 0; i < LEDC_MAX_CHANNELS; i++) {
@@ -69,22 +219,21 @@ fn_t drv_pwm_init(void) {
 }
 
 /**
- * @brief 指定したGPIOピンをPWM出力として設定
+ * @brief 指定したGPIOピンを周波数を指定してPWM出力として設定
  *
  * @param gpio_pin GPIOピン番号
- * @param initial_duty 初期デューティ値 (0-100%)
+ * @param freq_hz 周波数
+ * @param initial_duty 初期デューティ値（0-drv_pwm_get_max_duty()）
  * @return 成功時にチャンネル番号、失敗時に-1
  */
-int drv_pwm_setup_pin(gpio_num_t gpio_pin, uint8_t initial_duty) {
-  ESP_LOGI(TAG, "Setting up PWM on GPIO %d with duty %d%%", gpio_pin,
-           initial_duty);
-
-  if (!pwm_initialized) {
-    ESP_LOGI(TAG, "PWM not initialized, initializing now");
-    if (drv_pwm_init() != kSuccess) {
-      ESP_LOGE(TAG, "PWM initialization failed");
-      return -1;
-    }
+int drv_pwm_setup(gpio_num_t gpio_pin, uint32_t freq_hz,
+                  uint32_t initial_duty) {
+  if (!pwm_initialized && drv_pwm_init() != kSuccess) {
+    ESP_LOGE(TAG, "PWM initialization failed");
+    return -1;
+  }
+  if (freq_hz == 0) {
+    return -1;
   }
 
   // 空きチャンネルを探す
@@ -101,40 +250,99 @@ int drv_pwm_setup_pin(gpio_num_t gpio_pin, uint8_t initial_duty) {
     return -1;  // 空きチャンネルがない
   }
 
+  int timer = pwm_timer_acquire(freq_hz);
+  if (timer < 0) {
+    ESP_LOGE(TAG, "No PWM timer left for %lu Hz", (unsigned long)freq_hz);
+    return -1;
+  }
+  uint32_t max_duty = 1UL << pwm_timers[timer].res_bits;
+  if (initial_duty > max_duty) initial_duty = max_duty;
+
   // ピンのリセットと設定
   gpio_reset_pin(gpio_pin);
   esp_err_t gpio_err = gpio_set_direction(gpio_pin, GPIO_MODE_OUTPUT);
   if (gpio_err != ESP_OK) {
     ESP_LOGE(TAG, "Failed to set GPIO direction: %d", gpio_err);
+    pwm_timers[timer].users--;
     return -1;
   }
 
-  // 0-100%を0-8191の範囲に変換
-  uint32_t duty = (initial_duty * 8191) / 100;
-
   // チャンネル設定
   ledc_channel_config_t ledc_channel = {
       .channel = pwm_channels[channel_idx].channel,
-      .duty = duty,
+      .duty = initial_duty,
       .gpio_num = gpio_pin,
       .speed_mode = LEDC_MODE,
       .hpoint = 0,
-      .timer_sel = LEDC_TIMER};
+      .timer_sel = timer};
 
   esp_err_t err = ledc_channel_config(&ledc_channel);
   if (err != ESP_OK) {
     ESP_LOGE(TAG, "PWM channel config failed with error: %d", err);
+    pwm_timers[timer].users--;
     return -1;
   }
 
   // チャンネル情報を保存
   pwm_channels[channel_idx].in_use = true;
   pwm_channels[channel_idx].gpio = gpio_pin;
+  pwm_channels[channel_idx].timer = timer;
+  pwm_channels[channel_idx].duty = initial_duty;
+  pwm_channels[channel_idx].fading = false;
+  if (++pwm_channels[channel_idx].gen == 0) {
+    pwm_channels[channel_idx].gen = 1;  // 0は使わない
+  }
 
-  ESP_LOGI(TAG, "PWM setup successful on channel %d", channel_idx);
+  ESP_LOGI(TAG, "PWM setup on channel %d, GPIO %d, %lu Hz, %d bit",
+           channel_idx, gpio_pin, (unsigned long)freq_hz,
+           pwm_timers[timer].res_bits);
   return channel_idx;
 }
 
+/**
+ * @brief 指定したGPIOピンをPWM出力として設定
+ *
+ * 5kHz、デューティ比は%で指定します。
+ *
+ * @param gpio_pin GPIOピン番号
+ * @param initial_duty 初期デューティ値 (0-100%)
+ * @return 成功時にチャンネル番号、失敗時に-1
+ */
+int drv_pwm_setup_pin(gpio_num_t gpio_pin, uint8_t initial_duty) {
+  uint32_t max_duty = 1UL << pwm_resolution(LEDC_DEFAULT_FREQUENCY);
+  return drv_pwm_setup(gpio_pin, LEDC_DEFAULT_FREQUENCY,
+                       initial_duty * max_duty / 100);
+}
+
+/**
+ * @brief PWMのデューティ値をそのままの分解能で設定
+ *
+ * 頻繁に呼ばれる前提なのでログは出しません。ミューテックスは使わず、
+ * LEDCドライバ内部の短いクリティカルセクションだけです。
+ *
+ * @param channel チャンネル番号
+ * @param duty デューティ値（0-drv_pwm_get_max_duty()）
+ * @return kSuccess 成功時、kFailure 失敗時
+ */
+fn_t drv_pwm_set_duty_raw(int channel, uint32_t duty) {
+  pwm_channel_t *ch = pwm_get_channel(channel);
+  if (ch == NULL) {
+    return kFailure;
+  }
+  uint32_t max_duty = 1UL << pwm_timers[ch->timer].res_bits;
+  if (duty > max_duty) duty = max_duty;
+
+  if (!pwm_fade_cancel(ch)) {
+    return kFailure;
+  }
+  if (ledc_set_duty(LEDC_MODE, ch->channel, duty) != ESP_OK ||
+      ledc_update_duty(LEDC_MODE, ch->channel) != ESP_OK) {
+    return kFailure;
+  }
+  ch->duty = duty;
+  return kSuccess;
+}
+
 /**
  * @brief PWMのデューティ比を設定
  *
@@ -143,29 +351,189 @@ int drv_pwm_setup_pin(gpio_num_t gpio_pin, uint8_t initial_duty) {
  * @return kSuccess 成功時、kFailure 失敗時
  */
 fn_t drv_pwm_set_duty(int channel, uint8_t duty) {
-  if (channel < 0 || channel >= LEDC_MAX_CHANNELS ||
-      !pwm_channels[channel].in_use) {
-    ESP_LOGE(TAG, "Invalid PWM channel: %d", channel);
+  pwm_channel_t *ch = pwm_get_channel(channel);
+  if (ch == NULL || duty > 100) {
+    return kFailure;
+  }
+  uint32_t max_duty = 1UL << pwm_timers[ch->timer].res_bits;
+  return drv_pwm_set_duty_raw(channel, duty * max_duty / 100);
+}
+
+/**
+ * @brief 複数チャンネルのデューティ値を同時に切り替える
+ *
+ * ledc_set_dutyはデューティ値を書き込むだけで、出力はledc_update_dutyの
+ * 後の周期の頭で切り替わります。割り込みを止めても、反映の指示の途中で
+ * 周期の境目を越えれば、先に指示したチャンネルだけが一周期早く変わります。
+ * そこで書き込みを先に全部済ませ、関係するタイマーを止めてから反映を
+ * 指示し、タイマーを再開します。止まっている間は境目が来ないので、同じ
+ * タイマーのチャンネルは必ず同じ周期の頭で切り替わります。その代わり、
+ * 実行中の周期がタイマーを止めていた数マイクロ秒だけ延びます。
+ *
+ * @param channels チャンネル番号の配列
+ * @param duties デューティ値の配列（0-drv_pwm_get_max_duty()）
+ * @param count 要素数（1-8）
+ * @return kSuccess 成功時、kFailure 失敗時
+ */
+fn_t drv_pwm_set_duties(const int *channels, const uint32_t *duties,
+                        uint8_t count) {
+  if (count == 0 || count > LEDC_MAX_CHANNELS) {
     return kFailure;
   }
+  // 途中で失敗して一部だけ変わらないよう、先に全部検証する
+  for (int i = 0; i < count; i++) {
+    pwm_channel_t *ch = pwm_get_channel(channels[i]);
+    if (ch == NULL || pwm_fade_busy(ch)) {
+      return kFailure;
+    }
+  }
 
-  // 0-100%を0-8191の範囲に変換
-  uint32_t duty_scaled = (duty * 8191) / 100;
+  for (int i = 0; i < count; i++) {
+    pwm_channel_t *ch = &pwm_channels[channels[i]];
+    uint32_t max_duty = 1UL << pwm_timers[ch->timer].res_bits;
+    uint32_t duty = duties[i] > max_duty ? max_duty : duties[i];
+    pwm_fade_cancel(ch);  // 検証済みなので止まる
+    if (ledc_set_duty(LEDC_MODE, ch->channel, duty) != ESP_OK) {
+      return kFailure;
+    }
+    ch->duty = duty;
+  }
 
-  esp_err_t err =
-      ledc_set_duty(LEDC_MODE, pwm_channels[channel].channel, duty_scaled);
-  if (err != ESP_OK) {
-    ESP_LOGE(TAG, "PWM set duty failed with error: %d", err);
+  // 関係するタイマー（pwm_timersの添字のビット）
+  uint32_t timers = 0;
+  for (int i = 0; i < count; i++) {
+    timers |= 1UL << pwm_channels[channels[i]].timer;
+  }
+
+  fn_t result = kSuccess;
+  portENTER_CRITICAL(&pwm_latch_lock);
+  for (int t = 0; t < LEDC_MAX_TIMERS; t++) {
+    if (timers & (1UL << t)) ledc_timer_pause(LEDC_MODE, t);
+  }
+  for (int i = 0; i < count; i++) {
+    if (ledc_update_duty(LEDC_MODE, pwm_channels[channels[i]].channel) !=
+        ESP_OK) {
+      result = kFailure;
+    }
+  }
+  for (int t = 0; t < LEDC_MAX_TIMERS; t++) {
+    if (timers & (1UL << t)) ledc_timer_resume(LEDC_MODE, t);
+  }
+  portEXIT_CRITICAL(&pwm_latch_lock);
+  return result;
+}
+
+/**
+ * @brief チャンネルの周波数を返す
+ *
+ * @param channel チャンネル番号
+ * @return 周波数、無効なチャンネルは0
+ */
+uint32_t drv_pwm_get_freq(int channel) {
+  pwm_channel_t *ch = pwm_get_channel(channel);
+  return ch == NULL ? 0 : pwm_timers[ch->timer].freq_hz;
+}
+
+/**
+ * @brief デューティ値の最大（100%）を返す
+ *
+ * @param channel チャンネル番号
+ * @return 最大デューティ値、無効なチャンネルは0
+ */
+uint32_t drv_pwm_get_max_duty(int channel) {
+  pwm_channel_t *ch = pwm_get_channel(channel);
+  return ch == NULL ? 0 : 1UL << pwm_timers[ch->timer].res_bits;
+}
+
+/**
+ * @brief チャンネルの周波数を変更
+ *
+ * 同じ周波数のタイマーがあれば共有し、チャンネルがタイマーを
+ * 1人で使っていればそのタイマーを設定し直します。デューティ比は
+ * 割合を保って新しい分解能に合わせます。
+ *
+ * @param channel チャンネル番号
+ * @param freq_hz 周波数
+ * @return kSuccess 成功時、kFailure 失敗時（タイマーの空きがない等）
+ */
+fn_t drv_pwm_set_freq(int channel, uint32_t freq_hz) {
+  pwm_channel_t *ch = pwm_get_channel(channel);
+  if (ch == NULL || freq_hz == 0) {
     return kFailure;
   }
+  int old = ch->timer;
+  if (pwm_timers[old].freq_hz == freq_hz) {
+    return kSuccess;
+  }
+  if (!pwm_fade_cancel(ch)) {
+    return kFailure;
+  }
+  uint32_t old_max = 1UL << pwm_timers[old].res_bits;
 
-  err = ledc_update_duty(LEDC_MODE, pwm_channels[channel].channel);
-  if (err != ESP_OK) {
-    ESP_LOGE(TAG, "PWM update duty failed with error: %d", err);
+  int timer = pwm_timer_find(freq_hz);
+  if (timer < 0 && pwm_timers[old].users == 1) {
+    if (pwm_timer_config(old, freq_hz) != kSuccess) {
+      return kFailure;
+    }
+    timer = old;
+  } else {
+    timer = pwm_timer_acquire(freq_hz);
+    if (timer < 0) {
+      return kFailure;
+    }
+    if (ledc_bind_channel_timer(LEDC_MODE, ch->channel, timer) != ESP_OK) {
+      pwm_timers[timer].users--;
+      return kFailure;
+    }
+    pwm_timers[old].users--;
+    ch->timer = timer;
+  }
+
+  uint32_t max_duty = 1UL << pwm_timers[timer].res_bits;
+  return drv_pwm_set_duty_raw(channel,
+                              (uint64_t)ch->duty * max_duty / old_max);
+}
+
+/**
+ * @brief ハードウェアでデューティ値をフェード
+ *
+ * LEDCがフェードを進めるのでCPUは使いません。すぐに戻ります。
+ *
+ * @param channel チャンネル番号
+ * @param duty 目標のデューティ値（0-drv_pwm_get_max_duty()）
+ * @param time_ms フェード時間
+ * @return kSuccess 成功時、kFailure 失敗時
+ */
+fn_t drv_pwm_fade(int channel, uint32_t duty, uint32_t time_ms) {
+  pwm_channel_t *ch = pwm_get_channel(channel);
+  if (ch == NULL) {
     return kFailure;
   }
+  if (!pwm_fade_installed) {
+    if (ledc_fade_func_install(0) != ESP_OK) {
+      ESP_LOGE(TAG, "PWM fade install failed");
+      return kFailure;
+    }
+    pwm_fade_installed = true;
+  }
+  uint32_t max_duty = 1UL << pwm_timers[ch->timer].res_bits;
+  if (duty > max_duty) duty = max_duty;
 
-  ESP_LOGI(TAG, "PWM duty set to %d%% on channel %d", duty, channel);
+  if (!pwm_fade_cancel(ch)) {
+    return kFailure;
+  }
+  ledc_cbs_t cbs = {.fade_cb = pwm_fade_end};
+  ledc_cb_register(LEDC_MODE, ch->channel, &cbs, ch);
+  if (ledc_set_fade_with_time(LEDC_MODE, ch->channel, duty, time_ms) !=
+      ESP_OK) {
+    return kFailure;
+  }
+  ch->fading = true;
+  if (ledc_fade_start(LEDC_MODE, ch->channel, LEDC_FADE_NO_WAIT) != ESP_OK) {
+    ch->fading = false;
+    return kFailure;
+  }
+  ch->duty = duty;
   return kSuccess;
 }
 
@@ -173,19 +541,90 @@ fn_t drv_pwm_set_duty(int channel, uint8_t duty) {
  * @brief PWMチャンネルを無効化
  *
  * @param channel チャンネル番号
- * @return kSuccess 成功時、kFailure 失敗時
+ * @return kSuccess 成功時、kFailure 失敗時（ESP32でフェード中など）
  */
 fn_t drv_pwm_disable(int channel) {
-  if (channel < 0 || channel >= LEDC_MAX_CHANNELS ||
-      !pwm_channels[channel].in_use) {
+  pwm_channel_t *ch = pwm_get_channel(channel);
+  if (ch == NULL || !pwm_fade_cancel(ch)) {
     return kFailure;
   }
-
-  esp_err_t err = ledc_stop(LEDC_MODE, pwm_channels[channel].channel, 0);
+  esp_err_t err = ledc_stop(LEDC_MODE, ch->channel, 0);
   if (err != ESP_OK) {
     return kFailure;
   }
 
-  pwm_channels[channel].in_use = false;
+  pwm_timers[ch->timer].users--;
+  ch->in_use = false;
   return kSuccess;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief チャンネルが設定済みかを返す
+ *
+ * @param channel チャンネル番号（範囲外でもよい）
+ * @return 設定済みのときtrue
+ */
+bool drv_pwm_in_use(int channel) { return pwm_get_channel(channel) != NULL; }
+
+/**
+ * @brief チャンネルのハンドルを返す
+ *
+ * ハンドルはチャンネル番号に世代を組み合わせた値です。チャンネルを
+ * 無効化して設定し直すと世代が進むので、古いハンドルは別の出力を
+ * 指さなくなります。
+ *
+ * @param channel チャンネル番号
+ * @return ハンドル（LEDC_MAX_CHANNELS以上）、無効なチャンネルは-1
+ */
+int drv_pwm_handle(int channel) {
+  pwm_channel_t *ch = pwm_get_channel(channel);
+  return ch == NULL ? -1 : (int)ch->gen * LEDC_MAX_CHANNELS + channel;
+}
+
+/**
+ * @brief ハンドルが指すチャンネル番号を返す
+ *
+ * 世代は1から始まるので、LEDC_MAX_CHANNELS未満の値（世代を持たない
+ * チャンネル番号）はハンドルではありません。受け付けると、disableの後に
+ * 別のピンに割り当てられたチャンネルを古い番号で動かせてしまいます。
+ *
+ * @param handle ハンドル
+ * @return チャンネル番号、無効または古いハンドルのとき-1
+ */
+int drv_pwm_handle_channel(int handle) {
+  if (handle < LEDC_MAX_CHANNELS) {
+    return -1;
+  }
+  int channel = handle % LEDC_MAX_CHANNELS;
+  pwm_channel_t *ch = pwm_get_channel(channel);
+  if (ch == NULL || ch->gen != handle / LEDC_MAX_CHANNELS) {
+    return -1;
+  }
+  return channel;
+}
+
+/**
+ * @brief 設定済みのチャンネルをすべて無効化
+ *
+ * VMの終了後に呼ばれるので、止められないフェードは終わるまで待ちます。
+ *
+ * @return kSuccess 常に成功
+ */
+fn_t drv_pwm_release_all(void) {
+  int released = 0;
+  for (int i = 0; i < LEDC_MAX_CHANNELS; i++) {
+    if (!pwm_channels[i].in_use) {
+      continue;
+    }
+    while (pwm_fade_busy(&pwm_channels[i])) {
+      vTaskDelay(1);
+    }
+    if (drv_pwm_disable(i) == kSuccess) {
+      released++;
+    }
+  }
+  if (released > 0) {
+    ESP_LOGI(TAG, "Released %d PWM channels", released);
+  }
+  return kSuccess;
+}
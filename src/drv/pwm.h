@@ -9,6 +9,7 @@
 #ifndef PWM_H
 #define PWM_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include "../lib/fn.h"
@@ -17,15 +18,32 @@
 /**
  * @brief PWM機能の初期化
  *
- * LEDC周波数とタイマーを設定します
+ * チャンネル表を初期化します。タイマーはチャンネルの設定時に
+ * 周波数ごとに割り当てます。
  *
  * @return kSuccess 初期化成功時
  */
 fn_t drv_pwm_init(void);
 
+/**
+ * @brief 指定したGPIOピンを周波数を指定してPWM出力として設定
+ *
+ * LEDCのタイマー（4つ）を周波数ごとに共有します。分解能は周波数に
+ * 対して取れる最大です（5kHzで13ビット）。
+ *
+ * @param gpio_pin GPIOピン番号
+ * @param freq_hz 周波数
+ * @param initial_duty 初期デューティ値（0-drv_pwm_get_max_duty()）
+ * @return 成功時にチャンネル番号、失敗時に-1
+ */
+int drv_pwm_setup(gpio_num_t gpio_pin, uint32_t freq_hz,
+                  uint32_t initial_duty);
+
 /**
  * @brief 指定したGPIOピンをPWM出力として設定
  *
+ * 5kHz、デューティ比は%で指定します。
+ *
  * @param gpio_pin GPIOピン番号
  * @param initial_duty 初期デューティ値 (0-100%)
  * @return 成功時にチャンネル番号、失敗時に-1
@@ -42,11 +60,118 @@ int drv_pwm_setup_pin(gpio_num_t gpio_pin, uint8_t initial_duty);
 fn_t drv_pwm_set_duty(int channel, uint8_t duty);
 
 /**
- * @brief PWMチャンネルを無効化
+ * @brief PWMのデューティ値をそのままの分解能で設定
+ *
+ * ログを出さず、ミューテックスも使いません。
  *
  * @param channel チャンネル番号
+ * @param duty デューティ値（0-drv_pwm_get_max_duty()）
  * @return kSuccess 成功時、kFailure 失敗時
  */
+fn_t drv_pwm_set_duty_raw(int channel, uint32_t duty);
+
+/**
+ * @brief 複数チャンネルのデューティ値を同時に切り替える
+ *
+ * すべてのデューティ値を書き込んでから、関係するタイマーを止めて
+ * まとめて反映を指示し、タイマーを再開します。同じタイマーのチャンネルは
+ * 次のPWM周期の頭で一斉に切り替わります。実行中の周期はタイマーを
+ * 止めていた数マイクロ秒だけ延びます。
+ *
+ * @param channels チャンネル番号の配列
+ * @param duties デューティ値の配列（0-drv_pwm_get_max_duty()）
+ * @param count 要素数（1-8）
+ * @return kSuccess 成功時、kFailure 失敗時（無効なチャンネルがあれば
+ * 何も変えません）
+ */
+fn_t drv_pwm_set_duties(const int *channels, const uint32_t *duties,
+                        uint8_t count);
+
+/**
+ * @brief チャンネルの周波数を返す
+ *
+ * @param channel チャンネル番号
+ * @return 周波数、無効なチャンネルは0
+ */
+uint32_t drv_pwm_get_freq(int channel);
+
+/**
+ * @brief デューティ値の最大（100%）を返す
+ *
+ * @param channel チャンネル番号
+ * @return 最大デューティ値、無効なチャンネルは0
+ */
+uint32_t drv_pwm_get_max_duty(int channel);
+
+/**
+ * @brief チャンネルの周波数を変更
+ *
+ * @param channel チャンネル番号
+ * @param freq_hz 周波数
+ * @return kSuccess 成功時、kFailure 失敗時（タイマーの空きがない等）
+ */
+fn_t drv_pwm_set_freq(int channel, uint32_t freq_hz);
+
+/**
+ * @brief ハードウェアでデューティ値をフェード
+ *
+ * フェードを止められないチップ（ESP32）では、フェードが終わるまで
+ * このチャンネルのデューティ値・周波数の変更、フェード、無効化は
+ * 待たずにkFailureを返します。
+ *
+ * @param channel チャンネル番号
+ * @param duty 目標のデューティ値（0-drv_pwm_get_max_duty()）
+ * @param time_ms フェード時間
+ * @return kSuccess 成功時、kFailure 失敗時
+ */
+fn_t drv_pwm_fade(int channel, uint32_t duty, uint32_t time_ms);
+
+/**
+ * @brief PWMチャンネルを無効化
+ *
+ * @param channel チャンネル番号
+ * @return kSuccess 成功時、kFailure 失敗時（ESP32でフェード中など）
+ */
 fn_t drv_pwm_disable(int channel);
 
+/**
+ * @brief チャンネルが設定済みかを返す
+ *
+ * @param channel チャンネル番号（範囲外でもよい）
+ * @return 設定済みのときtrue
+ */
+bool drv_pwm_in_use(int channel);
+
+/**
+ * @brief チャンネルのハンドルを返す
+ *
+ * ハンドルはチャンネル番号に世代を組み合わせた値です。チャンネルを
+ * 無効化して設定し直すと世代が進むので、古いハンドルは別の出力を
+ * 指さなくなります。
+ *
+ * @param channel チャンネル番号
+ * @return ハンドル、無効なチャンネルは-1
+ */
+int drv_pwm_handle(int channel);
+
+/**
+ * @brief ハンドルが指すチャンネル番号を返す
+ *
+ * 世代を持たないチャンネル番号（0-7）は受け付けません。
+ *
+ * @param handle ハンドル
+ * @return チャンネル番号、無効または古いハンドルのとき-1
+ */
+int drv_pwm_handle_channel(int handle);
+
+/**
+ * @brief 設定済みのチャンネルをすべて無効化
+ *
+ * VMの終了後に呼び、スクリプトが解放しなかったチャンネルとタイマーを
+ * 次のスクリプトに持ち越さないようにします。
+ *
+ * @return kSuccess 常に成功
+ */
+fn_t drv_pwm_release_all(void);
+
 #endif /* PWM_H */
\ No newline at end of file
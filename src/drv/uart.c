@@ -10,34 +10,362 @@
  */
 #include "uart.h"
 
+#include <stdlib.h>
+#include <string.h>
+
+#include "../lib/ring/spsc_ring.h"
 #include "driver/uart.h"
 #include "esp_err.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"  // Required for pdMS_TO_TICKS
-#include "freertos/task.h"      // Required for pdMS_TO_TICKS
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"  // Required for pdMS_TO_TICKS
 
 #define TAG "UART_DRV"
-#define DEBUG_UART 1  // デバッグログの有効/無効を切り替える
+#define DEBUG_UART 0  // 1にすると読み書きのたびにログを出す (遅くなる)
 
 // デバッグログマクロ
 #if DEBUG_UART
 #define UART_DEBUG(fmt, ...) ESP_LOGD(TAG, fmt, ##__VA_ARGS__)
 #define UART_PERF(fmt, ...) ESP_LOGI(TAG, "[PERF] " fmt, ##__VA_ARGS__)
 #else
-#define UART_DEBUG(fmt, ...)
-#define UART_PERF(fmt, ...)
+// 無効時も呼び出しは if (0) で残し、書式の検査と変数の参照を保つ
+#define UART_DEBUG(fmt, ...)                  \
+  do {                                        \
+    if (0) ESP_LOGD(TAG, fmt, ##__VA_ARGS__); \
+  } while (0)
+#define UART_PERF(fmt, ...)                             \
+  do {                                                  \
+    if (0) ESP_LOGI(TAG, "[PERF] " fmt, ##__VA_ARGS__); \
+  } while (0)
 #endif
 
+#define UART_EVENT_QUEUE_LEN 20
+#define UART_CTRL_QUEUE_LEN 8
+#define UART_SERVICE_TASK_STACK 3072
+#define UART_SERVICE_TASK_PRIORITY 10  // mruby/c VMタスクより高く
+#define UART_RX_RING_MIN_SIZE 1024
+#define UART_TX_RETRY_TICKS 1  // 送信側が詰まっているときの再試行間隔
+
+// サービスタスクへの制御メッセージ
+typedef enum {
+  kUartCtrlTxKick,  // TXリングに積んだ
+  kUartCtrlAttach,  // イベントキューをキューセットに加える
+  kUartCtrlDetach,  // イベントキューをキューセットから外す
+} uart_ctrl_cmd_t;
+
+typedef struct {
+  uart_ctrl_cmd_t cmd;
+  uart_port_num_t uart_num;
+} uart_ctrl_t;
+
+// 全ポートで共有する1つのサービスタスク。各ポートのイベントキューと
+// 制御キューをキューセットで同時に待つ。最初のinitで作り、以後は残す。
+static struct {
+  TaskHandle_t task;
+  QueueSetHandle_t set;
+  QueueHandle_t ctrl;
+  SemaphoreHandle_t done;  // attach/detachの完了通知
+} uart_service;
+
 // UART設定と初期化状態を保存するための構造体
 // UART_NUM_MAX を使用して ESP32 の全ポートに対応
+//
+// 受信はサービスタスクがESP-IDFのイベントキューを待ち、
+// ドライバのバッファからSPSCリングへ移す。読み出し側(mruby/cタスク)は
+// リングだけを見るので、ロックもポーリングも不要。
+// 非同期送信は逆向きで、mruby/cタスクがTXリングに積み、サービスタスクが
+// ドライバの送信バッファ (空きがなければFIFO) へ流す。
 static struct {
   bool initialized;
+  QueueHandle_t event_queue;
+  bool attached;                // キューセットに入っている
+  SemaphoreHandle_t rx_sem;     // データがリングに入るたびにgive
+  volatile int64_t last_rx_us;  // 最後にデータがリングに入った時刻
+  spsc_ring_t ring;
+  uint8_t* ring_buf;
+  spsc_ring_t tx_ring;
+  uint8_t* tx_ring_buf;
+  SemaphoreHandle_t tx_sem;  // TXリングから送り出すたびにgive
+  bool tx_fifo_only;         // ドライバの送信バッファなし
+  drv_uart_rx_notify_t notify;
+  void* notify_arg;
+  drv_uart_stats_t stats;
   // Keep track of pins/baud for logging or potential re-init?
   // int tx_pin;
   // int rx_pin;
   // int baud_rate;
 } uart_status[UART_NUM_MAX] = {0};  // Initialize all to false
 
+/**
+ * @brief Move everything the ESP-IDF driver holds into the RX ring
+ *
+ * Reads straight into the free region of the ring. When the ring is full
+ * the newest bytes are dropped and counted.
+ */
+static void uart_rx_drain(uart_port_num_t uart_num) {
+  size_t buffered = 0;
+  bool received = false;
+  uart_get_buffered_data_len(uart_num, &buffered);
+
+  while (buffered > 0) {
+    size_t space;
+    uint8_t* dst = spsc_ring_write_ptr(&uart_status[uart_num].ring, &space);
+    if (space == 0) {
+      uint8_t discard[64];
+      int n = uart_read_bytes(uart_num, discard,
+                              buffered < sizeof(discard) ? buffered
+                                                         : sizeof(discard),
+                              0);
+      if (n <= 0) break;
+      uart_status[uart_num].stats.rx_dropped += n;
+      buffered -= n;
+      continue;
+    }
+    int n = uart_read_bytes(uart_num, dst, space < buffered ? space : buffered,
+                            0);
+    if (n <= 0) break;
+    spsc_ring_commit(&uart_status[uart_num].ring, n);
+    uart_status[uart_num].stats.rx_bytes += n;
+    buffered -= n;
+    received = true;
+  }
+
+  if (received) {
+    uart_status[uart_num].last_rx_us = esp_timer_get_time();
+    xSemaphoreGive(uart_status[uart_num].rx_sem);
+    drv_uart_rx_notify_t notify = uart_status[uart_num].notify;
+    if (notify) notify(uart_num, uart_status[uart_num].notify_arg);
+  }
+}
+
+/**
+ * @brief Move queued TX data into the UART without blocking
+ *
+ * Hands the driver only as much as its TX buffer can take right now (or the
+ * hardware FIFO when the driver has no TX buffer), so the service task never
+ * stalls on a slow line.
+ *
+ * @return true if data is still waiting in the TX ring
+ */
+static bool uart_tx_pump(uart_port_num_t uart_num) {
+  spsc_ring_t* ring = &uart_status[uart_num].tx_ring;
+  bool sent = false;
+  size_t avail;
+  const uint8_t* src;
+
+  while ((src = spsc_ring_read_ptr(ring, &avail)) != NULL && avail > 0) {
+    int n;
+    if (uart_status[uart_num].tx_fifo_only) {
+      n = uart_tx_chars(uart_num, (const char*)src, avail);
+    } else {
+      size_t room = 0;
+      uart_get_tx_buffer_free_size(uart_num, &room);
+      if (room == 0) break;
+      n = uart_write_bytes(uart_num, (const char*)src,
+                           avail < room ? avail : room);
+    }
+    if (n <= 0) break;
+    spsc_ring_consume(ring, n);
+    uart_status[uart_num].stats.tx_sent += n;
+    sent = true;
+  }
+
+  if (sent) xSemaphoreGive(uart_status[uart_num].tx_sem);
+  return spsc_ring_count(ring) > 0;
+}
+
+/**
+ * @brief Handle one event from the driver queue of a port
+ */
+static void uart_handle_event(uart_port_num_t uart_num) {
+  uart_event_t event;
+  if (xQueueReceive(uart_status[uart_num].event_queue, &event, 0) != pdTRUE) {
+    return;
+  }
+  uart_status[uart_num].stats.rx_events++;
+  switch (event.type) {
+    case UART_DATA:
+      uart_rx_drain(uart_num);
+      break;
+    case UART_FIFO_OVF:
+    case UART_BUFFER_FULL:
+      uart_status[uart_num].stats.hw_overflows++;
+      uart_rx_drain(uart_num);
+      break;
+    default:
+      break;  // break/parity/frame errors
+  }
+}
+
+/**
+ * @brief Find the port that owns a queue set member
+ *
+ * @return Port number, or -1 if the member is not an attached event queue
+ */
+static int uart_port_of(QueueSetMemberHandle_t member) {
+  for (int i = 0; i < UART_NUM_MAX; i++) {
+    if (uart_status[i].attached && uart_status[i].event_queue == member) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static void uart_handle_member(QueueSetMemberHandle_t member);
+
+/**
+ * @brief Add the event queue of a port to the queue set
+ *
+ * A queue can only join a set while it is empty, so pending events are
+ * discarded first and the driver buffer is drained once instead.
+ */
+static void uart_attach(uart_port_num_t uart_num) {
+  QueueHandle_t queue = uart_status[uart_num].event_queue;
+  do {
+    xQueueReset(queue);
+  } while (xQueueAddToSet(queue, uart_service.set) != pdPASS);
+  uart_status[uart_num].attached = true;
+  uart_rx_drain(uart_num);
+}
+
+/**
+ * @brief Remove the event queue of a port from the queue set
+ *
+ * The RX interrupt is already off, so only events announced before the
+ * request can be left. They are handled in order until the queue is empty
+ * and can leave the set.
+ */
+static void uart_detach(uart_port_num_t uart_num) {
+  QueueHandle_t queue = uart_status[uart_num].event_queue;
+  while (xQueueRemoveFromSet(queue, uart_service.set) != pdPASS) {
+    QueueSetMemberHandle_t member = xQueueSelectFromSet(uart_service.set, 0);
+    if (member == NULL) {
+      xQueueReset(queue);  // 通知のないイベントは捨てる
+    } else {
+      uart_handle_member(member);
+    }
+  }
+  uart_status[uart_num].attached = false;
+}
+
+/**
+ * @brief Handle one member returned by the queue set
+ */
+static void uart_handle_member(QueueSetMemberHandle_t member) {
+  if (member == uart_service.ctrl) {
+    uart_ctrl_t ctrl;
+    if (xQueueReceive(uart_service.ctrl, &ctrl, 0) != pdTRUE) return;
+    switch (ctrl.cmd) {
+      case kUartCtrlTxKick:
+        break;  // 送信は毎周回まとめて流す
+      case kUartCtrlAttach:
+        uart_attach(ctrl.uart_num);
+        xSemaphoreGive(uart_service.done);
+        break;
+      case kUartCtrlDetach:
+        uart_detach(ctrl.uart_num);
+        xSemaphoreGive(uart_service.done);
+        break;
+    }
+    return;
+  }
+
+  int uart_num = uart_port_of(member);
+  if (uart_num < 0) return;
+  int64_t start = esp_timer_get_time();
+  uart_handle_event(uart_num);
+  uart_status[uart_num].stats.service_us += esp_timer_get_time() - start;
+}
+
+/**
+ * @brief Service task shared by all ports
+ *
+ * Waits on the event queues of every initialized port and the control queue
+ * at once, moves RX data into the rings and drains the TX rings. While TX
+ * data is waiting it wakes up every UART_TX_RETRY_TICKS to retry.
+ */
+static void uart_service_task(void* arg) {
+  bool tx_waiting = false;
+
+  while (true) {
+    QueueSetMemberHandle_t member = xQueueSelectFromSet(
+        uart_service.set, tx_waiting ? UART_TX_RETRY_TICKS : portMAX_DELAY);
+    if (member != NULL) uart_handle_member(member);
+
+    tx_waiting = false;
+    for (int i = 0; i < UART_NUM_MAX; i++) {
+      if (!uart_status[i].attached) continue;
+      int64_t start = esp_timer_get_time();
+      tx_waiting |= uart_tx_pump(i);
+      uart_status[i].stats.service_us += esp_timer_get_time() - start;
+    }
+  }
+}
+
+/**
+ * @brief Start the shared service task on first use
+ */
+static fn_t uart_service_start(void) {
+  if (uart_service.task) return kSuccess;
+
+  uart_service.set = xQueueCreateSet(UART_NUM_MAX * UART_EVENT_QUEUE_LEN +
+                                     UART_CTRL_QUEUE_LEN);
+  uart_service.ctrl = xQueueCreate(UART_CTRL_QUEUE_LEN, sizeof(uart_ctrl_t));
+  uart_service.done = xSemaphoreCreateBinary();
+  if (!uart_service.set || !uart_service.ctrl || !uart_service.done ||
+      xQueueAddToSet(uart_service.ctrl, uart_service.set) != pdPASS ||
+      xTaskCreate(uart_service_task, "uart_svc", UART_SERVICE_TASK_STACK, NULL,
+                  UART_SERVICE_TASK_PRIORITY, &uart_service.task) != pdPASS) {
+    ESP_LOGE(TAG, "UART service task creation failed");
+    if (uart_service.ctrl) vQueueDelete(uart_service.ctrl);
+    if (uart_service.set) vQueueDelete(uart_service.set);
+    if (uart_service.done) vSemaphoreDelete(uart_service.done);
+    uart_service.ctrl = NULL;
+    uart_service.set = NULL;
+    uart_service.done = NULL;
+    uart_service.task = NULL;
+    return kFailure;
+  }
+  return kSuccess;
+}
+
+/**
+ * @brief Send a control message and wait until the service task handled it
+ */
+static void uart_service_call(uart_ctrl_cmd_t cmd, uart_port_num_t uart_num) {
+  uart_ctrl_t ctrl = {.cmd = cmd, .uart_num = uart_num};
+  xQueueSend(uart_service.ctrl, &ctrl, portMAX_DELAY);
+  xSemaphoreTake(uart_service.done, portMAX_DELAY);
+}
+
+/**
+ * @brief Smallest power of two that is >= n
+ */
+static size_t uart_ring_size(size_t n) {
+  size_t size = UART_RX_RING_MIN_SIZE;
+  while (size < n) size <<= 1;
+  return size;
+}
+
+/**
+ * @brief Release the rings and semaphores of a port (NULL-safe)
+ */
+static void uart_free_rings(uart_port_num_t uart_num) {
+  free(uart_status[uart_num].ring_buf);
+  free(uart_status[uart_num].tx_ring_buf);
+  uart_status[uart_num].ring_buf = NULL;
+  uart_status[uart_num].tx_ring_buf = NULL;
+  if (uart_status[uart_num].rx_sem)
+    vSemaphoreDelete(uart_status[uart_num].rx_sem);
+  if (uart_status[uart_num].tx_sem)
+    vSemaphoreDelete(uart_status[uart_num].tx_sem);
+  uart_status[uart_num].rx_sem = NULL;
+  uart_status[uart_num].tx_sem = NULL;
+}
+
 /**
  * @brief Initialize UART port
  */
@@ -93,7 +421,33 @@ fn_t drv_uart_init(uart_port_num_t uart_num, int tx_pin, int rx_pin,
   // ドライバインストール (バッファサイズを引数から取得)
   // Queue size, interrupt flags are set to 0/default for now
   ESP_ERROR_CHECK(uart_driver_install(uart_num, rx_buffer_size, tx_buffer_size,
-                                      0, NULL, 0));
+                                      UART_EVENT_QUEUE_LEN,
+                                      &uart_status[uart_num].event_queue, 0));
+
+  // 受信/送信リングと共有サービスタスク
+  size_t ring_size = uart_ring_size(2 * rx_buffer_size);
+  size_t tx_ring_size = uart_ring_size(2 * tx_buffer_size);
+  uart_status[uart_num].ring_buf = (uint8_t*)malloc(ring_size);
+  uart_status[uart_num].tx_ring_buf = (uint8_t*)malloc(tx_ring_size);
+  uart_status[uart_num].rx_sem = xSemaphoreCreateBinary();
+  uart_status[uart_num].tx_sem = xSemaphoreCreateBinary();
+  if (!uart_status[uart_num].ring_buf || !uart_status[uart_num].tx_ring_buf ||
+      !uart_status[uart_num].rx_sem || !uart_status[uart_num].tx_sem ||
+      uart_service_start() != kSuccess) {
+    ESP_LOGE(TAG, "UART%d ring allocation failed", uart_num);
+    uart_free_rings(uart_num);
+    uart_driver_delete(uart_num);
+    return kFailure;
+  }
+  spsc_ring_init(&uart_status[uart_num].ring, uart_status[uart_num].ring_buf,
+                 ring_size);
+  spsc_ring_init(&uart_status[uart_num].tx_ring,
+                 uart_status[uart_num].tx_ring_buf, tx_ring_size);
+  uart_status[uart_num].tx_fifo_only = (tx_buffer_size == 0);
+  memset(&uart_status[uart_num].stats, 0, sizeof(drv_uart_stats_t));
+  uart_status[uart_num].notify = NULL;
+  uart_status[uart_num].last_rx_us = 0;
+  uart_service_call(kUartCtrlAttach, uart_num);
 
   // 状態を保存
   uart_status[uart_num].initialized = true;
@@ -127,6 +481,12 @@ int drv_uart_write(uart_port_num_t uart_num, const void* data, size_t len) {
     return -1;
   }
 
+  // write_asyncで積んだ分が先に出るよう、サービスタスクがTXリングを
+  // 送り終えるのを待つ。待っている間にmruby/cタスクが積むことはない
+  while (spsc_ring_count(&uart_status[uart_num].tx_ring) > 0) {
+    xSemaphoreTake(uart_status[uart_num].tx_sem, portMAX_DELAY);
+  }
+
   // データ送信 (uart_write_bytes expects const char*)
   int written = uart_write_bytes(uart_num, (const char*)data, len);
   TickType_t end_time = xTaskGetTickCount();
@@ -138,7 +498,7 @@ int drv_uart_write(uart_port_num_t uart_num, const void* data, size_t len) {
     // Return ESP-IDF error code? Or just -1?
     return -1;
   } else if (written != len) {
-    ESP_LOGW(TAG, "UART%d write incomplete: wrote %d of %d bytes", uart_num,
+    ESP_LOGW(TAG, "UART%d write incomplete: wrote %d of %zu bytes", uart_num,
              written, len);
     // Return written count anyway
   }
@@ -146,6 +506,61 @@ int drv_uart_write(uart_port_num_t uart_num, const void* data, size_t len) {
   return written;
 }
 
+/**
+ * @brief Queue data for transmission without blocking
+ */
+int drv_uart_write_async(uart_port_num_t uart_num, const void* data,
+                         size_t len) {
+  // パラメータチェック
+  if (uart_num < 0 || uart_num >= UART_NUM_MAX || (!data && len > 0)) {
+    ESP_LOGE(TAG, "Invalid UART write_async parameters");
+    return -1;
+  }
+
+  // 初期化チェック
+  if (!uart_status[uart_num].initialized) {
+    ESP_LOGE(TAG, "UART%d not initialized for write_async", uart_num);
+    return -1;
+  }
+
+  // 入る分だけ積む。ここではログを出さない (高頻度で呼ばれるため)
+  size_t queued = spsc_ring_write(&uart_status[uart_num].tx_ring, data, len);
+  uart_status[uart_num].stats.tx_queued += queued;
+  if (queued < len) {
+    uart_status[uart_num].stats.tx_rejected += len - queued;
+    uart_status[uart_num].stats.tx_backpressure++;
+  }
+
+  // サービスタスクを起こす。キューが満杯でも、そのときはタスクが
+  // 起きているので次の周回で送られる
+  if (queued > 0) {
+    uart_ctrl_t kick = {.cmd = kUartCtrlTxKick, .uart_num = uart_num};
+    xQueueSend(uart_service.ctrl, &kick, 0);
+  }
+  return queued;
+}
+
+/**
+ * @brief Wait until queued data has been transmitted
+ */
+fn_t drv_uart_flush(uart_port_num_t uart_num, uint32_t timeout_ms) {
+  if (uart_num < 0 || uart_num >= UART_NUM_MAX ||
+      !uart_status[uart_num].initialized) {
+    return kFailure;
+  }
+
+  // TXリングが空になるまで待ち、最後にUARTの送出完了を待つ
+  TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(timeout_ms);
+  while (spsc_ring_count(&uart_status[uart_num].tx_ring) > 0) {
+    TickType_t now = xTaskGetTickCount();
+    if ((int32_t)(deadline - now) <= 0) return kFailure;  // タイムアウト
+    xSemaphoreTake(uart_status[uart_num].tx_sem, deadline - now);
+  }
+  TickType_t now = xTaskGetTickCount();
+  TickType_t left = (int32_t)(deadline - now) > 0 ? deadline - now : 0;
+  return uart_wait_tx_done(uart_num, left) == ESP_OK ? kSuccess : kFailure;
+}
+
 /**
  * @brief Read data from UART port
  */
@@ -167,24 +582,21 @@ int drv_uart_read(uart_port_num_t uart_num, void* buf, size_t len,
     return -1;
   }
 
-  // タイムアウト設定（ティック単位）
-  // 無限待機は許可しない
-  TickType_t ticks_to_wait = pdMS_TO_TICKS(timeout_ms);
-  if (ticks_to_wait == 0) {
-    ticks_to_wait = 1;  // 最小待機時間を1ティックに設定
+  // リングから読み、足りなければサービスタスクの通知を待つ
+  spsc_ring_t* ring = &uart_status[uart_num].ring;
+  TickType_t deadline = start_time + pdMS_TO_TICKS(timeout_ms);
+  size_t read_bytes = spsc_ring_read(ring, buf, len);
+  while (read_bytes < len) {
+    TickType_t now = xTaskGetTickCount();
+    if ((int32_t)(deadline - now) <= 0) break;  // タイムアウト
+    xSemaphoreTake(uart_status[uart_num].rx_sem, deadline - now);
+    read_bytes +=
+        spsc_ring_read(ring, (uint8_t*)buf + read_bytes, len - read_bytes);
   }
-
-  // データ受信 (uart_read_bytes expects uint8_t* for buffer)
-  int read_bytes = uart_read_bytes(uart_num, (uint8_t*)buf, len, ticks_to_wait);
   TickType_t end_time = xTaskGetTickCount();
-  UART_PERF("UART%d read took %lu ms, got %d bytes", uart_num,
+  UART_PERF("UART%d read took %lu ms, got %zu bytes", uart_num,
             (end_time - start_time) * portTICK_PERIOD_MS, read_bytes);
 
-  if (read_bytes < 0) {
-    ESP_LOGE(TAG, "UART%d read failed (error code: %d)", uart_num, read_bytes);
-    return -1;
-  }
-
   return read_bytes;
 }
 
@@ -214,46 +626,30 @@ int drv_uart_read_until(uart_port_num_t uart_num, void* buf, size_t len,
 
   uint8_t* buffer = (uint8_t*)buf;
   size_t total_read = 0;
+  spsc_ring_t* ring = &uart_status[uart_num].ring;
 
-  // バッファサイズが1バイトの場合は通常のreadを使用
-  if (len == 1) {
-    return drv_uart_read(uart_num, buf, 1, timeout_ms);
-  }
-
-  // 一度に最大128バイト読み込む（ESP32のFIFOサイズに合わせる）
-  const size_t chunk_size = 128;
-  uint8_t temp_buf[chunk_size];
-
+  // リングの連続領域ごとにmemchrで探してまとめてコピーする。
+  // デリミタの後ろは読まない (残りは次の読み出しに回す)
   while (total_read < len) {
-    // 残り時間を計算
-    TickType_t current_time = xTaskGetTickCount();
-    if (current_time >= timeout_end) {
-      break;  // タイムアウト
+    bool found;
+    size_t n = spsc_ring_read_until(ring, &buffer[total_read], len - total_read,
+                                    (uint8_t)delimiter, &found);
+    total_read += n;
+    if (found) {
+      return total_read;  // デリミタを見つけた
     }
-
-    // 読み込むサイズを計算
-    size_t remaining = len - total_read;
-    size_t to_read = (remaining < chunk_size) ? remaining : chunk_size;
-
-    // データ読み込み
-    int read_bytes = uart_read_bytes(uart_num, temp_buf, to_read, 1);
-    UART_DEBUG("UART read_until chunk: read=%d bytes", read_bytes);
-
-    if (read_bytes <= 0) {
-      break;  // エラーまたはタイムアウト
+    if (n > 0) {
+      continue;
     }
-
-    // デリミタを探す
-    for (int i = 0; i < read_bytes; i++) {
-      buffer[total_read++] = temp_buf[i];
-      if (temp_buf[i] == (uint8_t)delimiter) {
-        return total_read;  // デリミタを見つけた
-      }
+    TickType_t current_time = xTaskGetTickCount();
+    if ((int32_t)(timeout_end - current_time) <= 0) {
+      break;  // タイムアウト
     }
+    xSemaphoreTake(uart_status[uart_num].rx_sem, timeout_end - current_time);
   }
 
   TickType_t actual_end_time = xTaskGetTickCount();
-  UART_PERF("UART%d read_until took %lu ms, total_read=%d", uart_num,
+  UART_PERF("UART%d read_until took %lu ms, total_read=%zu", uart_num,
             (actual_end_time - start_time) * portTICK_PERIOD_MS, total_read);
 
   return total_read;
@@ -277,9 +673,50 @@ fn_t drv_uart_get_available(uart_port_num_t uart_num, size_t* available_bytes) {
     return kFailure;  // Or return kSuccess with 0 bytes? Let's return failure.
   }
 
-  ESP_ERROR_CHECK(uart_get_buffered_data_len(uart_num, available_bytes));
-  UART_DEBUG("UART get_available result: available=%d bytes", *available_bytes);
-  return kSuccess;  // ESP_ERROR_CHECK ensures err == ESP_OK if we reach here
+  *available_bytes = spsc_ring_count(&uart_status[uart_num].ring);
+  UART_DEBUG("UART get_available result: available=%zu bytes", *available_bytes);
+  return kSuccess;
+}
+
+/**
+ * @brief Get the time the newest RX data was buffered
+ */
+fn_t drv_uart_get_rx_time(uart_port_num_t uart_num, int64_t* time_us) {
+  if (uart_num < 0 || uart_num >= UART_NUM_MAX || !time_us ||
+      !uart_status[uart_num].initialized) {
+    return kFailure;
+  }
+  *time_us = uart_status[uart_num].last_rx_us;
+  return kSuccess;
+}
+
+/**
+ * @brief Register a function called whenever RX data arrives
+ */
+fn_t drv_uart_set_rx_notify(uart_port_num_t uart_num,
+                            drv_uart_rx_notify_t notify, void* arg) {
+  if (uart_num < 0 || uart_num >= UART_NUM_MAX ||
+      !uart_status[uart_num].initialized) {
+    return kFailure;
+  }
+  uart_status[uart_num].notify = NULL;  // argを書き換える間は呼ばせない
+  uart_status[uart_num].notify_arg = arg;
+  uart_status[uart_num].notify = notify;
+  return kSuccess;
+}
+
+/**
+ * @brief Get the RX and TX counters of a port
+ */
+fn_t drv_uart_get_stats(uart_port_num_t uart_num, drv_uart_stats_t* stats) {
+  if (uart_num < 0 || uart_num >= UART_NUM_MAX || !stats ||
+      !uart_status[uart_num].initialized) {
+    return kFailure;
+  }
+  *stats = uart_status[uart_num].stats;
+  stats->tx_pending = spsc_ring_count(&uart_status[uart_num].tx_ring);
+  stats->tx_capacity = uart_status[uart_num].tx_ring.mask + 1;
+  return kSuccess;
 }
 
 /**
@@ -300,9 +737,15 @@ fn_t drv_uart_deinit(uart_port_num_t uart_num) {
     return kSuccess;  // Already deinitialized is success
   }
 
+  // 受信割り込みを止めてから、サービスタスクにキューを外させる
+  uart_status[uart_num].notify = NULL;
+  uart_disable_rx_intr(uart_num);
+  uart_service_call(kUartCtrlDetach, uart_num);
+
   // ドライバ削除
   // Note: This will also free the buffers allocated by uart_driver_install
   ESP_ERROR_CHECK(uart_driver_delete(uart_num));
+  uart_free_rings(uart_num);
 
   // 状態をリセット
   uart_status[uart_num].initialized = false;
@@ -22,6 +22,31 @@ typedef uart_port_t uart_port_num_t;
 // Remove definition of uart_port_num_t if it conflicts or is redundant
 // typedef enum { UART_NUM_0 = 0, UART_NUM_1, UART_NUM_2 } uart_port_num_t;
 
+/**
+ * @brief Called on the UART service task after new data has been buffered
+ *
+ * @param uart_num UART port number
+ * @param arg Argument given to drv_uart_set_rx_notify()
+ */
+typedef void (*drv_uart_rx_notify_t)(uart_port_num_t uart_num, void* arg);
+
+/**
+ * @brief RX and TX counters of a port, reset by drv_uart_init()
+ */
+typedef struct {
+  uint32_t rx_bytes;        /**< bytes moved into the RX ring */
+  uint32_t rx_dropped;      /**< bytes dropped because the ring was full */
+  uint32_t rx_events;       /**< UART events handled */
+  uint32_t hw_overflows;    /**< FIFO or driver buffer overflow events */
+  uint64_t service_us;      /**< time spent in the service task */
+  uint32_t tx_queued;       /**< bytes accepted by drv_uart_write_async() */
+  uint32_t tx_sent;         /**< queued bytes handed to the UART */
+  uint32_t tx_rejected;     /**< bytes refused because the TX queue was full */
+  uint32_t tx_backpressure; /**< async writes that were cut short */
+  uint32_t tx_pending;      /**< bytes waiting in the TX queue now */
+  uint32_t tx_capacity;     /**< size of the TX queue */
+} drv_uart_stats_t;
+
 /**
  * @brief Initialize UART port
  *
@@ -29,8 +54,10 @@ typedef uart_port_t uart_port_num_t;
  * @param tx_pin TX pin number (use GPIO_NUM_NC if not used)
  * @param rx_pin RX pin number (use GPIO_NUM_NC if not used)
  * @param baud_rate Baud rate
- * @param rx_buffer_size RX ring buffer size
- * @param tx_buffer_size TX ring buffer size (0 for no buffer)
+ * @param rx_buffer_size RX ring buffer size of the ESP-IDF driver; the
+ * driver's own RX ring is twice as large (at least 1KB)
+ * @param tx_buffer_size TX ring buffer size (0 for no buffer); the TX queue
+ * of drv_uart_write_async() is twice as large (at least 1KB)
  * @return kSuccess on success, kFailure on failure
  */
 fn_t drv_uart_init(uart_port_num_t uart_num, int tx_pin, int rx_pin,
@@ -39,6 +66,9 @@ fn_t drv_uart_init(uart_port_num_t uart_num, int tx_pin, int rx_pin,
 /**
  * @brief Write data to UART port
  *
+ * Blocks until data queued by drv_uart_write_async() has reached the
+ * driver, so the two never reorder on the line.
+ *
  * @param uart_num UART port number
  * @param data Pointer to data buffer
  * @param len Length of data to write
@@ -46,6 +76,36 @@ fn_t drv_uart_init(uart_port_num_t uart_num, int tx_pin, int rx_pin,
  */
 int drv_uart_write(uart_port_num_t uart_num, const void* data, size_t len);
 
+/**
+ * @brief Queue data for transmission without blocking
+ *
+ * Copies as much as fits into the TX queue of the port and returns at once.
+ * The service task moves the queue into the UART driver as room frees up.
+ * Bytes that do not fit are not queued; the caller decides whether to retry
+ * or drop them.
+ *
+ * @param uart_num UART port number
+ * @param data Pointer to data buffer
+ * @param len Length of data to queue
+ * @return Number of bytes queued (less than len when the queue is full), or
+ * -1 on error
+ */
+int drv_uart_write_async(uart_port_num_t uart_num, const void* data,
+                         size_t len);
+
+/**
+ * @brief Wait until queued data has been transmitted
+ *
+ * Waits for the TX queue to empty and then for the UART to shift out the
+ * last byte.
+ *
+ * @param uart_num UART port number
+ * @param timeout_ms Timeout in milliseconds
+ * @return kSuccess when everything has been sent, kFailure on timeout or if
+ * port not initialized
+ */
+fn_t drv_uart_flush(uart_port_num_t uart_num, uint32_t timeout_ms);
+
 /**
  * @brief Read data from UART port
  *
@@ -82,6 +142,39 @@ int drv_uart_read_until(uart_port_num_t uart_num, void* buf, size_t len,
  */
 fn_t drv_uart_get_available(uart_port_num_t uart_num, size_t* available_bytes);
 
+/**
+ * @brief Get the time the newest RX data was buffered
+ *
+ * @param uart_num UART port number
+ * @param time_us Pointer to store the esp_timer time in microseconds (0 if
+ * nothing has arrived since drv_uart_init())
+ * @return kSuccess on success, kFailure if port not initialized
+ */
+fn_t drv_uart_get_rx_time(uart_port_num_t uart_num, int64_t* time_us);
+
+/**
+ * @brief Register a function called whenever RX data arrives
+ *
+ * The function runs on the service task shared by all ports, so it must be
+ * short and must not touch the mruby/c VM except through task resume.
+ *
+ * @param uart_num UART port number
+ * @param notify Function to call, or NULL to remove it
+ * @param arg Argument passed to the function
+ * @return kSuccess on success, kFailure if port not initialized
+ */
+fn_t drv_uart_set_rx_notify(uart_port_num_t uart_num,
+                            drv_uart_rx_notify_t notify, void* arg);
+
+/**
+ * @brief Get the RX and TX counters of a port
+ *
+ * @param uart_num UART port number
+ * @param stats Pointer to store the counters
+ * @return kSuccess on success, kFailure if port not initialized
+ */
+fn_t drv_uart_get_stats(uart_port_num_t uart_num, drv_uart_stats_t* stats);
+
 /**
  * @brief Deinitialize UART port
  *
@@ -0,0 +1,57 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file cobs.c
+ * @brief Consistent Overhead Byte Stuffing
+ */
+#include "cobs.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+size_t cobs_encode(const uint8_t *src, size_t len, uint8_t *dst) {
+  size_t out = 1;   // first code byte is filled in later
+  size_t code_pos = 0;
+  uint8_t code = 1;
+
+  for (size_t i = 0; i < len; i++) {
+    if (src[i] == 0) {
+      dst[code_pos] = code;
+      code_pos = out++;
+      code = 1;
+      continue;
+    }
+    dst[out++] = src[i];
+    if (++code == 0xFF) {
+      dst[code_pos] = code;
+      code_pos = out++;
+      code = 1;
+    }
+  }
+  dst[code_pos] = code;
+  return out;
+}
+
+bool cobs_decode(const uint8_t *src, size_t len, uint8_t *dst,
+                 size_t *out_len) {
+  size_t in = 0;
+  size_t out = 0;
+
+  while (in < len) {
+    uint8_t code = src[in++];
+    size_t run = code - 1;
+    if (code == 0 || run > len - in) return false;
+    // memmove: dst may trail src in the same buffer
+    memmove(&dst[out], &src[in], run);
+    if (memchr(&dst[out], 0, run) != NULL) return false;
+    in += run;
+    out += run;
+    if (code != 0xFF && in < len) dst[out++] = 0;
+  }
+  *out_len = out;
+  return true;
+}
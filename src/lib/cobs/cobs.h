@@ -0,0 +1,60 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file cobs.h
+ * @brief Consistent Overhead Byte Stuffing
+ *
+ * COBS removes every zero byte from a block at a cost of one byte per 254,
+ * so a zero can delimit frames on a byte stream. A receiver that loses
+ * sync only has to wait for the next zero.
+ */
+#ifndef LIB_COBS_COBS_H
+#define LIB_COBS_COBS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Worst-case encoded size of n bytes, without the delimiter
+ */
+#define COBS_MAX_ENCODED(n) ((n) + (n) / 254 + 1)
+
+/**
+ * @brief Encodes a block
+ *
+ * @param src Input bytes
+ * @param len Input length
+ * @param dst Output, at least COBS_MAX_ENCODED(len) bytes; must not overlap
+ * src
+ * @return Encoded length (no zero bytes, no delimiter appended)
+ */
+size_t cobs_encode(const uint8_t *src, size_t len, uint8_t *dst);
+
+/**
+ * @brief Decodes a block
+ *
+ * The output is never longer than the input, so dst may be the same buffer
+ * as src.
+ *
+ * @param src Encoded bytes, without the delimiter
+ * @param len Encoded length
+ * @param dst Output, at least len bytes
+ * @param out_len Decoded length
+ * @return false if the block is not valid COBS (a zero byte or a code that
+ * runs past the end)
+ */
+bool cobs_decode(const uint8_t *src, size_t len, uint8_t *dst,
+                 size_t *out_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,144 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file fastmath.c
+ * @brief Table-driven single precision and fixed-point math
+ */
+#include "fastmath.h"
+
+#include <math.h>
+#include <stdint.h>
+
+#define FASTMATH_PI 3.14159265f
+#define FASTMATH_STEPS 1024 /**< table steps per turn */
+
+/**
+ * @brief sin(i * pi / 512) in Q15 for the first quarter turn
+ */
+static const uint16_t quarter_sin[257] = {
+    0, 201, 402, 603, 804, 1005, 1206, 1407, 1608, 1809,
+    2009, 2210, 2411, 2611, 2811, 3012, 3212, 3412, 3612, 3812,
+    4011, 4211, 4410, 4609, 4808, 5007, 5205, 5404, 5602, 5800,
+    5998, 6195, 6393, 6590, 6787, 6983, 7180, 7376, 7571, 7767,
+    7962, 8157, 8351, 8546, 8740, 8933, 9127, 9319, 9512, 9704,
+    9896, 10088, 10279, 10469, 10660, 10850, 11039, 11228, 11417, 11605,
+    11793, 11980, 12167, 12354, 12540, 12725, 12910, 13095, 13279, 13463,
+    13646, 13828, 14010, 14192, 14373, 14553, 14733, 14912, 15091, 15269,
+    15447, 15624, 15800, 15976, 16151, 16326, 16500, 16673, 16846, 17018,
+    17190, 17361, 17531, 17700, 17869, 18037, 18205, 18372, 18538, 18703,
+    18868, 19032, 19195, 19358, 19520, 19681, 19841, 20001, 20160, 20318,
+    20475, 20632, 20788, 20943, 21097, 21251, 21403, 21555, 21706, 21856,
+    22006, 22154, 22302, 22449, 22595, 22740, 22884, 23028, 23170, 23312,
+    23453, 23593, 23732, 23870, 24008, 24144, 24279, 24414, 24548, 24680,
+    24812, 24943, 25073, 25202, 25330, 25457, 25583, 25708, 25833, 25956,
+    26078, 26199, 26320, 26439, 26557, 26674, 26791, 26906, 27020, 27133,
+    27246, 27357, 27467, 27576, 27684, 27791, 27897, 28002, 28106, 28209,
+    28311, 28411, 28511, 28610, 28707, 28803, 28899, 28993, 29086, 29178,
+    29269, 29359, 29448, 29535, 29622, 29707, 29792, 29875, 29957, 30038,
+    30118, 30196, 30274, 30350, 30425, 30499, 30572, 30644, 30715, 30784,
+    30853, 30920, 30986, 31050, 31114, 31177, 31238, 31298, 31357, 31415,
+    31471, 31527, 31581, 31634, 31686, 31737, 31786, 31834, 31881, 31927,
+    31972, 32015, 32058, 32099, 32138, 32177, 32214, 32251, 32286, 32319,
+    32352, 32383, 32413, 32442, 32470, 32496, 32522, 32546, 32568, 32590,
+    32610, 32629, 32647, 32664, 32679, 32693, 32706, 32718, 32729, 32738,
+    32746, 32753, 32758, 32762, 32766, 32767, 32768,
+};
+
+/**
+ * @brief Sine at a table step in Q15, any step number
+ */
+static int32_t sin_step(int32_t i) {
+  i &= FASTMATH_STEPS - 1;
+  int32_t k = i & 255;
+  switch (i >> 8) {
+    case 0:
+      return quarter_sin[k];
+    case 1:
+      return quarter_sin[256 - k];
+    case 2:
+      return -quarter_sin[k];
+    default:
+      return -quarter_sin[256 - k];
+  }
+}
+
+/**
+ * @brief Interpolated sine at a position given in table steps
+ */
+static float sin_steps(float t) {
+  if (t > 1e9f || t < -1e9f) {
+    t = fmodf(t, FASTMATH_STEPS);  // keeps the integer part in range
+  }
+  int32_t i = (int32_t)t;
+  if (t < i) i--;  // floor for negative angles
+  float f = t - i;
+  int32_t s0 = sin_step(i);
+  int32_t s1 = sin_step(i + 1);
+  return (s0 + (s1 - s0) * f) * (1.0f / 32768);
+}
+
+float fastmath_sinf(float rad) {
+  return sin_steps(rad * (FASTMATH_STEPS / (2 * FASTMATH_PI)));
+}
+
+float fastmath_cosf(float rad) {
+  return sin_steps(rad * (FASTMATH_STEPS / (2 * FASTMATH_PI)) +
+                   FASTMATH_STEPS / 4);
+}
+
+float fastmath_sqrtf(float x) { return (x > 0) ? sqrtf(x) : 0; }
+
+float fastmath_atan2f(float y, float x) {
+  float ax = fabsf(x);
+  float ay = fabsf(y);
+  if (ax == 0 && ay == 0) return 0;
+
+  // atan on [0, 1], max error about 1e-5 rad
+  float z = (ay > ax) ? ax / ay : ay / ax;
+  float z2 = z * z;
+  float a =
+      z * (0.9998660f +
+           z2 * (-0.3302995f +
+                 z2 * (0.1801410f + z2 * (-0.0851330f + z2 * 0.0208351f))));
+
+  if (ay > ax) a = FASTMATH_PI / 2 - a;
+  if (x < 0) a = FASTMATH_PI - a;
+  return (y < 0) ? -a : a;
+}
+
+int32_t fastmath_isin(int32_t angle) {
+  // FASTMATH_TURN is 4 units per table step
+  int32_t i = angle >> 2;
+  int32_t f = angle & 3;
+  int32_t s0 = sin_step(i);
+  int32_t s1 = sin_step(i + 1);
+  int32_t q15 = s0 + (((s1 - s0) * f) >> 2);
+  return (q15 + 4) >> 3;
+}
+
+int32_t fastmath_icos(int32_t angle) {
+  return fastmath_isin(angle + FASTMATH_TURN / 4);
+}
+
+uint32_t fastmath_isqrt(uint32_t x) {
+  uint32_t root = 0;
+  uint32_t bit = 1UL << 30;
+  while (bit > x) bit >>= 2;
+  while (bit != 0) {
+    if (x >= root + bit) {
+      x -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return root;
+}
+
+int32_t fastmath_iatan2(int32_t y, int32_t x) {
+  float a = fastmath_atan2f((float)y, (float)x);
+  return (int32_t)lroundf(a * (FASTMATH_TURN / (2 * FASTMATH_PI)));
+}
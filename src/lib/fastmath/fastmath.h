@@ -0,0 +1,79 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file fastmath.h
+ * @brief Table-driven single precision and fixed-point math
+ *
+ * sin/cos interpolate a 257-entry quarter-wave table (Q15), sqrt uses the
+ * single precision FPU path and atan2 a minimax polynomial. The float
+ * functions are accurate to about 3e-5, enough for graphics, and avoid the
+ * software double precision of libm.
+ *
+ * The fixed-point functions use FASTMATH_TURN angle units per turn and
+ * return FASTMATH_ONE for 1.0.
+ */
+#ifndef LIB_FASTMATH_FASTMATH_H
+#define LIB_FASTMATH_FASTMATH_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FASTMATH_TURN 4096 /**< fixed-point angle units per turn */
+#define FASTMATH_ONE 4096  /**< fixed-point 1.0 (Q12) */
+
+/**
+ * @brief Sine of an angle in radians
+ */
+float fastmath_sinf(float rad);
+
+/**
+ * @brief Cosine of an angle in radians
+ */
+float fastmath_cosf(float rad);
+
+/**
+ * @brief Square root; 0 for negative input
+ */
+float fastmath_sqrtf(float x);
+
+/**
+ * @brief Angle of (x, y) in radians, -pi to pi
+ */
+float fastmath_atan2f(float y, float x);
+
+/**
+ * @brief Fixed-point sine
+ *
+ * @param angle Angle in FASTMATH_TURN units per turn, any value
+ * @return Sine in Q12 (-FASTMATH_ONE to FASTMATH_ONE)
+ */
+int32_t fastmath_isin(int32_t angle);
+
+/**
+ * @brief Fixed-point cosine, see fastmath_isin()
+ */
+int32_t fastmath_icos(int32_t angle);
+
+/**
+ * @brief Integer square root, rounded down
+ */
+uint32_t fastmath_isqrt(uint32_t x);
+
+/**
+ * @brief Fixed-point angle of (x, y)
+ *
+ * @return Angle in FASTMATH_TURN units per turn, -FASTMATH_TURN / 2 to
+ *         FASTMATH_TURN / 2
+ */
+int32_t fastmath_iatan2(int32_t y, int32_t x);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,30 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file gamma.h
+ * @brief Gamma correction table for LED output
+ *
+ * Maps 8-bit color values to linear light with gamma 2.2, in 8.8 fixed
+ * point so the fraction is left for brightness scaling and dithering.
+ */
+#ifndef LIB_PIXEL_GAMMA_H
+#define LIB_PIXEL_GAMMA_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief (v / 255) ^ 2.2 * 255 in 8.8 fixed point, for v = 0 to 255
+ */
+extern const uint16_t pixel_gamma22[256];
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
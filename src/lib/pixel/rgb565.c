@@ -0,0 +1,148 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file rgb565.c
+ * @brief RGB565 pixel kernels
+ *
+ * The paired paths load and store two pixels per 32-bit access and swap the
+ * bytes of both at once, which halves the memory accesses on the Xtensa
+ * cores. The blend itself is per pixel: a pixel's three channels are spread
+ * over one 32-bit word with 5 bits of headroom each, so one multiply blends
+ * all of them. Two pixels do not fit in a word with that headroom, so
+ * pairing the arithmetic would take more multiplies, not fewer.
+ * RGB565_SCALAR selects the per-pixel code.
+ */
+#include "rgb565.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Channel mask of a pixel spread over 32 bits as 00000GGGGGG00000RRRRR000000BBBBB */
+#define RGB565_SPREAD_MASK 0x07E0F81FUL
+
+static inline uint16_t swap16(uint16_t v) {
+  return (uint16_t)((v >> 8) | (v << 8));
+}
+
+/**
+ * @brief Blends one native-order pixel with 5-bit alpha
+ */
+static inline uint16_t blend_one(uint16_t d, uint16_t s, uint32_t a5) {
+  uint32_t fg = (s | ((uint32_t)s << 16)) & RGB565_SPREAD_MASK;
+  uint32_t bg = (d | ((uint32_t)d << 16)) & RGB565_SPREAD_MASK;
+  bg += ((fg - bg) * a5) >> 5;
+  bg &= RGB565_SPREAD_MASK;
+  return (uint16_t)(bg | (bg >> 16));
+}
+
+/**
+ * @brief Converts one RGB888 pixel to display-order RGB565
+ */
+static inline uint16_t pack_one(const uint8_t *p) {
+  uint16_t c = (uint16_t)(((p[0] & 0xF8) << 8) | ((p[1] & 0xFC) << 3) |
+                          (p[2] >> 3));
+  return swap16(c);
+}
+
+static inline bool aligned4(const void *p) {
+  return ((uintptr_t)p & 3) == 0;
+}
+
+void rgb565_fill(uint16_t *dst, uint16_t color, size_t n) {
+  uint16_t px = swap16(color);
+#ifndef RGB565_SCALAR
+  if (n > 0 && !aligned4(dst)) {
+    *dst++ = px;
+    n--;
+  }
+  uint32_t pair = px | ((uint32_t)px << 16);
+  uint32_t *w = (uint32_t *)dst;
+  size_t words = n / 2;
+  while (words >= 4) {
+    w[0] = pair;
+    w[1] = pair;
+    w[2] = pair;
+    w[3] = pair;
+    w += 4;
+    words -= 4;
+  }
+  while (words--) {
+    *w++ = pair;
+  }
+  dst = (uint16_t *)w;
+  n &= 1;
+#endif
+  while (n--) {
+    *dst++ = px;
+  }
+}
+
+void rgb565_fill_from_first(uint16_t *dst, size_t n) {
+  if (n > 1) rgb565_fill(dst + 1, swap16(dst[0]), n - 1);
+}
+
+void rgb565_blend(uint16_t *dst, const uint16_t *src, uint8_t alpha,
+                  size_t n) {
+  uint32_t a5 = (alpha + 4) >> 3;
+  if (a5 == 0) return;
+  if (a5 >= 32) {
+    for (size_t i = 0; i < n; i++) dst[i] = src[i];
+    return;
+  }
+#ifndef RGB565_SCALAR
+  if (n > 0 && !aligned4(dst)) {
+    *dst = swap16(blend_one(swap16(*dst), swap16(*src), a5));
+    dst++;
+    src++;
+    n--;
+  }
+  if (aligned4(src)) {
+    uint32_t *wd = (uint32_t *)dst;
+    const uint32_t *ws = (const uint32_t *)src;
+    for (size_t i = n / 2; i > 0; i--) {
+      // swap the bytes of both pixels at once to native order, then blend
+      // each with its channels spread over a word
+      uint32_t d = *wd;
+      uint32_t s = *ws++;
+      d = ((d & 0x00FF00FFUL) << 8) | ((d >> 8) & 0x00FF00FFUL);
+      s = ((s & 0x00FF00FFUL) << 8) | ((s >> 8) & 0x00FF00FFUL);
+      uint32_t lo = blend_one((uint16_t)d, (uint16_t)s, a5);
+      uint32_t hi = blend_one((uint16_t)(d >> 16), (uint16_t)(s >> 16), a5);
+      uint32_t r = lo | (hi << 16);
+      *wd++ = ((r & 0x00FF00FFUL) << 8) | ((r >> 8) & 0x00FF00FFUL);
+    }
+    dst = (uint16_t *)wd;
+    src = (const uint16_t *)ws;
+    n &= 1;
+  }
+#endif
+  while (n--) {
+    *dst = swap16(blend_one(swap16(*dst), swap16(*src), a5));
+    dst++;
+    src++;
+  }
+}
+
+void rgb565_from_rgb888(uint16_t *dst, const uint8_t *src, size_t n) {
+#ifndef RGB565_SCALAR
+  if (n > 0 && !aligned4(dst)) {
+    *dst++ = pack_one(src);
+    src += 3;
+    n--;
+  }
+  uint32_t *w = (uint32_t *)dst;
+  for (size_t i = n / 2; i > 0; i--) {
+    *w++ = pack_one(src) | ((uint32_t)pack_one(src + 3) << 16);
+    src += 6;
+  }
+  dst = (uint16_t *)w;
+  n &= 1;
+#endif
+  while (n--) {
+    *dst++ = pack_one(src);
+    src += 3;
+  }
+}
@@ -0,0 +1,73 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file rgb565.h
+ * @brief RGB565 pixel kernels
+ *
+ * Fill, alpha blend and RGB888 conversion for pixel buffers in display byte
+ * order (big-endian RGB565), the layout LovyanGFX uses for 16-bit sprites.
+ * The kernels move two pixels per 32-bit load and store where the buffers
+ * are aligned; define RGB565_SCALAR to build the one-pixel-at-a-time
+ * versions instead. Both produce bit-identical results, checked by
+ * test/test_rgb565 in the native environment.
+ */
+#ifndef LIB_PIXEL_RGB565_H
+#define LIB_PIXEL_RGB565_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Fills a buffer with one color
+ *
+ * @param dst Pixel buffer (display byte order)
+ * @param color RGB565 color (native byte order)
+ * @param n Number of pixels
+ */
+void rgb565_fill(uint16_t *dst, uint16_t color, size_t n);
+
+/**
+ * @brief Fills a buffer with the pixel already in its first element
+ *
+ * Lets the caller have the graphics library convert a color into one
+ * pixel, then spreads that pixel as it is, in display byte order.
+ *
+ * @param dst Pixel buffer (display byte order), dst[0] is the pixel
+ * @param n Number of pixels, including the first
+ */
+void rgb565_fill_from_first(uint16_t *dst, size_t n);
+
+/**
+ * @brief Blends src over dst
+ *
+ * Computes dst = dst + (src - dst) * alpha per channel, with alpha reduced
+ * to 5 bits ((alpha + 4) >> 3, 0-32).
+ *
+ * @param dst Pixel buffer to blend into (display byte order)
+ * @param src Pixel buffer to blend from (display byte order)
+ * @param alpha Opacity of src (0-255)
+ * @param n Number of pixels
+ */
+void rgb565_blend(uint16_t *dst, const uint16_t *src, uint8_t alpha,
+                  size_t n);
+
+/**
+ * @brief Converts packed RGB888 pixels to RGB565
+ *
+ * @param dst Pixel buffer (display byte order)
+ * @param src Packed R, G, B bytes, 3 per pixel
+ * @param n Number of pixels
+ */
+void rgb565_from_rgb888(uint16_t *dst, const uint8_t *src, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,111 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file spsc_ring.c
+ * @brief Lock-free single-producer single-consumer byte ring
+ */
+#include "spsc_ring.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+void spsc_ring_init(spsc_ring_t *ring, uint8_t *buf, size_t size) {
+  ring->buf = buf;
+  ring->mask = size - 1;
+  ring->head = 0;
+  ring->tail = 0;
+}
+
+size_t spsc_ring_count(const spsc_ring_t *ring) {
+  uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+  uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+  return head - tail;
+}
+
+size_t spsc_ring_space(const spsc_ring_t *ring) {
+  return ring->mask + 1 - spsc_ring_count(ring);
+}
+
+uint8_t *spsc_ring_write_ptr(spsc_ring_t *ring, size_t *len) {
+  uint32_t head = ring->head;
+  uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+  size_t space = ring->mask + 1 - (head - tail);
+  size_t to_end = ring->mask + 1 - (head & ring->mask);
+  *len = (space < to_end) ? space : to_end;
+  return ring->buf + (head & ring->mask);
+}
+
+void spsc_ring_commit(spsc_ring_t *ring, size_t len) {
+  __atomic_store_n(&ring->head, ring->head + len, __ATOMIC_RELEASE);
+}
+
+const uint8_t *spsc_ring_read_ptr(const spsc_ring_t *ring, size_t *len) {
+  uint32_t tail = ring->tail;
+  uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+  size_t count = head - tail;
+  size_t to_end = ring->mask + 1 - (tail & ring->mask);
+  *len = (count < to_end) ? count : to_end;
+  return ring->buf + (tail & ring->mask);
+}
+
+void spsc_ring_consume(spsc_ring_t *ring, size_t len) {
+  __atomic_store_n(&ring->tail, ring->tail + len, __ATOMIC_RELEASE);
+}
+
+size_t spsc_ring_write(spsc_ring_t *ring, const void *src, size_t len) {
+  const uint8_t *p = (const uint8_t *)src;
+  size_t done = 0;
+  // at most two runs: up to the end of the storage, then from the start
+  for (int i = 0; i < 2 && done < len; i++) {
+    size_t n;
+    uint8_t *dst = spsc_ring_write_ptr(ring, &n);
+    if (n == 0) break;
+    if (n > len - done) n = len - done;
+    memcpy(dst, p + done, n);
+    spsc_ring_commit(ring, n);
+    done += n;
+  }
+  return done;
+}
+
+size_t spsc_ring_read(spsc_ring_t *ring, void *dst, size_t len) {
+  uint8_t *p = (uint8_t *)dst;
+  size_t done = 0;
+  for (int i = 0; i < 2 && done < len; i++) {
+    size_t n;
+    const uint8_t *src = spsc_ring_read_ptr(ring, &n);
+    if (n == 0) break;
+    if (n > len - done) n = len - done;
+    memcpy(p + done, src, n);
+    spsc_ring_consume(ring, n);
+    done += n;
+  }
+  return done;
+}
+
+size_t spsc_ring_read_until(spsc_ring_t *ring, void *dst, size_t len,
+                            uint8_t delimiter, bool *found) {
+  uint8_t *p = (uint8_t *)dst;
+  size_t done = 0;
+  *found = false;
+  for (int i = 0; i < 2 && done < len; i++) {
+    size_t n;
+    const uint8_t *src = spsc_ring_read_ptr(ring, &n);
+    if (n == 0) break;
+    if (n > len - done) n = len - done;
+    const uint8_t *hit = (const uint8_t *)memchr(src, delimiter, n);
+    if (hit) {
+      n = hit - src + 1;
+      *found = true;
+    }
+    memcpy(p + done, src, n);
+    spsc_ring_consume(ring, n);
+    done += n;
+    if (*found) break;
+  }
+  return done;
+}
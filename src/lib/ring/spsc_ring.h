@@ -0,0 +1,121 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file spsc_ring.h
+ * @brief Lock-free single-producer single-consumer byte ring
+ *
+ * One task writes and one task reads without any lock. Head and tail are
+ * free-running counters published with release/acquire ordering, so the
+ * capacity must be a power of two. Besides copying in and out, the ring
+ * hands out its contiguous free or filled region so that a producer can
+ * fill it and a consumer can scan it in place.
+ */
+#ifndef LIB_RING_SPSC_RING_H
+#define LIB_RING_SPSC_RING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Ring state
+ */
+typedef struct {
+  uint8_t *buf;  /**< storage */
+  uint32_t mask; /**< capacity - 1 */
+  uint32_t head; /**< total bytes written, owned by the producer */
+  uint32_t tail; /**< total bytes read, owned by the consumer */
+} spsc_ring_t;
+
+/**
+ * @brief Initializes an empty ring
+ *
+ * @param ring Ring to initialize
+ * @param buf Storage
+ * @param size Storage size, a power of two
+ */
+void spsc_ring_init(spsc_ring_t *ring, uint8_t *buf, size_t size);
+
+/**
+ * @brief Number of bytes that can be read
+ */
+size_t spsc_ring_count(const spsc_ring_t *ring);
+
+/**
+ * @brief Number of bytes that can be written
+ */
+size_t spsc_ring_space(const spsc_ring_t *ring);
+
+/**
+ * @brief Copies up to len bytes in (producer)
+ *
+ * @return Number of bytes written
+ */
+size_t spsc_ring_write(spsc_ring_t *ring, const void *src, size_t len);
+
+/**
+ * @brief Copies up to len bytes out (consumer)
+ *
+ * @return Number of bytes read
+ */
+size_t spsc_ring_read(spsc_ring_t *ring, void *dst, size_t len);
+
+/**
+ * @brief Copies bytes out up to and including a delimiter (consumer)
+ *
+ * Scans each contiguous filled region with memchr and copies whole runs,
+ * so the cost per byte is that of memchr plus memcpy. Nothing after the
+ * delimiter is consumed.
+ *
+ * @param ring Ring
+ * @param dst Destination
+ * @param len Maximum number of bytes to copy
+ * @param delimiter Byte to stop after
+ * @param found Set to true when the delimiter was copied
+ * @return Number of bytes read
+ */
+size_t spsc_ring_read_until(spsc_ring_t *ring, void *dst, size_t len,
+                            uint8_t delimiter, bool *found);
+
+/**
+ * @brief Contiguous free region (producer)
+ *
+ * Fill up to *len bytes at the returned pointer, then publish them with
+ * spsc_ring_commit().
+ *
+ * @param ring Ring
+ * @param len Size of the region
+ * @return Start of the region
+ */
+uint8_t *spsc_ring_write_ptr(spsc_ring_t *ring, size_t *len);
+
+/**
+ * @brief Publishes bytes filled through spsc_ring_write_ptr() (producer)
+ */
+void spsc_ring_commit(spsc_ring_t *ring, size_t len);
+
+/**
+ * @brief Contiguous filled region (consumer)
+ *
+ * @param ring Ring
+ * @param len Size of the region
+ * @return Start of the region
+ */
+const uint8_t *spsc_ring_read_ptr(const spsc_ring_t *ring, size_t *len);
+
+/**
+ * @brief Releases bytes seen through spsc_ring_read_ptr() (consumer)
+ */
+void spsc_ring_consume(spsc_ring_t *ring, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
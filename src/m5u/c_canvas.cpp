@@ -3,8 +3,12 @@
 #include "my_mrubydef.h"
 
 #ifdef USE_CANVAS
+#include "../lib/pixel/rgb565.h"
 #include "c_canvas.h"
 #include "drawing.h"
+#ifdef USE_IMAGE_STREAM
+#include "c_image_stream.h"
+#endif
 
 static mrbc_class *canvas_class;
 
@@ -47,29 +51,132 @@ static void c_canvas_create_sprite(mrb_vm *vm, mrb_value *v, int argc) {
   }
 }
 
+// Leading target argument of push_* methods: a Canvas, Display or nothing.
+// Sets *argi to the first argument after the target.
+static LovyanGFX *canvas_push_target(mrb_vm *vm, mrb_value *v, int argc,
+                                     int *argi) {
+  if (argc > 0 && GET_ARG(1).tt != MRBC_TT_INTEGER &&
+      GET_ARG(1).tt != MRBC_TT_FLOAT && GET_ARG(1).tt != MRBC_TT_ARRAY) {
+    *argi = 2;
+    if (mrbc_obj_is_kind_of(&GET_ARG(1), canvas_class)) {
+      M5Canvas *dst = *(M5Canvas **)GET_ARG(1).instance->data;
+      if (dst == nullptr) {
+        mrbc_raise(vm, MRBC_CLASS(RuntimeError), "already destroyed");
+      }
+      return dst;
+    }
+    return &M5.Display;  // no error, fall on default
+  }
+  *argi = 1;
+  return &M5.Display;
+}
+
+// push_sprite([target], x, y, [transparent_color])
 static void c_canvas_push_sprite(mrb_vm *vm, mrb_value *v, int argc) {
   M5Canvas *canvas = get_checked_data(M5Canvas, vm, v);
-
-  if (argc == 2) {
-    int x = val_to_i(vm, v, GET_ARG(1), argc);
-    int y = val_to_i(vm, v, GET_ARG(2), argc);
-    canvas->pushSprite(x, y);
-  } else if (argc == 3) {
-    LovyanGFX *dst;
-    if (mrbc_obj_is_kind_of(&GET_ARG(1), canvas_class)) {
-      dst = get_checked_data(M5Canvas, vm, (&GET_ARG(1)));
+  int a;
+  LovyanGFX *dst = canvas_push_target(vm, v, argc, &a);
+  if (dst == nullptr) return;
+
+  if (argc >= a + 1) {
+    int x = val_to_i(vm, v, GET_ARG(a), argc);
+    int y = val_to_i(vm, v, GET_ARG(a + 1), argc);
+    if (argc >= a + 2) {
+      uint16_t transp = val_to_i(vm, v, GET_ARG(a + 2), argc);
+      canvas->pushSprite(dst, x, y, transp);
     } else {
-      dst = &M5.Display;  // no error, fall on default
+      canvas->pushSprite(dst, x, y);
     }
-    int x = val_to_i(vm, v, GET_ARG(2), argc);
-    int y = val_to_i(vm, v, GET_ARG(3), argc);
-    canvas->pushSprite(dst, x, y);
   } else {
     mrbc_raise(vm, MRBC_CLASS(ArgumentError), "x-y");
     SET_FALSE_RETURN();
   }
 }
 
+// push_rotate_zoom([target], x, y, angle, zoom_x, [zoom_y], [transparent_color])
+// draws the sprite rotated around its pivot, which lands on (x, y)
+static void canvas_push_rotate_zoom(mrb_vm *vm, mrb_value *v, int argc,
+                                    bool aa) {
+  M5Canvas *canvas = get_checked_data(M5Canvas, vm, v);
+  int a;
+  LovyanGFX *dst = canvas_push_target(vm, v, argc, &a);
+  if (dst == nullptr) return;
+
+  if (argc < a + 3) {
+    mrbc_raise(vm, MRBC_CLASS(ArgumentError), "x, y, angle, zoom");
+    SET_FALSE_RETURN();
+    return;
+  }
+  float x = val_to_f(vm, v, GET_ARG(a), argc);
+  float y = val_to_f(vm, v, GET_ARG(a + 1), argc);
+  float angle = val_to_f(vm, v, GET_ARG(a + 2), argc);
+  float zoom_x = val_to_f(vm, v, GET_ARG(a + 3), argc);
+  float zoom_y = (argc >= a + 4) ? val_to_f(vm, v, GET_ARG(a + 4), argc) : zoom_x;
+  if (argc >= a + 5) {
+    uint16_t transp = val_to_i(vm, v, GET_ARG(a + 5), argc);
+    if (aa) {
+      canvas->pushRotateZoomWithAA(dst, x, y, angle, zoom_x, zoom_y, transp);
+    } else {
+      canvas->pushRotateZoom(dst, x, y, angle, zoom_x, zoom_y, transp);
+    }
+  } else {
+    if (aa) {
+      canvas->pushRotateZoomWithAA(dst, x, y, angle, zoom_x, zoom_y);
+    } else {
+      canvas->pushRotateZoom(dst, x, y, angle, zoom_x, zoom_y);
+    }
+  }
+  SET_TRUE_RETURN();
+}
+
+static void c_canvas_push_rotate_zoom(mrb_vm *vm, mrb_value *v, int argc) {
+  canvas_push_rotate_zoom(vm, v, argc, false);
+}
+
+static void c_canvas_push_rotate_zoom_aa(mrb_vm *vm, mrb_value *v, int argc) {
+  canvas_push_rotate_zoom(vm, v, argc, true);
+}
+
+// push_affine([target], [a, b, c, d, e, f], [transparent_color])
+// maps sprite (u, v) to (a*u + b*v + c, d*u + e*v + f)
+static void c_canvas_push_affine(mrb_vm *vm, mrb_value *v, int argc) {
+  M5Canvas *canvas = get_checked_data(M5Canvas, vm, v);
+  int a;
+  LovyanGFX *dst = canvas_push_target(vm, v, argc, &a);
+  if (dst == nullptr) return;
+
+  if (argc < a || GET_ARG(a).tt != MRBC_TT_ARRAY ||
+      mrbc_array_size(&GET_ARG(a)) != 6) {
+    mrbc_raise(vm, MRBC_CLASS(ArgumentError), "matrix of 6 numbers");
+    SET_FALSE_RETURN();
+    return;
+  }
+  float matrix[6];
+  for (int i = 0; i < 6; i++) {
+    mrbc_value e = mrbc_array_get(&GET_ARG(a), i);
+    matrix[i] = (e.tt == MRBC_TT_FLOAT) ? e.d : val_to_i(vm, v, e, argc);
+  }
+  if (argc >= a + 1) {
+    uint16_t transp = val_to_i(vm, v, GET_ARG(a + 1), argc);
+    canvas->pushAffine(dst, matrix, transp);
+  } else {
+    canvas->pushAffine(dst, matrix);
+  }
+  SET_TRUE_RETURN();
+}
+
+// set_pivot(x, y): rotation center used by push_rotate_zoom
+static void c_canvas_set_pivot(mrb_vm *vm, mrb_value *v, int argc) {
+  M5Canvas *canvas = get_checked_data(M5Canvas, vm, v);
+  if (argc > 1) {
+    canvas->setPivot(val_to_f(vm, v, GET_ARG(1), argc),
+                     val_to_f(vm, v, GET_ARG(2), argc));
+    SET_TRUE_RETURN();
+  } else {
+    SET_FALSE_RETURN();
+  }
+}
+
 static void c_canvas_delete_sprite(mrb_vm *vm, mrb_value *v, int argc) {
   M5Canvas *canvas = get_checked_data(M5Canvas, vm, v);
   canvas->deleteSprite();
@@ -116,9 +223,101 @@ static void c_canvas_puts(mrb_vm *vm, mrb_value *v, int argc) {
   draw_puts(canvas, vm, v, argc);
 }
 
+// pixel buffer of an unrotated 16-bit sprite, the layout the rgb565 kernels
+// work on; nullptr otherwise
+static uint16_t *canvas_rgb565_buffer(M5Canvas *canvas) {
+  if (canvas->getColorDepth() != 16 || canvas->getRotation() != 0) {
+    return nullptr;
+  }
+  return (uint16_t *)canvas->getBuffer();
+}
+
+// Same result as draw_clear: clearDisplay() itself converts the color into
+// the first pixel, clipped to it, and the kernel copies that pixel over the
+// rest. A clip rect smaller than the canvas takes the draw_clear path.
 static void c_canvas_clear(mrb_vm *vm, mrb_value *v, int argc) {
   M5Canvas *canvas = get_checked_data(M5Canvas, vm, v);
-  draw_clear(canvas, vm, v, argc);
+  uint16_t *buf = canvas_rgb565_buffer(canvas);
+  int32_t cx, cy, cw, ch;
+  canvas->getClipRect(&cx, &cy, &cw, &ch);
+  if (buf == nullptr || cx != 0 || cy != 0 || cw != canvas->width() ||
+      ch != canvas->height()) {
+    draw_clear(canvas, vm, v, argc);
+    return;
+  }
+  int color = (argc > 0) ? val_to_i(vm, v, GET_ARG(1), argc) : 0;
+  canvas->setClipRect(0, 0, 1, 1);
+  canvas->clearDisplay(color);
+  canvas->clearClipRect();
+  rgb565_fill_from_first(buf, canvas->width() * canvas->height());
+  canvas->setCursor(0, 0);
+  SET_TRUE_RETURN();
+}
+
+// blend(src_canvas, alpha, [x, y]): blends src over this canvas with alpha
+// (0-255). Both canvases must be 16-bit and unrotated.
+static void c_canvas_blend(mrb_vm *vm, mrb_value *v, int argc) {
+  M5Canvas *canvas = get_checked_data(M5Canvas, vm, v);
+  if (argc < 2 || !mrbc_obj_is_kind_of(&GET_ARG(1), canvas_class)) {
+    mrbc_raise(vm, MRBC_CLASS(ArgumentError), "canvas, alpha");
+    return;
+  }
+  M5Canvas *src = get_checked_data(M5Canvas, vm, (&GET_ARG(1)));
+  uint16_t *dbuf = canvas_rgb565_buffer(canvas);
+  uint16_t *sbuf = canvas_rgb565_buffer(src);
+  if (dbuf == nullptr || sbuf == nullptr) {
+    SET_FALSE_RETURN();
+    return;
+  }
+  int alpha = val_to_i(vm, v, GET_ARG(2), argc);
+  int x = (argc > 3) ? val_to_i(vm, v, GET_ARG(3), argc) : 0;
+  int y = (argc > 3) ? val_to_i(vm, v, GET_ARG(4), argc) : 0;
+  int dw = canvas->width(), dh = canvas->height();
+  int sw = src->width(), sh = src->height();
+
+  // clip the source rectangle to the destination
+  int sx = (x < 0) ? -x : 0;
+  int sy = (y < 0) ? -y : 0;
+  int w = std::min(sw - sx, dw - (x + sx));
+  int h = std::min(sh - sy, dh - (y + sy));
+  if (alpha < 0) alpha = 0;
+  if (alpha > 255) alpha = 255;
+  for (int row = 0; row < h && w > 0; row++) {
+    rgb565_blend(dbuf + (y + sy + row) * dw + x + sx,
+                 sbuf + (sy + row) * sw + sx, alpha, w);
+  }
+  SET_TRUE_RETURN();
+}
+
+// draw_rgb888(data, x, y, w, h): writes packed RGB888 pixels (3 bytes each)
+// into a 16-bit unrotated canvas
+static void c_canvas_draw_rgb888(mrb_vm *vm, mrb_value *v, int argc) {
+  M5Canvas *canvas = get_checked_data(M5Canvas, vm, v);
+  if (argc < 5 || GET_ARG(1).tt != MRBC_TT_STRING) {
+    mrbc_raise(vm, MRBC_CLASS(ArgumentError), "data, x, y, w, h");
+    return;
+  }
+  uint16_t *buf = canvas_rgb565_buffer(canvas);
+  int x = val_to_i(vm, v, GET_ARG(2), argc);
+  int y = val_to_i(vm, v, GET_ARG(3), argc);
+  int w = val_to_i(vm, v, GET_ARG(4), argc);
+  int h = val_to_i(vm, v, GET_ARG(5), argc);
+  if (buf == nullptr || w <= 0 || h <= 0 ||
+      GET_ARG(1).string->size < (uint64_t)w * h * 3) {  // no int overflow
+    SET_FALSE_RETURN();
+    return;
+  }
+  const uint8_t *data = GET_ARG(1).string->data;
+  int dw = canvas->width(), dh = canvas->height();
+  int sx = (x < 0) ? -x : 0;
+  int sy = (y < 0) ? -y : 0;
+  int cw = std::min(w - sx, dw - (x + sx));
+  int ch = std::min(h - sy, dh - (y + sy));
+  for (int row = 0; row < ch && cw > 0; row++) {
+    rgb565_from_rgb888(buf + (y + sy + row) * dw + x + sx,
+                       data + ((sy + row) * w + sx) * 3, cw);
+  }
+  SET_TRUE_RETURN();
 }
 
 static void class_canvas_fill_rect(mrb_vm *vm, mrb_value *v, int argc) {
@@ -146,6 +345,11 @@ static void class_canvas_draw_line(mrb_vm *vm, mrb_value *v, int argc) {
   draw_draw_line(canvas, vm, v, argc);
 }
 
+static void class_canvas_draw_points(mrb_vm *vm, mrb_value *v, int argc) {
+  M5Canvas *canvas = get_checked_data(M5Canvas, vm, v);
+  draw_draw_points(canvas, vm, v, argc);
+}
+
 #ifdef USE_FILE_FUNCTION
 static void class_canvas_draw_bmp(mrb_vm *vm, mrb_value *v, int argc) {
   M5Canvas *canvas = get_checked_data(M5Canvas, vm, v);
@@ -189,6 +393,9 @@ static void class_canvas_set_rotation(mrb_vm *vm, mrb_value *v, int argc) {
 
 static void class_canvas_destroy(mrb_vm *vm, mrb_value *v, int argc) {
   M5Canvas *canvas = get_checked_data(M5Canvas, vm, v);
+#ifdef USE_IMAGE_STREAM
+  image_stream_drop_target(canvas);
+#endif
   delete canvas;
   put_null_data(v);
 }
@@ -200,6 +407,12 @@ void class_canvas_init() {
   mrbc_define_method(0, canvas_class, "initialize", c_canvas_initialize);
   mrbc_define_method(0, canvas_class, "scroll", c_canvas_scroll);
   mrbc_define_method(0, canvas_class, "push_sprite", c_canvas_push_sprite);
+  mrbc_define_method(0, canvas_class, "push_rotate_zoom",
+                     c_canvas_push_rotate_zoom);
+  mrbc_define_method(0, canvas_class, "push_rotate_zoom_aa",
+                     c_canvas_push_rotate_zoom_aa);
+  mrbc_define_method(0, canvas_class, "push_affine", c_canvas_push_affine);
+  mrbc_define_method(0, canvas_class, "set_pivot", c_canvas_set_pivot);
   mrbc_define_method(0, canvas_class, "delete_sprite", c_canvas_delete_sprite);
   mrbc_define_method(0, canvas_class, "create_sprite", c_canvas_create_sprite);
   mrbc_define_method(0, canvas_class, "destroy", class_canvas_destroy);
@@ -212,12 +425,16 @@ void class_canvas_init() {
   mrbc_define_method(0, canvas_class, "print", c_canvas_print);
   mrbc_define_method(0, canvas_class, "puts", c_canvas_puts);
   mrbc_define_method(0, canvas_class, "clear", c_canvas_clear);
+  mrbc_define_method(0, canvas_class, "blend", c_canvas_blend);
+  mrbc_define_method(0, canvas_class, "draw_rgb888", c_canvas_draw_rgb888);
 
   mrbc_define_method(0, canvas_class, "fill_rect", class_canvas_fill_rect);
   mrbc_define_method(0, canvas_class, "draw_rect", class_canvas_draw_rect);
   mrbc_define_method(0, canvas_class, "fill_circle", class_canvas_flll_circle);
   mrbc_define_method(0, canvas_class, "draw_circle", class_canvas_draw_circle);
   mrbc_define_method(0, canvas_class, "draw_line", class_canvas_draw_line);
+  mrbc_define_method(0, canvas_class, "draw_points",
+                     class_canvas_draw_points);
 #ifdef USE_FILE_FUNCTION
   mrbc_define_method(0, canvas_class, "draw_bmpfile", class_canvas_draw_bmp);
   mrbc_define_method(0, canvas_class, "draw_jpgfile", class_canvas_draw_jpg);
@@ -2,6 +2,7 @@
 
 #include <M5Unified.h>
 
+#include "../drv/input.h"
 #include "drawing.h"
 #include "my_mrubydef.h"
 
@@ -77,6 +78,10 @@ static void class_display_draw_line(mrb_vm *vm, mrb_value *v, int argc) {
   draw_draw_line(&M5.Display, vm, v, argc);
 }
 
+static void class_display_draw_points(mrb_vm *vm, mrb_value *v, int argc) {
+  draw_draw_points(&M5.Display, vm, v, argc);
+}
+
 #ifdef USE_FILE_FUNCTION
 static void class_display_draw_bmp(mrb_vm *vm, mrb_value *v, int argc) {
   draw_draw_bmp(&M5.Display, vm, v, argc);
@@ -126,11 +131,13 @@ static void class_display_end_write(mrb_vm *vm, mrb_value *v, int argc) {
 
 static void class_btn_is_pressed(mrb_vm *vm, mrb_value *v, int argc) {
   int no = *v->instance->data;
+  drv_input_lock();  // M5.update() on the Input sampler rewrites them
   m5::Button_Class btns[] = {M5.BtnA, M5.BtnB, M5.BtnC,
 #ifdef USE_FULL_BUTTONS
                              M5.BtnEXT, M5.BtnPWR
 #endif
   };
+  drv_input_unlock();
   if (0 <= no && no < sizeof(btns)) {
     if (btns[no].isPressed()) {
       SET_TRUE_RETURN();
@@ -142,7 +149,9 @@ static void class_btn_is_pressed(mrb_vm *vm, mrb_value *v, int argc) {
 
 static void class_btn_was_pressed(mrb_vm *vm, mrb_value *v, int argc) {
   int no = *v->instance->data;
+  drv_input_lock();
   m5::Button_Class btns[] = {M5.BtnA, M5.BtnB, M5.BtnC};
+  drv_input_unlock();
   if (0 <= no && no < sizeof(btns)) {
     if (btns[no].wasPressed()) {
       SET_TRUE_RETURN();
@@ -186,6 +195,8 @@ void class_display_button_init() {
   mrbc_define_method(0, class_display, "draw_circle",
                      class_display_draw_circle);
   mrbc_define_method(0, class_display, "draw_line", class_display_draw_line);
+  mrbc_define_method(0, class_display, "draw_points",
+                     class_display_draw_points);
 #ifdef USE_FILE_FUNCTION
   mrbc_define_method(0, class_display, "draw_bmpfile", class_display_draw_bmp);
   mrbc_define_method(0, class_display, "draw_jpgfile", class_display_draw_jpg);
@@ -0,0 +1,307 @@
+//
+// DisplayList: drawing commands recorded from Ruby and replayed natively
+//
+// Each primitive is appended to a compact byte buffer (an opcode followed by
+// 16-bit arguments). run replays the whole buffer inside one
+// startWrite/endWrite transaction, and an unchanged list can be run again
+// without recording anything.
+//
+
+#include <M5Unified.h>
+
+#include "my_mrubydef.h"
+
+#ifdef USE_DISPLAY_LIST
+#include "c_display_list.h"
+
+#include <vector>
+
+#include "esp_timer.h"
+
+enum display_list_op : uint8_t {
+  kOpFillRect,    // x, y, w, h, color
+  kOpDrawRect,    // x, y, w, h, color
+  kOpDrawLine,    // x0, y0, x1, y1, color
+  kOpFillCircle,  // x, y, r, color
+  kOpDrawCircle,  // x, y, r, color
+  kOpFillScreen,  // color
+  kOpText,        // x, y, has_color, color, len, bytes
+  kOpBlit,        // canvas ref index, x, y
+};
+
+struct DisplayList {
+  std::vector<uint8_t> buf;
+  std::vector<mrbc_value> refs;  // canvases used by kOpBlit, kept alive
+  uint32_t count = 0;
+};
+
+static mrbc_class *display_list_class;
+
+static void display_list_put(DisplayList *dl, int16_t value) {
+  uint8_t b[2];
+  memcpy(b, &value, 2);
+  dl->buf.insert(dl->buf.end(), b, b + 2);
+}
+
+static int16_t display_list_get(const uint8_t *&p) {
+  int16_t value;
+  memcpy(&value, p, 2);
+  p += 2;
+  return value;
+}
+
+static void display_list_release(DisplayList *dl) {
+  for (auto &ref : dl->refs) {
+    mrbc_decref(&ref);
+  }
+  dl->refs.clear();
+  dl->buf.clear();
+  dl->count = 0;
+}
+
+static void display_list_replay(const DisplayList *dl, LovyanGFX *dst) {
+  const uint8_t *p = dl->buf.data();
+  const uint8_t *end = p + dl->buf.size();
+  dst->startWrite();
+  while (p < end) {
+    uint8_t op = *p++;
+    switch (op) {
+      case kOpFillRect:
+      case kOpDrawRect:
+      case kOpDrawLine: {
+        int16_t a = display_list_get(p);
+        int16_t b = display_list_get(p);
+        int16_t c = display_list_get(p);
+        int16_t d = display_list_get(p);
+        uint16_t color = display_list_get(p);
+        if (op == kOpFillRect) {
+          dst->fillRect(a, b, c, d, color);
+        } else if (op == kOpDrawRect) {
+          dst->drawRect(a, b, c, d, color);
+        } else {
+          dst->drawLine(a, b, c, d, color);
+        }
+        break;
+      }
+      case kOpFillCircle:
+      case kOpDrawCircle: {
+        int16_t x = display_list_get(p);
+        int16_t y = display_list_get(p);
+        int16_t r = display_list_get(p);
+        uint16_t color = display_list_get(p);
+        if (op == kOpFillCircle) {
+          dst->fillCircle(x, y, r, color);
+        } else {
+          dst->drawCircle(x, y, r, color);
+        }
+        break;
+      }
+      case kOpFillScreen:
+        dst->fillScreen((uint16_t)display_list_get(p));
+        break;
+      case kOpText: {
+        int16_t x = display_list_get(p);
+        int16_t y = display_list_get(p);
+        bool has_color = display_list_get(p);
+        uint16_t color = display_list_get(p);
+        uint16_t len = display_list_get(p);
+        if (has_color) dst->setTextColor(color);
+        dst->setCursor(x, y);
+        dst->write(p, len);
+        p += len;
+        break;
+      }
+      case kOpBlit: {
+        const mrbc_value &ref = dl->refs[display_list_get(p)];
+        int16_t x = display_list_get(p);
+        int16_t y = display_list_get(p);
+        M5Canvas *canvas = *(M5Canvas **)ref.instance->data;
+        if (canvas != nullptr) canvas->pushSprite(dst, x, y);  // skip destroyed
+        break;
+      }
+    }
+  }
+  dst->endWrite();
+}
+
+static void c_display_list_new(mrb_vm *vm, mrb_value *v, int argc) {
+  v[0] = mrbc_instance_new(vm, v[0].cls, sizeof(DisplayList *));
+  *(DisplayList **)v->instance->data = new DisplayList();
+}
+
+// reads argument i as a coordinate (int16) or an RGB565 color (uint16)
+static bool display_list_arg(mrb_vm *vm, mrb_value *v, int argc, int i,
+                             bool color, int *value) {
+  *value = val_to_i(vm, v, GET_ARG(i), argc);
+  if (color ? (*value < 0 || *value > UINT16_MAX)
+            : (*value < INT16_MIN || *value > INT16_MAX)) {
+    mrbc_raise(vm, MRBC_CLASS(ArgumentError),
+               color ? "color out of range" : "coordinate out of range");
+    return false;
+  }
+  return true;
+}
+
+// records an opcode followed by n integer arguments, the last one a color
+static void display_list_record(mrb_vm *vm, mrb_value *v, int argc,
+                                display_list_op op, int n) {
+  DisplayList *dl = get_checked_data(DisplayList, vm, v);
+  if (argc < n) {
+    mrbc_raise(vm, MRBC_CLASS(ArgumentError), "wrong number of arguments");
+    return;
+  }
+  int args[5];
+  for (int i = 1; i <= n; i++) {
+    if (!display_list_arg(vm, v, argc, i, i == n, &args[i - 1])) return;
+  }
+  dl->buf.push_back(op);
+  for (int i = 0; i < n; i++) {
+    display_list_put(dl, args[i]);
+  }
+  dl->count++;
+  SET_RETURN(v[0]);  // allow chaining
+}
+
+static void c_display_list_fill_rect(mrb_vm *vm, mrb_value *v, int argc) {
+  display_list_record(vm, v, argc, kOpFillRect, 5);
+}
+
+static void c_display_list_draw_rect(mrb_vm *vm, mrb_value *v, int argc) {
+  display_list_record(vm, v, argc, kOpDrawRect, 5);
+}
+
+static void c_display_list_draw_line(mrb_vm *vm, mrb_value *v, int argc) {
+  display_list_record(vm, v, argc, kOpDrawLine, 5);
+}
+
+static void c_display_list_fill_circle(mrb_vm *vm, mrb_value *v, int argc) {
+  display_list_record(vm, v, argc, kOpFillCircle, 4);
+}
+
+static void c_display_list_draw_circle(mrb_vm *vm, mrb_value *v, int argc) {
+  display_list_record(vm, v, argc, kOpDrawCircle, 4);
+}
+
+static void c_display_list_fill_screen(mrb_vm *vm, mrb_value *v, int argc) {
+  display_list_record(vm, v, argc, kOpFillScreen, 1);
+}
+
+// text(x, y, str, [color])
+static void c_display_list_text(mrb_vm *vm, mrb_value *v, int argc) {
+  DisplayList *dl = get_checked_data(DisplayList, vm, v);
+  if (argc < 3) {
+    mrbc_raise(vm, MRBC_CLASS(ArgumentError), "x, y, text");
+    return;
+  }
+  int x, y, color = 0;
+  if (!display_list_arg(vm, v, argc, 1, false, &x) ||
+      !display_list_arg(vm, v, argc, 2, false, &y) ||
+      (argc > 3 && !display_list_arg(vm, v, argc, 4, true, &color))) {
+    return;
+  }
+  const char *str = val_to_s(vm, v, GET_ARG(3), argc);
+  size_t len = strlen(str);
+  if (len > INT16_MAX) len = INT16_MAX;
+  dl->buf.push_back(kOpText);
+  display_list_put(dl, x);
+  display_list_put(dl, y);
+  display_list_put(dl, argc > 3);  // without a color, keep the text color
+  display_list_put(dl, color);
+  display_list_put(dl, len);
+  dl->buf.insert(dl->buf.end(), str, str + len);
+  dl->count++;
+  SET_RETURN(v[0]);
+}
+
+// blit(canvas, x, y): the canvas is referenced, not copied, so changes to it
+// show up on the next run
+static void c_display_list_blit(mrb_vm *vm, mrb_value *v, int argc) {
+  DisplayList *dl = get_checked_data(DisplayList, vm, v);
+  mrbc_class *canvas_class = mrbc_get_class_by_name("Canvas");
+  if (argc < 3 || canvas_class == nullptr ||
+      !mrbc_obj_is_kind_of(&GET_ARG(1), canvas_class)) {
+    mrbc_raise(vm, MRBC_CLASS(ArgumentError), "canvas, x, y");
+    return;
+  }
+  int x, y;
+  if (!display_list_arg(vm, v, argc, 2, false, &x) ||
+      !display_list_arg(vm, v, argc, 3, false, &y)) {
+    return;
+  }
+  if (dl->refs.size() > INT16_MAX) {
+    mrbc_raise(vm, MRBC_CLASS(ArgumentError), "too many canvases");
+    return;
+  }
+  mrbc_incref(&GET_ARG(1));
+  dl->refs.push_back(GET_ARG(1));
+  dl->buf.push_back(kOpBlit);
+  display_list_put(dl, dl->refs.size() - 1);
+  display_list_put(dl, x);
+  display_list_put(dl, y);
+  dl->count++;
+  SET_RETURN(v[0]);
+}
+
+// run([target]): replays the list in one write transaction and returns the
+// time it took in microseconds
+static void c_display_list_run(mrb_vm *vm, mrb_value *v, int argc) {
+  DisplayList *dl = get_checked_data(DisplayList, vm, v);
+  LovyanGFX *dst = &M5.Display;
+  mrbc_class *canvas_class = mrbc_get_class_by_name("Canvas");
+  if (argc > 0 && canvas_class &&
+      mrbc_obj_is_kind_of(&GET_ARG(1), canvas_class)) {
+    dst = get_checked_data(M5Canvas, vm, (&GET_ARG(1)));
+  }
+  int64_t start = esp_timer_get_time();
+  display_list_replay(dl, dst);
+  SET_INT_RETURN(esp_timer_get_time() - start);
+}
+
+static void c_display_list_reset(mrb_vm *vm, mrb_value *v, int argc) {
+  DisplayList *dl = get_checked_data(DisplayList, vm, v);
+  display_list_release(dl);
+  SET_RETURN(v[0]);
+}
+
+static void c_display_list_size(mrb_vm *vm, mrb_value *v, int argc) {
+  DisplayList *dl = get_checked_data(DisplayList, vm, v);
+  SET_INT_RETURN(dl->count);
+}
+
+static void c_display_list_bytes(mrb_vm *vm, mrb_value *v, int argc) {
+  DisplayList *dl = get_checked_data(DisplayList, vm, v);
+  SET_INT_RETURN(dl->buf.size());
+}
+
+static void c_display_list_destroy(mrb_vm *vm, mrb_value *v, int argc) {
+  DisplayList *dl = get_checked_data(DisplayList, vm, v);
+  display_list_release(dl);
+  delete dl;
+  put_null_data(v);
+}
+
+void class_display_list_init() {
+  display_list_class = mrbc_define_class(0, "DisplayList", mrbc_class_object);
+  mrbc_define_method(0, display_list_class, "new", c_display_list_new);
+  mrbc_define_method(0, display_list_class, "fill_rect",
+                     c_display_list_fill_rect);
+  mrbc_define_method(0, display_list_class, "draw_rect",
+                     c_display_list_draw_rect);
+  mrbc_define_method(0, display_list_class, "draw_line",
+                     c_display_list_draw_line);
+  mrbc_define_method(0, display_list_class, "fill_circle",
+                     c_display_list_fill_circle);
+  mrbc_define_method(0, display_list_class, "draw_circle",
+                     c_display_list_draw_circle);
+  mrbc_define_method(0, display_list_class, "fill_screen",
+                     c_display_list_fill_screen);
+  mrbc_define_method(0, display_list_class, "text", c_display_list_text);
+  mrbc_define_method(0, display_list_class, "blit", c_display_list_blit);
+  mrbc_define_method(0, display_list_class, "run", c_display_list_run);
+  mrbc_define_method(0, display_list_class, "reset", c_display_list_reset);
+  mrbc_define_method(0, display_list_class, "size", c_display_list_size);
+  mrbc_define_method(0, display_list_class, "bytes", c_display_list_bytes);
+  mrbc_define_method(0, display_list_class, "destroy", c_display_list_destroy);
+}
+
+#endif  // USE_DISPLAY_LIST
@@ -0,0 +1,3 @@
+extern "C" {
+    void class_display_list_init();
+}
@@ -6,34 +6,171 @@
 
 #include "c_font.h"
 
+#include <algorithm>
 #include <vector>
 #include <lgfx/v1/lgfx_fonts.hpp>
 
 #include "drawing.h"
+#include "esp_partition.h"
 
 struct font_info {
     const char* name;
     const lgfx::v1::IFont* font;
+    int store;      // index in font_store, -1 for fonts linked into the firmware
 };
 
+// VLW fonts kept in a raw flash partition. The partition is mapped and the
+// glyph metrics are parsed on first use only; glyph bitmaps are read through
+// the flash cache while drawing, so only the pages a script touches are
+// fetched. Entries survive VM reloads so a font is never mapped twice.
+struct font_store_entry {
+    char* name;
+    char* label;
+    uint32_t offset;
+    esp_partition_mmap_handle_t handle;
+    lgfx::v1::PointerWrapper* data;
+    lgfx::v1::VLWfont* vlw;
+};
+
+static std::vector<struct font_store_entry> font_store;
+
 std::vector<struct font_info> m5fonts;
+// font numbers ordered by name, kept sorted by c_font_add() for binary search
+static std::vector<uint8_t> m5font_index;
+
+static mrbc_class *font_class;
+
+static bool font_name_less(uint8_t no, const char* name)
+{
+    return strcmp(m5fonts[no].name, name) < 0;
+}
+
+// returns the font number registered as name, or -1
+static int font_lookup(const char* name)
+{
+    auto it = std::lower_bound(m5font_index.begin(), m5font_index.end(), name, font_name_less);
+    if(it != m5font_index.end() && strcmp(m5fonts[*it].name, name) == 0){
+        return *it;
+    }
+    return -1;
+}
+
+static const lgfx::v1::IFont* font_store_load(struct font_store_entry &e)
+{
+    if(e.vlw != nullptr) return e.vlw;
+
+    const esp_partition_t *part = esp_partition_find_first(
+        ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, e.label);
+    if(part == nullptr || e.offset >= part->size) return nullptr;
+
+    const void *ptr;
+    uint32_t size = part->size - e.offset;
+    if(esp_partition_mmap(part, e.offset, size, ESP_PARTITION_MMAP_DATA,
+                          &ptr, &e.handle) != ESP_OK){
+        return nullptr;
+    }
+    auto data = new lgfx::v1::PointerWrapper((const uint8_t*)ptr, size);
+    auto vlw = new lgfx::v1::VLWfont();
+    if(!vlw->loadFont(data)){
+        delete vlw;
+        delete data;
+        esp_partition_munmap(e.handle);
+        return nullptr;
+    }
+    e.data = data;
+    e.vlw = vlw;
+    return vlw;
+}
+
+// bytes of RAM held by a loaded store font (glyph metric tables + objects)
+static size_t font_store_resident(const struct font_store_entry &e)
+{
+    const lgfx::v1::VLWfont *f = e.vlw;
+    if(f == nullptr) return 0;
+    size_t per_glyph = sizeof(*f->gUnicode) + sizeof(*f->gHeight) + sizeof(*f->gWidth)
+                     + sizeof(*f->gxAdvance) + sizeof(*f->gdY) + sizeof(*f->gdX)
+                     + sizeof(*f->gBitmap);
+    return sizeof(*f) + sizeof(*e.data) + f->gCount * per_glyph;
+}
+
+// font object for the font number, loading it from the store on first use
+static const lgfx::v1::IFont* font_resolve(int no, bool *ok)
+{
+    const struct font_info &fi = m5fonts[no];
+    if(fi.store < 0){
+        *ok = true;
+        return fi.font;
+    }
+    const lgfx::v1::IFont* font = font_store_load(font_store[fi.store]);
+    *ok = (font != nullptr);
+    return font;
+}
+
+// font number given as Integer, String or Font object, or -1
+static int font_arg(mrb_vm *vm, mrb_value *v, int argc)
+{
+    if(argc<1) return -1;
+    if(GET_ARG(1).tt == MRBC_TT_INTEGER){
+        int no = GET_ARG(1).i;
+        return (0 <= no && no < (int)m5fonts.size()) ? no : -1;
+    } else if(GET_ARG(1).tt == MRBC_TT_STRING){
+        return font_lookup(val_to_s(vm, v, GET_ARG(1),argc));
+    } else if(mrbc_obj_is_kind_of(&GET_ARG(1), font_class)){
+        return *(int *)GET_ARG(1).instance->data;
+    }
+    return -1;
+}
 
 static void
 class_font_by_name(mrb_vm *vm, mrb_value *v, int argc)
 {
     if(argc>0){
         const char* fontname = val_to_s(vm, v, GET_ARG(1),argc);
-        //search the fonrname from m5fonts vector and return the order number of the font
-        for(int i=0; i<m5fonts.size(); i++){
-            if(strcmp(m5fonts[i].name, fontname)==0){
-                SET_INT_RETURN(i);
-                return;
-            }
+        int no = font_lookup(fontname);
+        if(no >= 0){
+            SET_INT_RETURN(no);
+            return;
         }
     }
     SET_FALSE_RETURN();
 }
 
+// Font.get(name) returns a Font object bound to the font number, so that
+// set_font(font) does not need any name lookup
+static void
+class_font_get(mrb_vm *vm, mrb_value *v, int argc)
+{
+    int no = font_arg(vm, v, argc);
+    if(no >= 0){
+        mrbc_value font = mrbc_instance_new(vm, font_class, sizeof(int));
+        *(int *)font.instance->data = no;
+        SET_RETURN(font);
+        return;
+    }
+    SET_FALSE_RETURN();
+}
+
+static void
+c_font_name(mrb_vm *vm, mrb_value *v, int argc)
+{
+    if(v[0].tt != MRBC_TT_OBJECT){
+        SET_FALSE_RETURN();
+        return;
+    }
+    int no = *(int *)v->instance->data;
+    SET_RETURN(mrbc_string_new_cstr(vm, m5fonts[no].name));
+}
+
+static void
+c_font_no(mrb_vm *vm, mrb_value *v, int argc)
+{
+    if(v[0].tt != MRBC_TT_OBJECT){
+        SET_FALSE_RETURN();
+        return;
+    }
+    SET_INT_RETURN(*(int *)v->instance->data);
+}
+
 static void
 class_font_number(mrb_vm *vm, mrb_value *v, int argc)
 {
@@ -54,28 +191,52 @@ class_font_names(mrb_vm *vm, mrb_value *v, int argc)
 
 void draw_set_font(LovyanGFX *dst, mrb_vm *vm, mrb_value *v, int argc)
 {
-    if(argc>0){
-        if(GET_ARG(1).tt == MRBC_TT_INTEGER){
-            unsigned int  fontnumber = val_to_i(vm, v, GET_ARG(1),argc);
-            if(fontnumber < m5fonts.size()){
-                dst->setFont(m5fonts[fontnumber].font);
-                SET_TRUE_RETURN();
-                return;
-            }
-        } else if(GET_ARG(1).tt == MRBC_TT_STRING){   // by_name
-            const char* fontname = val_to_s(vm, v, GET_ARG(1),argc);
-            for(int i=0; i<m5fonts.size(); i++){
-                if(strcmp(m5fonts[i].name, fontname)==0){
-                    dst->setFont(m5fonts[i].font);
-                    SET_TRUE_RETURN();
-                    return;
-                }
-            }
+    int no = font_arg(vm, v, argc);
+    if(no >= 0){
+        bool ok;
+        const lgfx::v1::IFont* font = font_resolve(no, &ok);
+        if(ok){
+            dst->setFont(font);
+            SET_TRUE_RETURN();
+            return;
         }
-    } 
+    }
     SET_FALSE_RETURN();
 }
 
+// Font.add_vlw(name, partition_label, [offset]) registers a VLW font stored in
+// a data partition. Nothing is read from flash until the font is first set.
+static void
+class_font_add_vlw(mrb_vm *vm, mrb_value *v, int argc)
+{
+    if(argc<2 || GET_ARG(1).tt != MRBC_TT_STRING || GET_ARG(2).tt != MRBC_TT_STRING){
+        mrbc_raise(vm, MRBC_CLASS(ArgumentError), "name and partition label");
+        return;
+    }
+    uint32_t offset = (argc>2) ? val_to_i(vm, v, GET_ARG(3), argc) : 0;
+    int no = c_font_add_partition(val_to_s(vm, v, GET_ARG(1), argc),
+                                  val_to_s(vm, v, GET_ARG(2), argc), offset);
+    if(no >= 0){
+        SET_INT_RETURN(no);
+    } else {
+        SET_FALSE_RETURN();
+    }
+}
+
+// Font.resident(font) returns the bytes of RAM the font holds, 0 for fonts
+// linked into the firmware or not loaded yet
+static void
+class_font_resident(mrb_vm *vm, mrb_value *v, int argc)
+{
+    int no = font_arg(vm, v, argc);
+    if(no < 0){
+        SET_FALSE_RETURN();
+        return;
+    }
+    int store = m5fonts[no].store;
+    SET_INT_RETURN(store < 0 ? 0 : font_store_resident(font_store[store]));
+}
+
 static void class_display_set_font(mrb_vm *vm, mrb_value *v, int argc)
 {
     draw_set_font(&M5.Display,vm,v,argc);
@@ -92,21 +253,92 @@ uint8_t c_font_add(const char* fontname, const lgfx::v1::IFont* font)
     struct font_info fi;
     fi.name = fontname;
     fi.font = font;
+    fi.store = -1;
     m5fonts.push_back(fi);
-    return m5fonts.size()-1;
+    uint8_t no = m5fonts.size()-1;
+    auto it = std::lower_bound(m5font_index.begin(), m5font_index.end(), fontname, font_name_less);
+    m5font_index.insert(it, no);
+    return no;
+}
+
+int c_font_add_partition(const char* fontname, const char* label, uint32_t offset)
+{
+    if(font_lookup(fontname) >= 0 || m5fonts.size() >= UINT8_MAX) return -1;
+
+    int store = -1;
+    for(int i=0; i<font_store.size(); i++){
+        const struct font_store_entry &e = font_store[i];
+        if(strcmp(e.name, fontname)==0 && strcmp(e.label, label)==0 && e.offset == offset){
+            store = i;
+            break;
+        }
+    }
+    if(store < 0){
+        struct font_store_entry e = {};
+        e.name = strdup(fontname);
+        e.label = strdup(label);
+        e.offset = offset;
+        font_store.push_back(e);
+        store = font_store.size()-1;
+    }
+
+    uint8_t no = c_font_add(font_store[store].name, nullptr);
+    m5fonts[no].store = store;
+    return no;
 }
 
 void class_font_init()  // order dependency. Font must be defined after Display and Canvas
 {
     mrb_class *class_font = mrbc_define_class(0, "Font", mrbc_class_object);
+    font_class = class_font;
     mrbc_define_method(0, class_font, "by_name", class_font_by_name);  // old i/f
+    mrbc_define_method(0, class_font, "get", class_font_get);
     mrbc_define_method(0, class_font, "count", class_font_number);
     mrbc_define_method(0, class_font, "names", class_font_names);
+    mrbc_define_method(0, class_font, "add_vlw", class_font_add_vlw);
+    mrbc_define_method(0, class_font, "resident", class_font_resident);
+    mrbc_define_method(0, class_font, "name", c_font_name);
+    mrbc_define_method(0, class_font, "number", c_font_no);
 
+    // class_font_init() runs again on every VM reload
+    m5fonts.clear();
+    m5font_index.clear();
     c_font_add("default", nullptr);
 #ifdef USE_EFONTJA10
     c_font_add("efontJA_10", &efontJA_10);
 #endif // USE_EFONTJA10
+#ifdef USE_LGFX_BUILTIN_FONTS
+    c_font_add("Font0", &lgfx::fonts::Font0);
+    c_font_add("Font2", &lgfx::fonts::Font2);
+    c_font_add("Font4", &lgfx::fonts::Font4);
+    c_font_add("Font6", &lgfx::fonts::Font6);
+    c_font_add("Font7", &lgfx::fonts::Font7);
+    c_font_add("Font8", &lgfx::fonts::Font8);
+    c_font_add("TomThumb", &lgfx::fonts::TomThumb);
+    c_font_add("FreeMono9pt7b", &lgfx::fonts::FreeMono9pt7b);
+    c_font_add("FreeMono12pt7b", &lgfx::fonts::FreeMono12pt7b);
+    c_font_add("FreeMono18pt7b", &lgfx::fonts::FreeMono18pt7b);
+    c_font_add("FreeMono24pt7b", &lgfx::fonts::FreeMono24pt7b);
+    c_font_add("FreeSans9pt7b", &lgfx::fonts::FreeSans9pt7b);
+    c_font_add("FreeSans12pt7b", &lgfx::fonts::FreeSans12pt7b);
+    c_font_add("FreeSans18pt7b", &lgfx::fonts::FreeSans18pt7b);
+    c_font_add("FreeSans24pt7b", &lgfx::fonts::FreeSans24pt7b);
+    c_font_add("FreeSerif9pt7b", &lgfx::fonts::FreeSerif9pt7b);
+    c_font_add("FreeSerif12pt7b", &lgfx::fonts::FreeSerif12pt7b);
+    c_font_add("FreeSerif18pt7b", &lgfx::fonts::FreeSerif18pt7b);
+    c_font_add("FreeSerif24pt7b", &lgfx::fonts::FreeSerif24pt7b);
+    c_font_add("DejaVu9", &lgfx::fonts::DejaVu9);
+    c_font_add("DejaVu12", &lgfx::fonts::DejaVu12);
+    c_font_add("DejaVu18", &lgfx::fonts::DejaVu18);
+    c_font_add("DejaVu24", &lgfx::fonts::DejaVu24);
+    c_font_add("DejaVu40", &lgfx::fonts::DejaVu40);
+    c_font_add("DejaVu56", &lgfx::fonts::DejaVu56);
+    c_font_add("DejaVu72", &lgfx::fonts::DejaVu72);
+    c_font_add("Orbitron_Light_24", &lgfx::fonts::Orbitron_Light_24);
+    c_font_add("Roboto_Thin_24", &lgfx::fonts::Roboto_Thin_24);
+    c_font_add("Satisfy_24", &lgfx::fonts::Satisfy_24);
+    c_font_add("Yellowtail_32", &lgfx::fonts::Yellowtail_32);
+#endif // USE_LGFX_BUILTIN_FONTS
 
 
     mrbc_class *class_display = mrbc_get_class_by_name("Display");
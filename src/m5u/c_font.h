@@ -2,6 +2,7 @@
 extern "C" {
     void class_font_init();
     uint8_t c_font_add(const char* fontname, const lgfx::v1::IFont* font);
+    int c_font_add_partition(const char* fontname, const char* label, uint32_t offset);
 }
 
 
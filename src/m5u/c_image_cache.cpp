@@ -0,0 +1,284 @@
+//
+// ImageCache: decoded image cache for draw_bmpstr/draw_jpgstr/draw_pngstr
+//
+// Entries are keyed by a hash of the encoded bytes and the target color
+// depth, and keep a copy of the encoded bytes so a hit is confirmed against
+// the data. A hit pushes the already decoded sprite instead of decoding
+// again. PNGs with transparency are not cached: they are blended into the
+// target while decoding, which an opaque sprite cannot reproduce. Buffers go
+// to PSRAM when the board has it.
+//
+
+#include <M5Unified.h>
+
+#include "my_mrubydef.h"
+
+#ifdef USE_IMAGE_CACHE
+#include "c_image_cache.h"
+
+#include <vector>
+
+#include "esp_heap_caps.h"
+
+#define IMAGE_CACHE_MAX_ENTRIES 8
+#define IMAGE_CACHE_MAX_BYTES (64 * 1024)
+#define IMAGE_CACHE_MAX_BYTES_PSRAM (512 * 1024)
+
+struct image_cache_entry {
+  uint32_t hash;                // FNV-1a of the encoded bytes
+  uint32_t size;                // encoded size
+  uint8_t *data;                // copy of the encoded bytes
+  lgfx::color_depth_t depth;    // color depth of the target
+  bool pinned;
+  uint32_t last_use;            // LRU clock
+  size_t bytes;                 // decoded buffer and data copy size
+  M5Canvas *sprite;
+};
+
+static std::vector<struct image_cache_entry> cache;
+static size_t cache_bytes = 0;
+static uint32_t cache_clock = 0;
+static uint32_t cache_hits = 0;
+static uint32_t cache_misses = 0;
+static uint32_t cache_evictions = 0;
+
+static uint32_t image_hash(const uint8_t *mem, size_t len) {
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < len; i++) {
+    h = (h ^ mem[i]) * 16777619u;
+  }
+  return h;
+}
+
+static bool image_cache_match(const struct image_cache_entry &e, uint32_t hash,
+                              const uint8_t *mem, size_t len) {
+  return e.hash == hash && e.size == len && memcmp(e.data, mem, len) == 0;
+}
+
+static uint32_t be16(const uint8_t *p) { return (p[0] << 8) | p[1]; }
+static uint32_t be32(const uint8_t *p) {
+  return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+static int32_t le32(const uint8_t *p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | (p[3] << 24);
+}
+
+// reads the image dimensions from the header without decoding
+static bool image_size(draw_pic_type t, const uint8_t *mem, size_t len,
+                       int *w, int *h) {
+  switch (t) {
+    case bmp:
+      if (len < 26 || mem[0] != 'B' || mem[1] != 'M') return false;
+      *w = le32(mem + 18);
+      *h = abs(le32(mem + 22));  // negative height is a top-down bitmap
+      return true;
+    case png:
+      if (len < 26 || memcmp(mem + 12, "IHDR", 4) != 0) return false;
+      *w = be32(mem + 16);
+      *h = be32(mem + 20);
+      return true;
+    case jpg:
+      for (size_t i = 2; i + 9 < len;) {
+        if (mem[i] != 0xFF) return false;
+        uint8_t marker = mem[i + 1];
+        if (marker == 0xFF) {
+          i++;
+          continue;
+        }
+        if (0xC0 <= marker && marker <= 0xCF && marker != 0xC4 &&
+            marker != 0xC8 && marker != 0xCC) {  // SOFn
+          *h = be16(mem + i + 5);
+          *w = be16(mem + i + 7);
+          return true;
+        }
+        i += 2 + be16(mem + i + 2);
+      }
+      return false;
+  }
+  return false;
+}
+
+// true if the PNG has an alpha channel or a tRNS chunk
+static bool png_transparent(const uint8_t *mem, size_t len) {
+  uint8_t color_type = mem[25];
+  if (color_type == 4 || color_type == 6) return true;  // gray/RGB + alpha
+  for (size_t i = 8; i + 8 <= len;) {
+    if (memcmp(mem + i + 4, "tRNS", 4) == 0) return true;
+    if (memcmp(mem + i + 4, "IDAT", 4) == 0) return false;  // tRNS comes first
+    uint32_t n = be32(mem + i);
+    if (n > len) return true;  // broken, leave it to the decoder uncached
+    i += 12 + n;
+  }
+  return false;
+}
+
+static void image_cache_drop(size_t i) {
+  delete cache[i].sprite;
+  heap_caps_free(cache[i].data);
+  cache_bytes -= cache[i].bytes;
+  cache.erase(cache.begin() + i);
+}
+
+// evicts least recently used unpinned entries until `bytes` more fit
+static bool image_cache_make_room(size_t bytes, size_t budget) {
+  while (cache.size() >= IMAGE_CACHE_MAX_ENTRIES ||
+         cache_bytes + bytes > budget) {
+    int lru = -1;
+    for (size_t i = 0; i < cache.size(); i++) {
+      if (cache[i].pinned) continue;
+      if (lru < 0 || cache[i].last_use < cache[lru].last_use) lru = i;
+    }
+    if (lru < 0) return false;  // everything left is pinned
+    image_cache_drop(lru);
+    cache_evictions++;
+  }
+  return true;
+}
+
+// false if the decoder gave up (unsupported format, truncated data)
+static bool image_decode(LovyanGFX *dst, draw_pic_type t, const uint8_t *mem,
+                         size_t len, int x, int y) {
+  switch (t) {
+    case bmp:
+      return dst->drawBmp(mem, len, x, y);
+    case jpg:
+      return dst->drawJpg(mem, len, x, y);
+    case png:
+      return dst->drawPng(mem, len, x, y);
+  }
+  return false;
+}
+
+void image_cache_draw(LovyanGFX *dst, draw_pic_type t, const uint8_t *mem,
+                      size_t len, int x, int y) {
+  uint32_t hash = image_hash(mem, len);
+  lgfx::color_depth_t depth = dst->getColorDepth();
+  cache_clock++;
+
+  for (auto &e : cache) {
+    if (e.depth == depth && image_cache_match(e, hash, mem, len)) {
+      e.last_use = cache_clock;
+      cache_hits++;
+      e.sprite->pushSprite(dst, x, y);
+      return;
+    }
+  }
+  cache_misses++;
+
+  // decode once into a new entry and push it, or draw directly when the
+  // image cannot be cached
+  int w, h;
+  if (!image_size(t, mem, len, &w, &h) || w <= 0 || h <= 0 ||
+      (t == png && png_transparent(mem, len))) {
+    image_decode(dst, t, mem, len, x, y);
+    return;
+  }
+  bool psram = heap_caps_get_free_size(MALLOC_CAP_SPIRAM) > 0;
+  size_t budget = psram ? IMAGE_CACHE_MAX_BYTES_PSRAM : IMAGE_CACHE_MAX_BYTES;
+  size_t bytes =
+      ((size_t)w * h * (depth & lgfx::color_depth_t::bit_mask) + 7) / 8 + len;
+  if (bytes > budget || !image_cache_make_room(bytes, budget)) {
+    image_decode(dst, t, mem, len, x, y);
+    return;
+  }
+
+  M5Canvas *sprite = new M5Canvas();
+  sprite->setColorDepth(depth);
+  sprite->setPsram(psram);
+  uint8_t *data = (uint8_t *)heap_caps_malloc(
+      len, psram ? MALLOC_CAP_SPIRAM : MALLOC_CAP_8BIT);
+  if (data == nullptr || sprite->createSprite(w, h) == nullptr) {
+    heap_caps_free(data);
+    delete sprite;
+    image_decode(dst, t, mem, len, x, y);
+    return;
+  }
+  if (!image_decode(sprite, t, mem, len, 0, 0)) {
+    // pushing the sprite would paint a filled rectangle; draw it directly
+    // as the uncached path does and keep nothing
+    heap_caps_free(data);
+    delete sprite;
+    image_decode(dst, t, mem, len, x, y);
+    return;
+  }
+  memcpy(data, mem, len);
+  sprite->pushSprite(dst, x, y);
+
+  struct image_cache_entry e;
+  e.hash = hash;
+  e.size = len;
+  e.data = data;
+  e.depth = depth;
+  e.pinned = false;
+  e.last_use = cache_clock;
+  e.bytes = bytes;
+  e.sprite = sprite;
+  cache.push_back(e);
+  cache_bytes += bytes;
+}
+
+static int image_cache_set_pin(mrb_vm *vm, mrb_value *v, int argc, bool pin) {
+  if (argc < 1 || GET_ARG(1).tt != MRBC_TT_STRING) {
+    mrbc_raise(vm, MRBC_CLASS(ArgumentError), "not a string");
+    return -1;
+  }
+  const uint8_t *mem = GET_ARG(1).string->data;
+  size_t len = GET_ARG(1).string->size;
+  uint32_t hash = image_hash(mem, len);
+  int n = 0;
+  for (auto &e : cache) {
+    if (image_cache_match(e, hash, mem, len)) {
+      e.pinned = pin;
+      n++;
+    }
+  }
+  return n;
+}
+
+// ImageCache.pin(data): keeps the decoded image from being evicted. The image
+// must have been drawn once. Returns false when it is not cached.
+static void class_image_cache_pin(mrb_vm *vm, mrb_value *v, int argc) {
+  int n = image_cache_set_pin(vm, v, argc, true);
+  if (n >= 0) SET_BOOL_RETURN(n > 0);
+}
+
+static void class_image_cache_unpin(mrb_vm *vm, mrb_value *v, int argc) {
+  int n = image_cache_set_pin(vm, v, argc, false);
+  if (n >= 0) SET_BOOL_RETURN(n > 0);
+}
+
+static void class_image_cache_clear(mrb_vm *vm, mrb_value *v, int argc) {
+  while (!cache.empty()) {
+    image_cache_drop(cache.size() - 1);
+  }
+  SET_TRUE_RETURN();
+}
+
+// ImageCache.stats: [hits, misses, evictions, entries, bytes]
+static void class_image_cache_stats(mrb_vm *vm, mrb_value *v, int argc) {
+  uint32_t values[] = {cache_hits, cache_misses, cache_evictions,
+                       (uint32_t)cache.size(), (uint32_t)cache_bytes};
+  mrbc_value ret = mrbc_array_new(vm, 5);
+  for (int i = 0; i < 5; i++) {
+    mrbc_value n = mrbc_fixnum_value(values[i]);
+    mrbc_array_set(&ret, i, &n);
+  }
+  SET_RETURN(ret);
+}
+
+void class_image_cache_init() {
+  // decoded images outlive a VM reload, pins belong to the script that made
+  // them
+  for (auto &e : cache) {
+    e.pinned = false;
+  }
+
+  mrbc_class *class_image_cache =
+      mrbc_define_class(0, "ImageCache", mrbc_class_object);
+  mrbc_define_method(0, class_image_cache, "pin", class_image_cache_pin);
+  mrbc_define_method(0, class_image_cache, "unpin", class_image_cache_unpin);
+  mrbc_define_method(0, class_image_cache, "clear", class_image_cache_clear);
+  mrbc_define_method(0, class_image_cache, "stats", class_image_cache_stats);
+}
+
+#endif  // USE_IMAGE_CACHE
@@ -0,0 +1,6 @@
+#include "drawing.h"
+
+extern "C" {
+    void class_image_cache_init();
+}
+void image_cache_draw(LovyanGFX *dst, draw_pic_type t, const uint8_t *mem, size_t len, int x, int y);
@@ -0,0 +1,303 @@
+//
+// ImageStream: chunked BMP/JPG/PNG decoding into Display or Canvas
+//
+// The encoded image never has to sit in the mruby/c heap. The LovyanGFX
+// decoders pull their input through a DataWrapper, so each stream runs its
+// decoder on a task of its own, used as a coroutine: feed() hands it the
+// block and waits until it has consumed it, and the decoder waits for the
+// next feed() when it runs out. Only one of the two runs at a time. Between
+// blocks the decoder is parked inside drawJpg/drawPng with the target's
+// write state open, so scripts must not draw to the target until finish().
+//
+
+#include <M5Unified.h>
+
+#include "my_mrubydef.h"
+
+#ifdef USE_IMAGE_STREAM
+#include "c_image_stream.h"
+
+#include "drawing.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "freertos/semphr.h"
+
+#define IMAGE_STREAM_TASK_STACK 6144
+
+class ImageStream : public lgfx::v1::DataWrapper {
+ public:
+  LovyanGFX *dst;
+  draw_pic_type type;
+  int x, y;
+  SemaphoreHandle_t go = nullptr;    // VM -> decoder: a block is ready
+  SemaphoreHandle_t wait = nullptr;  // decoder -> VM: block used or done
+  ImageStream *next = nullptr;       // live streams, see image_stream_list
+  const uint8_t *src = nullptr;      // block being fed, valid during feed()
+  uint32_t src_len = 0;
+  bool eof = false;       // no more data will be fed
+  bool finished = false;  // decoder has returned
+  bool result = false;
+  int32_t pos = 0;
+  uint32_t fed = 0;
+  int64_t elapsed_us = 0;  // time the decoder ran, not the time between feeds
+  // heap held by the decoder, measured only while it runs
+  int32_t held = 0;
+  int32_t held_peak = 0;
+  size_t free_at_resume = 0;
+  uint32_t stack_used = 0;
+
+  ImageStream() {
+    need_transaction = true;  // release a shared SPI bus while waiting
+  }
+
+  int read(uint8_t *buf, uint32_t len) override {
+    uint32_t got = 0;
+    while (got < len) {
+      if (src_len > 0) {
+        uint32_t n = src_len < len - got ? src_len : len - got;
+        memcpy(buf + got, src, n);
+        src += n;
+        src_len -= n;
+        got += n;
+        continue;
+      }
+      if (eof) break;
+      park();
+    }
+    pos += got;
+    sample_heap();
+    return got;
+  }
+
+  void skip(int32_t offset) override {
+    uint8_t tmp[32];
+    while (offset > 0) {
+      int n = read(tmp, offset < (int32_t)sizeof(tmp) ? offset : sizeof(tmp));
+      if (n <= 0) break;
+      offset -= n;
+    }
+  }
+
+  bool seek(uint32_t offset) override {
+    if (offset < (uint32_t)pos) return false;  // the stream cannot rewind
+    skip(offset - pos);
+    return offset == (uint32_t)pos;
+  }
+
+  void close(void) override {}
+
+  int32_t tell(void) override { return pos; }
+
+  // decoder side: the heap used since resume() is ours, as the VM is waiting
+  void sample_heap(void) {
+    int32_t now = held + (int32_t)(free_at_resume -
+                                   heap_caps_get_free_size(MALLOC_CAP_8BIT));
+    if (now > held_peak) held_peak = now;
+  }
+
+  // decoder side: give the block back and wait for the next one
+  void park(void) {
+    sample_heap();
+    held += (int32_t)(free_at_resume -
+                      heap_caps_get_free_size(MALLOC_CAP_8BIT));
+    xSemaphoreGive(wait);
+    xSemaphoreTake(go, portMAX_DELAY);
+  }
+
+  // VM side: run the decoder until it needs more data or returns
+  void resume(void) {
+    int64_t start_us = esp_timer_get_time();
+    free_at_resume = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    xSemaphoreGive(go);
+    xSemaphoreTake(wait, portMAX_DELAY);
+    elapsed_us += esp_timer_get_time() - start_us;
+  }
+
+  // VM side: stop the decoder, it sees the end of data and returns
+  void abort(void) {
+    src_len = 0;
+    eof = true;
+    if (!finished) resume();
+  }
+};
+
+// values kept in the Ruby instance after the native stream is released
+struct image_stream_data {
+  ImageStream *stream;
+  bool result;
+  uint32_t bytes;
+  uint32_t peak;
+  uint32_t stack_used;
+  int64_t elapsed_us;
+};
+
+static mrbc_class *image_stream_class;
+// streams not finished yet, released when the VM reloads
+static ImageStream *image_stream_list = nullptr;
+
+static void image_stream_task(void *arg) {
+  ImageStream *s = (ImageStream *)arg;
+  xSemaphoreTake(s->go, portMAX_DELAY);  // first feed() or finish()
+  switch (s->type) {
+    case bmp:
+      s->result = s->dst->drawBmp(s, s->x, s->y);
+      break;
+    case jpg:
+      s->result = s->dst->drawJpg(s, s->x, s->y);
+      break;
+    case png:
+      s->result = s->dst->drawPng(s, s->x, s->y);
+      break;
+  }
+  s->sample_heap();
+  s->stack_used = IMAGE_STREAM_TASK_STACK - uxTaskGetStackHighWaterMark(NULL);
+  s->finished = true;
+  xSemaphoreGive(s->wait);  // s may be freed from here on
+  vTaskDelete(NULL);
+}
+
+static void image_stream_free(ImageStream *s) {
+  s->abort();
+  for (ImageStream **p = &image_stream_list; *p != nullptr; p = &(*p)->next) {
+    if (*p == s) {
+      *p = s->next;
+      break;
+    }
+  }
+  vSemaphoreDelete(s->go);
+  vSemaphoreDelete(s->wait);
+  delete s;
+}
+
+// Stops the streams drawing into dst, called before a Canvas is deleted.
+// They stay allocated until finish() so the Ruby objects remain valid.
+void image_stream_drop_target(LovyanGFX *dst) {
+  for (ImageStream *s = image_stream_list; s != nullptr; s = s->next) {
+    if (s->dst == dst) s->abort();
+  }
+}
+
+static void c_image_stream_new(mrb_vm *vm, mrb_value *v, int argc) {
+  v[0] = mrbc_instance_new(vm, v[0].cls, sizeof(struct image_stream_data));
+  mrbc_instance_call_initialize(vm, v, argc);
+}
+
+// ImageStream.new(target, type, x, y)
+static void c_image_stream_initialize(mrb_vm *vm, mrb_value *v, int argc) {
+  struct image_stream_data *d = (struct image_stream_data *)v->instance->data;
+  memset(d, 0, sizeof(*d));
+  if (argc < 4) {
+    mrbc_raise(vm, MRBC_CLASS(ArgumentError), "target, type, x, y");
+    return;
+  }
+
+  LovyanGFX *dst;
+  mrbc_class *canvas_class = mrbc_get_class_by_name("Canvas");
+  if (canvas_class && mrbc_obj_is_kind_of(&GET_ARG(1), canvas_class)) {
+    dst = get_checked_data(M5Canvas, vm, (&GET_ARG(1)));
+  } else {
+    dst = &M5.Display;  // no error, fall on default
+  }
+
+  const char *t = val_to_s(vm, v, GET_ARG(2), argc);
+  draw_pic_type type;
+  if (strcmp(t, "bmp") == 0) {
+    type = bmp;
+  } else if (strcmp(t, "jpg") == 0 || strcmp(t, "jpeg") == 0) {
+    type = jpg;
+  } else if (strcmp(t, "png") == 0) {
+    type = png;
+  } else {
+    mrbc_raise(vm, MRBC_CLASS(ArgumentError), "type must be bmp, jpg or png");
+    return;
+  }
+
+  ImageStream *s = new ImageStream();
+  s->dst = dst;
+  s->type = type;
+  s->x = val_to_i(vm, v, GET_ARG(3), argc);
+  s->y = val_to_i(vm, v, GET_ARG(4), argc);
+  s->go = xSemaphoreCreateBinary();
+  s->wait = xSemaphoreCreateBinary();
+  if (s->go == nullptr || s->wait == nullptr ||
+      xTaskCreate(image_stream_task, "img_stream", IMAGE_STREAM_TASK_STACK, s,
+                  uxTaskPriorityGet(NULL), NULL) != pdPASS) {
+    if (s->go) vSemaphoreDelete(s->go);
+    if (s->wait) vSemaphoreDelete(s->wait);
+    delete s;
+    mrbc_raise(vm, MRBC_CLASS(RuntimeError), "stream creation failed");
+    return;
+  }
+  s->next = image_stream_list;
+  image_stream_list = s;
+  d->stream = s;
+}
+
+// feed(str): decodes the block and returns once the decoder has used all of
+// it; false if the decoder had already stopped (done or failed)
+static void c_image_stream_feed(mrb_vm *vm, mrb_value *v, int argc) {
+  ImageStream *s = get_checked_data(ImageStream, vm, v);
+  if (argc < 1 || GET_ARG(1).tt != MRBC_TT_STRING) {
+    mrbc_raise(vm, MRBC_CLASS(ArgumentError), "not a string");
+    return;
+  }
+  if (s->finished) {
+    SET_FALSE_RETURN();
+    return;
+  }
+  s->src = GET_ARG(1).string->data;
+  s->src_len = GET_ARG(1).string->size;
+  s->resume();
+  s->fed += GET_ARG(1).string->size - s->src_len;
+  s->src_len = 0;  // the rest is not needed once the decoder has returned
+  SET_TRUE_RETURN();
+}
+
+// finish: marks the end of data, lets the decoder return and releases it.
+// Returns the decode result.
+static void c_image_stream_finish(mrb_vm *vm, mrb_value *v, int argc) {
+  ImageStream *s = get_checked_data(ImageStream, vm, v);
+  s->abort();
+
+  struct image_stream_data *d = (struct image_stream_data *)v->instance->data;
+  d->result = s->result;
+  d->bytes = s->fed;
+  d->peak = sizeof(ImageStream) + IMAGE_STREAM_TASK_STACK + s->held_peak;
+  d->stack_used = s->stack_used;
+  d->elapsed_us = s->elapsed_us;
+  image_stream_free(s);
+  put_null_data(v);
+  SET_BOOL_RETURN(d->result);
+}
+
+// stats: [decode time in us, bytes fed, peak bytes used by this stream
+// (the stream, its decoder stack and the decoder work area), decoder stack
+// bytes actually used]
+static void c_image_stream_stats(mrb_vm *vm, mrb_value *v, int argc) {
+  struct image_stream_data *d = (struct image_stream_data *)v->instance->data;
+  mrbc_value ret = mrbc_array_new(vm, 4);
+  mrbc_value us = mrbc_fixnum_value(d->elapsed_us);
+  mrbc_value bytes = mrbc_fixnum_value(d->bytes);
+  mrbc_value peak = mrbc_fixnum_value(d->peak);
+  mrbc_array_set(&ret, 0, &us);
+  mrbc_array_set(&ret, 1, &bytes);
+  mrbc_value stack = mrbc_fixnum_value(d->stack_used);
+  mrbc_array_set(&ret, 2, &peak);
+  mrbc_array_set(&ret, 3, &stack);
+  SET_RETURN(ret);
+}
+
+void class_image_stream_init() {
+  // streams left by the previous VM: their Ruby objects are gone
+  while (image_stream_list != nullptr) image_stream_free(image_stream_list);
+
+  image_stream_class = mrbc_define_class(0, "ImageStream", mrbc_class_object);
+  mrbc_define_method(0, image_stream_class, "new", c_image_stream_new);
+  mrbc_define_method(0, image_stream_class, "initialize",
+                     c_image_stream_initialize);
+  mrbc_define_method(0, image_stream_class, "feed", c_image_stream_feed);
+  mrbc_define_method(0, image_stream_class, "finish", c_image_stream_finish);
+  mrbc_define_method(0, image_stream_class, "stats", c_image_stream_stats);
+}
+
+#endif  // USE_IMAGE_STREAM
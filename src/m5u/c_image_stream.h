@@ -0,0 +1,6 @@
+extern "C" {
+    void class_image_stream_init();
+}
+
+// stops the streams drawing into a Canvas that is about to be deleted
+void image_stream_drop_target(LovyanGFX *dst);
@@ -1,9 +1,13 @@
 
 #include <M5Unified.h>
 
+#include "../drv/input.h"
 #include "my_mrubydef.h"
 
-static void class_m5_update(mrb_vm *vm, mrb_value *v, int argc) { M5.update(); }
+// shares M5.update() with the Input sampler task
+static void class_m5_update(mrb_vm *vm, mrb_value *v, int argc) {
+  drv_input_update();
+}
 
 static void  // see definition of "enum board_t" in M5GFX/src/lgfx/boards.hpp
 class_m5_board(mrb_vm *vm, mrb_value *v, int argc) {
@@ -4,7 +4,10 @@
 
 #include "c_canvas.h"
 #include "c_display_button.h"
+#include "c_display_list.h"
 #include "c_font.h"
+#include "c_image_cache.h"
+#include "c_image_stream.h"
 #include "c_m5.h"
 #include "c_speaker.h"
 #include "c_touch.h"
@@ -21,6 +24,15 @@ void init_c_m5u() {
 #ifdef USE_CANVAS
   class_canvas_init();
 #endif
+#ifdef USE_DISPLAY_LIST
+  class_display_list_init();
+#endif
+#ifdef USE_IMAGE_STREAM
+  class_image_stream_init();
+#endif
+#ifdef USE_IMAGE_CACHE
+  class_image_cache_init();
+#endif
 #ifdef USE_SPEAKER
   class_speaker_init();
 #endif
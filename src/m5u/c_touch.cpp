@@ -1,21 +1,31 @@
 #include <M5Unified.h>
 #include "my_mrubydef.h"
 #include "c_touch.h"
+#include "../drv/input.h"
+
+// The Input sampler task may be running M5.update(), which rewrites the
+// touch state, so every read below holds drv_input_lock().
 
 #ifdef USE_TOUCH
 
 static void
 class_touch_get_count(mrb_vm *vm, mrb_value *v, int argc)
 {
-    SET_INT_RETURN(M5.Touch.getCount());
+    drv_input_lock();
+    int count = M5.Touch.getCount();
+    drv_input_unlock();
+    SET_INT_RETURN(count);
 }
 
 static void
 class_touch_get_detail(mrb_vm *vm, mrb_value *v, int argc)
 {
     int no = (argc>0)? GET_INT_ARG(1) : 0;
-    if(no<M5.Touch.getCount()){
-        auto detail = M5.Touch.getDetail(no);
+    drv_input_lock();
+    bool found = no<M5.Touch.getCount();
+    auto detail = M5.Touch.getDetail(found? no : 0);
+    drv_input_unlock();
+    if(found){
         mrb_value ret = mrbc_array_new(vm, 5);
         mrb_value a[5];
         a[0] = mrbc_integer_value(detail.x);
@@ -37,49 +47,53 @@ class_touch_get_detail(mrb_vm *vm, mrb_value *v, int argc)
 static void class_touch_wasclicked(mrb_vm *vm, mrb_value *v, int argc)
 {
     int no = (argc>0)? val_to_i(vm,v,GET_ARG(1),argc) : 0;
-    if(no<M5.Touch.getCount()){
-        if(M5.Touch.getDetail(no).wasClicked()){  
-            SET_TRUE_RETURN();
-            return;
-        }
+    drv_input_lock();
+    bool ret = no<M5.Touch.getCount() && M5.Touch.getDetail(no).wasClicked();
+    drv_input_unlock();
+    if(ret){
+        SET_TRUE_RETURN();
+    } else {
+        SET_FALSE_RETURN();
     }
-    SET_FALSE_RETURN();
 }
 
 static void class_touch_ispressed(mrb_vm *vm, mrb_value *v, int argc)
 {
     int no = (argc>0)? val_to_i(vm,v,GET_ARG(1),argc)  : 0;
-    if(no<M5.Touch.getCount()){
-        if(M5.Touch.getDetail(no).isPressed()){
-            SET_TRUE_RETURN();
-            return;
-        }
+    drv_input_lock();
+    bool ret = no<M5.Touch.getCount() && M5.Touch.getDetail(no).isPressed();
+    drv_input_unlock();
+    if(ret){
+        SET_TRUE_RETURN();
+    } else {
+        SET_FALSE_RETURN();
     }
-    SET_FALSE_RETURN();
 }
 
 static void class_touch_isreleased(mrb_vm *vm, mrb_value *v, int argc)
 {
     int no = (argc>0)?  val_to_i(vm,v,GET_ARG(1),argc)  : 0;
-    if(no<M5.Touch.getCount()){
-        if(M5.Touch.getDetail(no).isReleased()){
-            SET_TRUE_RETURN();
-            return;
-        }
+    drv_input_lock();
+    bool ret = no<M5.Touch.getCount() && M5.Touch.getDetail(no).isReleased();
+    drv_input_unlock();
+    if(ret){
+        SET_TRUE_RETURN();
+    } else {
+        SET_FALSE_RETURN();
     }
-    SET_FALSE_RETURN();
 }
 
 static void class_touch_isholding(mrb_vm *vm, mrb_value *v, int argc)
 {
     int no = (argc>0)?  val_to_i(vm,v,GET_ARG(1),argc)  : 0;
-    if(no<M5.Touch.getCount()){
-        if(M5.Touch.getDetail(no).isHolding()){
-            SET_TRUE_RETURN();
-            return;
-        }
+    drv_input_lock();
+    bool ret = no<M5.Touch.getCount() && M5.Touch.getDetail(no).isHolding();
+    drv_input_unlock();
+    if(ret){
+        SET_TRUE_RETURN();
+    } else {
+        SET_FALSE_RETURN();
     }
-    SET_FALSE_RETURN();
 }
 
 
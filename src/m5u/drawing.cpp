@@ -6,7 +6,11 @@
 
 #include <M5Unified.h>
 
+#include "../api/typed_array.h"
 #include "my_mrubydef.h"
+#ifdef USE_IMAGE_CACHE
+#include "c_image_cache.h"
+#endif
 
 void draw_set_text_size(LovyanGFX *dst, mrb_vm *vm, mrb_value *v, int argc) {
   if (argc > 0) {
@@ -164,6 +168,35 @@ void draw_draw_circle(LovyanGFX *dst, mrb_vm *vm, mrb_value *v, int argc) {
   }
 }
 
+// draw_points(points, color): points is an Int16Array or Array of
+// x0, y0, x1, y1, ... pairs. An Int16Array is read in place.
+void draw_draw_points(LovyanGFX *dst, mrb_vm *vm, mrb_value *v, int argc) {
+  if (argc < 2) {
+    SET_FALSE_RETURN();
+    return;
+  }
+  int color = val_to_i(vm, v, GET_ARG(2), argc);
+  int n;
+  const int16_t *xy = typed_array_int16(&GET_ARG(1), &n);
+  dst->startWrite();
+  if (xy != nullptr) {
+    for (int i = 0; i + 1 < n; i += 2) {
+      dst->drawPixel(xy[i], xy[i + 1], color);
+    }
+  } else if (GET_ARG(1).tt == MRBC_TT_ARRAY) {
+    n = mrbc_array_size(&GET_ARG(1));
+    for (int i = 0; i + 1 < n; i += 2) {
+      mrbc_value x = mrbc_array_get(&GET_ARG(1), i);
+      mrbc_value y = mrbc_array_get(&GET_ARG(1), i + 1);
+      if (x.tt == MRBC_TT_INTEGER && y.tt == MRBC_TT_INTEGER) {
+        dst->drawPixel(x.i, y.i, color);
+      }
+    }
+  }
+  dst->endWrite();
+  SET_TRUE_RETURN();
+}
+
 #ifdef USE_FILE_FUNCTION
 
 static void draw_draw_pic_file(LovyanGFX *dst, draw_pic_type t, mrb_vm *vm,
@@ -202,6 +235,7 @@ void draw_draw_png(LovyanGFX *dst, mrb_vm *vm, mrb_value *v, int argc) {
 
 #endif  // USE_FILE_FUNCTION
 
+#ifndef USE_IMAGE_CACHE
 static void draw_draw_pic_mem(LovyanGFX *dst, draw_pic_type t, const uint8_t * mem, size_t memsize, int x, int y){
   switch(t){
       case bmp:
@@ -215,6 +249,7 @@ static void draw_draw_pic_mem(LovyanGFX *dst, draw_pic_type t, const uint8_t * m
           break;
   }
 }
+#endif  // USE_IMAGE_CACHE
 void draw_draw_pic_str(LovyanGFX *dst, draw_pic_type t, mrb_vm *vm, mrb_value *v, int argc)
 {
     if(argc<3){
@@ -232,7 +267,11 @@ void draw_draw_pic_str(LovyanGFX *dst, draw_pic_type t, mrb_vm *vm, mrb_value *v
     int x = val_to_i(vm, v, GET_ARG(2),argc);
     int y = val_to_i(vm, v, GET_ARG(3),argc);
 
+#ifdef USE_IMAGE_CACHE
+    image_cache_draw(dst, t, mem, memsize, x, y);
+#else
     draw_draw_pic_mem(dst,t, mem, memsize,x,y);
+#endif
     
     SET_TRUE_RETURN();
 }
@@ -17,6 +17,7 @@ void draw_draw_rect(LovyanGFX *dst, mrb_vm *vm, mrb_value *v, int argc);
 void draw_draw_line(LovyanGFX *dst, mrb_vm *vm, mrb_value *v, int argc);
 void draw_flll_circle(LovyanGFX *dst, mrb_vm *vm, mrb_value *v, int argc);
 void draw_draw_circle(LovyanGFX *dst, mrb_vm *vm, mrb_value *v, int argc);
+void draw_draw_points(LovyanGFX *dst, mrb_vm *vm, mrb_value *v, int argc);
 void draw_draw_bmpstr(LovyanGFX *dst, mrb_vm *vm, mrb_value *v, int argc);
 void draw_draw_jpgstr(LovyanGFX *dst, mrb_vm *vm, mrb_value *v, int argc);
 void draw_draw_pngstr(LovyanGFX *dst, mrb_vm *vm, mrb_value *v, int argc);
@@ -9,8 +9,12 @@
 #define USE_DISPLAY_GRAPHICS  // Display to support graphics functions
 #define USE_SPEAKER           // to support Speaker functions
 #define USE_CANVAS            // to support Canvas functions
+#define USE_DISPLAY_LIST      // to support DisplayList (recorded drawing)
+#define USE_IMAGE_STREAM      // to support ImageStream (chunked image decode)
+#define USE_IMAGE_CACHE       // cache decoded images drawn by draw_*str
 #define USE_TOUCH
 #define USE_FONT
+// #define USE_LGFX_BUILTIN_FONTS  // register all LovyanGFX built-in fonts in Font
 #define USE_MOTOR  // to support Motor functions
 
 #include "c_m5.h"
@@ -17,14 +17,18 @@
 #include <stdlib.h>
 
 #include "api/blink.h"
+#include "api/fastmath.h"
 #include "api/input.h"
 #include "api/led.h"
 #include "api/pwm.h"
+#include "api/typed_array.h"
 #include "api/uart.h"
+#include "api/uart_packet.h"
 #include "app/blink.h"
 #include "app/init.h"
 // #include "driver/gpio.h"
 #include "drv/ble_blink.h"
+#include "drv/pwm.h"
 #include "esp_task_wdt.h"
 #include "lib/fn.h"
 #include "mrubyc.h"
@@ -92,6 +96,9 @@ void app_main() {
     api_blink_define();  // Blink.*
     api_pwm_define();    // PWM.*
     api_uart_define();   // UART.*
+    api_uart_packet_define();  // UART::Packet
+    api_fastmath_define();  // FastMath.*
+    api_typed_array_define();  // Int16Array, Float32Array
 
     init_c_m5u();  // for features in m5u directory
 
@@ -123,6 +130,7 @@ void app_main() {
 
     ble_print("mruby/c finished");
     mrbc_cleanup();
+    drv_pwm_release_all();  // PWM channels the script left open
     request_mruby_reload = false;
 
     // Reset WDT before the end of loop
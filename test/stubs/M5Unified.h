@@ -0,0 +1,53 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+// Host stub of the M5Unified and LovyanGFX headers, see test/stubs/README.
+// Only the members the code under test uses are declared.
+#pragma once
+
+#include <stdint.h>
+
+namespace lgfx {
+inline namespace v1 {
+
+struct DataWrapper {
+  virtual ~DataWrapper() = default;
+  bool need_transaction = false;
+  virtual int read(uint8_t *buf, uint32_t len) = 0;
+  virtual void skip(int32_t offset) = 0;
+  virtual bool seek(uint32_t offset) = 0;
+  virtual void close(void) = 0;
+  virtual int32_t tell(void) = 0;
+};
+
+}  // namespace v1
+}  // namespace lgfx
+
+class LovyanGFX {
+ public:
+  bool drawBmp(lgfx::DataWrapper *data, int32_t x, int32_t y);
+  bool drawJpg(lgfx::DataWrapper *data, int32_t x, int32_t y);
+  bool drawPng(lgfx::DataWrapper *data, int32_t x, int32_t y);
+};
+
+class M5Canvas : public LovyanGFX {};
+
+namespace m5 {
+
+class Button_Class {
+ public:
+  bool isPressed(void) const;
+  bool wasPressed(void) const;
+};
+
+class M5Unified {
+ public:
+  LovyanGFX Display;
+  Button_Class BtnA, BtnB, BtnC;
+  void update(void);
+};
+
+}  // namespace m5
+
+extern m5::M5Unified M5;
@@ -0,0 +1,20 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+// Host stub of the ESP-IDF header, see test/stubs/README
+#pragma once
+
+#include "esp_err.h"
+
+typedef int gpio_num_t;
+
+typedef enum {
+  GPIO_MODE_INPUT = 1,
+  GPIO_MODE_OUTPUT = 2,
+} gpio_mode_t;
+
+#define GPIO_NUM_NC (-1)
+
+void gpio_reset_pin(gpio_num_t gpio_num);
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode);
@@ -0,0 +1,90 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+// Host stub of the ESP-IDF header, see test/stubs/README
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "driver/gpio.h"
+#include "esp_err.h"
+
+typedef enum {
+  LEDC_LOW_SPEED_MODE = 0,
+} ledc_mode_t;
+
+typedef int ledc_channel_t;
+
+typedef enum {
+  LEDC_TIMER_0 = 0,
+  LEDC_TIMER_1,
+  LEDC_TIMER_2,
+  LEDC_TIMER_3,
+  LEDC_TIMER_MAX,
+} ledc_timer_t;
+
+typedef enum {
+  LEDC_AUTO_CLK = 0,
+} ledc_clk_cfg_t;
+
+typedef enum {
+  LEDC_FADE_NO_WAIT = 0,
+  LEDC_FADE_WAIT_DONE,
+} ledc_fade_mode_t;
+
+typedef struct {
+  ledc_mode_t speed_mode;
+  int timer_num;
+  int duty_resolution;
+  uint32_t freq_hz;
+  ledc_clk_cfg_t clk_cfg;
+} ledc_timer_config_t;
+
+typedef struct {
+  int gpio_num;
+  ledc_mode_t speed_mode;
+  ledc_channel_t channel;
+  int timer_sel;
+  uint32_t duty;
+  int hpoint;
+} ledc_channel_config_t;
+
+typedef enum {
+  LEDC_FADE_END_EVT = 0,
+} ledc_cb_event_t;
+
+typedef struct {
+  ledc_cb_event_t event;
+  uint32_t speed_mode;
+  uint32_t channel;
+  uint32_t duty;
+} ledc_cb_param_t;
+
+typedef bool (*ledc_cb_t)(const ledc_cb_param_t *param, void *user_arg);
+
+typedef struct {
+  ledc_cb_t fade_cb;
+} ledc_cbs_t;
+
+esp_err_t ledc_timer_config(const ledc_timer_config_t *timer_conf);
+esp_err_t ledc_channel_config(const ledc_channel_config_t *ledc_conf);
+esp_err_t ledc_bind_channel_timer(ledc_mode_t speed_mode,
+                                  ledc_channel_t channel, int timer_sel);
+esp_err_t ledc_set_duty(ledc_mode_t speed_mode, ledc_channel_t channel,
+                        uint32_t duty);
+esp_err_t ledc_update_duty(ledc_mode_t speed_mode, ledc_channel_t channel);
+esp_err_t ledc_stop(ledc_mode_t speed_mode, ledc_channel_t channel,
+                    uint32_t idle_level);
+esp_err_t ledc_timer_pause(ledc_mode_t speed_mode, int timer_sel);
+esp_err_t ledc_timer_resume(ledc_mode_t speed_mode, int timer_sel);
+esp_err_t ledc_fade_func_install(int intr_alloc_flags);
+esp_err_t ledc_cb_register(ledc_mode_t speed_mode, ledc_channel_t channel,
+                           ledc_cbs_t *cbs, void *user_arg);
+esp_err_t ledc_set_fade_with_time(ledc_mode_t speed_mode,
+                                  ledc_channel_t channel,
+                                  uint32_t target_duty, int max_fade_time_ms);
+esp_err_t ledc_fade_start(ledc_mode_t speed_mode, ledc_channel_t channel,
+                          ledc_fade_mode_t fade_mode);
+esp_err_t ledc_fade_stop(ledc_mode_t speed_mode, ledc_channel_t channel);
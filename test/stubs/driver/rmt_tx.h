@@ -0,0 +1,81 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+// Host stub of the ESP-IDF header, see test/stubs/README
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+typedef union {
+  struct {
+    uint16_t duration0 : 15;
+    uint16_t level0 : 1;
+    uint16_t duration1 : 15;
+    uint16_t level1 : 1;
+  };
+  uint32_t val;
+} rmt_symbol_word_t;
+
+typedef struct rmt_channel_t *rmt_channel_handle_t;
+typedef struct rmt_encoder_t *rmt_encoder_handle_t;
+
+#define RMT_CLK_SRC_DEFAULT 0
+
+typedef struct {
+  int gpio_num;
+  int clk_src;
+  uint32_t resolution_hz;
+  size_t mem_block_symbols;
+  size_t trans_queue_depth;
+} rmt_tx_channel_config_t;
+
+typedef size_t (*rmt_encode_simple_cb_t)(const void *data, size_t data_size,
+                                         size_t symbols_written,
+                                         size_t symbols_free,
+                                         rmt_symbol_word_t *symbols,
+                                         bool *done, void *arg);
+
+typedef struct {
+  rmt_encode_simple_cb_t callback;
+  void *arg;
+  size_t min_chunk_size;
+} rmt_simple_encoder_config_t;
+
+typedef struct {
+  int loop_count;
+} rmt_transmit_config_t;
+
+typedef struct {
+  size_t num_symbols;
+} rmt_tx_done_event_data_t;
+
+typedef bool (*rmt_tx_done_callback_t)(rmt_channel_handle_t tx_chan,
+                                       const rmt_tx_done_event_data_t *edata,
+                                       void *user_ctx);
+
+typedef struct {
+  rmt_tx_done_callback_t on_trans_done;
+} rmt_tx_event_callbacks_t;
+
+esp_err_t rmt_new_tx_channel(const rmt_tx_channel_config_t *config,
+                             rmt_channel_handle_t *ret_chan);
+esp_err_t rmt_new_simple_encoder(const rmt_simple_encoder_config_t *config,
+                                 rmt_encoder_handle_t *ret_encoder);
+esp_err_t rmt_tx_register_event_callbacks(rmt_channel_handle_t tx_channel,
+                                          const rmt_tx_event_callbacks_t *cbs,
+                                          void *user_data);
+esp_err_t rmt_enable(rmt_channel_handle_t channel);
+esp_err_t rmt_disable(rmt_channel_handle_t channel);
+esp_err_t rmt_del_channel(rmt_channel_handle_t channel);
+esp_err_t rmt_del_encoder(rmt_encoder_handle_t encoder);
+esp_err_t rmt_transmit(rmt_channel_handle_t tx_channel,
+                       rmt_encoder_handle_t encoder, const void *payload,
+                       size_t payload_bytes,
+                       const rmt_transmit_config_t *config);
+esp_err_t rmt_tx_wait_all_done(rmt_channel_handle_t tx_channel,
+                               int timeout_ms);
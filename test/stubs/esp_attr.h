@@ -0,0 +1,8 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+// Host stub of the ESP-IDF header, see test/stubs/README
+#pragma once
+
+#define IRAM_ATTR
@@ -0,0 +1,22 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+// Host stub of the ESP-IDF header, see test/stubs/README
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct QueueDefinition *QueueHandle_t;
+
+QueueHandle_t xQueueCreate(uint32_t length, uint32_t item_size);
+void vQueueDelete(QueueHandle_t queue);
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item,
+                      TickType_t wait);
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t wait);
+uint32_t uxQueueMessagesWaiting(QueueHandle_t queue);
+BaseType_t xQueueReset(QueueHandle_t queue);
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item,
+                             BaseType_t *woken);
+BaseType_t xQueueReceiveFromISR(QueueHandle_t queue, void *item,
+                                BaseType_t *woken);
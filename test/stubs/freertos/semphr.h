@@ -0,0 +1,16 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+// Host stub of the ESP-IDF header, see test/stubs/README
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct SemaphoreDefinition *SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+void vSemaphoreDelete(SemaphoreHandle_t sem);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t wait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
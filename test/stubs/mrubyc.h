@@ -0,0 +1,167 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+// Host stub of the mruby/c header, see test/stubs/README. The value layout
+// is cut down to the fields the bindings under test read.
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef int64_t mrbc_int_t;  // MRBC_INT64
+typedef double mrbc_float_t;
+typedef int16_t mrbc_sym;
+
+typedef enum {
+  MRBC_TT_EMPTY = 0,
+  MRBC_TT_NIL,
+  MRBC_TT_FALSE,
+  MRBC_TT_TRUE,
+  MRBC_TT_INTEGER,
+  MRBC_TT_FLOAT,
+  MRBC_TT_SYMBOL,
+  MRBC_TT_CLASS,
+  MRBC_TT_OBJECT,
+  MRBC_TT_PROC,
+  MRBC_TT_ARRAY,
+  MRBC_TT_STRING,
+  MRBC_TT_RANGE,
+  MRBC_TT_HASH,
+} mrbc_vtype;
+#define MRBC_TT_FIXNUM MRBC_TT_INTEGER
+
+typedef struct RClass {
+  const char *name;
+  struct RClass *super;
+} mrbc_class;
+
+typedef struct RInstance {
+  mrbc_class *cls;
+  uint8_t data[];
+} mrbc_instance;
+
+typedef struct RString {
+  uint16_t size;
+  uint8_t *data;
+} mrbc_string;
+
+typedef struct RArray {
+  uint16_t n_stored;
+  struct RObject *data;
+} mrbc_array;
+
+typedef struct RObject {
+  mrbc_vtype tt;
+  union {
+    mrbc_int_t i;
+    mrbc_float_t d;
+    mrbc_class *cls;
+    mrbc_instance *instance;
+    mrbc_string *string;
+    mrbc_array *array;
+  };
+} mrbc_value;
+
+typedef struct VM {
+  int id;
+} mrbc_vm;
+
+typedef struct RTcb {
+  mrbc_vm vm;
+  bool suspended;
+} mrbc_tcb;
+
+typedef mrbc_vm mrb_vm;
+typedef mrbc_value mrb_value;
+typedef mrbc_class mrb_class;
+typedef void (*mrbc_func_t)(mrbc_vm *vm, mrbc_value *v, int argc);
+
+extern mrbc_class mrbc_class_Object;
+extern mrbc_class mrbc_class_ArgumentError;
+extern mrbc_class mrbc_class_RuntimeError;
+extern mrbc_class mrbc_class_IndexError;
+extern mrbc_class mrbc_class_TypeError;
+#define mrbc_class_object (&mrbc_class_Object)
+#define MRBC_CLASS(cls) (&mrbc_class_##cls)
+
+#define VM2TCB(p) ((mrbc_tcb *)(p))
+
+#define GET_ARG(n) v[(n)]
+#define SET_RETURN(n) \
+  do {                \
+    v[0] = (n);       \
+  } while (0)
+#define SET_NIL_RETURN() \
+  do {                   \
+    v[0].tt = MRBC_TT_NIL; \
+  } while (0)
+#define SET_FALSE_RETURN() \
+  do {                     \
+    v[0].tt = MRBC_TT_FALSE; \
+  } while (0)
+#define SET_TRUE_RETURN() \
+  do {                    \
+    v[0].tt = MRBC_TT_TRUE; \
+  } while (0)
+#define SET_BOOL_RETURN(n)                           \
+  do {                                               \
+    v[0].tt = (n) ? MRBC_TT_TRUE : MRBC_TT_FALSE;    \
+  } while (0)
+#define SET_INT_RETURN(n)    \
+  do {                       \
+    v[0].tt = MRBC_TT_INTEGER; \
+    v[0].i = (n);            \
+  } while (0)
+#define SET_FLOAT_RETURN(n) \
+  do {                      \
+    v[0].tt = MRBC_TT_FLOAT; \
+    v[0].d = (n);           \
+  } while (0)
+
+mrbc_class *mrbc_define_class(mrbc_vm *vm, const char *name,
+                              mrbc_class *super);
+mrbc_class *mrbc_define_class_under(mrbc_vm *vm, const mrbc_class *outer,
+                                    const char *name, mrbc_class *super);
+void mrbc_define_method(mrbc_vm *vm, mrbc_class *cls, const char *name,
+                        mrbc_func_t func);
+mrbc_class *mrbc_get_class_by_name(const char *name);
+int mrbc_obj_is_kind_of(const mrbc_value *obj, const mrbc_class *cls);
+void mrbc_raise(mrbc_vm *vm, mrbc_class *exc_cls, const char *msg);
+
+mrbc_value mrbc_instance_new(mrbc_vm *vm, mrbc_class *cls, int size);
+void mrbc_instance_call_initialize(mrbc_vm *vm, mrbc_value *v, int argc);
+mrbc_value mrbc_send(mrbc_vm *vm, mrbc_value *v, int reg_ofs,
+                     mrbc_value *recv, const char *method_name, int argc,
+                     ...);
+void mrbc_decref(mrbc_value *v);
+
+// value constructors are inline in mruby/c too
+static inline mrbc_value mrbc_integer_value(mrbc_int_t n) {
+  mrbc_value v;
+  v.tt = MRBC_TT_INTEGER;
+  v.i = n;
+  return v;
+}
+#define mrbc_fixnum_value(n) mrbc_integer_value(n)
+static inline mrbc_value mrbc_float_value(mrbc_vm *vm, mrbc_float_t n) {
+  mrbc_value v;
+  v.tt = MRBC_TT_FLOAT;
+  v.d = n;
+  return v;
+}
+static inline mrbc_value mrbc_bool_value(int n) {
+  mrbc_value v;
+  v.tt = n ? MRBC_TT_TRUE : MRBC_TT_FALSE;
+  v.i = 0;
+  return v;
+}
+mrbc_value mrbc_array_new(mrbc_vm *vm, int size);
+int mrbc_array_set(mrbc_value *ary, int idx, mrbc_value *set_val);
+mrbc_value mrbc_string_new(mrbc_vm *vm, const void *src, int len);
+int mrbc_string_size(const mrbc_value *str);
+
+void mrbc_suspend_task(mrbc_tcb *tcb);
+void mrbc_resume_task(mrbc_tcb *tcb);
+void hal_disable_irq(void);
+void hal_enable_irq(void);
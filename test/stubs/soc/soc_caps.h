@@ -0,0 +1,11 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+// Host stub of the ESP-IDF header, ESP32 values, see test/stubs/README
+#pragma once
+
+#define SOC_RMT_TX_CANDIDATES_PER_GROUP 4
+#define SOC_RMT_MEM_WORDS_PER_CHANNEL 48
+#define SOC_LEDC_TIMER_BIT_WIDTH 20
+// no SOC_LEDC_SUPPORT_FADE_STOP: the ESP32 cannot stop a fade
@@ -0,0 +1,181 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file test_main.c
+ * @brief COBS and UART::Packet framing tests
+ *
+ * Frames are built the way UART::Packet builds them: COBS(payload +
+ * CRC-16/MODBUS, low byte first) followed by a zero byte, and checked the
+ * way it checks them, decoding in place and running the CRC over payload
+ * and CRC together. Random payloads of 0-256 bytes must come back
+ * unchanged, and every single-bit corruption of a frame must be rejected.
+ * Framing a 64-byte payload and checking it is timed.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unity.h>
+
+#include "lib/cobs/cobs.h"
+#include "lib/crc/crc.h"
+
+#define CRC_POLY 0xA001U  // CRC-16/MODBUS, reflected
+#define CRC_SEED 0xFFFFU
+#define MAX_PAYLOAD 256
+#define FRAME_SIZE (COBS_MAX_ENCODED(MAX_PAYLOAD + 2) + 1)
+#define ROUND_TRIPS 20000
+#define CORRUPT_FRAMES 100
+#define BENCH_ROUNDS 200000
+
+static double now_s(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// UART::Packet#write without the driver: returns the frame length
+static size_t frame(const uint8_t *payload, size_t len, uint8_t *tx) {
+  uint8_t raw[MAX_PAYLOAD + 2];
+  memcpy(raw, payload, len);
+  uint16_t crc = crc16_reflect(CRC_POLY, CRC_SEED, raw, len);
+  raw[len] = crc & 0xFF;
+  raw[len + 1] = crc >> 8;
+  size_t n = cobs_encode(raw, len + 2, tx);
+  tx[n++] = 0;
+  return n;
+}
+
+// UART::Packet's packet_decode on a frame without its delimiter: returns
+// the payload length, left at the start of buf, or -1
+static int unframe(uint8_t *buf, size_t len) {
+  size_t out;
+  if (!cobs_decode(buf, len, buf, &out) || out < 2) return -1;
+  if (crc16_reflect(CRC_POLY, CRC_SEED, buf, out) != 0) return -1;
+  return (int)(out - 2);
+}
+
+// zeros are frequent in binary protocols, so one byte in four is zero
+static void random_payload(uint8_t *dst, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    dst[i] = rand() % 4 == 0 ? 0 : (uint8_t)rand();
+  }
+}
+
+void setUp(void) { srand(1); }
+
+void tearDown(void) {}
+
+static void test_known_vectors(void) {
+  static const struct {
+    uint8_t src[8];
+    size_t len;
+    uint8_t enc[8];
+    size_t enc_len;
+  } vectors[] = {
+      {{0x00}, 1, {0x01, 0x01}, 2},
+      {{0x00, 0x00}, 2, {0x01, 0x01, 0x01}, 3},
+      {{0x11, 0x22, 0x00, 0x33}, 4, {0x03, 0x11, 0x22, 0x02, 0x33}, 5},
+      {{0x11, 0x00, 0x00, 0x00}, 4, {0x02, 0x11, 0x01, 0x01, 0x01}, 5},
+      {{0}, 0, {0x01}, 1},
+  };
+  for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+    uint8_t enc[16];
+    size_t n = cobs_encode(vectors[i].src, vectors[i].len, enc);
+    TEST_ASSERT_EQUAL(vectors[i].enc_len, n);
+    TEST_ASSERT_EQUAL_MEMORY(vectors[i].enc, enc, n);
+
+    size_t out;
+    TEST_ASSERT_TRUE(cobs_decode(enc, n, enc, &out));
+    TEST_ASSERT_EQUAL(vectors[i].len, out);
+    if (out > 0) TEST_ASSERT_EQUAL_MEMORY(vectors[i].src, enc, out);
+  }
+}
+
+static void test_long_runs_use_full_blocks(void) {
+  uint8_t src[600], enc[COBS_MAX_ENCODED(600)];
+  for (size_t i = 0; i < sizeof(src); i++) src[i] = (uint8_t)(i % 255 + 1);
+  size_t n = cobs_encode(src, sizeof(src), enc);
+  TEST_ASSERT_EQUAL(COBS_MAX_ENCODED(sizeof(src)), n);
+  TEST_ASSERT_EQUAL_HEX8(0xFF, enc[0]);
+  TEST_ASSERT_NULL(memchr(enc, 0, n));
+
+  size_t out;
+  TEST_ASSERT_TRUE(cobs_decode(enc, n, enc, &out));
+  TEST_ASSERT_EQUAL(sizeof(src), out);
+  TEST_ASSERT_EQUAL_MEMORY(src, enc, out);
+}
+
+static void test_invalid_blocks_rejected(void) {
+  size_t out;
+  uint8_t buf[8];
+  // a zero byte inside the block
+  memcpy(buf, "\x03\x11\x00\x01", 4);
+  TEST_ASSERT_FALSE(cobs_decode(buf, 4, buf, &out));
+  // a code running past the end
+  memcpy(buf, "\x05\x11\x22", 3);
+  TEST_ASSERT_FALSE(cobs_decode(buf, 3, buf, &out));
+  // a zero code
+  memcpy(buf, "\x00", 1);
+  TEST_ASSERT_FALSE(cobs_decode(buf, 1, buf, &out));
+}
+
+static void test_random_round_trips(void) {
+  uint8_t payload[MAX_PAYLOAD], tx[FRAME_SIZE];
+  for (int i = 0; i < ROUND_TRIPS; i++) {
+    size_t len = rand() % (MAX_PAYLOAD + 1);
+    random_payload(payload, len);
+    size_t n = frame(payload, len, tx);
+    TEST_ASSERT_LESS_OR_EQUAL(FRAME_SIZE, n);
+    TEST_ASSERT_EQUAL_HEX8(0, tx[n - 1]);
+    TEST_ASSERT_NULL(memchr(tx, 0, n - 1));  // the only zero delimits
+    TEST_ASSERT_EQUAL(len, unframe(tx, n - 1));
+    if (len > 0) TEST_ASSERT_EQUAL_MEMORY(payload, tx, len);
+  }
+}
+
+static void test_single_bit_corruptions_rejected(void) {
+  uint8_t payload[MAX_PAYLOAD], tx[FRAME_SIZE], buf[FRAME_SIZE];
+  int checked = 0;
+  for (int f = 0; f < CORRUPT_FRAMES; f++) {
+    size_t len = 1 + rand() % 48;
+    random_payload(payload, len);
+    size_t n = frame(payload, len, tx) - 1;  // without the delimiter
+    for (size_t bit = 0; bit < n * 8; bit++) {
+      memcpy(buf, tx, n);
+      buf[bit / 8] ^= 1 << (bit % 8);
+      TEST_ASSERT_EQUAL(-1, unframe(buf, n));
+      checked++;
+    }
+  }
+  printf("%d single-bit corruptions, all rejected\n", checked);
+}
+
+static void test_bench_64_byte_frame(void) {
+  uint8_t payload[64], tx[FRAME_SIZE];
+  random_payload(payload, sizeof(payload));
+  volatile int sink = 0;
+  double t = now_s();
+  for (int i = 0; i < BENCH_ROUNDS; i++) {
+    payload[0] = (uint8_t)i;
+    size_t n = frame(payload, sizeof(payload), tx);
+    sink += unframe(tx, n - 1);
+  }
+  t = now_s() - t;
+  TEST_ASSERT_EQUAL(64 * BENCH_ROUNDS, sink);
+  printf("64-byte payload: frame + check %.2f us\n", t / BENCH_ROUNDS * 1e6);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_known_vectors);
+  RUN_TEST(test_long_runs_use_full_blocks);
+  RUN_TEST(test_invalid_blocks_rejected);
+  RUN_TEST(test_random_round_trips);
+  RUN_TEST(test_single_bit_corruptions_rejected);
+  RUN_TEST(test_bench_64_byte_frame);
+  return UNITY_END();
+}
@@ -0,0 +1,145 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file test_main.c
+ * @brief FastMath accuracy and speed against libm
+ *
+ * The float functions must stay within the 3e-5 documented in fastmath.h,
+ * the fixed-point ones within 2 units. The timings compare with libm in
+ * double precision, which runs in hardware on the host but in software on
+ * the ESP32, so they only show the host side of the trade.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+#include <unity.h>
+
+#include "lib/fastmath/fastmath.h"
+
+#define FLOAT_TOLERANCE 3e-5
+#define BENCH_CALLS 1000000
+
+static double now_s(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static void test_sin_cos(void) {
+  double max_sin = 0, max_cos = 0;
+  for (int i = -200000; i <= 200000; i++) {
+    double x = i * 1e-4;  // about three turns each way
+    max_sin = fmax(max_sin, fabs(fastmath_sinf(x) - sin(x)));
+    max_cos = fmax(max_cos, fabs(fastmath_cosf(x) - cos(x)));
+  }
+  char msg[64];
+  snprintf(msg, sizeof(msg), "max error sin %.2e cos %.2e", max_sin, max_cos);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_TRUE(max_sin < FLOAT_TOLERANCE);
+  TEST_ASSERT_TRUE(max_cos < FLOAT_TOLERANCE);
+}
+
+static void test_sqrt(void) {
+  for (int i = 0; i <= 100000; i++) {
+    float x = i * 0.37f;
+    TEST_ASSERT_FLOAT_WITHIN(sqrt(x) * 1e-6, sqrt(x), fastmath_sqrtf(x));
+  }
+  TEST_ASSERT_FLOAT_WITHIN(0, 0, fastmath_sqrtf(-1));
+}
+
+static void test_atan2(void) {
+  double max_err = 0;
+  for (int i = -300; i <= 300; i++) {
+    for (int j = -300; j <= 300; j++) {
+      if (i == 0 && j == 0) continue;
+      double y = i * 0.37, x = j * 0.53;
+      max_err = fmax(max_err, fabs(fastmath_atan2f(y, x) - atan2(y, x)));
+    }
+  }
+  char msg[64];
+  snprintf(msg, sizeof(msg), "max error atan2 %.2e", max_err);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_TRUE(max_err < FLOAT_TOLERANCE);
+}
+
+static void test_isin_icos(void) {
+  for (int a = -2 * FASTMATH_TURN; a <= 2 * FASTMATH_TURN; a++) {
+    double rad = a * 2 * M_PI / FASTMATH_TURN;
+    TEST_ASSERT_INT_WITHIN(2, lround(FASTMATH_ONE * sin(rad)),
+                           fastmath_isin(a));
+    TEST_ASSERT_INT_WITHIN(2, lround(FASTMATH_ONE * cos(rad)),
+                           fastmath_icos(a));
+  }
+  TEST_ASSERT_EQUAL_INT(FASTMATH_ONE, fastmath_isin(FASTMATH_TURN / 4));
+}
+
+static void test_isqrt(void) {
+  for (uint32_t x = 0; x < 2000000; x += 7) {
+    uint32_t r = fastmath_isqrt(x);
+    TEST_ASSERT_TRUE((uint64_t)r * r <= x && (uint64_t)(r + 1) * (r + 1) > x);
+  }
+  const uint32_t edges[] = {0xFFFFFFFFu, 0xFFFE0001u, 0xFFFDFFFFu};
+  for (int i = 0; i < 3; i++) {
+    uint32_t r = fastmath_isqrt(edges[i]);
+    TEST_ASSERT_TRUE((uint64_t)r * r <= edges[i] &&
+                     (uint64_t)(r + 1) * (r + 1) > edges[i]);
+  }
+}
+
+static void test_iatan2(void) {
+  for (int y = -100; y <= 100; y++) {
+    for (int x = -100; x <= 100; x++) {
+      if (x == 0 && y == 0) continue;
+      double want = atan2(y, x) / (2 * M_PI) * FASTMATH_TURN;
+      double err = fabs(fastmath_iatan2(y, x) - want);
+      if (err > FASTMATH_TURN / 2) err = FASTMATH_TURN - err;  // +-180 degrees
+      TEST_ASSERT_TRUE(err <= 2);
+    }
+  }
+  TEST_ASSERT_EQUAL_INT(0, fastmath_iatan2(0, 0));
+}
+
+static void test_bench(void) {
+  volatile float sink = 0;
+  char msg[96];
+
+  double t = now_s();
+  for (int i = 0; i < BENCH_CALLS; i++) sink += fastmath_sinf(i * 1e-3f);
+  double fast = now_s() - t;
+  t = now_s();
+  for (int i = 0; i < BENCH_CALLS; i++) sink += sin(i * 1e-3);
+  double libm = now_s() - t;
+  snprintf(msg, sizeof(msg), "sin: fastmath %.1f ns, libm %.1f ns",
+           fast * 1e9 / BENCH_CALLS, libm * 1e9 / BENCH_CALLS);
+  TEST_MESSAGE(msg);
+
+  t = now_s();
+  for (int i = 0; i < BENCH_CALLS; i++) {
+    sink += fastmath_atan2f(i & 255, (i >> 8) & 255);
+  }
+  fast = now_s() - t;
+  t = now_s();
+  for (int i = 0; i < BENCH_CALLS; i++) sink += atan2(i & 255, (i >> 8) & 255);
+  libm = now_s() - t;
+  snprintf(msg, sizeof(msg), "atan2: fastmath %.1f ns, libm %.1f ns",
+           fast * 1e9 / BENCH_CALLS, libm * 1e9 / BENCH_CALLS);
+  TEST_MESSAGE(msg);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_sin_cos);
+  RUN_TEST(test_sqrt);
+  RUN_TEST(test_atan2);
+  RUN_TEST(test_isin_icos);
+  RUN_TEST(test_isqrt);
+  RUN_TEST(test_iatan2);
+  RUN_TEST(test_bench);
+  return UNITY_END();
+}
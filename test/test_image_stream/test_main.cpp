@@ -0,0 +1,437 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file test_main.cpp
+ * @brief ImageStream hand-off tests against a fake decoder
+ *
+ * The binding is built with stub mruby/c and LovyanGFX functions. The
+ * decoder task is a real thread and the FreeRTOS semaphores are built on
+ * pthreads, so feed() and the decoder really hand the block back and forth.
+ * The fake decoder reads a length byte and that many payload bytes, a few
+ * at a time, and records whether the VM side was waiting on every read.
+ *
+ * Also checked: truncated and surplus data, a Canvas destroyed mid-stream
+ * and the release of unfinished streams when the VM reloads.
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unity.h>
+
+#include "freertos/task.h"  // M5Unified brings it in on the device
+#include "m5u/c_image_stream.cpp"
+
+#define FAKE_READ_SIZE 5
+#define FAKE_WORK_AREA 1000
+#define FAKE_STACK_FREE 1024
+#define MAX_METHODS 16
+
+struct SemaphoreDefinition {
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  int count;
+};
+
+struct method_entry {
+  mrbc_class *cls;
+  const char *name;
+  mrbc_func_t func;
+};
+
+mrbc_class mrbc_class_Object = {"Object", nullptr};
+mrbc_class mrbc_class_ArgumentError = {"ArgumentError", nullptr};
+mrbc_class mrbc_class_RuntimeError = {"RuntimeError", nullptr};
+mrbc_class mrbc_class_IndexError = {"IndexError", nullptr};
+mrbc_class mrbc_class_TypeError = {"TypeError", nullptr};
+m5::M5Unified M5;
+
+static mrbc_class classes[4];
+static int n_classes;
+static mrbc_class canvas_cls = {"Canvas", &mrbc_class_Object};
+static method_entry methods[MAX_METHODS];
+static int n_methods;
+static mrbc_vm vm;
+static const char *raised;
+
+static pthread_mutex_t tasks_lock = PTHREAD_MUTEX_INITIALIZER;
+static int live_tasks;
+static size_t free_heap;
+
+// decoder side
+static volatile bool vm_waiting;  // set around feed() and finish()
+static int reads_while_vm_ran;
+static uint8_t decoded[256];
+static int decoded_len;
+
+// --- stub FreeRTOS, on pthreads ----------------------------------------
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+  SemaphoreHandle_t s = (SemaphoreHandle_t)calloc(1, sizeof(*s));
+  pthread_mutex_init(&s->lock, nullptr);
+  pthread_cond_init(&s->cond, nullptr);
+  return s;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t s) {
+  pthread_mutex_destroy(&s->lock);
+  pthread_cond_destroy(&s->cond);
+  free(s);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t wait) {
+  pthread_mutex_lock(&s->lock);
+  while (s->count == 0) pthread_cond_wait(&s->cond, &s->lock);
+  s->count = 0;
+  pthread_mutex_unlock(&s->lock);
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s) {
+  pthread_mutex_lock(&s->lock);
+  s->count = 1;
+  pthread_cond_signal(&s->cond);
+  pthread_mutex_unlock(&s->lock);
+  return pdTRUE;
+}
+
+struct task_start {
+  TaskFunction_t fn;
+  void *arg;
+};
+
+static void *task_main(void *p) {
+  task_start start = *(task_start *)p;
+  free(p);
+  start.fn(start.arg);
+  return nullptr;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack,
+                       void *arg, UBaseType_t priority, TaskHandle_t *handle) {
+  task_start *start = (task_start *)malloc(sizeof(*start));
+  start->fn = fn;
+  start->arg = arg;
+  pthread_t thread;
+  pthread_mutex_lock(&tasks_lock);
+  live_tasks++;
+  pthread_mutex_unlock(&tasks_lock);
+  pthread_create(&thread, nullptr, task_main, start);
+  pthread_detach(thread);
+  return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+  pthread_mutex_lock(&tasks_lock);
+  live_tasks--;
+  pthread_mutex_unlock(&tasks_lock);
+  pthread_exit(nullptr);
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task) { return 1; }
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+  return FAKE_STACK_FREE;
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) { return free_heap; }
+
+int64_t esp_timer_get_time(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// a finished decoder task deletes itself just after it wakes the VM
+static int wait_live_tasks(int n) {
+  for (int i = 0; i < 1000; i++) {
+    pthread_mutex_lock(&tasks_lock);
+    int live = live_tasks;
+    pthread_mutex_unlock(&tasks_lock);
+    if (live == n) return live;
+    struct timespec ts = {0, 1000000};
+    nanosleep(&ts, nullptr);
+  }
+  return live_tasks;
+}
+
+// --- stub mruby/c ------------------------------------------------------
+
+mrbc_class *mrbc_define_class(mrbc_vm *vm, const char *name,
+                              mrbc_class *super) {
+  for (int i = 0; i < n_classes; i++) {
+    if (strcmp(classes[i].name, name) == 0) return &classes[i];
+  }
+  classes[n_classes] = {name, super};
+  return &classes[n_classes++];
+}
+
+void mrbc_define_method(mrbc_vm *vm, mrbc_class *cls, const char *name,
+                        mrbc_func_t func) {
+  for (int i = 0; i < n_methods; i++) {
+    if (methods[i].cls == cls && strcmp(methods[i].name, name) == 0) {
+      methods[i].func = func;
+      return;
+    }
+  }
+  methods[n_methods++] = {cls, name, func};
+}
+
+mrbc_class *mrbc_get_class_by_name(const char *name) {
+  return strcmp(name, "Canvas") == 0 ? &canvas_cls : nullptr;
+}
+
+int mrbc_obj_is_kind_of(const mrbc_value *obj, const mrbc_class *cls) {
+  return obj->tt == MRBC_TT_OBJECT && obj->instance->cls == cls;
+}
+
+void mrbc_raise(mrbc_vm *vm, mrbc_class *exc_cls, const char *msg) {
+  raised = msg;
+}
+
+mrbc_value mrbc_instance_new(mrbc_vm *vm, mrbc_class *cls, int size) {
+  mrbc_value v;
+  v.tt = MRBC_TT_OBJECT;
+  v.instance = (mrbc_instance *)calloc(1, sizeof(mrbc_instance) + size);
+  v.instance->cls = cls;
+  return v;
+}
+
+static mrbc_func_t find_method(mrbc_class *cls, const char *name) {
+  for (int i = 0; i < n_methods; i++) {
+    if (methods[i].cls == cls && strcmp(methods[i].name, name) == 0) {
+      return methods[i].func;
+    }
+  }
+  return nullptr;
+}
+
+void mrbc_instance_call_initialize(mrbc_vm *vm, mrbc_value *v, int argc) {
+  mrbc_value recv = v[0];
+  find_method(v[0].instance->cls, "initialize")(vm, v, argc);
+  v[0] = recv;
+}
+
+// the tests pass Strings and Integers, so to_s and to_i are never sent
+mrbc_value mrbc_send(mrbc_vm *vm, mrbc_value *v, int reg_ofs,
+                     mrbc_value *recv, const char *method_name, int argc,
+                     ...) {
+  raised = method_name;
+  return *recv;
+}
+
+mrbc_value mrbc_array_new(mrbc_vm *vm, int size) {
+  mrbc_value v;
+  v.tt = MRBC_TT_ARRAY;
+  v.array = (mrbc_array *)calloc(1, sizeof(mrbc_array));
+  v.array->data = (mrbc_value *)calloc(size, sizeof(mrbc_value));
+  return v;
+}
+
+int mrbc_array_set(mrbc_value *ary, int idx, mrbc_value *set_val) {
+  ary->array->data[idx] = *set_val;
+  if (idx >= ary->array->n_stored) ary->array->n_stored = idx + 1;
+  return 0;
+}
+
+// --- fake decoder ------------------------------------------------------
+
+// reads a length byte, then that many bytes; false if the data ran short
+static bool fake_decode(lgfx::DataWrapper *data) {
+  free_heap -= FAKE_WORK_AREA;
+  uint8_t n = 0;
+  bool ok = data->read(&n, 1) == 1;
+  decoded_len = 0;
+  while (ok && decoded_len < n) {
+    // take a while per read, so a VM that did not wait runs meanwhile
+    struct timespec ts = {0, 200000};
+    nanosleep(&ts, nullptr);
+    if (!vm_waiting) reads_while_vm_ran++;
+    int want = n - decoded_len < FAKE_READ_SIZE ? n - decoded_len
+                                                : FAKE_READ_SIZE;
+    int got = data->read(decoded + decoded_len, want);
+    decoded_len += got;
+    ok = got == want;
+  }
+  free_heap += FAKE_WORK_AREA;
+  return ok;
+}
+
+bool LovyanGFX::drawBmp(lgfx::DataWrapper *data, int32_t x, int32_t y) {
+  return fake_decode(data);
+}
+
+bool LovyanGFX::drawJpg(lgfx::DataWrapper *data, int32_t x, int32_t y) {
+  return fake_decode(data);
+}
+
+bool LovyanGFX::drawPng(lgfx::DataWrapper *data, int32_t x, int32_t y) {
+  return fake_decode(data);
+}
+
+// --- helpers -----------------------------------------------------------
+
+static mrbc_value str_value(const uint8_t *p, int len) {
+  mrbc_value v;
+  v.tt = MRBC_TT_STRING;
+  v.string = (mrbc_string *)malloc(sizeof(mrbc_string));
+  v.string->size = len;
+  v.string->data = (uint8_t *)p;
+  return v;
+}
+
+static mrbc_value int_value(int n) { return mrbc_integer_value(n); }
+
+static mrbc_value call(mrbc_value recv, const char *name, int argc = 0,
+                       const mrbc_value *args = nullptr) {
+  mrbc_value v[6];
+  v[0] = recv;
+  for (int i = 0; i < argc; i++) v[i + 1] = args[i];
+  mrbc_class *cls = recv.tt == MRBC_TT_CLASS ? recv.cls : recv.instance->cls;
+  vm_waiting = true;
+  find_method(cls, name)(&vm, v, argc);
+  vm_waiting = false;
+  return v[0];
+}
+
+static mrbc_value new_stream(mrbc_value target) {
+  mrbc_value cls;
+  cls.tt = MRBC_TT_CLASS;
+  cls.cls = image_stream_class;
+  mrbc_value args[] = {target, str_value((const uint8_t *)"jpg", 3),
+                       int_value(0), int_value(0)};
+  return call(cls, "new", 4, args);
+}
+
+static mrbc_value display_target(void) {
+  mrbc_value v;
+  v.tt = MRBC_TT_NIL;
+  return v;
+}
+
+static bool feed(mrbc_value s, const uint8_t *p, int len) {
+  mrbc_value arg = str_value(p, len);
+  return call(s, "feed", 1, &arg).tt == MRBC_TT_TRUE;
+}
+
+static int64_t stat(mrbc_value s, int i) {
+  return call(s, "stats").array->data[i].i;
+}
+
+static void make_image(uint8_t *img, int n) {
+  img[0] = n;
+  for (int i = 1; i <= n; i++) img[i] = (uint8_t)(i * 7);
+}
+
+void setUp(void) {
+  n_classes = 0;
+  n_methods = 0;
+  raised = nullptr;
+  reads_while_vm_ran = 0;
+  decoded_len = 0;
+  free_heap = 100000;
+  memset(decoded, 0, sizeof(decoded));
+  class_image_stream_init();
+}
+
+void tearDown(void) {}
+
+// --- tests -------------------------------------------------------------
+
+static void test_feed_hands_off_blocks(void) {
+  uint8_t img[41];
+  make_image(img, 40);
+  mrbc_value s = new_stream(display_target());
+  TEST_ASSERT_NULL(raised);
+  TEST_ASSERT_EQUAL(1, wait_live_tasks(1));
+
+  static const int blocks[] = {3, 7, 11, 20};
+  int off = 0;
+  for (int b : blocks) {
+    TEST_ASSERT_TRUE(feed(s, img + off, b));
+    off += b;
+  }
+  TEST_ASSERT_EQUAL(41, off);
+  TEST_ASSERT_EQUAL(MRBC_TT_TRUE, call(s, "finish").tt);
+
+  TEST_ASSERT_EQUAL(0, reads_while_vm_ran);
+  TEST_ASSERT_EQUAL(40, decoded_len);
+  TEST_ASSERT_EQUAL_MEMORY(img + 1, decoded, 40);
+  TEST_ASSERT_EQUAL(41, stat(s, 1));
+  TEST_ASSERT_EQUAL(sizeof(ImageStream) + IMAGE_STREAM_TASK_STACK +
+                        FAKE_WORK_AREA,
+                    stat(s, 2));
+  TEST_ASSERT_EQUAL(IMAGE_STREAM_TASK_STACK - FAKE_STACK_FREE, stat(s, 3));
+  TEST_ASSERT_EQUAL(0, wait_live_tasks(0));
+  TEST_ASSERT_NULL(image_stream_list);
+}
+
+static void test_truncated_data_fails(void) {
+  uint8_t img[41];
+  make_image(img, 40);
+  mrbc_value s = new_stream(display_target());
+  TEST_ASSERT_TRUE(feed(s, img, 21));
+  TEST_ASSERT_EQUAL(MRBC_TT_FALSE, call(s, "finish").tt);
+  TEST_ASSERT_EQUAL(20, decoded_len);
+  TEST_ASSERT_EQUAL(21, stat(s, 1));
+  TEST_ASSERT_EQUAL(0, wait_live_tasks(0));
+}
+
+static void test_surplus_data_is_refused(void) {
+  uint8_t img[32];
+  make_image(img, 10);
+  memset(img + 11, 0xEE, sizeof(img) - 11);
+  mrbc_value s = new_stream(display_target());
+  TEST_ASSERT_TRUE(feed(s, img, 20));  // the decoder returns mid-block
+  TEST_ASSERT_FALSE(feed(s, img + 20, 12));
+  TEST_ASSERT_EQUAL(MRBC_TT_TRUE, call(s, "finish").tt);
+  TEST_ASSERT_EQUAL(10, decoded_len);
+  TEST_ASSERT_EQUAL(11, stat(s, 1));  // the surplus was not consumed
+  TEST_ASSERT_EQUAL(0, wait_live_tasks(0));
+}
+
+static void test_canvas_destroy_stops_stream(void) {
+  M5Canvas canvas;
+  mrbc_value target = mrbc_instance_new(&vm, &canvas_cls, sizeof(void *));
+  *(M5Canvas **)target.instance->data = &canvas;
+  uint8_t img[41];
+  make_image(img, 40);
+
+  mrbc_value s = new_stream(target);
+  TEST_ASSERT_EQUAL_PTR(&canvas, image_stream_list->dst);
+  TEST_ASSERT_TRUE(feed(s, img, 10));
+  image_stream_drop_target(&canvas);  // what Canvas.destroy does
+  TEST_ASSERT_EQUAL(0, wait_live_tasks(0));
+  TEST_ASSERT_FALSE(feed(s, img + 10, 10));
+  TEST_ASSERT_EQUAL(MRBC_TT_FALSE, call(s, "finish").tt);
+  TEST_ASSERT_EQUAL(9, decoded_len);
+  TEST_ASSERT_NULL(image_stream_list);
+  free(target.instance);
+}
+
+static void test_reload_releases_streams(void) {
+  uint8_t img[41];
+  make_image(img, 40);
+  mrbc_value a = new_stream(display_target());
+  mrbc_value b = new_stream(display_target());
+  TEST_ASSERT_TRUE(feed(a, img, 5));
+  TEST_ASSERT_TRUE(feed(b, img, 15));
+  TEST_ASSERT_EQUAL(2, wait_live_tasks(2));
+
+  class_image_stream_init();  // the VM reloads, a and b are gone
+  TEST_ASSERT_NULL(image_stream_list);
+  TEST_ASSERT_EQUAL(0, wait_live_tasks(0));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_feed_hands_off_blocks);
+  RUN_TEST(test_truncated_data_fails);
+  RUN_TEST(test_surplus_data_is_refused);
+  RUN_TEST(test_canvas_destroy_stops_stream);
+  RUN_TEST(test_reload_releases_streams);
+  return UNITY_END();
+}
@@ -0,0 +1,331 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file test_main.cpp
+ * @brief Button sampler tests against fake M5 buttons
+ *
+ * The sampler task is a real thread. The stub FreeRTOS task notification
+ * lets the test tick the sampler one period at a time and wait until the
+ * sample has been taken, and esp_timer_get_time returns a fake clock the
+ * test moves by one period per tick. The fake buttons return the raw level
+ * the test sets, so presses, bounces and releases are played sample by
+ * sample.
+ *
+ * Checked: bounces shorter than the debounce time are dropped, an edge
+ * carries the time its level first changed, releases are counted, the
+ * queue drains in order, and edges are dropped and counted while nobody
+ * reads them.
+ */
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+
+#include "drv/input.cpp"
+
+#define PERIOD_MS 5
+#define DEBOUNCE_MS 20
+
+struct SemaphoreDefinition {
+  pthread_mutex_t lock;
+};
+
+struct QueueDefinition {
+  pthread_mutex_t lock;
+  uint8_t *items;
+  uint32_t item_size, length, head, count;
+};
+
+struct esp_timer {
+  esp_timer_cb_t callback;
+  void *arg;
+  bool active;
+  uint64_t period_us;
+};
+
+m5::M5Unified M5;
+
+static bool raw_pressed[INPUT_BUTTONS];
+static int64_t fake_now_us;
+static int updates;  // M5.update calls
+static int notified;  // input_notify calls
+
+// task notification, and whether the sampler waits for the next one
+static pthread_mutex_t notify_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t notify_cond = PTHREAD_COND_INITIALIZER;
+static uint32_t notify_count;
+static bool sampler_idle;
+
+// --- fake M5 -----------------------------------------------------------
+
+bool m5::Button_Class::isPressed(void) const {
+  return raw_pressed[this - &M5.BtnA];
+}
+
+void m5::M5Unified::update(void) { updates++; }
+
+// --- stub FreeRTOS and esp_timer, on pthreads --------------------------
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+  SemaphoreHandle_t s = (SemaphoreHandle_t)calloc(1, sizeof(*s));
+  pthread_mutex_init(&s->lock, nullptr);
+  return s;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t wait) {
+  pthread_mutex_lock(&s->lock);
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s) {
+  pthread_mutex_unlock(&s->lock);
+  return pdTRUE;
+}
+
+QueueHandle_t xQueueCreate(uint32_t length, uint32_t item_size) {
+  QueueHandle_t q = (QueueHandle_t)calloc(1, sizeof(*q));
+  pthread_mutex_init(&q->lock, nullptr);
+  q->items = (uint8_t *)calloc(length, item_size);
+  q->item_size = item_size;
+  q->length = length;
+  return q;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t wait) {
+  pthread_mutex_lock(&q->lock);
+  bool ok = q->count < q->length;
+  if (ok) {
+    uint32_t i = (q->head + q->count++) % q->length;
+    memcpy(q->items + i * q->item_size, item, q->item_size);
+  }
+  pthread_mutex_unlock(&q->lock);
+  return ok ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t wait) {
+  pthread_mutex_lock(&q->lock);
+  bool ok = q->count > 0;
+  if (ok) {
+    memcpy(item, q->items + q->head * q->item_size, q->item_size);
+    q->head = (q->head + 1) % q->length;
+    q->count--;
+  }
+  pthread_mutex_unlock(&q->lock);
+  return ok ? pdTRUE : pdFALSE;
+}
+
+uint32_t uxQueueMessagesWaiting(QueueHandle_t q) {
+  pthread_mutex_lock(&q->lock);
+  uint32_t n = q->count;
+  pthread_mutex_unlock(&q->lock);
+  return n;
+}
+
+BaseType_t xQueueReset(QueueHandle_t q) {
+  pthread_mutex_lock(&q->lock);
+  q->head = q->count = 0;
+  pthread_mutex_unlock(&q->lock);
+  return pdPASS;
+}
+
+static void *task_main(void *p) {
+  ((TaskFunction_t)p)(nullptr);
+  return nullptr;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack,
+                       void *arg, UBaseType_t priority, TaskHandle_t *handle) {
+  pthread_t thread;
+  pthread_create(&thread, nullptr, task_main, (void *)fn);
+  pthread_detach(thread);
+  *handle = (TaskHandle_t)1;
+  return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait) {
+  pthread_mutex_lock(&notify_lock);
+  sampler_idle = true;
+  pthread_cond_broadcast(&notify_cond);
+  while (notify_count == 0) pthread_cond_wait(&notify_cond, &notify_lock);
+  uint32_t n = notify_count;
+  notify_count = 0;
+  sampler_idle = false;
+  pthread_mutex_unlock(&notify_lock);
+  return n;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  pthread_mutex_lock(&notify_lock);
+  notify_count++;
+  pthread_cond_broadcast(&notify_cond);
+  pthread_mutex_unlock(&notify_lock);
+  return pdPASS;
+}
+
+int64_t esp_timer_get_time(void) { return fake_now_us; }
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args,
+                           esp_timer_handle_t *out_handle) {
+  *out_handle = (esp_timer_handle_t)calloc(1, sizeof(**out_handle));
+  (*out_handle)->callback = args->callback;
+  (*out_handle)->arg = args->arg;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer,
+                                   uint64_t period_us) {
+  timer->active = true;
+  timer->period_us = period_us;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+  timer->active = false;
+  return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer) { return timer->active; }
+
+// --- helpers -----------------------------------------------------------
+
+static void count_notify(void *arg) { notified++; }
+
+// one timer period: fires the timer and waits until the sample is taken
+static void tick(void) {
+  TEST_ASSERT_TRUE(input_timer->active);
+  fake_now_us += input_timer->period_us;
+  pthread_mutex_lock(&notify_lock);
+  while (!sampler_idle) pthread_cond_wait(&notify_cond, &notify_lock);
+  pthread_mutex_unlock(&notify_lock);
+  input_timer->callback(input_timer->arg);
+  pthread_mutex_lock(&notify_lock);
+  while (notify_count > 0 || !sampler_idle) {
+    pthread_cond_wait(&notify_cond, &notify_lock);
+  }
+  pthread_mutex_unlock(&notify_lock);
+}
+
+static void ticks(int n) {
+  for (int i = 0; i < n; i++) tick();
+}
+
+void setUp(void) {
+  memset(raw_pressed, 0, sizeof(raw_pressed));
+  memset(input_buttons, 0, sizeof(input_buttons));
+  input_dropped = 0;
+  notified = 0;
+  drv_input_set_notify(count_notify, nullptr);
+  TEST_ASSERT_EQUAL(kSuccess, drv_input_start(PERIOD_MS, DEBOUNCE_MS));
+}
+
+void tearDown(void) {
+  drv_input_stop();
+  drv_input_flush();
+}
+
+static void test_bounce_is_rejected(void) {
+  drv_input_event_t e;
+  // pressed for 3 samples (15 ms), shorter than the debounce time
+  raw_pressed[0] = true;
+  ticks(3);
+  raw_pressed[0] = false;
+  ticks(10);
+  TEST_ASSERT_FALSE(drv_input_pressed(0));
+  TEST_ASSERT_FALSE(drv_input_next(&e));
+
+  // a bounce in the middle starts the debounce time again
+  raw_pressed[0] = true;
+  ticks(3);
+  raw_pressed[0] = false;
+  tick();
+  raw_pressed[0] = true;
+  ticks(4);  // 15 ms since the bounce
+  TEST_ASSERT_FALSE(drv_input_pressed(0));
+  tick();
+  TEST_ASSERT_TRUE(drv_input_pressed(0));
+  TEST_ASSERT_TRUE(drv_input_next(&e));
+  TEST_ASSERT_FALSE(drv_input_next(&e));
+  TEST_ASSERT_EQUAL(1, notified);
+}
+
+static void test_edge_carries_first_change_time(void) {
+  drv_input_event_t e;
+  ticks(2);
+  int64_t pressed_at = fake_now_us + PERIOD_MS * 1000;
+  raw_pressed[1] = true;
+  ticks(DEBOUNCE_MS / PERIOD_MS + 1);
+  TEST_ASSERT_TRUE(drv_input_next(&e));
+  TEST_ASSERT_EQUAL(1, e.button);
+  TEST_ASSERT_TRUE(e.pressed);
+  TEST_ASSERT_EQUAL(pressed_at, e.time_us);
+
+  int64_t released_at = fake_now_us + PERIOD_MS * 1000;
+  raw_pressed[1] = false;
+  ticks(DEBOUNCE_MS / PERIOD_MS + 1);
+  TEST_ASSERT_TRUE(drv_input_next(&e));
+  TEST_ASSERT_FALSE(e.pressed);
+  TEST_ASSERT_EQUAL(released_at, e.time_us);
+}
+
+static void test_releases_are_counted_in_order(void) {
+  uint32_t before = drv_input_release_count(2);
+  for (int i = 0; i < 2; i++) {
+    raw_pressed[2] = true;
+    ticks(5);
+    raw_pressed[2] = false;
+    ticks(5);
+  }
+  TEST_ASSERT_EQUAL(before + 2, drv_input_release_count(2));
+  TEST_ASSERT_EQUAL(0, drv_input_release_count(0));
+  TEST_ASSERT_FALSE(drv_input_pressed(2));
+
+  TEST_ASSERT_EQUAL(4, drv_input_pending());
+  drv_input_event_t e;
+  for (int i = 0; i < 4; i++) {
+    TEST_ASSERT_TRUE(drv_input_next(&e));
+    TEST_ASSERT_EQUAL(2, e.button);
+    TEST_ASSERT_EQUAL(i % 2 == 0, e.pressed);
+  }
+  TEST_ASSERT_EQUAL(0, drv_input_pending());
+}
+
+static void test_unread_edges_are_dropped_and_counted(void) {
+  int presses = INPUT_QUEUE_LENGTH / 2 + 3;
+  for (int i = 0; i < presses; i++) {
+    raw_pressed[0] = true;
+    ticks(5);
+    raw_pressed[0] = false;
+    ticks(5);
+  }
+  uint32_t samples, missed, max_late_us, dropped;
+  drv_input_stats(&samples, &missed, &max_late_us, &dropped);
+  TEST_ASSERT_EQUAL(INPUT_QUEUE_LENGTH, drv_input_pending());
+  TEST_ASSERT_EQUAL(presses * 2 - INPUT_QUEUE_LENGTH, dropped);
+  // the level and the release count still follow the button
+  TEST_ASSERT_EQUAL(presses, drv_input_release_count(0));
+
+  drv_input_flush();
+  TEST_ASSERT_EQUAL(0, drv_input_pending());
+}
+
+static void test_start_takes_current_level(void) {
+  drv_input_stop();
+  raw_pressed[0] = true;
+  TEST_ASSERT_EQUAL(kSuccess, drv_input_start(PERIOD_MS, DEBOUNCE_MS));
+  TEST_ASSERT_TRUE(drv_input_pressed(0));
+  ticks(10);
+  TEST_ASSERT_EQUAL(0, drv_input_pending());
+  TEST_ASSERT_TRUE(updates > 0);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_bounce_is_rejected);
+  RUN_TEST(test_edge_carries_first_change_time);
+  RUN_TEST(test_releases_are_counted_in_order);
+  RUN_TEST(test_unread_edges_are_dropped_and_counted);
+  RUN_TEST(test_start_takes_current_level);
+  return UNITY_END();
+}
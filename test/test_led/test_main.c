@@ -0,0 +1,441 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file test_main.c
+ * @brief LED driver tests against a stub RMT channel
+ *
+ * The driver is built together with stub RMT, queue and heap functions
+ * that count the transactions and run the encoder the way the RMT
+ * interrupt does, one channel memory block at a time. A transaction ends
+ * when the next one needs its frame buffer, as on the hardware where show
+ * waits for the oldest frame on the wire.
+ *
+ * Refreshes of dithered strips are checked to resend the last frame and
+ * move the dither phase, without touching the frame being edited.
+ *
+ * The encoder is also checked symbol for symbol against the bit-by-bit
+ * encoder it replaced, and both are timed.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unity.h>
+
+#include "drv/led.c"
+
+#define STRIP_PIN 27
+#define STRIP_SIZE 25
+#define QUEUE_ITEMS 8
+#define BENCH_PIXELS 300
+#define BENCH_ROUNDS 2000
+
+struct QueueDefinition {
+  uint8_t items[QUEUE_ITEMS];
+  uint32_t head, count, length;
+};
+
+struct rmt_channel_t {
+  rmt_tx_done_callback_t done;
+  void *ctx;
+  uint32_t pending;  // transactions not completed yet
+};
+
+struct SemaphoreDefinition {
+  bool taken;
+};
+
+struct rmt_encoder_t {
+  rmt_simple_encoder_config_t config;
+};
+
+static uint32_t transmits;
+static size_t last_symbols;
+static rmt_symbol_word_t last_frame[STRIP_SIZE * kLedGrbw * 8 + 1];
+static struct rmt_channel_t *last_chan;
+
+QueueHandle_t xQueueCreate(uint32_t length, uint32_t item_size) {
+  QueueHandle_t q = calloc(1, sizeof(*q));
+  q->length = length;
+  return q;
+}
+
+void vQueueDelete(QueueHandle_t queue) { free(queue); }
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t wait) {
+  if (q->count == q->length) return pdFALSE;
+  q->items[(q->head + q->count++) % QUEUE_ITEMS] = *(const uint8_t *)item;
+  return pdTRUE;
+}
+
+static void rmt_complete_one(struct rmt_channel_t *chan) {
+  rmt_tx_done_event_data_t edata = {0};
+  chan->pending--;
+  chan->done(chan, &edata, chan->ctx);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t wait) {
+  // blocking on a frame buffer: the oldest transaction finishes meanwhile
+  if (q->count == 0 && wait != 0 && last_chan != NULL &&
+      last_chan->pending > 0) {
+    rmt_complete_one(last_chan);
+  }
+  if (q->count == 0) return pdFALSE;
+  *(uint8_t *)item = q->items[q->head];
+  q->head = (q->head + 1) % QUEUE_ITEMS;
+  q->count--;
+  return pdTRUE;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t q, const void *item,
+                             BaseType_t *woken) {
+  return xQueueSend(q, item, 0);
+}
+
+BaseType_t xQueueReceiveFromISR(QueueHandle_t q, void *item,
+                                BaseType_t *woken) {
+  return xQueueReceive(q, item, 0);
+}
+
+uint32_t uxQueueMessagesWaiting(QueueHandle_t q) { return q->count; }
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+  return calloc(1, sizeof(struct SemaphoreDefinition));
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem) { free(sem); }
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t wait) {
+  // single threaded: a blocking take of a held mutex would never return
+  TEST_ASSERT_TRUE(!sem->taken || wait == 0);
+  if (sem->taken) return pdFALSE;
+  sem->taken = true;
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+  sem->taken = false;
+  return pdTRUE;
+}
+
+void *heap_caps_malloc(size_t size, uint32_t caps) { return malloc(size); }
+
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps) {
+  return calloc(n, size);
+}
+
+void heap_caps_free(void *ptr) { free(ptr); }
+
+void gpio_reset_pin(gpio_num_t gpio_num) {}
+
+esp_err_t rmt_new_tx_channel(const rmt_tx_channel_config_t *config,
+                             rmt_channel_handle_t *ret_chan) {
+  *ret_chan = calloc(1, sizeof(**ret_chan));
+  return ESP_OK;
+}
+
+esp_err_t rmt_new_simple_encoder(const rmt_simple_encoder_config_t *config,
+                                 rmt_encoder_handle_t *ret_encoder) {
+  *ret_encoder = calloc(1, sizeof(**ret_encoder));
+  (*ret_encoder)->config = *config;
+  return ESP_OK;
+}
+
+esp_err_t rmt_tx_register_event_callbacks(rmt_channel_handle_t tx_channel,
+                                          const rmt_tx_event_callbacks_t *cbs,
+                                          void *user_data) {
+  tx_channel->done = cbs->on_trans_done;
+  tx_channel->ctx = user_data;
+  return ESP_OK;
+}
+
+esp_err_t rmt_enable(rmt_channel_handle_t channel) { return ESP_OK; }
+
+esp_err_t rmt_disable(rmt_channel_handle_t channel) { return ESP_OK; }
+
+esp_err_t rmt_del_channel(rmt_channel_handle_t channel) {
+  if (last_chan == channel) last_chan = NULL;
+  free(channel);
+  return ESP_OK;
+}
+
+esp_err_t rmt_del_encoder(rmt_encoder_handle_t encoder) {
+  free(encoder);
+  return ESP_OK;
+}
+
+esp_err_t rmt_transmit(rmt_channel_handle_t tx_channel,
+                       rmt_encoder_handle_t encoder, const void *payload,
+                       size_t payload_bytes,
+                       const rmt_transmit_config_t *config) {
+  const rmt_simple_encoder_config_t *enc = &encoder->config;
+  size_t written = 0;
+  bool done = false;
+  while (!done) {
+    size_t free_symbols = SOC_RMT_MEM_WORDS_PER_CHANNEL;
+    rmt_symbol_word_t block[SOC_RMT_MEM_WORDS_PER_CHANNEL];
+    size_t n = enc->callback(payload, payload_bytes, written, free_symbols,
+                             block, &done, enc->arg);
+    TEST_ASSERT_TRUE(n > 0 && n <= free_symbols);
+    TEST_ASSERT_TRUE(written + n <=
+                     sizeof(last_frame) / sizeof(last_frame[0]));
+    memcpy(&last_frame[written], block, n * sizeof(block[0]));
+    written += n;
+  }
+  last_symbols = written;
+  last_chan = tx_channel;
+  tx_channel->pending++;
+  transmits++;
+  return ESP_OK;
+}
+
+esp_err_t rmt_tx_wait_all_done(rmt_channel_handle_t tx_channel,
+                               int timeout_ms) {
+  while (tx_channel->pending > 0) rmt_complete_one(tx_channel);
+  return ESP_OK;
+}
+
+// Reads one byte back from the symbols, MSB first
+static uint8_t decode_byte(const rmt_symbol_word_t *s) {
+  uint8_t byte = 0;
+  for (int i = 0; i < 8; i++) {
+    TEST_ASSERT_EQUAL(1, s[i].level0);
+    TEST_ASSERT_EQUAL(0, s[i].level1);
+    byte = (uint8_t)(byte << 1 | (s[i].duration0 == WS2812_T1H));
+  }
+  return byte;
+}
+
+static double now_s(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// The encoder before the nibble table: one byte, 8 bit tests, per call
+static size_t bitwise_encoder(const void *data, size_t data_size,
+                              size_t symbols_written, size_t symbols_free,
+                              rmt_symbol_word_t *symbols, bool *done,
+                              void *arg) {
+  static const rmt_symbol_word_t zero = {
+      .level0 = 1,
+      .duration0 = WS2812_T0H,
+      .level1 = 0,
+      .duration1 = WS2812_T0L,
+  };
+  static const rmt_symbol_word_t one = {
+      .level0 = 1,
+      .duration0 = WS2812_T1H,
+      .level1 = 0,
+      .duration1 = WS2812_T1L,
+  };
+  if (symbols_free < 8) {
+    return 0;
+  }
+  size_t data_pos = symbols_written / 8;
+  const uint8_t *data_bytes = (const uint8_t *)data;
+  if (data_pos < data_size) {
+    size_t symbol_pos = 0;
+    for (int bitmask = 0x80; bitmask != 0; bitmask >>= 1) {
+      symbols[symbol_pos++] = (data_bytes[data_pos] & bitmask) ? one : zero;
+    }
+    return symbol_pos;
+  }
+  symbols[0] = ws2812_reset;
+  *done = 1;
+  return 1;
+}
+
+// Runs an encoder to the end the way the simple encoder does, refilling a
+// block of block_symbols, and returns the number of callback calls
+static size_t encode_all(rmt_encode_simple_cb_t encoder, const uint8_t *data,
+                         size_t size, size_t block_symbols,
+                         rmt_symbol_word_t *out, size_t *symbols) {
+  size_t written = 0;
+  size_t calls = 0;
+  bool done = false;
+  while (!done) {
+    size_t used = 0;
+    while (!done && used < block_symbols) {
+      size_t n = encoder(data, size, written, block_symbols - used,
+                         &out[written], &done, &led_strips[0]);
+      calls++;
+      if (n == 0) break;  // block full, the interrupt sends it
+      written += n;
+      used += n;
+    }
+  }
+  *symbols = written;
+  return calls;
+}
+
+static void random_fill(uint8_t *buf, size_t size) {
+  for (size_t i = 0; i < size; i++) buf[i] = (uint8_t)rand();
+}
+
+void setUp(void) {
+  transmits = 0;
+  TEST_ASSERT_EQUAL(kSuccess, drv_led_init(STRIP_PIN, STRIP_SIZE));
+}
+
+void tearDown(void) { drv_led_detach(0); }
+
+static void test_set_sends_every_call(void) {
+  for (uint16_t i = 0; i < STRIP_SIZE; i++) {
+    TEST_ASSERT_EQUAL(kSuccess, drv_led_set(0, i, 10, 20, 30));
+  }
+  TEST_ASSERT_EQUAL_UINT32(STRIP_SIZE, transmits);
+  TEST_ASSERT_EQUAL_UINT32(STRIP_SIZE, drv_led_transmit_count(0));
+}
+
+static void test_show_sends_once(void) {
+  for (uint16_t i = 0; i < STRIP_SIZE; i++) {
+    TEST_ASSERT_EQUAL(kSuccess, drv_led_set_pixel(0, i, 10, 20, 30, 0));
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, transmits);
+  TEST_ASSERT_EQUAL(kSuccess, drv_led_show(0));
+  TEST_ASSERT_EQUAL_UINT32(1, transmits);
+  TEST_ASSERT_EQUAL_UINT32(1, drv_led_transmit_count(0));
+}
+
+static void test_frame_encoding(void) {
+  TEST_ASSERT_EQUAL(kSuccess, drv_led_set_pixel(0, 0, 0x12, 0x34, 0x56, 0));
+  TEST_ASSERT_EQUAL(kSuccess,
+                    drv_led_set_pixel(0, STRIP_SIZE - 1, 0xFF, 0x00, 0xA5, 0));
+  TEST_ASSERT_EQUAL(kSuccess, drv_led_show(0));
+
+  // 8 symbols per byte, then the reset
+  TEST_ASSERT_EQUAL(STRIP_SIZE * kLedGrb * 8 + 1, last_symbols);
+  TEST_ASSERT_EQUAL_HEX8(0x34, decode_byte(&last_frame[0]));  // G R B
+  TEST_ASSERT_EQUAL_HEX8(0x12, decode_byte(&last_frame[8]));
+  TEST_ASSERT_EQUAL_HEX8(0x56, decode_byte(&last_frame[16]));
+  const rmt_symbol_word_t *last = &last_frame[(STRIP_SIZE - 1) * kLedGrb * 8];
+  TEST_ASSERT_EQUAL_HEX8(0x00, decode_byte(&last[0]));
+  TEST_ASSERT_EQUAL_HEX8(0xFF, decode_byte(&last[8]));
+  TEST_ASSERT_EQUAL_HEX8(0xA5, decode_byte(&last[16]));
+  TEST_ASSERT_EQUAL(0, last_frame[last_symbols - 1].level0);
+}
+
+static void test_edit_continues_on_copy(void) {
+  TEST_ASSERT_EQUAL(kSuccess, drv_led_set_pixel(0, 3, 1, 2, 3, 0));
+  TEST_ASSERT_EQUAL(kSuccess, drv_led_show(0));
+  // the next frame starts from the one sent, so showing it again is equal
+  TEST_ASSERT_EQUAL(kSuccess, drv_led_show(0));
+  TEST_ASSERT_EQUAL_HEX8(2, decode_byte(&last_frame[3 * kLedGrb * 8]));
+  TEST_ASSERT_EQUAL_HEX8(1, decode_byte(&last_frame[3 * kLedGrb * 8 + 8]));
+}
+
+static void test_show_waits_for_third_frame(void) {
+  // two frames can be queued while the third is being edited
+  TEST_ASSERT_EQUAL(kSuccess, drv_led_show(0));
+  TEST_ASSERT_EQUAL(kSuccess, drv_led_show(0));
+  TEST_ASSERT_EQUAL_UINT32(0, drv_led_stall_count(0));
+  TEST_ASSERT_EQUAL(kSuccess, drv_led_show(0));
+  TEST_ASSERT_EQUAL_UINT32(1, drv_led_stall_count(0));
+  TEST_ASSERT_EQUAL(kSuccess, drv_led_wait(0, 100));
+  TEST_ASSERT_EQUAL_UINT32(3, transmits);
+}
+
+static void test_refresh_resends_last_frame(void) {
+  TEST_ASSERT_EQUAL(kFailure, drv_led_refresh(0));  // nothing shown yet
+  TEST_ASSERT_EQUAL(kSuccess, drv_led_set_pixel(0, 0, 0x11, 0x22, 0x33, 0));
+  TEST_ASSERT_EQUAL(kSuccess, drv_led_show(0));
+  TEST_ASSERT_EQUAL(kFailure, drv_led_refresh(0));  // still in flight
+  TEST_ASSERT_EQUAL(kSuccess, drv_led_wait(0, 100));
+
+  // edits after show stay out of the refreshed frame
+  TEST_ASSERT_EQUAL(kSuccess, drv_led_set_pixel(0, 0, 0x44, 0x55, 0x66, 0));
+  for (int i = 0; i < 4; i++) {
+    TEST_ASSERT_EQUAL(kSuccess, drv_led_refresh(0));
+    TEST_ASSERT_EQUAL_HEX8(0x22, decode_byte(&last_frame[0]));
+    TEST_ASSERT_EQUAL_HEX8(0x11, decode_byte(&last_frame[8]));
+    TEST_ASSERT_EQUAL(kSuccess, drv_led_wait(0, 100));
+  }
+  TEST_ASSERT_EQUAL_UINT32(5, transmits);
+  TEST_ASSERT_EQUAL_UINT32(1, drv_led_transmit_count(0));  // shows only
+
+  TEST_ASSERT_EQUAL(kSuccess, drv_led_show(0));
+  TEST_ASSERT_EQUAL_HEX8(0x55, decode_byte(&last_frame[0]));
+  TEST_ASSERT_EQUAL_HEX8(0x44, decode_byte(&last_frame[8]));
+}
+
+static void test_refresh_moves_dither_phase(void) {
+  // level 3 at brightness 64 is 0.75 of a step: 6 of 8 frames round up
+  TEST_ASSERT_EQUAL(kSuccess, drv_led_set_output(0, false, 64, true));
+  TEST_ASSERT_TRUE(drv_led_dithering(0));
+  TEST_ASSERT_EQUAL(kSuccess, drv_led_set_pixel(0, 0, 0, 3, 0, 0));
+  TEST_ASSERT_EQUAL(kSuccess, drv_led_show(0));
+  TEST_ASSERT_EQUAL(kSuccess, drv_led_wait(0, 100));
+
+  int sum = 0;
+  for (int i = 0; i < 8; i++) {
+    TEST_ASSERT_EQUAL(kSuccess, drv_led_refresh(0));
+    sum += decode_byte(&last_frame[0]);
+    TEST_ASSERT_EQUAL(kSuccess, drv_led_wait(0, 100));
+  }
+  TEST_ASSERT_EQUAL(6, sum);
+
+  TEST_ASSERT_EQUAL(kSuccess, drv_led_set_output(0, false, 255, false));
+  TEST_ASSERT_FALSE(drv_led_dithering(0));
+}
+
+static void test_encoder_matches_bitwise(void) {
+  static const size_t kBlocks[] = {8, 48, 64};
+  static uint8_t data[BENCH_PIXELS * kLedGrb];
+  static rmt_symbol_word_t want[BENCH_PIXELS * kLedGrb * 8 + 1];
+  static rmt_symbol_word_t got[BENCH_PIXELS * kLedGrb * 8 + 1];
+  random_fill(data, sizeof(data));
+
+  for (size_t b = 0; b < sizeof(kBlocks) / sizeof(kBlocks[0]); b++) {
+    for (size_t size = 1; size <= sizeof(data); size += 97) {
+      size_t want_symbols, got_symbols;
+      encode_all(bitwise_encoder, data, size, kBlocks[b], want,
+                 &want_symbols);
+      encode_all(encoder_callback, data, size, kBlocks[b], got, &got_symbols);
+      TEST_ASSERT_EQUAL(size * 8 + 1, want_symbols);
+      TEST_ASSERT_EQUAL(want_symbols, got_symbols);
+      TEST_ASSERT_EQUAL_MEMORY(want, got, want_symbols * sizeof(want[0]));
+    }
+  }
+}
+
+static void test_encoder_bench(void) {
+  static uint8_t data[BENCH_PIXELS * kLedGrb];
+  static rmt_symbol_word_t out[BENCH_PIXELS * kLedGrb * 8 + 1];
+  random_fill(data, sizeof(data));
+
+  size_t symbols, calls[2];
+  double us[2];
+  rmt_encode_simple_cb_t encoders[2] = {bitwise_encoder, encoder_callback};
+  for (int e = 0; e < 2; e++) {
+    double t = now_s();
+    for (int i = 0; i < BENCH_ROUNDS; i++) {
+      calls[e] = encode_all(encoders[e], data, sizeof(data),
+                            SOC_RMT_MEM_WORDS_PER_CHANNEL, out, &symbols);
+    }
+    us[e] = (now_s() - t) * 1e6 / BENCH_ROUNDS;
+  }
+
+  char msg[128];
+  snprintf(msg, sizeof(msg),
+           "%d px: bitwise %.1f us %zu calls, table %.1f us %zu calls",
+           BENCH_PIXELS, us[0], calls[0], us[1], calls[1]);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_TRUE(calls[1] < calls[0]);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_set_sends_every_call);
+  RUN_TEST(test_show_sends_once);
+  RUN_TEST(test_frame_encoding);
+  RUN_TEST(test_edit_continues_on_copy);
+  RUN_TEST(test_show_waits_for_third_frame);
+  RUN_TEST(test_refresh_resends_last_frame);
+  RUN_TEST(test_refresh_moves_dither_phase);
+  RUN_TEST(test_encoder_matches_bitwise);
+  RUN_TEST(test_encoder_bench);
+  return UNITY_END();
+}
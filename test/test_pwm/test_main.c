@@ -0,0 +1,615 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file test_main.c
+ * @brief PWM driver and binding tests against fake LEDC functions
+ *
+ * The driver is built together with fake LEDC timers and channels that keep
+ * the configured frequency and resolution, the staged and the applied duty
+ * of every channel, and a hardware fade that only ends when the test says
+ * so. The stub soc_caps.h has the ESP32 values, which cannot stop a fade.
+ *
+ * Timers are checked to be shared per frequency, reconfigured in place,
+ * left for a matching timer and run out of, with the duty ratio kept
+ * across frequency changes. A running fade must make the calls that would
+ * have to stop it fail at once instead of waiting in vTaskDelay.
+ *
+ * The fakes log every duty write, update, timer pause and resume and the
+ * critical section, so drv_pwm_set_duties can be checked to write every
+ * duty first and then request all updates with the timers paused inside
+ * one critical section, and to change nothing when any entry is invalid.
+ *
+ * The PWM class is built against a stub mruby/c that only keeps the method
+ * table. Methods are called on instances and as class methods with a
+ * handle, and a handle kept after disable must not reach the channel once
+ * it is set up again for another pin, nor may a plain channel number.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+
+#include "drv/pwm.c"
+#include "api/pwm.c"
+
+#define FAKE_TIMERS LEDC_TIMER_MAX
+#define MAX_METHODS 16
+
+typedef struct {
+  uint32_t freq_hz;
+  int bits;
+  int configs;  // ledc_timer_config calls
+} fake_timer_t;
+
+typedef struct {
+  int timer;
+  uint32_t staged;  // ledc_set_duty
+  uint32_t duty;    // applied by ledc_update_duty
+  bool stopped;
+  bool fading;
+  ledc_cb_t fade_cb;
+  void *fade_arg;
+} fake_channel_t;
+
+static fake_timer_t fake_timers[FAKE_TIMERS];
+static fake_channel_t fake_channels[LEDC_MAX_CHANNELS];
+static int delays;  // vTaskDelay calls
+// S: ledc_set_duty, U: ledc_update_duty, P/R: timer pause/resume,
+// { and }: critical section
+static char events[64];
+static int event_count;
+
+static void event(char e) {
+  if (event_count < (int)sizeof(events) - 1) events[event_count++] = e;
+}
+
+static void clear_events(void) {
+  memset(events, 0, sizeof(events));
+  event_count = 0;
+}
+
+typedef struct {
+  mrbc_class *cls;
+  const char *name;
+  mrbc_func_t func;
+} method_entry_t;
+
+mrbc_class mrbc_class_Object = {"Object", NULL};
+mrbc_class mrbc_class_ArgumentError = {"ArgumentError", NULL};
+mrbc_class mrbc_class_RuntimeError = {"RuntimeError", NULL};
+mrbc_class mrbc_class_IndexError = {"IndexError", NULL};
+mrbc_class mrbc_class_TypeError = {"TypeError", NULL};
+
+static mrbc_class pwm_cls = {"PWM", &mrbc_class_Object};
+static mrbc_class other_cls = {"Other", &mrbc_class_Object};
+static method_entry_t methods[MAX_METHODS];
+static int n_methods;
+static mrbc_vm vm;
+static mrbc_class *raised;
+
+void gpio_reset_pin(gpio_num_t gpio_num) {}
+
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode) {
+  return ESP_OK;
+}
+
+esp_err_t ledc_timer_config(const ledc_timer_config_t *conf) {
+  TEST_ASSERT_TRUE(conf->timer_num >= 0 && conf->timer_num < FAKE_TIMERS);
+  fake_timer_t *t = &fake_timers[conf->timer_num];
+  t->freq_hz = conf->freq_hz;
+  t->bits = conf->duty_resolution;
+  t->configs++;
+  return ESP_OK;
+}
+
+esp_err_t ledc_channel_config(const ledc_channel_config_t *conf) {
+  fake_channel_t *c = &fake_channels[conf->channel];
+  c->timer = conf->timer_sel;
+  c->staged = c->duty = conf->duty;
+  c->stopped = false;
+  return ESP_OK;
+}
+
+esp_err_t ledc_bind_channel_timer(ledc_mode_t mode, ledc_channel_t channel,
+                                  int timer) {
+  fake_channels[channel].timer = timer;
+  return ESP_OK;
+}
+
+esp_err_t ledc_set_duty(ledc_mode_t mode, ledc_channel_t channel,
+                        uint32_t duty) {
+  // the real driver would wait for the fade to release the channel
+  TEST_ASSERT_FALSE(fake_channels[channel].fading);
+  event('S');
+  fake_channels[channel].staged = duty;
+  return ESP_OK;
+}
+
+esp_err_t ledc_update_duty(ledc_mode_t mode, ledc_channel_t channel) {
+  event('U');
+  fake_channels[channel].duty = fake_channels[channel].staged;
+  return ESP_OK;
+}
+
+esp_err_t ledc_stop(ledc_mode_t mode, ledc_channel_t channel,
+                    uint32_t idle_level) {
+  fake_channels[channel].stopped = true;
+  return ESP_OK;
+}
+
+esp_err_t ledc_timer_pause(ledc_mode_t mode, int timer) {
+  event('P');
+  return ESP_OK;
+}
+
+esp_err_t ledc_timer_resume(ledc_mode_t mode, int timer) {
+  event('R');
+  return ESP_OK;
+}
+
+esp_err_t ledc_fade_func_install(int intr_alloc_flags) { return ESP_OK; }
+
+esp_err_t ledc_cb_register(ledc_mode_t mode, ledc_channel_t channel,
+                           ledc_cbs_t *cbs, void *user_arg) {
+  fake_channels[channel].fade_cb = cbs->fade_cb;
+  fake_channels[channel].fade_arg = user_arg;
+  return ESP_OK;
+}
+
+esp_err_t ledc_set_fade_with_time(ledc_mode_t mode, ledc_channel_t channel,
+                                  uint32_t target_duty, int max_fade_time_ms) {
+  TEST_ASSERT_FALSE(fake_channels[channel].fading);
+  fake_channels[channel].staged = target_duty;
+  return ESP_OK;
+}
+
+esp_err_t ledc_fade_start(ledc_mode_t mode, ledc_channel_t channel,
+                          ledc_fade_mode_t fade_mode) {
+  fake_channels[channel].fading = true;
+  return ESP_OK;
+}
+
+esp_err_t ledc_fade_stop(ledc_mode_t mode, ledc_channel_t channel) {
+  TEST_FAIL_MESSAGE("the ESP32 has no ledc_fade_stop");
+  return ESP_FAIL;
+}
+
+// the fade-end interrupt
+static void fake_fade_end(int channel) {
+  fake_channel_t *c = &fake_channels[channel];
+  ledc_cb_param_t param = {.event = LEDC_FADE_END_EVT,
+                           .channel = channel,
+                           .duty = c->staged};
+  c->fading = false;
+  c->duty = c->staged;
+  c->fade_cb(&param, c->fade_arg);
+}
+
+void vTaskDelay(TickType_t ticks) {
+  // only drv_pwm_release_all may wait: let every fade end meanwhile
+  delays++;
+  for (int i = 0; i < LEDC_MAX_CHANNELS; i++) {
+    if (fake_channels[i].fading) fake_fade_end(i);
+  }
+}
+
+void vPortEnterCritical(portMUX_TYPE *mux) { event('{'); }
+
+void vPortExitCritical(portMUX_TYPE *mux) { event('}'); }
+
+// --- stub mruby/c ------------------------------------------------------
+
+mrbc_class *mrbc_define_class(mrbc_vm *vm, const char *name,
+                              mrbc_class *super) {
+  TEST_ASSERT_EQUAL_STRING("PWM", name);
+  return &pwm_cls;
+}
+
+void mrbc_define_method(mrbc_vm *vm, mrbc_class *cls, const char *name,
+                        mrbc_func_t func) {
+  TEST_ASSERT_TRUE(n_methods < MAX_METHODS);
+  methods[n_methods++] = (method_entry_t){cls, name, func};
+}
+
+int mrbc_obj_is_kind_of(const mrbc_value *obj, const mrbc_class *cls) {
+  return obj->tt == MRBC_TT_OBJECT && obj->instance->cls == cls;
+}
+
+void mrbc_raise(mrbc_vm *vm, mrbc_class *exc_cls, const char *msg) {
+  raised = exc_cls;
+}
+
+mrbc_value mrbc_instance_new(mrbc_vm *vm, mrbc_class *cls, int size) {
+  mrbc_value v;
+  v.tt = MRBC_TT_OBJECT;
+  v.instance = calloc(1, sizeof(mrbc_instance) + size);
+  v.instance->cls = cls;
+  return v;
+}
+
+void mrbc_decref(mrbc_value *v) {
+  if (v->tt == MRBC_TT_OBJECT) free(v->instance);
+}
+
+mrbc_value mrbc_array_new(mrbc_vm *vm, int size) {
+  mrbc_value v;
+  v.tt = MRBC_TT_ARRAY;
+  v.array = calloc(1, sizeof(mrbc_array));
+  v.array->data = calloc(size, sizeof(mrbc_value));
+  return v;
+}
+
+int mrbc_array_set(mrbc_value *ary, int idx, mrbc_value *set_val) {
+  ary->array->data[idx] = *set_val;
+  if (idx >= ary->array->n_stored) ary->array->n_stored = idx + 1;
+  return 0;
+}
+
+int64_t esp_timer_get_time(void) { return 0; }
+
+// --- helpers -----------------------------------------------------------
+
+static mrbc_value int_value(int n) { return mrbc_integer_value(n); }
+
+static mrbc_value class_value(mrbc_class *cls) {
+  mrbc_value v;
+  v.tt = MRBC_TT_CLASS;
+  v.cls = cls;
+  return v;
+}
+
+// [[pwm, duty], ...], freed with free_pairs()
+static mrbc_value pairs(int n, const mrbc_value *pwms, const int *duties) {
+  mrbc_value list = mrbc_array_new(&vm, n);
+  for (int i = 0; i < n; i++) {
+    mrbc_value pair = mrbc_array_new(&vm, 2);
+    mrbc_value duty = int_value(duties[i]);
+    mrbc_array_set(&pair, 0, (mrbc_value *)&pwms[i]);
+    mrbc_array_set(&pair, 1, &duty);
+    mrbc_array_set(&list, i, &pair);
+  }
+  return list;
+}
+
+static void free_pairs(mrbc_value *list) {
+  for (int i = 0; i < list->array->n_stored; i++) {
+    free(list->array->data[i].array->data);
+    free(list->array->data[i].array);
+  }
+  free(list->array->data);
+  free(list->array);
+}
+
+// calls recv.name(args...) the way the VM does, with the result in v[0]
+static mrbc_value call(mrbc_value recv, const char *name, int argc,
+                       const mrbc_value *args) {
+  mrbc_value v[4];
+  v[0] = recv;
+  for (int i = 0; i < argc; i++) v[i + 1] = args[i];
+  mrbc_class *cls = recv.tt == MRBC_TT_CLASS ? recv.cls : recv.instance->cls;
+  for (int i = 0; i < n_methods; i++) {
+    if (methods[i].cls == cls && strcmp(methods[i].name, name) == 0) {
+      methods[i].func(&vm, v, argc);
+      return v[0];
+    }
+  }
+  TEST_FAIL_MESSAGE(name);
+  return v[0];
+}
+
+static mrbc_value call1(mrbc_value recv, const char *name, int a) {
+  mrbc_value args[] = {int_value(a)};
+  return call(recv, name, 1, args);
+}
+
+static mrbc_value call2(mrbc_value recv, const char *name, int a, int b) {
+  mrbc_value args[] = {int_value(a), int_value(b)};
+  return call(recv, name, 2, args);
+}
+
+void setUp(void) {
+  memset(fake_timers, 0, sizeof(fake_timers));
+  memset(fake_channels, 0, sizeof(fake_channels));
+  delays = 0;
+  clear_events();
+  raised = NULL;
+  drv_pwm_init();
+  if (n_methods == 0) api_pwm_define();
+}
+
+void tearDown(void) { drv_pwm_release_all(); }
+
+static void test_same_frequency_shares_timer(void) {
+  int a = drv_pwm_setup(1, 5000, 0);
+  int b = drv_pwm_setup(2, 5000, 0);
+  int c = drv_pwm_setup(3, 1000, 0);
+  TEST_ASSERT_TRUE(a >= 0 && b >= 0 && c >= 0);
+  TEST_ASSERT_EQUAL(fake_channels[a].timer, fake_channels[b].timer);
+  TEST_ASSERT_TRUE(fake_channels[a].timer != fake_channels[c].timer);
+  TEST_ASSERT_EQUAL(1, fake_timers[fake_channels[a].timer].configs);
+
+  // the highest resolution the 80 MHz clock allows
+  TEST_ASSERT_EQUAL(13, fake_timers[fake_channels[a].timer].bits);
+  TEST_ASSERT_EQUAL(8192, drv_pwm_get_max_duty(a));
+  TEST_ASSERT_EQUAL(65536, drv_pwm_get_max_duty(c));
+  TEST_ASSERT_EQUAL(1000, drv_pwm_get_freq(c));
+}
+
+static void test_set_freq_reconfigures_own_timer(void) {
+  int a = drv_pwm_setup(1, 5000, 4096);
+  int timer = fake_channels[a].timer;
+  TEST_ASSERT_EQUAL(kSuccess, drv_pwm_set_freq(a, 1000));
+  TEST_ASSERT_EQUAL(timer, fake_channels[a].timer);
+  TEST_ASSERT_EQUAL(2, fake_timers[timer].configs);
+  TEST_ASSERT_EQUAL(1000, fake_timers[timer].freq_hz);
+  // half on stays half on at the new resolution
+  TEST_ASSERT_EQUAL(32768, fake_channels[a].duty);
+}
+
+static void test_set_freq_moves_to_matching_timer(void) {
+  int a = drv_pwm_setup(1, 5000, 2048);
+  int b = drv_pwm_setup(2, 1000, 0);
+  int old = fake_channels[a].timer;
+  TEST_ASSERT_EQUAL(kSuccess, drv_pwm_set_freq(a, 1000));
+  TEST_ASSERT_EQUAL(fake_channels[b].timer, fake_channels[a].timer);
+  TEST_ASSERT_EQUAL(16384, fake_channels[a].duty);
+
+  // the 5 kHz timer was left free: a new frequency gets it first
+  int c = drv_pwm_setup(3, 2000, 0);
+  TEST_ASSERT_EQUAL(old, fake_channels[c].timer);
+}
+
+static void test_shared_timer_is_not_reconfigured(void) {
+  int a = drv_pwm_setup(1, 5000, 0);
+  int b = drv_pwm_setup(2, 5000, 0);
+  TEST_ASSERT_EQUAL(kSuccess, drv_pwm_set_freq(a, 1000));
+  TEST_ASSERT_TRUE(fake_channels[a].timer != fake_channels[b].timer);
+  TEST_ASSERT_EQUAL(5000, drv_pwm_get_freq(b));
+  TEST_ASSERT_EQUAL(1000, drv_pwm_get_freq(a));
+}
+
+static void test_out_of_timers(void) {
+  int ch[FAKE_TIMERS];
+  for (int i = 0; i < FAKE_TIMERS; i++) {
+    ch[i] = drv_pwm_setup(i, 1000 * (i + 1), 0);
+    TEST_ASSERT_TRUE(ch[i] >= 0);
+  }
+  TEST_ASSERT_EQUAL(-1, drv_pwm_setup(10, 7000, 0));
+  // a frequency already in use still fits
+  TEST_ASSERT_TRUE(drv_pwm_setup(10, 2000, 0) >= 0);
+
+  // the 2 kHz timer is shared now, so it cannot be reconfigured either
+  TEST_ASSERT_EQUAL(kFailure, drv_pwm_set_freq(ch[1], 7000));
+  TEST_ASSERT_EQUAL(2000, drv_pwm_get_freq(ch[1]));
+}
+
+static void test_duty_is_clamped(void) {
+  int a = drv_pwm_setup(1, 5000, 100000);
+  TEST_ASSERT_EQUAL(8192, fake_channels[a].duty);
+  TEST_ASSERT_EQUAL(kSuccess, drv_pwm_set_duty_raw(a, 9000));
+  TEST_ASSERT_EQUAL(8192, fake_channels[a].duty);
+  TEST_ASSERT_EQUAL(kSuccess, drv_pwm_set_duty(a, 25));
+  TEST_ASSERT_EQUAL(2048, fake_channels[a].duty);
+  TEST_ASSERT_EQUAL(kFailure, drv_pwm_set_duty(a, 101));
+}
+
+static void test_running_fade_refuses_changes_without_waiting(void) {
+  int a = drv_pwm_setup(1, 5000, 0);
+  TEST_ASSERT_EQUAL(kSuccess, drv_pwm_fade(a, 8192, 1000));
+  TEST_ASSERT_TRUE(fake_channels[a].fading);
+
+  TEST_ASSERT_EQUAL(kFailure, drv_pwm_set_duty_raw(a, 100));
+  TEST_ASSERT_EQUAL(kFailure, drv_pwm_set_duty(a, 50));
+  TEST_ASSERT_EQUAL(kFailure, drv_pwm_set_freq(a, 1000));
+  TEST_ASSERT_EQUAL(kFailure, drv_pwm_fade(a, 0, 1000));
+  TEST_ASSERT_EQUAL(kFailure, drv_pwm_disable(a));
+  TEST_ASSERT_EQUAL(0, delays);
+  TEST_ASSERT_TRUE(drv_pwm_in_use(a));
+  TEST_ASSERT_EQUAL(5000, drv_pwm_get_freq(a));
+
+  fake_fade_end(a);
+  TEST_ASSERT_EQUAL(kSuccess, drv_pwm_set_duty_raw(a, 100));
+  TEST_ASSERT_EQUAL(100, fake_channels[a].duty);
+  TEST_ASSERT_EQUAL(kSuccess, drv_pwm_disable(a));
+}
+
+static void test_release_all_waits_for_fades(void) {
+  int a = drv_pwm_setup(1, 5000, 0);
+  int b = drv_pwm_setup(2, 1000, 0);
+  TEST_ASSERT_EQUAL(kSuccess, drv_pwm_fade(a, 8192, 1000));
+  TEST_ASSERT_EQUAL(kSuccess, drv_pwm_release_all());
+  TEST_ASSERT_TRUE(delays > 0);
+  TEST_ASSERT_FALSE(drv_pwm_in_use(a));
+  TEST_ASSERT_FALSE(drv_pwm_in_use(b));
+  TEST_ASSERT_TRUE(fake_channels[a].stopped && fake_channels[b].stopped);
+
+  // every timer is free again
+  for (int i = 0; i < FAKE_TIMERS; i++) {
+    TEST_ASSERT_TRUE(drv_pwm_setup(i, 100 * (i + 1), 0) >= 0);
+  }
+}
+
+static void test_set_duties_latches_inside_critical_section(void) {
+  int ch[3] = {drv_pwm_setup(1, 5000, 0), drv_pwm_setup(2, 5000, 0),
+               drv_pwm_setup(3, 1000, 0)};
+  uint32_t duties[3] = {100, 200, 300};
+  clear_events();
+  TEST_ASSERT_EQUAL(kSuccess, drv_pwm_set_duties(ch, duties, 3));
+  // every write, then both timers paused around all three updates
+  TEST_ASSERT_EQUAL_STRING("SSS{PPUUURR}", events);
+  for (int i = 0; i < 3; i++) {
+    TEST_ASSERT_EQUAL(duties[i], fake_channels[ch[i]].duty);
+  }
+}
+
+static void test_set_duties_invalid_entry_changes_nothing(void) {
+  int ch[3] = {drv_pwm_setup(1, 5000, 10), drv_pwm_setup(2, 5000, 20), 7};
+  uint32_t duties[3] = {100, 200, 300};
+  clear_events();
+  TEST_ASSERT_EQUAL(kFailure, drv_pwm_set_duties(ch, duties, 3));
+  TEST_ASSERT_EQUAL(0, event_count);
+  TEST_ASSERT_EQUAL(10, fake_channels[ch[0]].duty);
+  TEST_ASSERT_EQUAL(20, fake_channels[ch[1]].duty);
+
+  TEST_ASSERT_EQUAL(kFailure, drv_pwm_set_duties(ch, duties, 0));
+  TEST_ASSERT_EQUAL(0, event_count);
+}
+
+static void test_set_duties_refuses_running_fade(void) {
+  int ch[2] = {drv_pwm_setup(1, 5000, 10), drv_pwm_setup(2, 5000, 20)};
+  uint32_t duties[2] = {100, 200};
+  TEST_ASSERT_EQUAL(kSuccess, drv_pwm_fade(ch[1], 8192, 1000));
+  clear_events();
+  TEST_ASSERT_EQUAL(kFailure, drv_pwm_set_duties(ch, duties, 2));
+  TEST_ASSERT_EQUAL(0, event_count);
+  TEST_ASSERT_EQUAL(10, fake_channels[ch[0]].duty);
+  TEST_ASSERT_EQUAL(0, delays);
+}
+
+static void test_set_duties_clamps_per_channel(void) {
+  int ch[2] = {drv_pwm_setup(1, 5000, 0), drv_pwm_setup(2, 1000, 0)};
+  uint32_t duties[2] = {100000, 100000};
+  TEST_ASSERT_EQUAL(kSuccess, drv_pwm_set_duties(ch, duties, 2));
+  TEST_ASSERT_EQUAL(8192, fake_channels[ch[0]].duty);
+  TEST_ASSERT_EQUAL(65536, fake_channels[ch[1]].duty);
+}
+
+static void test_instance_and_class_calls(void) {
+  mrbc_value cls = class_value(&pwm_cls);
+  mrbc_value obj = call2(cls, "new", 15, 50);
+  TEST_ASSERT_EQUAL(MRBC_TT_OBJECT, obj.tt);
+  int handle = call(obj, "channel", 0, NULL).i;
+  TEST_ASSERT_TRUE(handle >= LEDC_MAX_CHANNELS);
+  fake_channel_t *c = &fake_channels[handle % LEDC_MAX_CHANNELS];
+  TEST_ASSERT_EQUAL(4096, c->duty);
+
+  TEST_ASSERT_EQUAL(MRBC_TT_TRUE, call1(obj, "set_duty", 75).tt);
+  TEST_ASSERT_EQUAL(6144, c->duty);
+  TEST_ASSERT_EQUAL(MRBC_TT_TRUE, call2(cls, "set_duty", handle, 25).tt);
+  TEST_ASSERT_EQUAL(2048, c->duty);
+  TEST_ASSERT_EQUAL(8192, call(obj, "max_duty", 0, NULL).i);
+  TEST_ASSERT_EQUAL(8192, call1(cls, "max_duty", handle).i);
+
+  // set_duties takes instances and handles alike
+  int other = call2(cls, "setup", 16, 0).i;
+  mrbc_value pwms[] = {obj, int_value(other)};
+  int duties[] = {100, 200};
+  mrbc_value list = pairs(2, pwms, duties);
+  TEST_ASSERT_EQUAL(MRBC_TT_TRUE, call(cls, "set_duties", 1, &list).tt);
+  TEST_ASSERT_EQUAL(100, c->duty);
+  TEST_ASSERT_EQUAL(200, fake_channels[other % LEDC_MAX_CHANNELS].duty);
+  free_pairs(&list);
+  free(obj.instance);
+}
+
+static void test_stale_handle_rejected_after_setup_again(void) {
+  mrbc_value cls = class_value(&pwm_cls);
+  int old = call2(cls, "setup", 15, 0).i;
+  TEST_ASSERT_EQUAL(MRBC_TT_TRUE, call1(cls, "disable", old).tt);
+  int handle = call2(cls, "setup", 16, 0).i;
+  TEST_ASSERT_EQUAL(old % LEDC_MAX_CHANNELS, handle % LEDC_MAX_CHANNELS);
+  TEST_ASSERT_TRUE(handle != old);
+
+  TEST_ASSERT_EQUAL(MRBC_TT_FALSE, call2(cls, "set_duty", old, 50).tt);
+  TEST_ASSERT_EQUAL(MRBC_TT_FALSE, call1(cls, "disable", old).tt);
+  // a plain channel number carries no generation either
+  TEST_ASSERT_EQUAL(MRBC_TT_FALSE,
+                    call2(cls, "set_duty", handle % LEDC_MAX_CHANNELS, 50).tt);
+  TEST_ASSERT_EQUAL(0, fake_channels[handle % LEDC_MAX_CHANNELS].duty);
+
+  TEST_ASSERT_EQUAL(MRBC_TT_TRUE, call2(cls, "set_duty", handle, 50).tt);
+  TEST_ASSERT_EQUAL(4096, fake_channels[handle % LEDC_MAX_CHANNELS].duty);
+}
+
+static void test_disabled_instance_rejected(void) {
+  mrbc_value cls = class_value(&pwm_cls);
+  mrbc_value obj = call2(cls, "new", 15, 0);
+  TEST_ASSERT_EQUAL(MRBC_TT_TRUE, call(obj, "disable", 0, NULL).tt);
+  TEST_ASSERT_EQUAL(MRBC_TT_FALSE, call1(obj, "set_duty", 10).tt);
+  TEST_ASSERT_EQUAL(MRBC_TT_FALSE, call(obj, "disable", 0, NULL).tt);
+  TEST_ASSERT_EQUAL(-1, call(obj, "channel", 0, NULL).i);
+
+  // nor does it reach the next user of the channel
+  mrbc_value next = call2(cls, "new", 16, 0);
+  TEST_ASSERT_EQUAL(MRBC_TT_FALSE, call1(obj, "set_duty", 10).tt);
+  TEST_ASSERT_EQUAL(MRBC_TT_TRUE, call1(next, "set_duty", 10).tt);
+  free(obj.instance);
+  free(next.instance);
+}
+
+static void test_unknown_and_foreign_values_rejected(void) {
+  mrbc_value cls = class_value(&pwm_cls);
+  int handle = call2(cls, "setup", 15, 0).i;
+  TEST_ASSERT_EQUAL(MRBC_TT_FALSE, call2(cls, "set_duty", 999, 10).tt);
+  TEST_ASSERT_EQUAL(MRBC_TT_FALSE, call2(cls, "set_duty", -1, 10).tt);
+  TEST_ASSERT_EQUAL(0, call1(cls, "max_duty", 999).i);
+
+  // an object of another class is not a PWM, whatever its data holds
+  mrbc_value foreign = mrbc_instance_new(&vm, &other_cls, sizeof(int));
+  *(int *)foreign.instance->data = handle;
+  int duties[] = {100};
+  mrbc_value list = pairs(1, &foreign, duties);
+  TEST_ASSERT_EQUAL(MRBC_TT_FALSE, call(cls, "set_duties", 1, &list).tt);
+  TEST_ASSERT_EQUAL(0, fake_channels[handle % LEDC_MAX_CHANNELS].duty);
+  free_pairs(&list);
+  free(foreign.instance);
+}
+
+static void test_bad_new_raises(void) {
+  mrbc_value cls = class_value(&pwm_cls);
+  call2(cls, "new", -1, 0);
+  TEST_ASSERT_EQUAL_PTR(MRBC_CLASS(ArgumentError), raised);
+  raised = NULL;
+  call2(cls, "new", 15, 101);
+  TEST_ASSERT_EQUAL_PTR(MRBC_CLASS(ArgumentError), raised);
+
+  mrbc_value objs[LEDC_MAX_CHANNELS];
+  for (int i = 0; i < LEDC_MAX_CHANNELS; i++) {
+    objs[i] = call2(cls, "new", i, 0);
+    TEST_ASSERT_EQUAL(MRBC_TT_OBJECT, objs[i].tt);
+  }
+  raised = NULL;
+  call2(cls, "new", 20, 0);
+  TEST_ASSERT_EQUAL_PTR(MRBC_CLASS(RuntimeError), raised);
+  for (int i = 0; i < LEDC_MAX_CHANNELS; i++) free(objs[i].instance);
+}
+
+static void test_release_all_frees_script_channels(void) {
+  mrbc_value cls = class_value(&pwm_cls);
+  int handles[FAKE_TIMERS];
+  for (int i = 0; i < FAKE_TIMERS; i++) {
+    mrbc_value args[] = {int_value(i), int_value(0), int_value(1000 * (i + 1))};
+    handles[i] = call(cls, "setup", 3, args).i;
+    TEST_ASSERT_TRUE(handles[i] >= LEDC_MAX_CHANNELS);
+  }
+  drv_pwm_release_all();  // what main.c does after the VM ends
+  for (int i = 0; i < FAKE_TIMERS; i++) {
+    TEST_ASSERT_EQUAL(MRBC_TT_FALSE, call2(cls, "set_duty", handles[i], 1).tt);
+    mrbc_value args[] = {int_value(i), int_value(0), int_value(300 * (i + 1))};
+    TEST_ASSERT_TRUE(call(cls, "setup", 3, args).i >= LEDC_MAX_CHANNELS);
+  }
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_same_frequency_shares_timer);
+  RUN_TEST(test_set_freq_reconfigures_own_timer);
+  RUN_TEST(test_set_freq_moves_to_matching_timer);
+  RUN_TEST(test_shared_timer_is_not_reconfigured);
+  RUN_TEST(test_out_of_timers);
+  RUN_TEST(test_duty_is_clamped);
+  RUN_TEST(test_running_fade_refuses_changes_without_waiting);
+  RUN_TEST(test_release_all_waits_for_fades);
+  RUN_TEST(test_set_duties_latches_inside_critical_section);
+  RUN_TEST(test_set_duties_invalid_entry_changes_nothing);
+  RUN_TEST(test_set_duties_refuses_running_fade);
+  RUN_TEST(test_set_duties_clamps_per_channel);
+  RUN_TEST(test_instance_and_class_calls);
+  RUN_TEST(test_stale_handle_rejected_after_setup_again);
+  RUN_TEST(test_disabled_instance_rejected);
+  RUN_TEST(test_unknown_and_foreign_values_rejected);
+  RUN_TEST(test_bad_new_raises);
+  RUN_TEST(test_release_all_frees_script_channels);
+  return UNITY_END();
+}
@@ -0,0 +1,181 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file test_main.c
+ * @brief RGB565 kernel tests
+ *
+ * Checks the kernels against a per-channel reference written directly from
+ * the formulas in rgb565.h, at every alignment of the source and
+ * destination buffers, and prints the throughput of each kernel. The
+ * Canvas.clear fast path is checked against a per-pixel clear.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unity.h>
+
+#include "lib/pixel/rgb565.h"
+
+#define TEST_PIXELS 67  // odd, so the paired paths leave a tail
+#define BENCH_PIXELS (320 * 240)
+#define BENCH_ROUNDS 50
+
+static uint16_t swap16(uint16_t v) { return (uint16_t)((v >> 8) | (v << 8)); }
+
+static uint16_t ref_blend(uint16_t d, uint16_t s, uint8_t alpha) {
+  uint32_t a = (alpha + 4) >> 3;
+  if (a > 32) a = 32;
+  d = swap16(d);
+  s = swap16(s);
+  uint32_t r = ((d >> 11) * (32 - a) + (s >> 11) * a) >> 5;
+  uint32_t g = (((d >> 5) & 0x3F) * (32 - a) + ((s >> 5) & 0x3F) * a) >> 5;
+  uint32_t b = ((d & 0x1F) * (32 - a) + (s & 0x1F) * a) >> 5;
+  return swap16((uint16_t)((r << 11) | (g << 5) | b));
+}
+
+static uint16_t ref_rgb888(const uint8_t *p) {
+  return swap16(
+      (uint16_t)(((p[0] >> 3) << 11) | ((p[1] >> 2) << 5) | (p[2] >> 3)));
+}
+
+static void random_fill(void *buf, size_t bytes) {
+  uint8_t *p = buf;
+  for (size_t i = 0; i < bytes; i++) p[i] = (uint8_t)rand();
+}
+
+static double now_s(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void setUp(void) { srand(1); }
+
+void tearDown(void) {}
+
+static void test_fill(void) {
+  uint16_t buf[TEST_PIXELS + 2], want[TEST_PIXELS + 2];
+  for (int off = 0; off < 2; off++) {
+    for (size_t n = 0; n <= TEST_PIXELS; n++) {
+      random_fill(buf, sizeof(buf));
+      memcpy(want, buf, sizeof(buf));
+      uint16_t color = (uint16_t)rand();
+      for (size_t i = 0; i < n; i++) want[off + i] = swap16(color);
+      rgb565_fill(buf + off, color, n);
+      TEST_ASSERT_EQUAL_HEX16_ARRAY(want, buf, TEST_PIXELS + 2);
+    }
+  }
+}
+
+// Stands in for the color conversion of clearDisplay(): RGB888 to the
+// display-order pixel of a 16-bit sprite
+static uint16_t ref_convert(uint32_t color) {
+  uint8_t rgb[3] = {(uint8_t)(color >> 16), (uint8_t)(color >> 8),
+                    (uint8_t)color};
+  return ref_rgb888(rgb);
+}
+
+static void test_clear_fast_path_matches_fallback(void) {
+  static const uint32_t colors[] = {0x000000, 0xFF0000, 0x00FF00, 0x0000FF,
+                                    0xFFFFFF, 0x123456, 0x00FFFF};
+  uint16_t fast[TEST_PIXELS + 2], slow[TEST_PIXELS + 2];
+  for (size_t c = 0; c < sizeof(colors) / sizeof(colors[0]); c++) {
+    for (int off = 0; off < 2; off++) {
+      for (size_t n = 1; n <= TEST_PIXELS; n++) {
+        random_fill(fast, sizeof(fast));
+        memcpy(slow, fast, sizeof(fast));
+        // fallback: clearDisplay() converts and writes every pixel
+        for (size_t i = 0; i < n; i++) slow[off + i] = ref_convert(colors[c]);
+        // fast path: clearDisplay() clipped to the first pixel, then copied
+        fast[off] = ref_convert(colors[c]);
+        rgb565_fill_from_first(fast + off, n);
+        TEST_ASSERT_EQUAL_HEX16_ARRAY(slow, fast, TEST_PIXELS + 2);
+      }
+    }
+  }
+}
+
+static void test_blend(void) {
+  uint16_t dst[TEST_PIXELS + 2], src[TEST_PIXELS + 2], want[TEST_PIXELS + 2];
+  for (int alpha = 0; alpha < 256; alpha++) {
+    for (int off = 0; off < 4; off++) {
+      int doff = off & 1, soff = off >> 1;
+      random_fill(dst, sizeof(dst));
+      random_fill(src, sizeof(src));
+      memcpy(want, dst, sizeof(dst));
+      for (size_t i = 0; i < TEST_PIXELS; i++) {
+        want[doff + i] = ref_blend(dst[doff + i], src[soff + i], alpha);
+      }
+      rgb565_blend(dst + doff, src + soff, alpha, TEST_PIXELS);
+      TEST_ASSERT_EQUAL_HEX16_ARRAY(want, dst, TEST_PIXELS + 2);
+    }
+  }
+}
+
+static void test_from_rgb888(void) {
+  uint16_t buf[TEST_PIXELS + 2], want[TEST_PIXELS + 2];
+  uint8_t rgb[TEST_PIXELS * 3];
+  for (int off = 0; off < 2; off++) {
+    random_fill(buf, sizeof(buf));
+    random_fill(rgb, sizeof(rgb));
+    memcpy(want, buf, sizeof(buf));
+    for (size_t i = 0; i < TEST_PIXELS; i++) {
+      want[off + i] = ref_rgb888(rgb + i * 3);
+    }
+    rgb565_from_rgb888(buf + off, rgb, TEST_PIXELS);
+    TEST_ASSERT_EQUAL_HEX16_ARRAY(want, buf, TEST_PIXELS + 2);
+  }
+}
+
+static void test_bench(void) {
+  uint16_t *dst = malloc(BENCH_PIXELS * 2);
+  uint16_t *src = malloc(BENCH_PIXELS * 2);
+  uint8_t *rgb = malloc(BENCH_PIXELS * 3);
+  TEST_ASSERT_NOT_NULL(dst);
+  TEST_ASSERT_NOT_NULL(src);
+  TEST_ASSERT_NOT_NULL(rgb);
+  random_fill(src, BENCH_PIXELS * 2);
+  random_fill(rgb, BENCH_PIXELS * 3);
+
+  char msg[96];
+  double t = now_s();
+  for (int i = 0; i < BENCH_ROUNDS; i++) {
+    rgb565_fill(dst, (uint16_t)i, BENCH_PIXELS);
+  }
+  snprintf(msg, sizeof(msg), "fill 320x240: %.1f us",
+           (now_s() - t) * 1e6 / BENCH_ROUNDS);
+  TEST_MESSAGE(msg);
+
+  t = now_s();
+  for (int i = 0; i < BENCH_ROUNDS; i++) {
+    rgb565_blend(dst, src, 128, BENCH_PIXELS);
+  }
+  snprintf(msg, sizeof(msg), "blend 320x240: %.1f us",
+           (now_s() - t) * 1e6 / BENCH_ROUNDS);
+  TEST_MESSAGE(msg);
+
+  t = now_s();
+  for (int i = 0; i < BENCH_ROUNDS; i++) {
+    rgb565_from_rgb888(dst, rgb, BENCH_PIXELS);
+  }
+  snprintf(msg, sizeof(msg), "from_rgb888 320x240: %.1f us",
+           (now_s() - t) * 1e6 / BENCH_ROUNDS);
+  TEST_MESSAGE(msg);
+
+  free(dst);
+  free(src);
+  free(rgb);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_fill);
+  RUN_TEST(test_clear_fast_path_matches_fallback);
+  RUN_TEST(test_blend);
+  RUN_TEST(test_from_rgb888);
+  RUN_TEST(test_bench);
+  return UNITY_END();
+}
@@ -0,0 +1,141 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * SPDX-FileCopyrightText: Copyright (c) 2025 ViXion Inc. All Rights Reserved.
+ */
+/**
+ * @file test_main.c
+ * @brief SPSC ring tests and line-reading throughput
+ *
+ * Checks spsc_ring_read_until() across the wrap point and measures it
+ * against the one-byte-at-a-time loop drv_uart_read_until used before.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unity.h>
+
+#include "lib/ring/spsc_ring.h"
+
+#define RING_SIZE 4096
+#define BENCH_BYTES (20u * 1000 * 1000)
+
+static uint8_t storage[RING_SIZE];
+static spsc_ring_t ring;
+
+static double now_s(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// the previous drv_uart_read_until loop
+static size_t read_until_bytewise(spsc_ring_t *r, uint8_t *dst, size_t len,
+                                  uint8_t delimiter, bool *found) {
+  size_t n = 0;
+  *found = false;
+  while (n < len && spsc_ring_read(r, &dst[n], 1) == 1) {
+    if (dst[n++] == delimiter) {
+      *found = true;
+      break;
+    }
+  }
+  return n;
+}
+
+void setUp(void) { spsc_ring_init(&ring, storage, sizeof(storage)); }
+
+void tearDown(void) {}
+
+static void test_read_until_stops_after_delimiter(void) {
+  uint8_t out[16];
+  bool found;
+  spsc_ring_write(&ring, "ab\ncd", 5);
+  TEST_ASSERT_EQUAL(3, spsc_ring_read_until(&ring, out, sizeof(out), '\n',
+                                            &found));
+  TEST_ASSERT_TRUE(found);
+  TEST_ASSERT_EQUAL_MEMORY("ab\n", out, 3);
+  TEST_ASSERT_EQUAL(2, spsc_ring_count(&ring));
+
+  TEST_ASSERT_EQUAL(2, spsc_ring_read_until(&ring, out, sizeof(out), '\n',
+                                            &found));
+  TEST_ASSERT_FALSE(found);
+  TEST_ASSERT_EQUAL(0, spsc_ring_count(&ring));
+}
+
+static void test_read_until_limit(void) {
+  uint8_t out[4];
+  bool found;
+  spsc_ring_write(&ring, "abcdef\n", 7);
+  TEST_ASSERT_EQUAL(4, spsc_ring_read_until(&ring, out, sizeof(out), '\n',
+                                            &found));
+  TEST_ASSERT_FALSE(found);
+  TEST_ASSERT_EQUAL(3, spsc_ring_read_until(&ring, out, sizeof(out), '\n',
+                                            &found));
+  TEST_ASSERT_TRUE(found);
+  TEST_ASSERT_EQUAL_MEMORY("ef\n", out, 3);
+}
+
+static void test_read_until_across_wrap(void) {
+  uint8_t line[100], out[100];
+  bool found;
+  for (int i = 0; i < 99; i++) line[i] = 'a' + i % 26;
+  line[99] = '\n';
+  // every line start position modulo the ring size, so lines straddle it
+  for (int i = 0; i < RING_SIZE; i++) {
+    TEST_ASSERT_EQUAL(100, spsc_ring_write(&ring, line, 100));
+    memset(out, 0, sizeof(out));
+    TEST_ASSERT_EQUAL(100, spsc_ring_read_until(&ring, out, sizeof(out), '\n',
+                                                &found));
+    TEST_ASSERT_TRUE(found);
+    TEST_ASSERT_EQUAL_MEMORY(line, out, 100);
+    spsc_ring_write(&ring, "x", 1);  // move the next start by one byte
+    spsc_ring_read(&ring, out, 1);
+  }
+}
+
+static void test_throughput(void) {
+  static const int lengths[] = {8, 32, 128, 512, 1500};
+  uint8_t line[1500], out[2048];
+  for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+    int len = lengths[l];
+    memset(line, 'a', len - 1);
+    line[len - 1] = '\n';
+    double mbps[2];
+    for (int scan = 0; scan < 2; scan++) {
+      spsc_ring_init(&ring, storage, sizeof(storage));
+      size_t total = 0, bad = 0;
+      double t = now_s();
+      while (total < BENCH_BYTES) {
+        while (spsc_ring_space(&ring) >= (size_t)len) {
+          spsc_ring_write(&ring, line, len);
+        }
+        bool found = true;
+        while (found) {
+          size_t n = scan ? spsc_ring_read_until(&ring, out, sizeof(out), '\n',
+                                                 &found)
+                          : read_until_bytewise(&ring, out, sizeof(out), '\n',
+                                                &found);
+          if (!found) break;
+          if (n != (size_t)len || memcmp(out, line, len) != 0) bad++;
+          total += n;
+        }
+      }
+      mbps[scan] = total / (now_s() - t) / 1e6;
+      TEST_ASSERT_EQUAL(0, bad);
+    }
+    char msg[80];
+    snprintf(msg, sizeof(msg),
+             "line %4d: bytewise %7.1f MB/s, memchr %7.1f MB/s", len, mbps[0],
+             mbps[1]);
+    TEST_MESSAGE(msg);
+  }
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_read_until_stops_after_delimiter);
+  RUN_TEST(test_read_until_limit);
+  RUN_TEST(test_read_until_across_wrap);
+  RUN_TEST(test_throughput);
+  return UNITY_END();
+}